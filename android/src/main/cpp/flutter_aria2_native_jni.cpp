@@ -3,11 +3,14 @@
 #include <aria2_c_api.h>
 #include "common/aria2_core.h"
 #include "common/aria2_helpers.h"
+#include "common/aria2_methods.h"
+#include "common/aria2_value.h"
 
 #include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <mutex>
 #include <sstream>
 #include <string>
@@ -86,6 +89,12 @@ jobject NewBoolean(JNIEnv* env, bool value) {
   return env->NewObject(cls, ctor, static_cast<jboolean>(value));
 }
 
+jobject NewDouble(JNIEnv* env, double value) {
+  jclass cls = env->FindClass("java/lang/Double");
+  jmethodID ctor = env->GetMethodID(cls, "<init>", "(D)V");
+  return env->NewObject(cls, ctor, static_cast<jdouble>(value));
+}
+
 jobject NewString(JNIEnv* env, const std::string& value) {
   return env->NewStringUTF(value.c_str());
 }
@@ -162,30 +171,131 @@ jobject MapGetMap(JNIEnv* env, jobject map, const char* key) {
   return value;
 }
 
-jobject MapGetList(JNIEnv* env, jobject map, const char* key) {
-  jobject value = MapGet(env, map, key);
-  if (!IsInstanceOf(env, value, "java/util/List")) return nullptr;
-  return value;
+jobject ValueToJava(JNIEnv* env, const flutter_aria2::common::Value& value) {
+  using Type = flutter_aria2::common::Value::Type;
+  switch (value.type()) {
+    case Type::kNull:
+      return nullptr;
+    case Type::kBool:
+      return NewBoolean(env, value.AsBool());
+    case Type::kInt: {
+      int64_t v = value.AsInt();
+      if (v >= INT32_MIN && v <= INT32_MAX) {
+        return NewInteger(env, static_cast<int>(v));
+      }
+      return NewLong(env, v);
+    }
+    case Type::kDouble:
+      return NewDouble(env, value.AsDouble());
+    case Type::kString:
+      return NewString(env, value.AsString());
+    case Type::kBytes: {
+      const auto& bytes = value.AsBytes();
+      jbyteArray array = env->NewByteArray(static_cast<jsize>(bytes.size()));
+      if (!bytes.empty()) {
+        env->SetByteArrayRegion(array, 0, static_cast<jsize>(bytes.size()),
+                                reinterpret_cast<const jbyte*>(bytes.data()));
+      }
+      return array;
+    }
+    case Type::kList: {
+      jobject list = NewArrayList(env);
+      for (const auto& item : value.AsList()) {
+        jobject v = ValueToJava(env, item);
+        ArrayListAdd(env, list, v);
+        if (v != nullptr) env->DeleteLocalRef(v);
+      }
+      return list;
+    }
+    case Type::kMap: {
+      jobject map = NewHashMap(env);
+      for (const auto& entry : value.AsMap()) {
+        jobject k = NewString(env, entry.first);
+        jobject v = ValueToJava(env, entry.second);
+        HashMapPut(env, map, k, v);
+        env->DeleteLocalRef(k);
+        if (v != nullptr) env->DeleteLocalRef(v);
+      }
+      return map;
+    }
+  }
+  return nullptr;
 }
 
-std::vector<std::string> JavaListToStringVector(JNIEnv* env, jobject list) {
-  std::vector<std::string> out;
-  if (!IsInstanceOf(env, list, "java/util/List")) return out;
-  jclass list_cls = env->FindClass("java/util/List");
-  jmethodID size_id = env->GetMethodID(list_cls, "size", "()I");
-  jmethodID get_id = env->GetMethodID(
-      list_cls, "get", "(I)Ljava/lang/Object;");
-
-  int size = env->CallIntMethod(list, size_id);
-  out.reserve(static_cast<size_t>(size));
-  for (int i = 0; i < size; ++i) {
-    jobject item = env->CallObjectMethod(list, get_id, i);
-    if (IsInstanceOf(env, item, "java/lang/String")) {
-      out.push_back(JStringToStdString(env, static_cast<jstring>(item)));
+flutter_aria2::common::Value JavaToValue(JNIEnv* env, jobject obj) {
+  using flutter_aria2::common::Value;
+  if (obj == nullptr) return Value();
+  if (IsInstanceOf(env, obj, "java/lang/Boolean")) {
+    jclass cls = env->FindClass("java/lang/Boolean");
+    jmethodID bool_value = env->GetMethodID(cls, "booleanValue", "()Z");
+    return Value(env->CallBooleanMethod(obj, bool_value) == JNI_TRUE);
+  }
+  if (IsInstanceOf(env, obj, "java/lang/Integer") ||
+      IsInstanceOf(env, obj, "java/lang/Long")) {
+    jclass cls = env->FindClass("java/lang/Number");
+    jmethodID long_value = env->GetMethodID(cls, "longValue", "()J");
+    return Value(static_cast<int64_t>(env->CallLongMethod(obj, long_value)));
+  }
+  if (IsInstanceOf(env, obj, "java/lang/Number")) {
+    jclass cls = env->FindClass("java/lang/Number");
+    jmethodID double_value = env->GetMethodID(cls, "doubleValue", "()D");
+    return Value(static_cast<double>(env->CallDoubleMethod(obj, double_value)));
+  }
+  if (IsInstanceOf(env, obj, "java/lang/String")) {
+    return Value(JStringToStdString(env, static_cast<jstring>(obj)));
+  }
+  if (IsInstanceOf(env, obj, "[B")) {
+    auto array = static_cast<jbyteArray>(obj);
+    Value::Bytes bytes(static_cast<size_t>(env->GetArrayLength(array)));
+    if (!bytes.empty()) {
+      env->GetByteArrayRegion(array, 0, static_cast<jsize>(bytes.size()),
+                              reinterpret_cast<jbyte*>(bytes.data()));
+    }
+    return Value(std::move(bytes));
+  }
+  if (IsInstanceOf(env, obj, "java/util/List")) {
+    jclass list_cls = env->FindClass("java/util/List");
+    jmethodID size_id = env->GetMethodID(list_cls, "size", "()I");
+    jmethodID get_id = env->GetMethodID(
+        list_cls, "get", "(I)Ljava/lang/Object;");
+    Value out = Value::NewList();
+    int size = env->CallIntMethod(obj, size_id);
+    for (int i = 0; i < size; ++i) {
+      ScopedLocalRef item(env, env->CallObjectMethod(obj, get_id, i));
+      out.Append(JavaToValue(env, item.get()));
+    }
+    return out;
+  }
+  if (IsInstanceOf(env, obj, "java/util/Map")) {
+    jclass map_cls = env->FindClass("java/util/Map");
+    jmethodID entry_set = env->GetMethodID(
+        map_cls, "entrySet", "()Ljava/util/Set;");
+    ScopedLocalRef set_obj(env, env->CallObjectMethod(obj, entry_set));
+    jclass set_cls = env->FindClass("java/util/Set");
+    jmethodID iterator = env->GetMethodID(
+        set_cls, "iterator", "()Ljava/util/Iterator;");
+    ScopedLocalRef it(env, env->CallObjectMethod(set_obj.get(), iterator));
+    jclass it_cls = env->FindClass("java/util/Iterator");
+    jmethodID has_next = env->GetMethodID(it_cls, "hasNext", "()Z");
+    jmethodID next = env->GetMethodID(it_cls, "next", "()Ljava/lang/Object;");
+    jclass entry_cls = env->FindClass("java/util/Map$Entry");
+    jmethodID get_key = env->GetMethodID(entry_cls, "getKey",
+                                         "()Ljava/lang/Object;");
+    jmethodID get_value = env->GetMethodID(entry_cls, "getValue",
+                                           "()Ljava/lang/Object;");
+    Value out = Value::NewMap();
+    while (env->CallBooleanMethod(it.get(), has_next) == JNI_TRUE) {
+      ScopedLocalRef entry(env, env->CallObjectMethod(it.get(), next));
+      ScopedLocalRef key(env, env->CallObjectMethod(entry.get(), get_key));
+      ScopedLocalRef value(env, env->CallObjectMethod(entry.get(), get_value));
+      if (IsInstanceOf(env, key.get(), "java/lang/String")) {
+        out.Set(JStringToStdString(env, static_cast<jstring>(key.get())),
+                JavaToValue(env, value.get()));
+      }
     }
-    env->DeleteLocalRef(item);
+    return out;
   }
-  return out;
+  return Value();
 }
 
 struct KeyValHelper {
@@ -301,7 +411,9 @@ void ThrowAria2Error(JNIEnv* env, const std::string& code,
     } \
   } while (0)
 
-void EmitDownloadEvent(aria2_download_event_t event, const std::string& gid) {
+void EmitNativeEvent(const char* method,
+                     flutter_aria2::common::Value&& payload,
+                     void* /*user_data*/) {
   if (g_vm == nullptr) return;
   JNIEnv* env = nullptr;
   bool did_attach = false;
@@ -321,12 +433,15 @@ void EmitDownloadEvent(aria2_download_event_t event, const std::string& gid) {
   }
   if (sink_local != nullptr) {
     jclass sink_cls = env->GetObjectClass(sink_local);
-    jmethodID method = env->GetMethodID(
-        sink_cls, "onDownloadEventFromNative", "(ILjava/lang/String;)V");
-    if (method != nullptr) {
-      jstring jgid = env->NewStringUTF(gid.c_str());
-      env->CallVoidMethod(sink_local, method, static_cast<jint>(event), jgid);
-      env->DeleteLocalRef(jgid);
+    jmethodID sink_method = env->GetMethodID(
+        sink_cls, "onNativeEventFromNative",
+        "(Ljava/lang/String;Ljava/lang/Object;)V");
+    if (sink_method != nullptr) {
+      jstring jmethod = env->NewStringUTF(method);
+      jobject jpayload = ValueToJava(env, payload);
+      env->CallVoidMethod(sink_local, sink_method, jmethod, jpayload);
+      env->DeleteLocalRef(jmethod);
+      if (jpayload != nullptr) env->DeleteLocalRef(jpayload);
     }
     env->DeleteLocalRef(sink_local);
   }
@@ -336,14 +451,6 @@ void EmitDownloadEvent(aria2_download_event_t event, const std::string& gid) {
   }
 }
 
-int DownloadEventCallback(aria2_session_t* /*session*/,
-                          aria2_download_event_t event,
-                          aria2_gid_t gid,
-                          void* /*user_data*/) {
-  EmitDownloadEvent(event, flutter_aria2::common::GidToHex(gid));
-  return 0;
-}
-
 jobject FileDataToJavaMap(JNIEnv* env, const aria2_file_data_t& file) {
   jobject file_map = NewHashMap(env);
   {
@@ -428,8 +535,7 @@ jobject InvokeNative(JNIEnv* env, Aria2State* state, const std::string& method,
     bool keep_running = MapGetBool(env, args, "keepRunning", true);
 
     const char* error = flutter_aria2::core::SessionNew(
-        state, options.data(), options.count(), keep_running,
-        &DownloadEventCallback, state);
+        state, options.data(), options.count(), keep_running);
     if (error != nullptr) {
       ThrowAria2Error(env, "SESSION_FAILED", "aria2_session_new returned null");
       return nullptr;
@@ -468,91 +574,6 @@ jobject InvokeNative(JNIEnv* env, Aria2State* state, const std::string& method,
     return NewInteger(env, ret);
   }
 
-  if (method == "addUri") {
-    REQUIRE_SESSION();
-    jobject uris_list = MapGetList(env, args, "uris");
-    if (uris_list == nullptr) {
-      ThrowAria2Error(env, "BAD_ARGS", "Missing 'uris'");
-      return nullptr;
-    }
-    auto uris = JavaListToStringVector(env, uris_list);
-    std::vector<const char*> uri_ptrs;
-    uri_ptrs.reserve(uris.size());
-    for (const auto& uri : uris) {
-      uri_ptrs.push_back(uri.c_str());
-    }
-    auto options = OptionsFromArgs(env, args, "options");
-    int position = MapGetInt(env, args, "position", -1);
-    aria2_gid_t gid;
-    int ret = aria2_add_uri(state->session, &gid, uri_ptrs.data(), uri_ptrs.size(),
-                            options.data(), options.count(), position);
-    if (ret != 0) {
-      ThrowAria2Error(env, "ARIA2_ERROR",
-                      "aria2_add_uri failed with code " + std::to_string(ret));
-      return nullptr;
-    }
-    return NewString(env, flutter_aria2::common::GidToHex(gid));
-  }
-
-  if (method == "addTorrent") {
-    REQUIRE_SESSION();
-    std::string torrent_file = MapGetString(env, args, "torrentFile");
-    jobject ws_list = MapGetList(env, args, "webseedUris");
-    auto webseeds = JavaListToStringVector(env, ws_list);
-    std::vector<const char*> ws_ptrs;
-    ws_ptrs.reserve(webseeds.size());
-    for (const auto& s : webseeds) {
-      ws_ptrs.push_back(s.c_str());
-    }
-
-    auto options = OptionsFromArgs(env, args, "options");
-    int position = MapGetInt(env, args, "position", -1);
-    aria2_gid_t gid;
-    int ret = 0;
-    if (ws_ptrs.empty()) {
-      ret = aria2_add_torrent_simple(state->session, &gid, torrent_file.c_str(),
-                                     options.data(), options.count(), position);
-    } else {
-      ret = aria2_add_torrent(state->session, &gid, torrent_file.c_str(),
-                              ws_ptrs.data(), ws_ptrs.size(), options.data(),
-                              options.count(), position);
-    }
-    if (ret != 0) {
-      ThrowAria2Error(env, "ARIA2_ERROR",
-                      "aria2_add_torrent failed with code " + std::to_string(ret));
-      return nullptr;
-    }
-    return NewString(env, flutter_aria2::common::GidToHex(gid));
-  }
-
-  if (method == "addMetalink") {
-    REQUIRE_SESSION();
-    std::string metalink_file = MapGetString(env, args, "metalinkFile");
-    auto options = OptionsFromArgs(env, args, "options");
-    int position = MapGetInt(env, args, "position", -1);
-    aria2_gid_t* gids = nullptr;
-    size_t gids_count = 0;
-    int ret = aria2_add_metalink(state->session, &gids, &gids_count,
-                                 metalink_file.c_str(), options.data(),
-                                 options.count(), position);
-    if (ret != 0) {
-      if (gids != nullptr) aria2_free(gids);
-      ThrowAria2Error(
-          env, "ARIA2_ERROR",
-          "aria2_add_metalink failed with code " + std::to_string(ret));
-      return nullptr;
-    }
-    jobject list = NewArrayList(env);
-    for (size_t i = 0; i < gids_count; ++i) {
-        jobject gid_obj =
-            NewString(env, flutter_aria2::common::GidToHex(gids[i]));
-      ArrayListAdd(env, list, gid_obj);
-      env->DeleteLocalRef(gid_obj);
-    }
-    if (gids != nullptr) aria2_free(gids);
-    return list;
-  }
-
   if (method == "getActiveDownload") {
     REQUIRE_SESSION();
     aria2_gid_t* gids = nullptr;
@@ -612,15 +633,6 @@ jobject InvokeNative(JNIEnv* env, Aria2State* state, const std::string& method,
     return NewInteger(env, ret);
   }
 
-  if (method == "changeOption") {
-    REQUIRE_SESSION();
-    std::string hex = MapGetString(env, args, "gid");
-    auto options = OptionsFromArgs(env, args, "options");
-    int ret = aria2_change_option(state->session, aria2_hex_to_gid(hex.c_str()),
-                                  options.data(), options.count());
-    return NewInteger(env, ret);
-  }
-
   if (method == "getGlobalOption") {
     REQUIRE_SESSION();
     std::string name = MapGetString(env, args, "name");
@@ -749,6 +761,22 @@ jobject InvokeNative(JNIEnv* env, Aria2State* state, const std::string& method,
     env->DeleteLocalRef(k_us);
     env->DeleteLocalRef(v_us);
 
+    const flutter_aria2::core::SpeedEstimate estimate = state->speeds.Estimate(
+        aria2_hex_to_gid(hex.c_str()), aria2_download_handle_get_total_length(dh),
+        aria2_download_handle_get_completed_length(dh),
+        aria2_download_handle_get_download_speed(dh));
+    jobject k_as = NewString(env, "avgSpeed");
+    jobject v_as = NewLong(env, estimate.avg_speed);
+    HashMapPut(env, map, k_as, v_as);
+    env->DeleteLocalRef(k_as);
+    env->DeleteLocalRef(v_as);
+
+    jobject k_eta = NewString(env, "eta");
+    jobject v_eta = NewLong(env, estimate.eta_seconds);
+    HashMapPut(env, map, k_eta, v_eta);
+    env->DeleteLocalRef(k_eta);
+    env->DeleteLocalRef(v_eta);
+
     aria2_binary_t ih = aria2_download_handle_get_info_hash(dh);
     if (ih.data != nullptr && ih.length > 0) {
       std::ostringstream ss;
@@ -979,8 +1007,18 @@ jobject InvokeNative(JNIEnv* env, Aria2State* state, const std::string& method,
     return map;
   }
 
-  ThrowAria2Error(env, "NOT_IMPLEMENTED", "Method not implemented: " + method);
-  return nullptr;
+  flutter_aria2::common::Value value;
+  std::string message;
+  const char* error = flutter_aria2::core::InvokeMethod(
+      state, method, JavaToValue(env, args), &value, &message);
+  if (error != nullptr) {
+    if (std::strcmp(error, flutter_aria2::core::kNotImplemented) == 0) {
+      message = "Method not implemented: " + method;
+    }
+    ThrowAria2Error(env, error, message);
+    return nullptr;
+  }
+  return ValueToJava(env, value);
 }
 
 }  // namespace
@@ -998,7 +1036,9 @@ Java_me_junjie_xing_flutter_1aria2_Aria2NativeManager_nativeInit(
     flutter_aria2::core::CleanupState(state);
     delete state;
   }
-  SetState(env, thiz, new Aria2State());
+  state = new Aria2State();
+  state->event_sink = &EmitNativeEvent;
+  SetState(env, thiz, state);
 }
 
 extern "C" JNIEXPORT void JNICALL
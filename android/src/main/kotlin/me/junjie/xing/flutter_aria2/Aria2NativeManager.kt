@@ -41,13 +41,9 @@ class Aria2NativeManager(
     }
 
     @Suppress("unused") // Called from JNI.
-    fun onDownloadEventFromNative(event: Int, gid: String) {
-        val payload = mapOf(
-            "event" to event,
-            "gid" to gid
-        )
+    fun onNativeEventFromNative(method: String, payload: Any?) {
         mainHandler.post {
-            channel.invokeMethod("onDownloadEvent", payload)
+            channel.invokeMethod(method, payload)
         }
     }
 
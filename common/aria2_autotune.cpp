@@ -0,0 +1,248 @@
+#include "aria2_autotune.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <utility>
+
+#include "aria2_helpers.h"
+#include "aria2_loopback.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+using BenchClock = std::chrono::steady_clock;
+
+constexpr char kBenchFilePrefix[] = "flutter_aria2_autotune_";
+
+// Download events of one benchmark session, in add order.
+struct BenchDownloads {
+  std::vector<aria2_gid_t> gids;
+  std::vector<BenchClock::time_point> completed_at;
+  int completed = 0;
+};
+
+int HandleBenchEvent(aria2_session_t* /*session*/, aria2_download_event_t event,
+                     aria2_gid_t gid, void* user_data) {
+  auto* downloads = static_cast<BenchDownloads*>(user_data);
+  auto it = std::find(downloads->gids.begin(), downloads->gids.end(), gid);
+  if (it == downloads->gids.end()) {
+    return 0;
+  }
+  if (event == ARIA2_EVENT_ON_DOWNLOAD_COMPLETE) {
+    downloads->completed_at[static_cast<size_t>(it - downloads->gids.begin())] =
+        BenchClock::now();
+    ++downloads->completed;
+  }
+  return 0;
+}
+}  // namespace
+
+int PickBestAutotuneRun(const std::vector<AutotuneRun>& runs) {
+  double fastest = 0;
+  for (const AutotuneRun& run : runs) {
+    if (run.ok) {
+      fastest = std::max(fastest, run.throughput);
+    }
+  }
+  int best = -1;
+  for (size_t i = 0; i < runs.size(); ++i) {
+    const AutotuneRun& run = runs[i];
+    if (!run.ok || run.throughput < fastest * (1 - kAutotuneTolerance)) {
+      continue;
+    }
+    if (best < 0 || run.write_latency_ms < runs[best].write_latency_ms) {
+      best = static_cast<int>(i);
+    }
+  }
+  return best;
+}
+
+Autotuner::~Autotuner() {
+  Stop();
+}
+
+bool Autotuner::Start(AutotuneConfig config, Callback on_done) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_.load()) {
+    return false;
+  }
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+  cancel_.store(false);
+  silent_.store(false);
+  running_.store(true);
+  worker_ = std::thread(
+      [this, config = std::move(config), on_done = std::move(on_done)]() {
+        Run(config, on_done);
+      });
+  return true;
+}
+
+void Autotuner::Cancel() {
+  cancel_.store(true);
+}
+
+void Autotuner::Stop() {
+  silent_.store(true);
+  cancel_.store(true);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+void Autotuner::Run(const AutotuneConfig& config, const Callback& on_done) {
+  std::vector<AutotuneRun> runs;
+  for (const std::string& cache : config.disk_cache) {
+    for (const std::string& allocation : config.file_allocation) {
+      for (const std::string& piece : config.piece_length) {
+        if (cancel_.load()) {
+          break;
+        }
+        runs.push_back(RunOnce(config, cache, allocation, piece));
+      }
+    }
+  }
+  if (silent_.load()) {
+    running_.store(false);
+    return;
+  }
+
+  common::Value list = common::Value::NewList();
+  for (const AutotuneRun& run : runs) {
+    common::Value item = common::Value::NewMap();
+    item.Set("diskCache", run.disk_cache);
+    item.Set("fileAllocation", run.file_allocation);
+    item.Set("pieceLength", run.piece_length);
+    item.Set("ok", run.ok);
+    item.Set("error", run.error);
+    item.Set("elapsedMs", run.elapsed_ms);
+    item.Set("throughput", static_cast<int64_t>(run.throughput));
+    item.Set("writeLatencyMs", run.write_latency_ms);
+    list.Append(std::move(item));
+  }
+  common::Value out = common::Value::NewMap();
+  out.Set("runs", std::move(list));
+  const int best = PickBestAutotuneRun(runs);
+  if (best >= 0) {
+    common::Value options = common::Value::NewMap();
+    options.Set("disk-cache", runs[best].disk_cache);
+    options.Set("file-allocation", runs[best].file_allocation);
+    options.Set("piece-length", runs[best].piece_length);
+    out.Set("best", std::move(options));
+  } else {
+    out.Set("best", common::Value());
+  }
+  out.Set("cancelled", cancel_.load());
+  // Clear the flag first so the caller may open its session right away.
+  running_.store(false);
+  on_done(std::move(out));
+}
+
+AutotuneRun Autotuner::RunOnce(const AutotuneConfig& config,
+                               const std::string& cache,
+                               const std::string& allocation,
+                               const std::string& piece) {
+  AutotuneRun run;
+  run.disk_cache = cache;
+  run.file_allocation = allocation;
+  run.piece_length = piece;
+
+  const int count = config.file_count;
+  const int64_t file_size = config.workload_bytes / count;
+  common::LoopbackHttpServer server(kBenchFilePrefix, file_size, count);
+  if (!server.Start()) {
+    run.error = "Failed to start loopback server";
+    return run;
+  }
+
+  common::KeyVals options;
+  options.Add("dir", config.dir);
+  options.Add("disk-cache", cache);
+  options.Add("file-allocation", allocation);
+  options.Add("piece-length", piece);
+  options.Add("split", "4");
+  options.Add("max-connection-per-server", "4");
+  options.Add("min-split-size", "1M");
+  options.Add("max-concurrent-downloads", std::to_string(count));
+  options.Add("allow-overwrite", "true");
+  options.Add("auto-file-renaming", "false");
+
+  BenchDownloads downloads;
+  aria2_session_config_t session_config;
+  aria2_session_config_init(&session_config);
+  session_config.keep_running = 0;
+  session_config.download_event_callback = &HandleBenchEvent;
+  session_config.user_data = &downloads;
+  aria2_session_t* session =
+      aria2_session_new(options.data(), options.count(), &session_config);
+  if (session == nullptr) {
+    run.error = "aria2_session_new failed";
+    return run;
+  }
+
+  // Register all gids before the first aria2_run so no event is missed.
+  downloads.completed_at.resize(static_cast<size_t>(count));
+  for (int i = 0; i < count; ++i) {
+    const std::string uri = server.Url(i);
+    const char* uri_ptr = uri.c_str();
+    aria2_gid_t gid = 0;
+    if (aria2_add_uri(session, &gid, &uri_ptr, 1, nullptr, 0, -1) == 0) {
+      downloads.gids.push_back(gid);
+    }
+  }
+
+  const auto start = BenchClock::now();
+  const auto deadline = start + std::chrono::milliseconds(config.run_timeout_ms);
+  bool aborted = false;
+  bool timed_out = false;
+  while (aria2_run(session, ARIA2_RUN_ONCE) == 1) {
+    if (!aborted && (cancel_.load() || BenchClock::now() > deadline)) {
+      timed_out = !cancel_.load();
+      aria2_shutdown(session, 1);
+      aborted = true;
+    }
+  }
+  const auto finish = BenchClock::now();
+  aria2_session_final(session);
+  server.Stop();
+
+  for (int i = 0; i < count; ++i) {
+    const std::string path = config.dir + "/" + server.FileName(i);
+    std::remove(path.c_str());
+    std::remove((path + ".aria2").c_str());
+  }
+
+  run.elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       finish - start)
+                       .count();
+  if (aborted) {
+    run.error = timed_out ? "Timed out" : "Cancelled";
+    return run;
+  }
+  if (downloads.completed != count) {
+    run.error = std::to_string(count - downloads.completed) + " of " +
+                std::to_string(count) + " downloads failed";
+    return run;
+  }
+  run.ok = true;
+  run.throughput = static_cast<double>(file_size * count) * 1000.0 /
+                   std::max<int64_t>(run.elapsed_ms, 1);
+  double latency_sum = 0;
+  for (int i = 0; i < count; ++i) {
+    const BenchClock::time_point sent = server.LastByteSent(i);
+    const BenchClock::time_point done = downloads.completed_at[static_cast<size_t>(i)];
+    if (done > sent) {
+      latency_sum +=
+          std::chrono::duration<double, std::milli>(done - sent).count();
+    }
+  }
+  run.write_latency_ms = latency_sum / count;
+  return run;
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
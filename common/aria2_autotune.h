@@ -0,0 +1,91 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_AUTOTUNE_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_AUTOTUNE_H_
+
+#include <aria2_c_api.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+struct AutotuneConfig {
+  // Download directory to benchmark; the workload files are removed again.
+  std::string dir;
+  // Option matrix; every combination is one run.
+  std::vector<std::string> disk_cache{"0", "16M", "64M"};
+  std::vector<std::string> file_allocation{"none", "prealloc", "falloc"};
+  std::vector<std::string> piece_length{"1M", "4M"};
+  // Bytes downloaded per run, spread over |file_count| parallel downloads.
+  int64_t workload_bytes = 32 * 1024 * 1024;
+  int file_count = 4;
+  int run_timeout_ms = 30000;
+};
+
+struct AutotuneRun {
+  std::string disk_cache;
+  std::string file_allocation;
+  std::string piece_length;
+  bool ok = false;
+  std::string error;
+  int64_t elapsed_ms = 0;
+  double throughput = 0;  // Bytes per second over the whole run.
+  // Mean time from the server sending a file's last byte until aria2
+  // reports the download complete: the cache flush and file close.
+  double write_latency_ms = 0;
+};
+
+// Index of the best successful run, or -1. The fastest run wins; runs within
+// kAutotuneTolerance of its throughput are ranked by write latency instead,
+// since on flash storage a shorter flush stall is worth a little bandwidth.
+constexpr double kAutotuneTolerance = 0.05;
+int PickBestAutotuneRun(const std::vector<AutotuneRun>& runs);
+
+// Runs the option matrix of AutotuneConfig on a worker thread. Each run uses
+// a temporary aria2 session that downloads synthetic files from a loopback
+// HTTP server, so the caller must not hold a session while it is running.
+class Autotuner {
+ public:
+  using Callback = std::function<void(common::Value)>;
+
+  Autotuner() = default;
+  ~Autotuner();
+
+  Autotuner(const Autotuner&) = delete;
+  Autotuner& operator=(const Autotuner&) = delete;
+
+  // Returns false when a benchmark is already running. |on_done| is called
+  // on the worker thread with {runs, best, cancelled}.
+  bool Start(AutotuneConfig config, Callback on_done);
+
+  bool running() const { return running_.load(); }
+
+  // Ends the benchmark after the current run; the result is still reported.
+  void Cancel();
+
+  // Aborts the benchmark and joins the worker without reporting.
+  void Stop();
+
+ private:
+  void Run(const AutotuneConfig& config, const Callback& on_done);
+  AutotuneRun RunOnce(const AutotuneConfig& config, const std::string& cache,
+                      const std::string& allocation, const std::string& piece);
+
+  std::mutex mutex_;
+  std::thread worker_;
+  std::atomic<bool> running_{false};
+  std::atomic<bool> cancel_{false};
+  std::atomic<bool> silent_{false};
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_AUTOTUNE_H_
@@ -0,0 +1,364 @@
+#include "aria2_bitfield.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+#define FLUTTER_ARIA2_BITFIELD_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define FLUTTER_ARIA2_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define FLUTTER_ARIA2_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define FLUTTER_ARIA2_BITFIELD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+int64_t PopcountWord(uint64_t x) {
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  return static_cast<int64_t>((x * 0x0101010101010101ULL) >> 56);
+}
+
+// A run starts at every set bit whose predecessor is clear. |prev_bit| is
+// the last bit before |data|.
+void SummarizeWords(const uint8_t* data, size_t size, uint64_t prev_bit,
+                    BitfieldSummary* out) {
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word = 0;
+    for (int k = 0; k < 8; ++k) {
+      word = (word << 8) | data[i + k];
+    }
+    const uint64_t starts = word & ~((word >> 1) | (prev_bit << 63));
+    out->completed += PopcountWord(word);
+    out->runs += PopcountWord(starts);
+    prev_bit = word & 1;
+  }
+  for (; i < size; ++i) {
+    const uint64_t byte = data[i];
+    const uint64_t starts = byte & ~((byte >> 1) | (prev_bit << 7));
+    out->completed += PopcountWord(byte);
+    out->runs += PopcountWord(starts);
+    prev_bit = byte & 1;
+  }
+}
+
+#ifdef FLUTTER_ARIA2_BITFIELD_AVX2
+bool CpuHasAvx2() {
+#ifdef _MSC_VER
+  int regs[4];
+  __cpuid(regs, 0);
+  if (regs[0] < 7) {
+    return false;
+  }
+  __cpuid(regs, 1);
+  if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0 ||
+      (_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+  __cpuidex(regs, 7, 0);
+  return (regs[1] & (1 << 5)) != 0;
+#else
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || (ecx & bit_OSXSAVE) == 0 ||
+      (ecx & bit_AVX) == 0) {
+    return false;
+  }
+  // The OS must save the YMM registers.
+  unsigned int xcr0_lo, xcr0_hi;
+  __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+  if ((xcr0_lo & 6) != 6) {
+    return false;
+  }
+  return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+         (ebx & bit_AVX2) != 0;
+#endif
+}
+
+bool UseAvx2() {
+  static const bool available = CpuHasAvx2();
+  return available;
+}
+
+// Set bits of |v| as four 64-bit sums, through a nibble lookup table.
+FLUTTER_ARIA2_TARGET_AVX2 __m256i PopcountAvx2(__m256i v) {
+  const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2,
+                                       3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2,
+                                       2, 3, 2, 3, 3, 4);
+  const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+  const __m256i lo =
+      _mm256_shuffle_epi8(lut, _mm256_and_si256(v, low_nibble));
+  const __m256i hi = _mm256_shuffle_epi8(
+      lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibble));
+  return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+
+// 32 bytes at a time. Each byte's predecessor bit comes from the vector
+// shifted by one byte across the two lanes.
+FLUTTER_ARIA2_TARGET_AVX2 void SummarizeAvx2(const uint8_t* data,
+                                             size_t size,
+                                             BitfieldSummary* out) {
+  const __m256i low_seven = _mm256_set1_epi8(0x7f);
+  const __m256i high_bit = _mm256_set1_epi8(static_cast<char>(0x80));
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i prev = zero;
+  __m256i ones = zero;
+  __m256i starts = zero;
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    const __m256i cur =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    const __m256i before = _mm256_alignr_epi8(
+        cur, _mm256_permute2x128_si256(prev, cur, 0x21), 15);
+    const __m256i carry =
+        _mm256_and_si256(_mm256_slli_epi16(before, 7), high_bit);
+    const __m256i shifted =
+        _mm256_and_si256(_mm256_srli_epi16(cur, 1), low_seven);
+    ones = _mm256_add_epi64(ones, PopcountAvx2(cur));
+    const __m256i first =
+        _mm256_andnot_si256(_mm256_or_si256(shifted, carry), cur);
+    starts = _mm256_add_epi64(starts, PopcountAvx2(first));
+    prev = cur;
+  }
+  alignas(32) int64_t lanes[4];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), ones);
+  out->completed += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), starts);
+  out->runs += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  SummarizeWords(data + i, size - i, i > 0 ? data[i - 1] & 1 : 0, out);
+}
+#endif
+
+#ifdef FLUTTER_ARIA2_BITFIELD_NEON
+void SummarizeNeon(const uint8_t* data, size_t size, BitfieldSummary* out) {
+  uint8x16_t prev = vdupq_n_u8(0);
+  uint64_t ones = 0;
+  uint64_t starts = 0;
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    const uint8x16_t cur = vld1q_u8(data + i);
+    const uint8x16_t carry = vshlq_n_u8(vextq_u8(prev, cur, 15), 7);
+    const uint8x16_t first =
+        vbicq_u8(cur, vorrq_u8(vshrq_n_u8(cur, 1), carry));
+    ones += vaddlvq_u8(vcntq_u8(cur));
+    starts += vaddlvq_u8(vcntq_u8(first));
+    prev = cur;
+  }
+  out->completed += static_cast<int64_t>(ones);
+  out->runs += static_cast<int64_t>(starts);
+  SummarizeWords(data + i, size - i, i > 0 ? data[i - 1] & 1 : 0, out);
+}
+#endif
+}  // namespace
+
+BitfieldSummary SummarizeBitfield(const uint8_t* data, size_t size) {
+  BitfieldSummary out;
+#if defined(FLUTTER_ARIA2_BITFIELD_AVX2)
+  if (UseAvx2()) {
+    SummarizeAvx2(data, size, &out);
+    return out;
+  }
+#elif defined(FLUTTER_ARIA2_BITFIELD_NEON)
+  SummarizeNeon(data, size, &out);
+  return out;
+#endif
+  return SummarizeBitfieldPortable(data, size);
+}
+
+BitfieldSummary SummarizeBitfieldPortable(const uint8_t* data, size_t size) {
+  BitfieldSummary out;
+  SummarizeWords(data, size, 0, &out);
+  return out;
+}
+
+const char* BitfieldKernel() {
+#if defined(FLUTTER_ARIA2_BITFIELD_AVX2)
+  return UseAvx2() ? "avx2" : "portable";
+#elif defined(FLUTTER_ARIA2_BITFIELD_NEON)
+  return "neon";
+#else
+  return "portable";
+#endif
+}
+
+bool PieceBitfields::Query(aria2_session_t* session, aria2_gid_t gid,
+                           int64_t since_seq, common::Value* out) {
+  aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+  if (handle == nullptr) {
+    return false;
+  }
+  const int64_t num_pieces = aria2_download_handle_get_num_pieces(handle);
+  const int64_t piece_length =
+      static_cast<int64_t>(aria2_download_handle_get_piece_length(handle));
+  aria2_binary_t raw = aria2_download_handle_get_bitfield(handle);
+  std::vector<uint8_t> bits(static_cast<size_t>((num_pieces + 7) / 8), 0);
+  if (raw.data != nullptr) {
+    std::memcpy(bits.data(), raw.data, std::min(bits.size(), raw.length));
+  }
+  aria2_free_binary(&raw);
+  aria2_delete_download_handle(handle);
+  if (num_pieces % 8 != 0) {
+    bits.back() &= static_cast<uint8_t>(0xff << (8 - num_pieces % 8));
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  History& entry = history_[gid];
+  entry.last_query = ++queries_;
+  std::deque<Snapshot>& history = entry.snapshots;
+  if (history.empty() || history.back().num_pieces != num_pieces ||
+      history.back().bits != bits) {
+    Snapshot snapshot;
+    snapshot.seq = next_seq_++;
+    snapshot.num_pieces = num_pieces;
+    snapshot.bits = bits;
+    entry.bytes += static_cast<int64_t>(bits.size());
+    bytes_ += static_cast<int64_t>(bits.size());
+    history.push_back(std::move(snapshot));
+    if (history.size() > kBitfieldHistory) {
+      entry.bytes -= static_cast<int64_t>(history.front().bits.size());
+      bytes_ -= static_cast<int64_t>(history.front().bits.size());
+      history.pop_front();
+    }
+    TrimLocked(gid);
+  }
+  const Snapshot* base = nullptr;
+  for (const Snapshot& snapshot : history) {
+    if (since_seq >= 0 && snapshot.seq == since_seq &&
+        snapshot.num_pieces == num_pieces) {
+      base = &snapshot;
+    }
+  }
+
+  const BitfieldSummary summary = SummarizeBitfield(bits.data(), bits.size());
+  int64_t first_missing = 0;
+  for (uint8_t byte : bits) {
+    if (byte != 0xff) {
+      for (int bit = 7; bit >= 0 && (byte & (1 << bit)) != 0; --bit) {
+        ++first_missing;
+      }
+      break;
+    }
+    first_missing += 8;
+  }
+  *out = common::Value::NewMap();
+  out->Set("seq", history.back().seq);
+  out->Set("numPieces", num_pieces);
+  out->Set("pieceLength", piece_length);
+  out->Set("completed", summary.completed);
+  out->Set("runs", summary.runs);
+  out->Set("firstMissing", std::min(first_missing, num_pieces));
+  out->Set("delta", base != nullptr);
+  if (base != nullptr) {
+    common::Value changed = common::Value::NewList();
+    for (size_t i = 0; i < bits.size(); ++i) {
+      const uint8_t diff = static_cast<uint8_t>(bits[i] ^ base->bits[i]);
+      for (int bit = 7; diff != 0 && bit >= 0; --bit) {
+        if ((diff & (1 << bit)) != 0) {
+          changed.Append(static_cast<int64_t>(i * 8 + (7 - bit)));
+        }
+      }
+    }
+    out->Set("changed", std::move(changed));
+  } else {
+    out->Set("bitfield", common::Value(common::Value::Bytes(bits)));
+  }
+  if (summary.runs <= kMaxBitfieldSegments) {
+    common::Value segments = common::Value::NewList();
+    int64_t start = -1;
+    for (size_t i = 0; i < bits.size(); ++i) {
+      const uint8_t byte = bits[i];
+      if ((byte == 0xff && start >= 0) || (byte == 0 && start < 0)) {
+        continue;
+      }
+      for (int bit = 7; bit >= 0; --bit) {
+        const int64_t piece = static_cast<int64_t>(i * 8 + (7 - bit));
+        const bool set = (byte & (1 << bit)) != 0;
+        if (set && start < 0) {
+          start = piece;
+        } else if (!set && start >= 0) {
+          segments.Append(start);
+          segments.Append(piece - start);
+          start = -1;
+        }
+      }
+    }
+    if (start >= 0) {
+      segments.Append(start);
+      segments.Append(num_pieces - start);
+    }
+    out->Set("segments", std::move(segments));
+  }
+  return true;
+}
+
+void PieceBitfields::OnDownloadEvent(aria2_download_event_t event,
+                                     aria2_gid_t gid) {
+  if (event != ARIA2_EVENT_ON_DOWNLOAD_COMPLETE &&
+      event != ARIA2_EVENT_ON_DOWNLOAD_ERROR &&
+      event != ARIA2_EVENT_ON_DOWNLOAD_STOP) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  EraseLocked(gid);
+}
+
+void PieceBitfields::Forget(aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  EraseLocked(gid);
+}
+
+void PieceBitfields::EraseLocked(aria2_gid_t gid) {
+  auto it = history_.find(gid);
+  if (it == history_.end()) {
+    return;
+  }
+  bytes_ -= it->second.bytes;
+  history_.erase(it);
+}
+
+void PieceBitfields::TrimLocked(aria2_gid_t keep) {
+  while (bytes_ > kMaxHistoryBytes) {
+    auto oldest = history_.end();
+    for (auto it = history_.begin(); it != history_.end(); ++it) {
+      if (it->first != keep && (oldest == history_.end() ||
+                                it->second.last_query <
+                                    oldest->second.last_query)) {
+        oldest = it;
+      }
+    }
+    if (oldest == history_.end()) {
+      break;
+    }
+    bytes_ -= oldest->second.bytes;
+    history_.erase(oldest);
+  }
+}
+
+common::Value PieceBitfields::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewMap();
+  out.Set("kernel", BitfieldKernel());
+  out.Set("tracked", static_cast<int64_t>(history_.size()));
+  out.Set("bytes", bytes_);
+  return out;
+}
+
+void PieceBitfields::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  history_.clear();
+  bytes_ = 0;
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
@@ -0,0 +1,107 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_BITFIELD_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_BITFIELD_H_
+
+#include <aria2_c_api.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+struct BitfieldSummary {
+  int64_t completed = 0;  // Set bits.
+  int64_t runs = 0;       // Runs of consecutive set bits.
+};
+
+// Summarizes a piece bitfield in aria2's layout (piece 0 is the most
+// significant bit of the first byte). Bits past the last piece must be
+// clear. Uses AVX2 on x86 CPUs that have it (picked at run time), NEON on
+// arm64 and 64-bit words elsewhere.
+BitfieldSummary SummarizeBitfield(const uint8_t* data, size_t size);
+
+// The 64-bit word path SummarizeBitfield falls back to, on any CPU.
+BitfieldSummary SummarizeBitfieldPortable(const uint8_t* data, size_t size);
+
+// "avx2", "neon" or "portable".
+const char* BitfieldKernel();
+
+// Serves piece bitfields to Dart, in full or as the pieces changed since an
+// earlier answer.
+//
+// Each download that was queried keeps its last kBitfieldHistory distinct
+// bitfields, numbered by a sequence that grows whenever a bitfield changes
+// and is never reused. A caller that passes the sequence of its last answer
+// gets back only the indexes of the pieces that differ from it, as long as
+// that bitfield is still in the history; otherwise, and when the piece
+// count changed (a magnet got its metadata), it gets the full bitfield.
+//
+// The history of a download is dropped when it completes, fails or is
+// removed, and the least recently queried downloads lose theirs when all
+// histories together exceed kMaxHistoryBytes.
+class PieceBitfields {
+ public:
+  static constexpr size_t kBitfieldHistory = 8;
+  static constexpr int64_t kMaxHistoryBytes = 16 * 1024 * 1024;
+  // Runs are listed only up to this many.
+  static constexpr int64_t kMaxBitfieldSegments = 256;
+
+  PieceBitfields() = default;
+
+  PieceBitfields(const PieceBitfields&) = delete;
+  PieceBitfields& operator=(const PieceBitfields&) = delete;
+
+  // Fills |out| with {seq, numPieces, pieceLength, completed, runs,
+  // firstMissing, delta} plus "bitfield" (bytes) or, for a delta, "changed"
+  // (piece indexes), and "segments" ([start, length, ...] of each run) when
+  // there are at most kMaxBitfieldSegments runs. |since_seq| < 0 asks for
+  // the full bitfield. Returns false when aria2 has no |gid|.
+  bool Query(aria2_session_t* session, aria2_gid_t gid, int64_t since_seq,
+             common::Value* out);
+
+  // Runs in the download event callback.
+  void OnDownloadEvent(aria2_download_event_t event, aria2_gid_t gid);
+
+  void Forget(aria2_gid_t gid);
+
+  // {kernel, tracked, bytes}.
+  common::Value Describe() const;
+
+  void Reset();
+
+ private:
+  struct Snapshot {
+    int64_t seq = 0;
+    int64_t num_pieces = 0;
+    std::vector<uint8_t> bits;
+  };
+
+  struct History {
+    std::deque<Snapshot> snapshots;
+    int64_t bytes = 0;
+    // Value of queries_ at the last query.
+    int64_t last_query = 0;
+  };
+
+  void EraseLocked(aria2_gid_t gid);
+  // Drops the least recently queried histories other than |keep| until
+  // the total fits kMaxHistoryBytes.
+  void TrimLocked(aria2_gid_t keep);
+
+  mutable std::mutex mutex_;
+  std::unordered_map<aria2_gid_t, History> history_;
+  int64_t bytes_ = 0;
+  int64_t queries_ = 0;
+  int64_t next_seq_ = 1;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_BITFIELD_H_
@@ -0,0 +1,305 @@
+#include "aria2_checksum.h"
+
+#include <algorithm>
+
+#include "aria2_helpers.h"
+#include "aria2_mapped_file.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+constexpr size_t kHashChunkSize = 1 << 20;
+}  // namespace
+
+ChecksumVerifier::~ChecksumVerifier() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ChecksumVerifier::Watch(aria2_gid_t gid,
+                             std::map<int, std::string> expected) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (workers_.empty()) {
+    const unsigned cores = std::thread::hardware_concurrency();
+    const unsigned count = std::max(1u, std::min(4u, cores / 2));
+    for (unsigned i = 0; i < count; ++i) {
+      workers_.emplace_back([this]() { WorkerLoop(); });
+    }
+  }
+  Download& download = downloads_[gid];
+  download.expected = std::move(expected);
+}
+
+bool ChecksumVerifier::LoadFilesLocked(aria2_session_t* session,
+                                       aria2_gid_t gid, Download* download,
+                                       int64_t* prefix) {
+  aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+  if (handle == nullptr) {
+    return false;
+  }
+  const int64_t total = aria2_download_handle_get_total_length(handle);
+  aria2_binary_t bitfield = aria2_download_handle_get_bitfield(handle);
+  *prefix = bitfield.data == nullptr
+                ? 0
+                : common::CompletedPrefix(
+                      bitfield,
+                      static_cast<int64_t>(
+                          aria2_download_handle_get_piece_length(handle)),
+                      total);
+  aria2_free_binary(&bitfield);
+
+  // Paths are final once data is being written; until then aria2 may not
+  // know the file name yet.
+  if (download->files.empty() && (*prefix > 0 || download->completing)) {
+    aria2_file_data_t* files = nullptr;
+    size_t files_count = 0;
+    if (aria2_download_handle_get_files(handle, &files, &files_count) == 0 &&
+        files != nullptr) {
+      int64_t offset = 0;
+      for (size_t i = 0; i < files_count; ++i) {
+        auto file = std::make_shared<File>();
+        file->index = files[i].index;
+        file->path = files[i].path != nullptr ? files[i].path : "";
+        file->offset = offset;
+        file->length = files[i].length;
+        file->selected = files[i].selected != 0 && !file->path.empty();
+        offset += files[i].length;
+        download->files.push_back(std::move(file));
+      }
+      aria2_free_file_data_array(files, files_count);
+    }
+  }
+  aria2_delete_download_handle(handle);
+  return true;
+}
+
+void ChecksumVerifier::ScheduleLocked(aria2_gid_t gid,
+                                      const std::shared_ptr<File>& file) {
+  if (file->queued || file->failed) {
+    return;
+  }
+  if (file->target > file->hashed) {
+    file->queued = true;
+    queue_.emplace_back(gid, file);
+    work_.notify_one();
+  } else if (file->hashed == file->length && file->digest.empty()) {
+    file->digest = file->hash.HexDigest();
+  }
+}
+
+void ChecksumVerifier::OnTick(aria2_session_t* session) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto now = std::chrono::steady_clock::now();
+  if (downloads_.empty() ||
+      now - last_tick_ < std::chrono::milliseconds(kChecksumTickMs)) {
+    return;
+  }
+  last_tick_ = now;
+  for (auto& item : downloads_) {
+    Download& download = item.second;
+    int64_t prefix = 0;
+    if (download.completing ||
+        !LoadFilesLocked(session, item.first, &download, &prefix)) {
+      continue;
+    }
+    for (const std::shared_ptr<File>& file : download.files) {
+      if (!file->selected) {
+        continue;
+      }
+      const int64_t target =
+          std::max<int64_t>(0, std::min(prefix - file->offset, file->length));
+      if (target > file->target) {
+        file->target = target;
+        ScheduleLocked(item.first, file);
+      }
+    }
+  }
+}
+
+bool ChecksumVerifier::OnDownloadEvent(aria2_session_t* session,
+                                       aria2_download_event_t event,
+                                       aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = downloads_.find(gid);
+  if (it == downloads_.end()) {
+    return false;
+  }
+  Download& download = it->second;
+  switch (event) {
+    case ARIA2_EVENT_ON_DOWNLOAD_COMPLETE:
+    case ARIA2_EVENT_ON_BT_DOWNLOAD_COMPLETE: {
+      if (download.completing) {
+        return false;
+      }
+      download.completing = true;
+      download.event = event;
+      int64_t prefix = 0;
+      LoadFilesLocked(session, gid, &download, &prefix);
+      for (const std::shared_ptr<File>& file : download.files) {
+        if (file->selected) {
+          file->target = file->length;
+          ScheduleLocked(gid, file);
+        }
+      }
+      FinishIfDoneLocked(gid);
+      return true;
+    }
+    case ARIA2_EVENT_ON_DOWNLOAD_ERROR:
+    case ARIA2_EVENT_ON_DOWNLOAD_STOP:
+      downloads_.erase(it);
+      return false;
+    default:
+      return false;
+  }
+}
+
+void ChecksumVerifier::FinishIfDoneLocked(aria2_gid_t gid) {
+  auto it = downloads_.find(gid);
+  if (it == downloads_.end() || !it->second.completing) {
+    return;
+  }
+  const Download& download = it->second;
+  for (const std::shared_ptr<File>& file : download.files) {
+    if (file->selected && !file->failed && file->digest.empty()) {
+      return;
+    }
+  }
+  ChecksumResult result;
+  result.gid = gid;
+  result.event = download.event;
+  std::map<int, std::string> unmatched = download.expected;
+  for (const std::shared_ptr<File>& file : download.files) {
+    if (!file->selected) {
+      continue;
+    }
+    FileDigest digest;
+    digest.index = file->index;
+    digest.path = file->path;
+    digest.sha256 = file->digest;
+    auto expected = unmatched.find(file->index);
+    if (expected != unmatched.end()) {
+      digest.expected = expected->second;
+      result.mismatch |= digest.sha256 != digest.expected;
+      unmatched.erase(expected);
+    }
+    result.files.push_back(std::move(digest));
+  }
+  // An expected digest for a file that was not downloaded cannot match.
+  for (const auto& expected : unmatched) {
+    FileDigest digest;
+    digest.index = expected.first;
+    digest.expected = expected.second;
+    result.files.push_back(std::move(digest));
+    result.mismatch = true;
+  }
+  if (result.mismatch) {
+    ++mismatches_;
+  } else {
+    ++verified_;
+  }
+  results_.push_back(std::move(result));
+  downloads_.erase(it);
+}
+
+void ChecksumVerifier::WorkerLoop() {
+  std::vector<char> buffer(kHashChunkSize);
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+    if (stopping_) {
+      return;
+    }
+    const aria2_gid_t gid = queue_.front().first;
+    std::shared_ptr<File> file = std::move(queue_.front().second);
+    queue_.pop_front();
+    const int64_t target = file->target;
+    const int64_t start = file->hashed;
+    const std::string path = file->path;
+    lock.unlock();
+
+    int64_t hashed = start;
+    common::InputFile input;
+    bool ok = input.Open(path);
+    while (ok && hashed < target) {
+      const size_t want = static_cast<size_t>(
+          std::min<int64_t>(static_cast<int64_t>(buffer.size()),
+                            target - hashed));
+      const int64_t read = input.ReadAt(hashed, buffer.data(), want);
+      if (read <= 0) {
+        ok = false;
+        break;
+      }
+      file->hash.Update(buffer.data(), static_cast<size_t>(read));
+      hashed += read;
+    }
+    input.Close();
+
+    lock.lock();
+    bytes_hashed_ += hashed - start;
+    file->hashed = hashed;
+    file->queued = false;
+    file->failed = !ok;
+    ScheduleLocked(gid, file);
+    FinishIfDoneLocked(gid);
+  }
+}
+
+std::vector<ChecksumResult> ChecksumVerifier::TakeResults() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<ChecksumResult> out;
+  out.swap(results_);
+  return out;
+}
+
+bool ChecksumVerifier::Holds(aria2_gid_t gid) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (downloads_.count(gid) > 0) {
+    return true;
+  }
+  for (const ChecksumResult& result : results_) {
+    if (result.gid == gid) {
+      return true;
+    }
+  }
+  return false;
+}
+
+common::Value ChecksumVerifier::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewMap();
+  out.Set("kernel", common::Sha256::Kernel());
+  out.Set("workers", static_cast<int64_t>(workers_.size()));
+  out.Set("watching", static_cast<int64_t>(downloads_.size()));
+  out.Set("queued", static_cast<int64_t>(queue_.size()));
+  out.Set("bytesHashed", bytes_hashed_);
+  out.Set("verified", verified_);
+  out.Set("mismatches", mismatches_);
+  return out;
+}
+
+std::vector<ChecksumResult> ChecksumVerifier::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<ChecksumResult> held;
+  held.swap(results_);
+  for (const auto& item : downloads_) {
+    if (item.second.completing) {
+      ChecksumResult result;
+      result.gid = item.first;
+      result.event = item.second.event;
+      held.push_back(std::move(result));
+    }
+  }
+  downloads_.clear();
+  queue_.clear();
+  return held;
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
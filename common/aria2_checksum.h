@@ -0,0 +1,138 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_CHECKSUM_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_CHECKSUM_H_
+
+#include <aria2_c_api.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "aria2_sha.h"
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// aria2's error code for a failed checksum, reported on a mismatch.
+constexpr int kChecksumErrorCode = 32;
+
+struct FileDigest {
+  int index = 0;  // 1-based, as aria2 numbers files.
+  std::string path;
+  std::string sha256;    // Empty when the file could not be read.
+  std::string expected;  // Empty when none was given.
+};
+
+struct ChecksumResult {
+  aria2_gid_t gid = 0;
+  aria2_download_event_t event = ARIA2_EVENT_ON_DOWNLOAD_COMPLETE;
+  bool mismatch = false;
+  std::vector<FileDigest> files;
+};
+
+// Incremental SHA-256 of downloaded files, so the digests are ready when a
+// download completes instead of rereading every file afterwards.
+//
+// For each watched download the tick reads aria2's piece bitfield and
+// computes the contiguous completed prefix of the data; a small pool of
+// worker threads hashes each file up to that prefix as it grows. The first
+// connection of a download fetches from the start, so the prefix follows it
+// closely. When aria2 reports completion the workers hash what is left and
+// the completion event is held back until the digests are ready. A file
+// whose digest differs from the expected one turns the event into an error
+// with kChecksumErrorCode, and the registry and history record the download
+// as failed; aria2 itself still lists it as complete.
+class ChecksumVerifier {
+ public:
+  static constexpr int kChecksumTickMs = 250;
+
+  ChecksumVerifier() = default;
+  ~ChecksumVerifier();
+
+  ChecksumVerifier(const ChecksumVerifier&) = delete;
+  ChecksumVerifier& operator=(const ChecksumVerifier&) = delete;
+
+  // Starts hashing the files of |gid|. |expected| maps file indexes to
+  // lower-case hex digests; files without one are only hashed.
+  void Watch(aria2_gid_t gid, std::map<int, std::string> expected);
+
+  // Hands newly completed prefixes to the workers.
+  void OnTick(aria2_session_t* session);
+
+  // Runs in the download event callback. For the first completion event of
+  // a watched download (ARIA2_EVENT_ON_BT_DOWNLOAD_COMPLETE for torrents)
+  // this queues the rest of the data and returns true: the event is then
+  // delivered through TakeResults. Stopped and failed downloads are
+  // forgotten.
+  bool OnDownloadEvent(aria2_session_t* session, aria2_download_event_t event,
+                       aria2_gid_t gid);
+
+  // Downloads whose digests became ready since the last call.
+  std::vector<ChecksumResult> TakeResults();
+
+  // Whether the completion of |gid| is, or will be, delivered through
+  // TakeResults rather than as it happened.
+  bool Holds(aria2_gid_t gid) const;
+
+  // {kernel, workers, watching, queued, bytesHashed, verified, mismatches}.
+  common::Value Describe() const;
+
+  // Forgets every download. Returns the completion events still held back,
+  // without digests.
+  std::vector<ChecksumResult> Reset();
+
+ private:
+  struct File {
+    int index = 0;
+    std::string path;
+    int64_t offset = 0;  // Of the file within the download's data.
+    int64_t length = 0;
+    bool selected = true;
+    int64_t target = 0;  // Bytes known to be complete.
+    int64_t hashed = 0;
+    bool queued = false;
+    bool failed = false;
+    common::Sha256 hash;  // Owned by the worker while |queued|.
+    std::string digest;
+  };
+
+  struct Download {
+    std::map<int, std::string> expected;
+    std::vector<std::shared_ptr<File>> files;
+    bool completing = false;
+    aria2_download_event_t event = ARIA2_EVENT_ON_DOWNLOAD_COMPLETE;
+  };
+
+  bool LoadFilesLocked(aria2_session_t* session, aria2_gid_t gid,
+                       Download* download, int64_t* prefix);
+  void ScheduleLocked(aria2_gid_t gid, const std::shared_ptr<File>& file);
+  void FinishIfDoneLocked(aria2_gid_t gid);
+  void WorkerLoop();
+
+  mutable std::mutex mutex_;
+  std::condition_variable work_;
+  std::deque<std::pair<aria2_gid_t, std::shared_ptr<File>>> queue_;
+  std::vector<std::thread> workers_;
+  bool stopping_ = false;
+
+  std::unordered_map<aria2_gid_t, Download> downloads_;
+  std::vector<ChecksumResult> results_;
+  std::chrono::steady_clock::time_point last_tick_;
+  int64_t bytes_hashed_ = 0;
+  int64_t verified_ = 0;
+  int64_t mismatches_ = 0;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_CHECKSUM_H_
@@ -0,0 +1,315 @@
+#include "aria2_concurrency.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "aria2_helpers.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+constexpr auto kSampleSpacing = std::chrono::milliseconds(250);
+constexpr int kKnobCount = 3;
+
+const char* KnobName(ConcurrencyKnob knob) {
+  switch (knob) {
+    case ConcurrencyKnob::kSplit:
+      return "split";
+    case ConcurrencyKnob::kMaxConnectionPerServer:
+      return "maxConnectionPerServer";
+    case ConcurrencyKnob::kMaxConcurrentDownloads:
+      return "maxConcurrentDownloads";
+  }
+  return "";
+}
+
+int Clamp(int value, int lo, int hi) {
+  return std::max(lo, std::min(value, hi));
+}
+}  // namespace
+
+constexpr double ConcurrencyController::kGainThreshold;
+constexpr double ConcurrencyController::kLossThreshold;
+constexpr double ConcurrencyController::kDecreaseFactor;
+
+const char* ConcurrencyKnobOption(ConcurrencyKnob knob) {
+  switch (knob) {
+    case ConcurrencyKnob::kSplit:
+      return "split";
+    case ConcurrencyKnob::kMaxConnectionPerServer:
+      return "max-connection-per-server";
+    case ConcurrencyKnob::kMaxConcurrentDownloads:
+      return "max-concurrent-downloads";
+  }
+  return "";
+}
+
+void ConcurrencyController::Configure(const ConcurrencyConfig& config,
+                                      const ConcurrencyKnobs& initial) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  config_ = config;
+  knobs_.split = Clamp(initial.split, config.min.split, config.max.split);
+  knobs_.max_connection_per_server =
+      Clamp(initial.max_connection_per_server,
+            config.min.max_connection_per_server,
+            config.max.max_connection_per_server);
+  knobs_.max_concurrent_downloads =
+      Clamp(initial.max_concurrent_downloads,
+            config.min.max_concurrent_downloads,
+            config.max.max_concurrent_downloads);
+  current_ = ConcurrencyKnob::kSplit;
+  direction_ = 0;
+  baseline_ = -1;
+  last_throughput_ = 0;
+  window_start_ = std::chrono::steady_clock::now();
+  last_sample_ = std::chrono::steady_clock::time_point();
+  speed_sum_ = 0;
+  sample_count_ = 0;
+  active_max_ = 0;
+  waiting_max_ = 0;
+  enabled_ = true;
+}
+
+void ConcurrencyController::Disable() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  enabled_ = false;
+}
+
+bool ConcurrencyController::enabled() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return enabled_;
+}
+
+ConcurrencyDecision ConcurrencyController::Step(
+    const ConcurrencySample& sample) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return StepLocked(sample);
+}
+
+ConcurrencyKnobs ConcurrencyController::knobs() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return knobs_;
+}
+
+void ConcurrencyController::Enable(aria2_session_t* session,
+                                   const ConcurrencyConfig& config) {
+  ConcurrencyKnobs initial;
+  initial.split = common::GetGlobalOptionInt(session, "split", initial.split);
+  initial.max_connection_per_server = common::GetGlobalOptionInt(
+      session, "max-connection-per-server", initial.max_connection_per_server);
+  initial.max_concurrent_downloads = common::GetGlobalOptionInt(
+      session, "max-concurrent-downloads", initial.max_concurrent_downloads);
+  Configure(config, initial);
+
+  // Push the clamped starting point so aria2 and the controller agree.
+  const ConcurrencyKnobs start = knobs();
+  common::KeyVals options;
+  options.Add("split", std::to_string(start.split));
+  options.Add("max-connection-per-server",
+              std::to_string(start.max_connection_per_server));
+  options.Add("max-concurrent-downloads",
+              std::to_string(start.max_concurrent_downloads));
+  aria2_change_global_option(session, options.data(), options.count());
+}
+
+void ConcurrencyController::OnTick(aria2_session_t* session,
+                                   MetricsLog* metrics) {
+  ConcurrencyDecision decision;
+  double throughput = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enabled_) {
+      return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_sample_ < kSampleSpacing) {
+      return;
+    }
+    last_sample_ = now;
+    const aria2_global_stat_t stat = aria2_get_global_stat(session);
+    speed_sum_ += stat.download_speed;
+    ++sample_count_;
+    active_max_ = std::max(active_max_, stat.num_active);
+    waiting_max_ = std::max(waiting_max_, stat.num_waiting);
+    if (now - window_start_ <
+        std::chrono::milliseconds(config_.sample_interval_ms)) {
+      return;
+    }
+
+    ConcurrencySample sample;
+    sample.throughput = speed_sum_ / sample_count_;
+    sample.num_active = active_max_;
+    sample.num_waiting = waiting_max_;
+    window_start_ = now;
+    speed_sum_ = 0;
+    sample_count_ = 0;
+    active_max_ = 0;
+    waiting_max_ = 0;
+
+    decision = StepLocked(sample);
+    throughput = sample.throughput;
+    if (!decision.changed) {
+      return;
+    }
+    common::KeyVals options;
+    options.Add(ConcurrencyKnobOption(decision.knob),
+                std::to_string(decision.to));
+    aria2_change_global_option(session, options.data(), options.count());
+  }
+
+  if (metrics != nullptr) {
+    common::Value data = common::Value::NewMap();
+    data.Set("knob", KnobName(decision.knob));
+    data.Set("from", decision.from);
+    data.Set("to", decision.to);
+    data.Set("throughput", static_cast<int64_t>(throughput));
+    data.Set("reason", decision.reason);
+    metrics->Record("concurrency", std::move(data));
+  }
+}
+
+common::Value ConcurrencyController::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewMap();
+  out.Set("enabled", enabled_);
+  out.Set("split", knobs_.split);
+  out.Set("maxConnectionPerServer", knobs_.max_connection_per_server);
+  out.Set("maxConcurrentDownloads", knobs_.max_concurrent_downloads);
+  out.Set("throughput", static_cast<int64_t>(last_throughput_));
+  return out;
+}
+
+void ConcurrencyController::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  enabled_ = false;
+  baseline_ = -1;
+  direction_ = 0;
+  last_throughput_ = 0;
+}
+
+int& ConcurrencyController::KnobLocked(ConcurrencyKnob knob) {
+  switch (knob) {
+    case ConcurrencyKnob::kSplit:
+      return knobs_.split;
+    case ConcurrencyKnob::kMaxConnectionPerServer:
+      return knobs_.max_connection_per_server;
+    case ConcurrencyKnob::kMaxConcurrentDownloads:
+      break;
+  }
+  return knobs_.max_concurrent_downloads;
+}
+
+int ConcurrencyController::MinLocked(ConcurrencyKnob knob) const {
+  switch (knob) {
+    case ConcurrencyKnob::kSplit:
+      return config_.min.split;
+    case ConcurrencyKnob::kMaxConnectionPerServer:
+      return config_.min.max_connection_per_server;
+    case ConcurrencyKnob::kMaxConcurrentDownloads:
+      break;
+  }
+  return config_.min.max_concurrent_downloads;
+}
+
+int ConcurrencyController::MaxLocked(ConcurrencyKnob knob) const {
+  switch (knob) {
+    case ConcurrencyKnob::kSplit:
+      return config_.max.split;
+    case ConcurrencyKnob::kMaxConnectionPerServer:
+      return config_.max.max_connection_per_server;
+    case ConcurrencyKnob::kMaxConcurrentDownloads:
+      break;
+  }
+  return config_.max.max_concurrent_downloads;
+}
+
+ConcurrencyDecision ConcurrencyController::StepLocked(
+    const ConcurrencySample& sample) {
+  ConcurrencyDecision decision;
+  if (!enabled_) {
+    return decision;
+  }
+  if (sample.num_active == 0) {
+    // Nothing to measure; start from a fresh baseline next time.
+    baseline_ = -1;
+    direction_ = 0;
+    decision.reason = "idle";
+    return decision;
+  }
+  last_throughput_ = sample.throughput;
+  if (baseline_ < 0) {
+    baseline_ = sample.throughput;
+    return IncreaseLocked(sample, "probe");
+  }
+  const double delta =
+      (sample.throughput - baseline_) / std::max(baseline_, 1.0);
+  baseline_ = sample.throughput;
+
+  if (direction_ > 0) {
+    if (delta >= kGainThreshold) {
+      return IncreaseLocked(sample, "gain");
+    }
+    int& value = KnobLocked(current_);
+    decision.knob = current_;
+    decision.from = value;
+    if (delta <= -kLossThreshold) {
+      // Multiplicative decrease, but always at least one step down.
+      decision.to = std::max(
+          MinLocked(current_),
+          std::min(value - 1, static_cast<int>(value * kDecreaseFactor)));
+      decision.reason = "loss";
+    } else {
+      // The last step bought nothing; give it back and try the next knob.
+      decision.to = std::max(MinLocked(current_), value - 1);
+      decision.reason = "plateau";
+    }
+    value = decision.to;
+    decision.changed = decision.to != decision.from;
+    direction_ = -1;
+    NextKnobLocked();
+    return decision;
+  }
+  if (delta <= -kLossThreshold) {
+    // Throughput fell without a change of ours: the link or server degraded.
+    // Hold and let the next window set a new baseline.
+    direction_ = 0;
+    decision.reason = "degraded";
+    return decision;
+  }
+  return IncreaseLocked(sample, "probe");
+}
+
+ConcurrencyDecision ConcurrencyController::IncreaseLocked(
+    const ConcurrencySample& sample, const char* reason) {
+  ConcurrencyDecision decision;
+  for (int i = 0; i < kKnobCount; ++i) {
+    int& value = KnobLocked(current_);
+    // More concurrent downloads only help while some are waiting.
+    const bool useful = current_ != ConcurrencyKnob::kMaxConcurrentDownloads ||
+                        sample.num_waiting > 0;
+    if (useful && value < MaxLocked(current_)) {
+      decision.changed = true;
+      decision.knob = current_;
+      decision.from = value;
+      decision.to = value + 1;
+      decision.reason = reason;
+      value = decision.to;
+      direction_ = 1;
+      return decision;
+    }
+    NextKnobLocked();
+  }
+  direction_ = 0;
+  decision.reason = "saturated";
+  return decision;
+}
+
+void ConcurrencyController::NextKnobLocked() {
+  current_ = static_cast<ConcurrencyKnob>(
+      (static_cast<int>(current_) + 1) % kKnobCount);
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
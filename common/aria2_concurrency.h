@@ -0,0 +1,123 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_CONCURRENCY_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_CONCURRENCY_H_
+
+#include <aria2_c_api.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "aria2_metrics.h"
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// The global options tuned by ConcurrencyController, in the order they are
+// visited by the hill climb.
+enum class ConcurrencyKnob {
+  kSplit = 0,
+  kMaxConnectionPerServer = 1,
+  kMaxConcurrentDownloads = 2,
+};
+
+const char* ConcurrencyKnobOption(ConcurrencyKnob knob);
+
+struct ConcurrencyKnobs {
+  int split = 5;
+  int max_connection_per_server = 1;
+  int max_concurrent_downloads = 5;
+};
+
+struct ConcurrencyConfig {
+  ConcurrencyKnobs min{1, 1, 1};
+  ConcurrencyKnobs max{16, 16, 10};
+  int sample_interval_ms = 3000;
+};
+
+// One averaged throughput window.
+struct ConcurrencySample {
+  double throughput = 0;  // Download bytes per second.
+  int num_active = 0;
+  int num_waiting = 0;
+};
+
+struct ConcurrencyDecision {
+  bool changed = false;
+  ConcurrencyKnob knob = ConcurrencyKnob::kSplit;
+  int from = 0;
+  int to = 0;
+  const char* reason = "";
+};
+
+// Opt-in online controller for split, max-connection-per-server and
+// max-concurrent-downloads.
+//
+// Every sample window it compares the mean download throughput with the
+// previous window: while an additive increase of the current knob keeps
+// paying off the climb continues, a clear loss backs the knob off
+// multiplicatively, and a plateau moves on to the next knob. Step() is pure
+// so the policy can be exercised without aria2; OnTick() feeds it from
+// aria2_get_global_stat and applies decisions with
+// aria2_change_global_option. aria2 copies split and
+// max-connection-per-server into a download when it starts, so changes to
+// those two affect later downloads only.
+class ConcurrencyController {
+ public:
+  // Gain/loss thresholds relative to the previous window.
+  static constexpr double kGainThreshold = 0.05;
+  static constexpr double kLossThreshold = 0.10;
+  static constexpr double kDecreaseFactor = 0.5;
+
+  // Starts from |initial| clamped into the configured bounds.
+  void Configure(const ConcurrencyConfig& config,
+                 const ConcurrencyKnobs& initial);
+  void Disable();
+  bool enabled() const;
+
+  ConcurrencyDecision Step(const ConcurrencySample& sample);
+
+  ConcurrencyKnobs knobs() const;
+
+  // Reads the current option values, then enables the controller.
+  void Enable(aria2_session_t* session, const ConcurrencyConfig& config);
+
+  void OnTick(aria2_session_t* session, MetricsLog* metrics);
+
+  common::Value Describe() const;
+
+  void Reset();
+
+ private:
+  int& KnobLocked(ConcurrencyKnob knob);
+  int MinLocked(ConcurrencyKnob knob) const;
+  int MaxLocked(ConcurrencyKnob knob) const;
+  ConcurrencyDecision StepLocked(const ConcurrencySample& sample);
+  // Probes an additive increase, starting at |current_| and skipping knobs
+  // that are at their bound or cannot help right now.
+  ConcurrencyDecision IncreaseLocked(const ConcurrencySample& sample,
+                                     const char* reason);
+  void NextKnobLocked();
+
+  mutable std::mutex mutex_;
+  bool enabled_ = false;
+  ConcurrencyConfig config_;
+  ConcurrencyKnobs knobs_;
+  ConcurrencyKnob current_ = ConcurrencyKnob::kSplit;
+  int direction_ = 0;  // +1 after an increase, -1 after a decrease.
+  double baseline_ = -1;
+  double last_throughput_ = 0;
+
+  // Window accumulation for OnTick().
+  std::chrono::steady_clock::time_point window_start_;
+  std::chrono::steady_clock::time_point last_sample_;
+  double speed_sum_ = 0;
+  int sample_count_ = 0;
+  int active_max_ = 0;
+  int waiting_max_ = 0;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_CONCURRENCY_H_
@@ -2,6 +2,9 @@
 
 #include <chrono>
 #include <thread>
+#include <utility>
+
+#include "aria2_helpers.h"
 
 namespace flutter_aria2 {
 namespace core {
@@ -23,6 +26,296 @@ struct RunInProgressGuard {
  private:
   std::atomic<bool>* flag_;
 };
+
+void EmitRetryAction(RuntimeState* state, const RetryAction& action) {
+  common::Value payload = common::Value::NewMap();
+  payload.Set("action", static_cast<int32_t>(action.kind));
+  payload.Set("gid", common::GidToHex(action.gid));
+  if (action.kind == RetryActionKind::kRetried) {
+    payload.Set("newGid", common::GidToHex(action.new_gid));
+  }
+  payload.Set("attempt", action.attempt);
+  payload.Set("errorCode", action.error_code);
+  payload.Set("delayMs", action.delay_ms);
+  payload.Set("reason", action.reason);
+  state->metrics.Record("retry", payload);
+  EmitEvent(state, "onRetryEvent", std::move(payload));
+}
+
+// Sends |payload| behind the download events the subscriptions queued, so
+// it cannot overtake the event it follows.
+void EmitAfterDownloadEvent(RuntimeState* state, const char* method,
+                            common::Value payload) {
+  if (state->subscriptions.HasQueued()) {
+    state->subscriptions.EnqueueAfter(method, std::move(payload));
+  } else {
+    EmitEvent(state, method, std::move(payload));
+  }
+}
+
+void EmitSettledWaiters(RuntimeState* state,
+                        std::vector<SettledWaiter>&& settled) {
+  for (SettledWaiter& waiter : settled) {
+    common::Value payload = common::Value::NewMap();
+    payload.Set("id", waiter.id);
+    payload.Set("results", std::move(waiter.results));
+    if (!waiter.error.empty()) {
+      payload.Set("error", waiter.error);
+    }
+    if (waiter.timed_out) {
+      payload.Set("timedOut", true);
+    }
+    EmitAfterDownloadEvent(state, "onDownloadSettled", std::move(payload));
+  }
+}
+
+void ForwardChecksumResult(RuntimeState* state, const ChecksumResult& result,
+                           aria2_download_event_t event) {
+  uint32_t slots = 0;
+  if (state->subscriptions.filtering()) {
+    slots = state->subscriptions.Match(event, result.gid);
+    if (slots == 0) {
+      return;
+    }
+  }
+  common::Value payload = common::Value::NewMap();
+  if (result.mismatch) {
+    payload.Set("errorCode", static_cast<int32_t>(kChecksumErrorCode));
+  }
+  if (!result.files.empty()) {
+    common::Value files = common::Value::NewList();
+    for (const FileDigest& file : result.files) {
+      common::Value entry = common::Value::NewMap();
+      entry.Set("index", static_cast<int32_t>(file.index));
+      entry.Set("path", file.path);
+      entry.Set("sha256", file.sha256);
+      if (!file.expected.empty()) {
+        entry.Set("expected", file.expected);
+        entry.Set("match", file.sha256 == file.expected);
+      }
+      files.Append(std::move(entry));
+    }
+    payload.Set("checksums", std::move(files));
+  }
+  if (slots != 0) {
+    // Delivered in the next batch like every other filtered event.
+    state->subscriptions.Enqueue(event, result.gid, slots, std::move(payload));
+    return;
+  }
+  payload.Set("event", static_cast<int32_t>(event));
+  payload.Set("gid", common::GidToHex(result.gid));
+  EmitEvent(state, "onDownloadEvent", std::move(payload));
+}
+
+// Delivers a completion event the checksum verifier held back. A digest
+// mismatch is reported as an error.
+void EmitChecksumResult(RuntimeState* state, const ChecksumResult& result) {
+  const aria2_download_event_t event =
+      result.mismatch ? ARIA2_EVENT_ON_DOWNLOAD_ERROR : result.event;
+  if (result.mismatch) {
+    // Recorded as complete when aria2 finished it.
+    state->registry.OnDownloadEvent(ARIA2_EVENT_ON_DOWNLOAD_ERROR, result.gid);
+    state->history.MarkFailed(result.gid, kChecksumErrorCode);
+  }
+  ForwardChecksumResult(state, result, event);
+  EmitSettledWaiters(state, state->waiters.OnDownloadEvent(
+                                state->session, event, result.gid, false,
+                                state->speeds));
+}
+
+void EmitFetchResult(RuntimeState* state, FetchResult&& result) {
+  common::Value payload = common::Value::NewMap();
+  payload.Set("gid", common::GidToHex(result.gid));
+  payload.Set("ok", result.ok);
+  if (result.ok) {
+    payload.Set("data", common::Value(std::move(result.data)));
+  } else {
+    payload.Set("error", result.error);
+    payload.Set("errorCode", result.error_code);
+    payload.Set("tooLarge", result.too_large);
+  }
+  EmitEvent(state, "onFetchComplete", std::move(payload));
+}
+
+void EmitStreamChunk(RuntimeState* state, StreamChunk&& chunk) {
+  common::Value payload = common::Value::NewMap();
+  payload.Set("id", chunk.id);
+  payload.Set("offset", chunk.offset);
+  if (!chunk.data.empty()) {
+    payload.Set("data", common::Value(std::move(chunk.data)));
+  }
+  if (chunk.done) {
+    payload.Set("done", true);
+  }
+  if (!chunk.error.empty()) {
+    payload.Set("error", chunk.error);
+  }
+  EmitEvent(state, "onStreamData", std::move(payload));
+}
+
+void EmitTriggerHits(RuntimeState* state,
+                     const std::vector<ProgressTriggerHit>& hits) {
+  common::Value list = common::Value::NewList();
+  for (const ProgressTriggerHit& hit : hits) {
+    common::Value entry = common::Value::NewMap();
+    entry.Set("id", hit.id);
+    entry.Set("gid", common::GidToHex(hit.gid));
+    entry.Set("totalLength", hit.total_length);
+    entry.Set("completedLength", hit.completed_length);
+    entry.Set("downloadSpeed", hit.speed);
+    entry.Set("avgSpeed", hit.avg_speed);
+    entry.Set("eta", hit.eta_seconds);
+    entry.Set("reasons", hit.reasons);
+    list.Append(std::move(entry));
+  }
+  common::Value payload = common::Value::NewMap();
+  payload.Set("hits", std::move(list));
+  EmitEvent(state, "onProgressTrigger", std::move(payload));
+}
+
+// Emits |event| right away, or while subscriptions are set, queues it for
+// the next batch if one wants it. Unwanted events are dropped before any
+// payload is built.
+void ForwardDownloadEvent(RuntimeState* state, aria2_download_event_t event,
+                          aria2_gid_t gid) {
+  if (state->subscriptions.filtering()) {
+    const uint32_t slots = state->subscriptions.Match(event, gid);
+    if (slots != 0) {
+      state->subscriptions.Enqueue(event, gid, slots);
+    }
+    return;
+  }
+  common::Value payload = common::Value::NewMap();
+  payload.Set("event", static_cast<int32_t>(event));
+  payload.Set("gid", common::GidToHex(gid));
+  EmitEvent(state, "onDownloadEvent", std::move(payload));
+}
+
+// Sends the events queued by ForwardDownloadEvent as one "onDownloadEvents"
+// call, then the events held back behind them.
+void FlushSubscribedEvents(RuntimeState* state) {
+  if (!state->subscriptions.HasQueued()) {
+    return;
+  }
+  EventSubscriptions::Batch batch = state->subscriptions.Take();
+  if (!batch.events.empty()) {
+    common::Value list = common::Value::NewList();
+    for (EventSubscriptions::Queued& queued : batch.events) {
+      common::Value entry = queued.fields.IsNull() ? common::Value::NewMap()
+                                                   : std::move(queued.fields);
+      entry.Set("event", static_cast<int32_t>(queued.event));
+      entry.Set("gid", common::GidToHex(queued.gid));
+      entry.Set("subscriptions", std::move(queued.names));
+      list.Append(std::move(entry));
+    }
+    common::Value payload = common::Value::NewMap();
+    payload.Set("events", std::move(list));
+    EmitEvent(state, "onDownloadEvents", std::move(payload));
+  }
+  for (auto& item : batch.after) {
+    EmitEvent(state, item.first, std::move(item.second));
+  }
+}
+
+int HandleDownloadEvent(aria2_session_t* session, aria2_download_event_t event,
+                        aria2_gid_t gid, void* user_data) {
+  auto* state = static_cast<RuntimeState*>(user_data);
+  if (state == nullptr) {
+    return 0;
+  }
+  bool retrying = false;
+  if (event == ARIA2_EVENT_ON_DOWNLOAD_ERROR) {
+    state->hosts.OnDownloadError(session, gid);
+    // Ask the scheduler for the priority before it forgets the download.
+    RetryAction action;
+    if (state->retry.OnDownloadError(session, gid,
+                                     state->scheduler.GetPriority(gid),
+                                     &action)) {
+      state->fetches.OnRetryAction(action);
+      retrying = action.kind == RetryActionKind::kScheduled;
+      EmitRetryAction(state, action);
+    }
+  } else if (event == ARIA2_EVENT_ON_DOWNLOAD_COMPLETE) {
+    state->hosts.OnDownloadComplete(session, gid);
+    state->retry.OnDownloadComplete(session, gid);
+  } else if (event == ARIA2_EVENT_ON_DOWNLOAD_START) {
+    state->hosts.OnDownloadStart(session, gid);
+  } else if (event == ARIA2_EVENT_ON_DOWNLOAD_PAUSE ||
+             event == ARIA2_EVENT_ON_DOWNLOAD_STOP) {
+    state->hosts.OnDownloadStop(gid);
+  }
+  state->scheduler.OnDownloadEvent(session, event, gid);
+  state->virtual_queue.OnDownloadEvent(session, event, gid);
+  state->registry.OnDownloadEvent(event, gid);
+  state->history.OnDownloadEvent(session, event, gid);
+  state->journal.OnDownloadEvent(session, event, gid);
+  state->resume.OnDownloadEvent(session, event, gid);
+  state->streams.OnDownloadEvent(event, gid);
+  state->bitfields.OnDownloadEvent(event, gid);
+  if (event == ARIA2_EVENT_ON_DOWNLOAD_COMPLETE ||
+      event == ARIA2_EVENT_ON_DOWNLOAD_ERROR ||
+      event == ARIA2_EVENT_ON_DOWNLOAD_STOP) {
+    state->retention.OnDownloadFinished(session, event, gid);
+  }
+  common::Value group;
+  const bool grouped =
+      state->groups.OnDownloadEvent(session, event, gid, &group);
+  bool held = false;
+  if (state->fetches.OnDownloadEvent(session, event, gid)) {
+    for (FetchResult& result : state->fetches.TakeResults()) {
+      EmitFetchResult(state, std::move(result));
+    }
+  } else if (state->checksums.OnDownloadEvent(session, event, gid)) {
+    held = true;
+  } else {
+    ForwardDownloadEvent(state, event, gid);
+  }
+  // After the member's own event, which the checksum verifier may still
+  // hold back or the subscriptions may have queued.
+  if (grouped) {
+    EmitAfterDownloadEvent(state, "onGroupEvent", std::move(group));
+  }
+  // Held completions settle their waiters once the digests are checked.
+  if (!held) {
+    EmitSettledWaiters(state, state->waiters.OnDownloadEvent(
+                                  session, event, gid, retrying,
+                                  state->speeds));
+  }
+  return 0;
+}
+
+void ResetComponents(RuntimeState* state) {
+  FlushSubscribedEvents(state);
+  state->subscriptions.Reset();
+  state->scheduler.Reset();
+  state->concurrency.Reset();
+  state->retry.Reset();
+  state->hosts.Reset();
+  state->virtual_queue.Reset();
+  state->registry.Reset();
+  state->retention.Reset();
+  state->history.Reset();
+  state->journal.Close();
+  state->resume.Reset();
+  state->bitfields.Reset();
+  state->groups.Reset();
+  state->speeds.Reset();
+  state->triggers.Reset();
+  for (const ChecksumResult& result : state->checksums.Reset()) {
+    EmitChecksumResult(state, result);
+  }
+  for (FetchResult& result : state->fetches.Reset("Session ended")) {
+    EmitFetchResult(state, std::move(result));
+  }
+  for (StreamChunk& chunk : state->streams.Reset("Session ended")) {
+    EmitStreamChunk(state, std::move(chunk));
+  }
+  EmitSettledWaiters(state, state->waiters.Reset("Session ended"));
+  common::Value progress;
+  if (state->importer.Abort("Session ended", &progress)) {
+    EmitEvent(state, "onImportProgress", std::move(progress));
+  }
+}
 }  // namespace
 
 int LibraryInit(RuntimeState* state) {
@@ -42,9 +335,11 @@ int LibraryDeinit(RuntimeState* state) {
   }
   StopRunLoop(state);
   WaitForPendingRun(state);
+  state->autotune.Stop();
   if (state->session != nullptr) {
     aria2_session_final(state->session);
     state->session = nullptr;
+    ResetComponents(state);
   }
   const int ret = aria2_library_deinit();
   state->library_initialized = false;
@@ -52,8 +347,7 @@ int LibraryDeinit(RuntimeState* state) {
 }
 
 const char* SessionNew(RuntimeState* state, const aria2_key_val_t* options,
-                       size_t options_count, bool keep_running,
-                       DownloadEventCallback callback, void* user_data) {
+                       size_t options_count, bool keep_running) {
   if (state == nullptr) {
     return "INVALID_STATE";
   }
@@ -63,12 +357,16 @@ const char* SessionNew(RuntimeState* state, const aria2_key_val_t* options,
   if (state->session != nullptr) {
     return "SESSION_EXISTS";
   }
+  if (state->autotune.running()) {
+    // aria2 supports one session per process; the benchmark owns it.
+    return "SESSION_FAILED";
+  }
 
   aria2_session_config_t config;
   aria2_session_config_init(&config);
   config.keep_running = keep_running ? 1 : 0;
-  config.download_event_callback = callback;
-  config.user_data = user_data;
+  config.download_event_callback = &HandleDownloadEvent;
+  config.user_data = state;
 
   state->session = aria2_session_new(options, options_count, &config);
   if (state->session == nullptr) {
@@ -93,6 +391,7 @@ const char* SessionFinal(RuntimeState* state, int* out_ret) {
     *out_ret = ret;
   }
   state->session = nullptr;
+  ResetComponents(state);
   return nullptr;
 }
 
@@ -104,7 +403,100 @@ int RunOnce(RuntimeState* state) {
     return 1;
   }
   RunInProgressGuard guard(&state->run_in_progress);
-  return aria2_run(state->session, ARIA2_RUN_ONCE);
+  const int ret = aria2_run(state->session, ARIA2_RUN_ONCE);
+  Tick(state);
+  return ret;
+}
+
+void OnDownloadAdded(RuntimeState* state, aria2_gid_t gid, Priority priority,
+                     DownloadHints hints) {
+  state->registry.OnAdded(gid);
+  state->journal.OnAdded(gid, hints.uris, hints.options);
+  state->scheduler.Track(gid, priority, std::move(hints));
+}
+
+void Tick(RuntimeState* state) {
+  if (state == nullptr || state->session == nullptr) {
+    return;
+  }
+  FlushSubscribedEvents(state);
+  state->scheduler.OnTick(state->session);
+  state->concurrency.OnTick(state->session, &state->metrics);
+  state->hosts.OnTick(state->session);
+  state->speeds.OnTick(state->session);
+  const std::vector<ProgressTriggerHit> hits =
+      state->triggers.OnTick(state->session, state->speeds);
+  if (!hits.empty()) {
+    EmitTriggerHits(state, hits);
+  }
+  for (const RetryAction& action : state->retry.OnTick(state->session)) {
+    const bool fetch = state->fetches.OnRetryAction(action);
+    if (action.kind == RetryActionKind::kRetried) {
+      state->groups.OnRetried(action.gid, action.new_gid);
+      state->subscriptions.OnRetried(action.gid, action.new_gid);
+      state->waiters.OnRetried(action.gid, action.new_gid);
+      DownloadHints hints;
+      // Fetches are not journaled: their data only lives in memory.
+      if (!fetch) {
+        hints.uris = action.uris;
+      }
+      hints.options = action.options;
+      OnDownloadAdded(state, action.new_gid, action.priority, std::move(hints));
+    }
+    EmitRetryAction(state, action);
+    if (action.kind == RetryActionKind::kGaveUp) {
+      EmitSettledWaiters(state, state->waiters.OnGaveUp(
+                                    state->session, action.gid,
+                                    state->speeds));
+    }
+  }
+  for (VirtualQueue::Materialized& item :
+       state->virtual_queue.OnTick(state->session)) {
+    DownloadHints hints;
+    hints.uris = std::move(item.uris);
+    hints.options = std::move(item.options);
+    OnDownloadAdded(state, item.gid, Priority::kNormal, std::move(hints));
+    common::Value payload = common::Value::NewMap();
+    payload.Set("id", item.id);
+    payload.Set("gid", common::GidToHex(item.gid));
+    EmitEvent(state, "onVirtualMaterialized", std::move(payload));
+  }
+  std::vector<ImportedDownload> imported;
+  common::Value progress;
+  const bool report = state->importer.OnTick(
+      state->session, &state->virtual_queue, &imported, &progress);
+  for (ImportedDownload& download : imported) {
+    DownloadHints hints;
+    hints.uris = std::move(download.uris);
+    hints.options = std::move(download.options);
+    OnDownloadAdded(state, download.gid, Priority::kNormal, std::move(hints));
+  }
+  if (report) {
+    EmitEvent(state, "onImportProgress", std::move(progress));
+  }
+  for (aria2_gid_t gid : state->retention.OnTick(state->session)) {
+    state->registry.Erase(gid);
+    state->retry.Forget(gid);
+    state->bitfields.Forget(gid);
+    state->groups.Forget(gid);
+    state->speeds.Forget(gid);
+    state->subscriptions.Forget(gid);
+  }
+  state->checksums.OnTick(state->session);
+  for (const ChecksumResult& result : state->checksums.TakeResults()) {
+    EmitChecksumResult(state, result);
+  }
+  EmitSettledWaiters(state, state->waiters.OnTick(state->session, state->speeds,
+                                                  state->checksums,
+                                                  state->retry));
+  state->fetches.OnTick(state->session);
+  for (FetchResult& result : state->fetches.TakeResults()) {
+    EmitFetchResult(state, std::move(result));
+  }
+  for (StreamChunk& chunk : state->streams.OnTick(state->session)) {
+    EmitStreamChunk(state, std::move(chunk));
+  }
+  state->journal.OnTick();
 }
 
 void StartRunLoop(RuntimeState* state) {
@@ -118,8 +510,13 @@ void StartRunLoop(RuntimeState* state) {
   if (state->run_thread.joinable()) {
     state->run_thread.join();
   }
+  // Iterate ARIA2_RUN_ONCE instead of blocking in ARIA2_RUN_DEFAULT so the
+  // native components get a tick between event-loop iterations. The loop
+  // still only ends when aria2 itself reports completion or shutdown.
   state->run_thread = std::thread([state, session]() {
-    aria2_run(session, ARIA2_RUN_DEFAULT);
+    while (aria2_run(session, ARIA2_RUN_ONCE) == 1) {
+      Tick(state);
+    }
     state->run_loop_active.store(false);
   });
 }
@@ -160,6 +557,13 @@ void WaitForPendingRun(RuntimeState* state) {
   }
 }
 
+void EmitEvent(RuntimeState* state, const char* method, common::Value payload) {
+  if (state == nullptr || state->event_sink == nullptr) {
+    return;
+  }
+  state->event_sink(method, std::move(payload), state->event_sink_user_data);
+}
+
 void CleanupState(RuntimeState* state) {
   if (state == nullptr) {
     return;
@@ -167,10 +571,16 @@ void CleanupState(RuntimeState* state) {
   // Same order as SessionFinal: stop run loop -> wait -> finalize session -> deinit library.
   StopRunLoop(state);
   WaitForPendingRun(state);
+  state->autotune.Stop();
   if (state->session != nullptr) {
     aria2_session_final(state->session);
     state->session = nullptr;
+    ResetComponents(state);
   }
+  state->virtual_queue.Close();
+  state->history.Close();
+  state->resume.Close();
+  state->torrents.Stop();
   if (state->library_initialized) {
     aria2_library_deinit();
     state->library_initialized = false;
@@ -7,9 +7,40 @@
 #include <cstddef>
 #include <thread>
 
+#include "aria2_autotune.h"
+#include "aria2_bitfield.h"
+#include "aria2_checksum.h"
+#include "aria2_concurrency.h"
+#include "aria2_fetch.h"
+#include "aria2_group.h"
+#include "aria2_history.h"
+#include "aria2_hoststats.h"
+#include "aria2_import.h"
+#include "aria2_journal.h"
+#include "aria2_metrics.h"
+#include "aria2_registry.h"
+#include "aria2_resume.h"
+#include "aria2_retention.h"
+#include "aria2_retry.h"
+#include "aria2_scheduler.h"
+#include "aria2_speed.h"
+#include "aria2_stream.h"
+#include "aria2_subscription.h"
+#include "aria2_timing.h"
+#include "aria2_torrent.h"
+#include "aria2_trigger.h"
+#include "aria2_value.h"
+#include "aria2_virtual_queue.h"
+#include "aria2_waiter.h"
+
 namespace flutter_aria2 {
 namespace core {
 
+// Forwards a native event (Dart-side method name plus payload) to the
+// platform channel. May be called from the aria2 run-loop thread.
+using NativeEventSink = void (*)(const char* method, common::Value&& payload,
+                                 void* user_data);
+
 struct RuntimeState {
   aria2_session_t* session = nullptr;
   bool library_initialized = false;
@@ -17,56 +48,74 @@ struct RuntimeState {
   std::atomic<bool> run_loop_active{false};
   std::atomic<bool> run_in_progress{false};
 
-  RuntimeState() = default;
+  NativeEventSink event_sink = nullptr;
+  void* event_sink_user_data = nullptr;
+
+  QueueScheduler scheduler;
+  ConcurrencyController concurrency;
+  RetryEngine retry;
+  HostStatsTable hosts;
+  VirtualQueue virtual_queue;
+  InputImporter importer;
+  DownloadRegistry registry;
+  RetentionManager retention;
+  HistoryStore history;
+  SessionJournal journal;
+  ResumeCache resume;
+  ChecksumVerifier checksums;
+  MetricsLog metrics;
+  Autotuner autotune;
+  TorrentCreator torrents;
+  MemoryFetcher fetches;
+  ProgressiveStreams streams;
+  PieceBitfields bitfields;
+  DownloadGroups groups;
+  SpeedHistory speeds;
+  ProgressTriggers triggers;
+  EventSubscriptions subscriptions;
+  DownloadWaiters waiters;
+  MethodTimings timings;
 
-  RuntimeState(RuntimeState&& other) noexcept
-      : session(other.session),
-        library_initialized(other.library_initialized),
-        run_thread(std::move(other.run_thread)),
-        run_loop_active(other.run_loop_active.load()),
-        run_in_progress(other.run_in_progress.load()) {
-    other.session = nullptr;
-    other.library_initialized = false;
-  }
-
-  RuntimeState& operator=(RuntimeState&& other) noexcept {
-    if (this == &other) return *this;
-    session = other.session;
-    library_initialized = other.library_initialized;
-    run_thread = std::move(other.run_thread);
-    run_loop_active.store(other.run_loop_active.load());
-    run_in_progress.store(other.run_in_progress.load());
-    other.session = nullptr;
-    other.library_initialized = false;
-    return *this;
-  }
+  RuntimeState() = default;
 
   RuntimeState(const RuntimeState&) = delete;
   RuntimeState& operator=(const RuntimeState&) = delete;
 };
 
-using DownloadEventCallback =
-    int (*)(aria2_session_t*, aria2_download_event_t, aria2_gid_t, void*);
-
 int LibraryInit(RuntimeState* state);
 int LibraryDeinit(RuntimeState* state);
 
 // Returns nullptr on success; otherwise returns a static error code string.
+// Fails with SESSION_FAILED while an autotune benchmark holds aria2.
+// Download events are routed through the native components and then emitted
+// as "onDownloadEvent" via |state->event_sink|, or queued for one
+// "onDownloadEvents" batch per tick while event subscriptions are set.
 const char* SessionNew(RuntimeState* state, const aria2_key_val_t* options,
-                       size_t options_count, bool keep_running,
-                       DownloadEventCallback callback, void* user_data);
+                       size_t options_count, bool keep_running);
 
 const char* SessionFinal(RuntimeState* state, int* out_ret);
 
 // Mirrors existing plugin behavior: returns 1 when a run is already in progress.
 int RunOnce(RuntimeState* state);
 
+// Registers a download the plugin just added with the native components.
+void OnDownloadAdded(RuntimeState* state, aria2_gid_t gid, Priority priority,
+                     DownloadHints hints);
+
+// Periodic work of the native components. Called on the thread driving
+// aria2_run after every iteration.
+void Tick(RuntimeState* state);
+
 void StartRunLoop(RuntimeState* state);
 void StopRunLoop(RuntimeState* state);
 
 const char* Shutdown(RuntimeState* state, bool force, int* out_ret);
 
 void WaitForPendingRun(RuntimeState* state);
+
+// Sends |payload| to Dart as a call of |method| through the platform sink.
+void EmitEvent(RuntimeState* state, const char* method, common::Value payload);
+
 void CleanupState(RuntimeState* state);
 
 // ─── State checks (return error code string or nullptr if OK) ───
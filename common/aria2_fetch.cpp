@@ -0,0 +1,233 @@
+#include "aria2_fetch.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "aria2_mapped_file.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+MemoryFetcher::~MemoryFetcher() { Reset(""); }
+
+std::string MemoryFetcher::Prepare(const std::string& fallback_dir,
+                                   common::KeyVals* options) {
+  std::string dir = common::TemporaryDirectory();
+  if (dir.empty()) {
+    dir = fallback_dir;
+  }
+  const auto now = std::chrono::system_clock::now().time_since_epoch();
+  std::string name;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    name = ".flutter_aria2-fetch-" +
+           std::to_string(
+               std::chrono::duration_cast<std::chrono::microseconds>(now)
+                   .count()) +
+           "-" + std::to_string(next_id_++);
+  }
+  options->Set("dir", dir);
+  options->Set("out", name);
+  options->Set("allow-overwrite", "true");
+  options->Set("auto-file-renaming", "false");
+  options->Set("file-allocation", "none");
+  return dir + "/" + name;
+}
+
+void MemoryFetcher::Track(aria2_gid_t gid, std::string path,
+                          int64_t max_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Fetch& fetch = fetches_[gid];
+  fetch.path = std::move(path);
+  fetch.max_bytes = max_bytes;
+}
+
+bool MemoryFetcher::OnDownloadEvent(aria2_session_t* session,
+                                    aria2_download_event_t event,
+                                    aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = fetches_.find(gid);
+  if (it == fetches_.end()) {
+    return false;
+  }
+  if (it->second.retrying ||
+      (event != ARIA2_EVENT_ON_DOWNLOAD_COMPLETE &&
+       event != ARIA2_EVENT_ON_DOWNLOAD_ERROR &&
+       event != ARIA2_EVENT_ON_DOWNLOAD_STOP)) {
+    return true;
+  }
+  int32_t error_code = 0;
+  if (event == ARIA2_EVENT_ON_DOWNLOAD_ERROR) {
+    if (aria2_download_handle_t* handle =
+            aria2_get_download_handle(session, gid)) {
+      error_code = aria2_download_handle_get_error_code(handle);
+      aria2_delete_download_handle(handle);
+    }
+  }
+  const Fetch fetch = std::move(it->second);
+  fetches_.erase(it);
+  FinishLocked(event, gid, fetch, error_code);
+  return true;
+}
+
+bool MemoryFetcher::OnRetryAction(const RetryAction& action) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = fetches_.find(action.gid);
+  if (it == fetches_.end()) {
+    return false;
+  }
+  switch (action.kind) {
+    case RetryActionKind::kScheduled:
+      it->second.retrying = true;
+      break;
+    case RetryActionKind::kRetried: {
+      // The retry is added with the same options, so it writes to the same
+      // staging file.
+      Fetch fetch = std::move(it->second);
+      fetches_.erase(it);
+      fetch.retrying = false;
+      fetches_[action.new_gid] = std::move(fetch);
+      break;
+    }
+    case RetryActionKind::kGaveUp:
+      // Without a scheduled retry the error event is still to come and
+      // finishes the fetch.
+      if (it->second.retrying) {
+        const Fetch fetch = std::move(it->second);
+        fetches_.erase(it);
+        FinishLocked(ARIA2_EVENT_ON_DOWNLOAD_ERROR, action.gid, fetch,
+                     action.error_code);
+      }
+      break;
+  }
+  return true;
+}
+
+void MemoryFetcher::FinishLocked(aria2_download_event_t event,
+                                 aria2_gid_t gid, const Fetch& fetch,
+                                 int32_t error_code) {
+  FetchResult result;
+  result.gid = gid;
+  result.error_code = error_code;
+  result.too_large = fetch.too_large;
+  if (event == ARIA2_EVENT_ON_DOWNLOAD_COMPLETE && !fetch.too_large) {
+    int64_t size = 0;
+    int64_t mtime_ns = 0;
+    common::InputFile input;
+    if (!common::StatFile(fetch.path, &size, &mtime_ns) ||
+        !input.Open(fetch.path)) {
+      result.error = "Cannot open " + fetch.path;
+    } else if (size > fetch.max_bytes) {
+      result.too_large = true;
+    } else {
+      result.data.resize(static_cast<size_t>(size));
+      int64_t done = 0;
+      while (done < size) {
+        const int64_t read =
+            input.ReadAt(done, result.data.data() + done,
+                         static_cast<size_t>(size - done));
+        if (read <= 0) {
+          break;
+        }
+        done += read;
+      }
+      result.ok = done == size;
+      if (!result.ok) {
+        result.error = "Cannot read " + fetch.path;
+        result.data.clear();
+      }
+    }
+  } else if (event == ARIA2_EVENT_ON_DOWNLOAD_ERROR) {
+    result.error =
+        "Download failed with error code " + std::to_string(result.error_code);
+  } else if (!fetch.too_large) {
+    result.error = "Download was removed";
+  }
+  if (result.too_large) {
+    result.error = "Larger than " + std::to_string(fetch.max_bytes) + " bytes";
+  }
+  common::RemoveFile(fetch.path);
+  common::RemoveFile(fetch.path + ".aria2");
+
+  if (result.ok) {
+    ++completed_;
+    bytes_delivered_ += static_cast<int64_t>(result.data.size());
+  } else {
+    ++failed_;
+  }
+  results_.push_back(std::move(result));
+}
+
+void MemoryFetcher::OnTick(aria2_session_t* session) {
+  std::vector<aria2_gid_t> oversized;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto now = std::chrono::steady_clock::now();
+    if (fetches_.empty() ||
+        now - last_tick_ < std::chrono::milliseconds(kFetchTickMs)) {
+      return;
+    }
+    last_tick_ = now;
+    for (auto& item : fetches_) {
+      Fetch& fetch = item.second;
+      if (fetch.too_large || fetch.retrying) {
+        continue;
+      }
+      aria2_download_handle_t* handle =
+          aria2_get_download_handle(session, item.first);
+      if (handle == nullptr) {
+        continue;
+      }
+      const int64_t length =
+          std::max(aria2_download_handle_get_total_length(handle),
+                   aria2_download_handle_get_completed_length(handle));
+      aria2_delete_download_handle(handle);
+      if (length > fetch.max_bytes) {
+        fetch.too_large = true;
+        oversized.push_back(item.first);
+      }
+    }
+  }
+  // The stop event finishes the fetch as too large.
+  for (aria2_gid_t gid : oversized) {
+    aria2_remove_download(session, gid, 1);
+  }
+}
+
+std::vector<FetchResult> MemoryFetcher::TakeResults() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<FetchResult> out;
+  out.swap(results_);
+  return out;
+}
+
+common::Value MemoryFetcher::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewMap();
+  out.Set("active", static_cast<int64_t>(fetches_.size()));
+  out.Set("completed", completed_);
+  out.Set("failed", failed_);
+  out.Set("bytesDelivered", bytes_delivered_);
+  out.Set("stagingDir", common::TemporaryDirectory());
+  return out;
+}
+
+std::vector<FetchResult> MemoryFetcher::Reset(const std::string& reason) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<FetchResult> out;
+  out.swap(results_);
+  for (const auto& item : fetches_) {
+    common::RemoveFile(item.second.path);
+    common::RemoveFile(item.second.path + ".aria2");
+    FetchResult result;
+    result.gid = item.first;
+    result.error = reason;
+    out.push_back(std::move(result));
+  }
+  failed_ += static_cast<int64_t>(fetches_.size());
+  fetches_.clear();
+  return out;
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
@@ -0,0 +1,104 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_FETCH_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_FETCH_H_
+
+#include <aria2_c_api.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "aria2_helpers.h"
+#include "aria2_retry.h"
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+constexpr int64_t kDefaultFetchMaxBytes = 16 * 1024 * 1024;
+
+struct FetchResult {
+  aria2_gid_t gid = 0;
+  bool ok = false;
+  bool too_large = false;
+  int32_t error_code = 0;  // aria2's, when it failed the download.
+  std::string error;
+  common::Value::Bytes data;
+};
+
+// Downloads small resources into memory. aria2 only writes to files, so a
+// fetch is staged in a uniquely named file under TemporaryDirectory(), which
+// is tmpfs (/dev/shm) on Linux, or under the download directory where there
+// is none. When the download completes the file is read into one buffer and
+// deleted together with its control file.
+//
+// Fetches do not produce download events: OnDownloadEvent claims their
+// events and the outcome is delivered through TakeResults instead.
+class MemoryFetcher {
+ public:
+  static constexpr int kFetchTickMs = 100;
+
+  MemoryFetcher() = default;
+  ~MemoryFetcher();
+
+  MemoryFetcher(const MemoryFetcher&) = delete;
+  MemoryFetcher& operator=(const MemoryFetcher&) = delete;
+
+  // Points |options| at a new staging file and returns its path.
+  std::string Prepare(const std::string& fallback_dir,
+                      common::KeyVals* options);
+
+  // Starts tracking |gid|, added with options from Prepare. A download that
+  // grows past |max_bytes| is removed and reported as too large.
+  void Track(aria2_gid_t gid, std::string path, int64_t max_bytes);
+
+  // Runs in the download event callback. Returns true when |gid| is a
+  // fetch; complete, error and stop events finish it.
+  bool OnDownloadEvent(aria2_session_t* session, aria2_download_event_t event,
+                       aria2_gid_t gid);
+
+  // Follows a fetch through the retry engine: it stays pending while a
+  // retry is scheduled, moves to the new gid when retried and fails when
+  // the engine gives up. Returns true when the action is for a fetch.
+  bool OnRetryAction(const RetryAction& action);
+
+  // Removes fetches whose size exceeds their limit, at most every
+  // kFetchTickMs.
+  void OnTick(aria2_session_t* session);
+
+  // Fetches finished since the last call.
+  std::vector<FetchResult> TakeResults();
+
+  // {active, completed, failed, bytesDelivered, stagingDir}.
+  common::Value Describe() const;
+
+  // Fails the pending fetches with |reason| and deletes their files.
+  std::vector<FetchResult> Reset(const std::string& reason);
+
+ private:
+  struct Fetch {
+    std::string path;
+    int64_t max_bytes = kDefaultFetchMaxBytes;
+    bool too_large = false;
+    bool retrying = false;  // Failed, with a retry scheduled.
+  };
+
+  void FinishLocked(aria2_download_event_t event, aria2_gid_t gid,
+                    const Fetch& fetch, int32_t error_code);
+
+  mutable std::mutex mutex_;
+  std::unordered_map<aria2_gid_t, Fetch> fetches_;
+  std::vector<FetchResult> results_;
+  uint64_t next_id_ = 0;
+  int64_t completed_ = 0;
+  int64_t failed_ = 0;
+  int64_t bytes_delivered_ = 0;
+  std::chrono::steady_clock::time_point last_tick_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_FETCH_H_
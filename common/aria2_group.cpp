@@ -0,0 +1,373 @@
+#include "aria2_group.h"
+
+#include <algorithm>
+#include <deque>
+#include <unordered_set>
+#include <utility>
+
+#include "aria2_helpers.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+// Deeper trees than aria2 ever builds mean a cycle in stale links.
+constexpr int kMaxGroupDepth = 16;
+
+bool GroupMemberStopped(int status) {
+  return status == common::kStatusComplete ||
+         status == common::kStatusError || status == common::kStatusRemoved;
+}
+
+// The status an event leaves a member in, or -1 when it says nothing.
+int GroupStatusForEvent(aria2_download_event_t event) {
+  switch (event) {
+    case ARIA2_EVENT_ON_DOWNLOAD_START:
+      return common::kStatusActive;
+    case ARIA2_EVENT_ON_DOWNLOAD_PAUSE:
+      return common::kStatusPaused;
+    case ARIA2_EVENT_ON_DOWNLOAD_STOP:
+      return common::kStatusRemoved;
+    case ARIA2_EVENT_ON_DOWNLOAD_COMPLETE:
+    case ARIA2_EVENT_ON_BT_DOWNLOAD_COMPLETE:
+      // A torrent that went on seeding is done as far as its group goes.
+      return common::kStatusComplete;
+    case ARIA2_EVENT_ON_DOWNLOAD_ERROR:
+      return common::kStatusError;
+    default:
+      return -1;
+  }
+}
+
+// Counts a torrent that completed and went on seeding as complete.
+int GroupProgressStatus(int status, int64_t total_length,
+                        int64_t completed_length) {
+  if (status == common::kStatusActive && total_length > 0 &&
+      completed_length >= total_length) {
+    return common::kStatusComplete;
+  }
+  return status;
+}
+}  // namespace
+
+bool DownloadGroups::LinkLocked(aria2_session_t* session, aria2_gid_t gid,
+                                Sample* sample) {
+  aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+  if (handle == nullptr) {
+    return false;
+  }
+  const aria2_gid_t belongs_to = aria2_download_handle_get_belongs_to(handle);
+  const aria2_gid_t parent = belongs_to != 0
+                                 ? belongs_to
+                                 : aria2_download_handle_get_following(handle);
+  if (parent != 0 && parent != gid) {
+    AddEdgeLocked(parent, gid);
+  }
+  aria2_gid_t* followed_by = nullptr;
+  size_t followed_count = 0;
+  if (aria2_download_handle_get_followed_by(handle, &followed_by,
+                                            &followed_count) == 0) {
+    for (size_t i = 0; i < followed_count; ++i) {
+      if (followed_by[i] != gid) {
+        AddEdgeLocked(gid, followed_by[i]);
+      }
+    }
+    if (followed_by != nullptr) {
+      aria2_free(followed_by);
+    }
+  }
+  sample->status = static_cast<int>(aria2_download_handle_get_status(handle));
+  sample->total_length = aria2_download_handle_get_total_length(handle);
+  sample->completed_length = aria2_download_handle_get_completed_length(handle);
+  sample->download_speed = aria2_download_handle_get_download_speed(handle);
+  sample->upload_speed = aria2_download_handle_get_upload_speed(handle);
+  aria2_delete_download_handle(handle);
+  auto it = members_.find(gid);
+  if (it != members_.end()) {
+    it->second.status =
+        GroupProgressStatus(sample->status, sample->total_length,
+                            sample->completed_length);
+    it->second.total_length = sample->total_length;
+    it->second.completed_length = sample->completed_length;
+  }
+  return true;
+}
+
+void DownloadGroups::AddEdgeLocked(aria2_gid_t parent, aria2_gid_t child) {
+  auto existing = members_.find(child);
+  if (existing != members_.end() && existing->second.parent == parent) {
+    return;
+  }
+  // Refuse links that would close a cycle.
+  aria2_gid_t up = parent;
+  for (int depth = 0; up != 0 && depth < kMaxGroupDepth; ++depth) {
+    if (up == child) {
+      return;
+    }
+    auto it = members_.find(up);
+    up = it == members_.end() ? 0 : it->second.parent;
+  }
+  members_[parent];
+  Member& member = members_[child];
+  if (member.parent != 0) {
+    std::vector<aria2_gid_t>& siblings = members_[member.parent].children;
+    siblings.erase(std::remove(siblings.begin(), siblings.end(), child),
+                   siblings.end());
+  }
+  member.parent = parent;
+  members_[parent].children.push_back(child);
+}
+
+aria2_gid_t DownloadGroups::RootLocked(aria2_session_t* session,
+                                       aria2_gid_t gid) {
+  for (int depth = 0; depth < kMaxGroupDepth; ++depth) {
+    Sample sample;
+    if (session != nullptr) {
+      LinkLocked(session, gid, &sample);
+    }
+    auto it = members_.find(gid);
+    if (it == members_.end() || it->second.parent == 0) {
+      break;
+    }
+    gid = it->second.parent;
+  }
+  return gid;
+}
+
+std::vector<aria2_gid_t> DownloadGroups::TreeLocked(aria2_gid_t root) const {
+  std::vector<aria2_gid_t> out;
+  if (members_.count(root) == 0) {
+    return out;
+  }
+  out.push_back(root);
+  for (size_t i = 0; i < out.size() && i < members_.size(); ++i) {
+    const Member& member = members_.at(out[i]);
+    out.insert(out.end(), member.children.begin(), member.children.end());
+  }
+  return out;
+}
+
+std::vector<aria2_gid_t> DownloadGroups::CollectLocked(
+    aria2_session_t* session, aria2_gid_t root, std::vector<Sample>* samples) {
+  std::vector<aria2_gid_t> out;
+  std::unordered_set<aria2_gid_t> seen;
+  std::deque<aria2_gid_t> queue = {root};
+  while (!queue.empty()) {
+    const aria2_gid_t gid = queue.front();
+    queue.pop_front();
+    if (!seen.insert(gid).second) {
+      continue;
+    }
+    Sample sample;
+    const bool live = LinkLocked(session, gid, &sample);
+    auto it = members_.find(gid);
+    if (!live) {
+      if (it == members_.end()) {
+        continue;
+      }
+      sample.status = it->second.status;
+      sample.total_length = it->second.total_length;
+      sample.completed_length = it->second.completed_length;
+    }
+    out.push_back(gid);
+    if (samples != nullptr) {
+      samples->push_back(sample);
+    }
+    if (it != members_.end()) {
+      queue.insert(queue.end(), it->second.children.begin(),
+                   it->second.children.end());
+    }
+  }
+  return out;
+}
+
+bool DownloadGroups::OnDownloadEvent(aria2_session_t* session,
+                                     aria2_download_event_t event,
+                                     aria2_gid_t gid, common::Value* out) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Sample sample;
+  LinkLocked(session, gid, &sample);
+  auto it = members_.find(gid);
+  if (it == members_.end()) {
+    return false;
+  }
+  const int status = GroupStatusForEvent(event);
+  if (status >= 0) {
+    it->second.status = status;
+  }
+  const aria2_gid_t root = RootLocked(nullptr, gid);
+  int64_t counts[common::kStatusRemoved + 1] = {};
+  int64_t members = 0;
+  bool finished = true;
+  for (aria2_gid_t member : TreeLocked(root)) {
+    const int member_status = members_.at(member).status;
+    if (member_status >= 0) {
+      ++counts[member_status];
+    }
+    finished = finished && GroupMemberStopped(member_status);
+    ++members;
+  }
+  *out = common::Value::NewMap();
+  out->Set("rootGid", common::GidToHex(root));
+  out->Set("gid", common::GidToHex(gid));
+  out->Set("event", static_cast<int32_t>(event));
+  out->Set("members", members);
+  out->Set("complete", counts[common::kStatusComplete]);
+  out->Set("error", counts[common::kStatusError]);
+  out->Set("removed", counts[common::kStatusRemoved]);
+  out->Set("finished", finished);
+  return true;
+}
+
+void DownloadGroups::OnRetried(aria2_gid_t old_gid, aria2_gid_t new_gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = members_.find(old_gid);
+  if (it == members_.end() || members_.count(new_gid) > 0) {
+    return;
+  }
+  Member member = std::move(it->second);
+  members_.erase(it);
+  member.status = common::kStatusWaiting;
+  member.forgotten = false;
+  if (member.parent != 0) {
+    for (aria2_gid_t& sibling : members_[member.parent].children) {
+      if (sibling == old_gid) {
+        sibling = new_gid;
+      }
+    }
+  }
+  for (aria2_gid_t child : member.children) {
+    auto child_it = members_.find(child);
+    if (child_it != members_.end()) {
+      child_it->second.parent = new_gid;
+    }
+  }
+  members_[new_gid] = std::move(member);
+}
+
+bool DownloadGroups::Progress(aria2_session_t* session, aria2_gid_t gid,
+                              common::Value* out) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const aria2_gid_t root = RootLocked(session, gid);
+  std::vector<Sample> samples;
+  const std::vector<aria2_gid_t> members =
+      CollectLocked(session, root, &samples);
+  if (members.empty()) {
+    return false;
+  }
+  int64_t counts[common::kStatusRemoved + 1] = {};
+  int64_t total_length = 0;
+  int64_t completed_length = 0;
+  int64_t download_speed = 0;
+  int64_t upload_speed = 0;
+  bool finished = true;
+  common::Value gids = common::Value::NewList();
+  for (size_t i = 0; i < members.size(); ++i) {
+    const Sample& sample = samples[i];
+    const int status = GroupProgressStatus(
+        sample.status, sample.total_length, sample.completed_length);
+    // Not yet started followers have not reported a status.
+    ++counts[status >= 0 ? status : common::kStatusWaiting];
+    finished = finished && GroupMemberStopped(status);
+    total_length += sample.total_length;
+    completed_length += sample.completed_length;
+    download_speed += sample.download_speed;
+    upload_speed += sample.upload_speed;
+    gids.Append(common::GidToHex(members[i]));
+  }
+  *out = common::Value::NewMap();
+  out->Set("rootGid", common::GidToHex(root));
+  out->Set("gids", std::move(gids));
+  out->Set("members", static_cast<int64_t>(members.size()));
+  out->Set("active", counts[common::kStatusActive]);
+  out->Set("waiting", counts[common::kStatusWaiting]);
+  out->Set("paused", counts[common::kStatusPaused]);
+  out->Set("complete", counts[common::kStatusComplete]);
+  out->Set("error", counts[common::kStatusError]);
+  out->Set("removed", counts[common::kStatusRemoved]);
+  out->Set("totalLength", total_length);
+  out->Set("completedLength", completed_length);
+  out->Set("downloadSpeed", download_speed);
+  out->Set("uploadSpeed", upload_speed);
+  out->Set("finished", finished);
+  return true;
+}
+
+int DownloadGroups::Apply(aria2_session_t* session, aria2_gid_t gid,
+                          Action action, bool force) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const aria2_gid_t root = RootLocked(session, gid);
+  std::vector<Sample> samples;
+  const std::vector<aria2_gid_t> members =
+      CollectLocked(session, root, &samples);
+  if (members.empty()) {
+    return -1;
+  }
+  int applied = 0;
+  for (size_t i = 0; i < members.size(); ++i) {
+    const int status = samples[i].status;
+    int ret = -1;
+    switch (action) {
+      case Action::kPause:
+        if (status == common::kStatusActive ||
+            status == common::kStatusWaiting) {
+          ret = aria2_pause_download(session, members[i], force ? 1 : 0);
+        }
+        break;
+      case Action::kUnpause:
+        if (status == common::kStatusPaused) {
+          ret = aria2_unpause_download(session, members[i]);
+        }
+        break;
+      case Action::kRemove:
+        if (status >= 0 && !GroupMemberStopped(status)) {
+          ret = aria2_remove_download(session, members[i], force ? 1 : 0);
+        }
+        break;
+    }
+    if (ret == 0) {
+      ++applied;
+    }
+  }
+  return applied;
+}
+
+void DownloadGroups::Forget(aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = members_.find(gid);
+  if (it == members_.end()) {
+    return;
+  }
+  it->second.forgotten = true;
+  const std::vector<aria2_gid_t> tree = TreeLocked(RootLocked(nullptr, gid));
+  for (aria2_gid_t member : tree) {
+    if (!members_.at(member).forgotten) {
+      return;
+    }
+  }
+  for (aria2_gid_t member : tree) {
+    members_.erase(member);
+  }
+}
+
+common::Value DownloadGroups::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  int64_t groups = 0;
+  for (const auto& item : members_) {
+    if (item.second.parent == 0) {
+      ++groups;
+    }
+  }
+  common::Value out = common::Value::NewMap();
+  out.Set("groups", groups);
+  out.Set("members", static_cast<int64_t>(members_.size()));
+  return out;
+}
+
+void DownloadGroups::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  members_.clear();
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
@@ -0,0 +1,107 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_GROUP_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_GROUP_H_
+
+#include <aria2_c_api.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// Tracks the trees aria2 grows out of a single request: a .torrent or
+// metalink fetched over HTTP and a magnet's metadata download are followed
+// by the downloads they describe ("followedBy" / "following"), and the
+// downloads of a metalink entry belong to their parent ("belongsTo").
+//
+// Links are read from aria2 whenever a member reports an event and again
+// while a group is walked, so a group is complete even when it was never
+// seen before the query. Each member keeps its last known status and
+// lengths, which stand in for members that retention already dropped from
+// aria2. The whole tree is forgotten once all of its members were.
+class DownloadGroups {
+ public:
+  enum class Action { kPause, kUnpause, kRemove };
+
+  DownloadGroups() = default;
+
+  DownloadGroups(const DownloadGroups&) = delete;
+  DownloadGroups& operator=(const DownloadGroups&) = delete;
+
+  // Runs in the download event callback. When |gid| is part of a group,
+  // fills |out| with {rootGid, gid, event, members, complete, error,
+  // removed, finished} and returns true. The counts come from the statuses
+  // the members last reported, so no member is queried.
+  bool OnDownloadEvent(aria2_session_t* session, aria2_download_event_t event,
+                       aria2_gid_t gid, common::Value* out);
+
+  // Moves the group entry of a retried download to its new gid.
+  void OnRetried(aria2_gid_t old_gid, aria2_gid_t new_gid);
+
+  // Fills |out| with the progress of the group of |gid|, any of its
+  // members: {rootGid, gids, members, active, waiting, paused, complete,
+  // error, removed, totalLength, completedLength, downloadSpeed,
+  // uploadSpeed, finished}. Returns false when |gid| is unknown.
+  bool Progress(aria2_session_t* session, aria2_gid_t gid,
+                common::Value* out);
+
+  // Applies |action| to every member of the group of |gid| it fits (pause
+  // to active and waiting members, unpause to paused ones, remove to all
+  // that have not stopped), root first. Returns how many members accepted
+  // it, or -1 when |gid| is unknown.
+  int Apply(aria2_session_t* session, aria2_gid_t gid, Action action,
+            bool force);
+
+  // |gid| left aria2; its last known state keeps counting for its group.
+  void Forget(aria2_gid_t gid);
+
+  // {groups, members}.
+  common::Value Describe() const;
+
+  void Reset();
+
+ private:
+  struct Member {
+    aria2_gid_t parent = 0;
+    std::vector<aria2_gid_t> children;
+    int status = -1;  // DownloadStatus; -1 until known.
+    int64_t total_length = 0;
+    int64_t completed_length = 0;
+    bool forgotten = false;
+  };
+
+  struct Sample {
+    int status = -1;
+    int64_t total_length = 0;
+    int64_t completed_length = 0;
+    int64_t download_speed = 0;
+    int64_t upload_speed = 0;
+  };
+
+  // Records the links aria2 reports for |gid|. Returns false when aria2 no
+  // longer has it; |sample| receives its state otherwise.
+  bool LinkLocked(aria2_session_t* session, aria2_gid_t gid, Sample* sample);
+  void AddEdgeLocked(aria2_gid_t parent, aria2_gid_t child);
+  // Follows parent links up from |gid|, refreshing them from aria2 on the
+  // way unless |session| is null.
+  aria2_gid_t RootLocked(aria2_session_t* session, aria2_gid_t gid);
+  // Known members of the tree under |root|, from the table alone.
+  std::vector<aria2_gid_t> TreeLocked(aria2_gid_t root) const;
+  // Members of the tree under |root| in breadth-first order, refreshing
+  // links and cached state on the way. |samples| may be null.
+  std::vector<aria2_gid_t> CollectLocked(aria2_session_t* session,
+                                         aria2_gid_t root,
+                                         std::vector<Sample>* samples);
+
+  mutable std::mutex mutex_;
+  std::unordered_map<aria2_gid_t, Member> members_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_GROUP_H_
@@ -1,5 +1,9 @@
 #include "aria2_helpers.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
 namespace flutter_aria2 {
 namespace common {
 
@@ -12,5 +16,118 @@ std::string GidToHex(aria2_gid_t gid) {
   return result;
 }
 
+int GetDownloadStatus(aria2_session_t* session, aria2_gid_t gid) {
+  aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+  if (handle == nullptr) {
+    return -1;
+  }
+  const int status = static_cast<int>(aria2_download_handle_get_status(handle));
+  aria2_delete_download_handle(handle);
+  return status;
+}
+
+std::string UriHost(const std::string& uri) {
+  const size_t scheme_end = uri.find("://");
+  if (scheme_end == std::string::npos) {
+    return "";
+  }
+  const size_t begin = scheme_end + 3;
+  std::string authority =
+      uri.substr(begin, uri.find_first_of("/?#", begin) - begin);
+  const size_t at = authority.rfind('@');
+  if (at != std::string::npos) {
+    authority.erase(0, at + 1);
+  }
+  size_t end = authority.size();
+  if (!authority.empty() && authority[0] == '[') {
+    end = authority.find(']');
+    end = end == std::string::npos ? authority.size() : end + 1;
+  } else {
+    end = std::min(end, authority.find(':'));
+  }
+  std::string host = authority.substr(0, end);
+  for (char& c : host) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return host;
+}
+
+int64_t CompletedPrefix(const aria2_binary_t& bitfield, int64_t piece_length,
+                        int64_t total_length) {
+  int64_t pieces = 0;
+  for (size_t i = 0; i < bitfield.length; ++i) {
+    const uint8_t bits = bitfield.data[i];
+    if (bits == 0xff) {
+      pieces += 8;
+      continue;
+    }
+    for (int bit = 7; bit >= 0 && (bits & (1 << bit)) != 0; --bit) {
+      ++pieces;
+    }
+    break;
+  }
+  return std::min(total_length, pieces * piece_length);
+}
+
+int GetGlobalOptionInt(aria2_session_t* session, const char* name, int def) {
+  char* value = aria2_get_global_option(session, name);
+  if (value == nullptr) {
+    return def;
+  }
+  char* end = nullptr;
+  const long parsed = std::strtol(value, &end, 10);
+  const bool ok = end != value;
+  aria2_free(value);
+  return ok ? static_cast<int>(parsed) : def;
+}
+
+void KeyVals::FromValue(const Value& map) {
+  const Value::Map& entries = map.AsMap();
+  keys.reserve(keys.size() + entries.size());
+  values.reserve(values.size() + entries.size());
+  for (const auto& entry : entries) {
+    if (!entry.second.IsString()) {
+      continue;
+    }
+    keys.push_back(entry.first);
+    values.push_back(entry.second.AsString());
+  }
+  Rebuild();
+}
+
+void KeyVals::Add(const std::string& key, const std::string& value) {
+  keys.push_back(key);
+  values.push_back(value);
+  Rebuild();
+}
+
+void KeyVals::Set(const std::string& key, const std::string& value) {
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (keys[i] == key) {
+      values[i] = value;
+      Rebuild();
+      return;
+    }
+  }
+  Add(key, value);
+}
+
+const std::string* KeyVals::Find(const std::string& key) const {
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (keys[i] == key) {
+      return &values[i];
+    }
+  }
+  return nullptr;
+}
+
+void KeyVals::Rebuild() {
+  kvs.resize(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    kvs[i].key = const_cast<char*>(keys[i].c_str());
+    kvs[i].value = const_cast<char*>(values[i].c_str());
+  }
+}
+
 }  // namespace common
 }  // namespace flutter_aria2
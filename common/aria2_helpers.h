@@ -3,13 +3,72 @@
 
 #include <aria2_c_api.h>
 
+#include <cstdint>
 #include <string>
+#include <vector>
+
+#include "aria2_value.h"
 
 namespace flutter_aria2 {
 namespace common {
 
+// Numeric values of aria2_download_status_t, mirrored by the Dart
+// `Aria2DownloadStatus` enum.
+enum DownloadStatus {
+  kStatusActive = 0,
+  kStatusWaiting = 1,
+  kStatusPaused = 2,
+  kStatusComplete = 3,
+  kStatusError = 4,
+  kStatusRemoved = 5,
+};
+
+// Numeric values of aria2_offset_mode_t, mirrored by `Aria2OffsetMode`.
+enum OffsetMode {
+  kOffsetSet = 0,
+  kOffsetCur = 1,
+  kOffsetEnd = 2,
+};
+
 std::string GidToHex(aria2_gid_t gid);
 
+// Returns the DownloadStatus of |gid|, or -1 when aria2 has no such download.
+int GetDownloadStatus(aria2_session_t* session, aria2_gid_t gid);
+
+// Returns the lower-cased host of |uri| ("scheme://[user@]host[:port]/..."),
+// or an empty string when it has none.
+std::string UriHost(const std::string& uri);
+
+// Bytes from the start of a download's data covered by the leading run of
+// completed pieces in |bitfield|.
+int64_t CompletedPrefix(const aria2_binary_t& bitfield, int64_t piece_length,
+                        int64_t total_length);
+
+// Reads an integer global option, returning |def| when unset or unparsable.
+int GetGlobalOptionInt(aria2_session_t* session, const char* name, int def);
+
+// Owns the strings behind an aria2_key_val_t array built from a Value map.
+struct KeyVals {
+  std::vector<std::string> keys;
+  std::vector<std::string> values;
+  std::vector<aria2_key_val_t> kvs;
+
+  void FromValue(const Value& map);
+  void Add(const std::string& key, const std::string& value);
+  // Replaces the value of |key|, adding it when absent.
+  void Set(const std::string& key, const std::string& value);
+  // Returns the value of |key|, or nullptr when absent.
+  const std::string* Find(const std::string& key) const;
+
+  const aria2_key_val_t* data() const {
+    return kvs.empty() ? nullptr : kvs.data();
+  }
+  size_t count() const { return kvs.size(); }
+
+ private:
+  void Rebuild();
+};
+
 }  // namespace common
 }  // namespace flutter_aria2
 
@@ -0,0 +1,402 @@
+#include "aria2_history.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "aria2_helpers.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+constexpr char kHistoryIndexMagic[8] = {'F', 'A', 'H', 'I', 'I', 'D', 'X', '1'};
+constexpr char kHistoryHeapMagic[8] = {'F', 'A', 'H', 'I', 'H', 'E', 'A', 'P'};
+
+struct HistoryHeapHeader {
+  char magic[8];
+  uint64_t size;  // Logical bytes, header included.
+};
+
+// One finished download. Strings: host, path, then the URIs, each
+// NUL-terminated.
+struct HistoryRow {
+  uint64_t gid;
+  int64_t finished_ms;  // Non-decreasing across rows.
+  int64_t duration_ms;
+  int64_t total_length;
+  int64_t completed_length;
+  uint64_t strings;
+  uint32_t strings_size;
+  uint32_t prev_same_host;  // Row index + 1; 0 for none.
+  int32_t error_code;
+  uint8_t status;  // common::DownloadStatus.
+  uint8_t reserved[3];
+};
+static_assert(sizeof(HistoryRow) == 64, "row layout is on disk");
+
+struct HistoryHeader {
+  char magic[8];
+  uint64_t count;
+  uint64_t reserved[6];
+};
+static_assert(sizeof(HistoryHeader) == 64, "header layout is on disk");
+
+HistoryHeader* HistoryHeaderOf(const common::MappedFile& index) {
+  return reinterpret_cast<HistoryHeader*>(index.data());
+}
+
+HistoryRow* HistoryRowOf(const common::MappedFile& index, uint64_t row) {
+  return reinterpret_cast<HistoryRow*>(index.data() + sizeof(HistoryHeader)) +
+         row;
+}
+
+int64_t NowUnixMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// First row in [0, count) finished at or after |ms|.
+uint64_t LowerBoundByTime(const common::MappedFile& index, uint64_t count,
+                          int64_t ms) {
+  uint64_t lo = 0;
+  uint64_t hi = count;
+  while (lo < hi) {
+    const uint64_t mid = lo + (hi - lo) / 2;
+    if (HistoryRowOf(index, mid)->finished_ms < ms) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+common::Value DescribeRow(const common::MappedFile& heap,
+                          const HistoryRow& row) {
+  common::Value out = common::Value::NewMap();
+  out.Set("gid", common::GidToHex(row.gid));
+  out.Set("status", static_cast<int32_t>(row.status));
+  out.Set("errorCode", static_cast<int32_t>(row.error_code));
+  out.Set("finishedAt", row.finished_ms);
+  out.Set("durationMs", row.duration_ms);
+  out.Set("totalLength", row.total_length);
+  out.Set("completedLength", row.completed_length);
+  out.Set("averageSpeed", row.duration_ms > 0
+                              ? row.completed_length * 1000 / row.duration_ms
+                              : int64_t{0});
+  const char* data = heap.data() + row.strings;
+  const char* end = data + row.strings_size;
+  const size_t host_length = std::strlen(data);
+  out.Set("host", std::string(data, host_length));
+  data += host_length + 1;
+  const size_t path_length = std::strlen(data);
+  out.Set("path", std::string(data, path_length));
+  data += path_length + 1;
+  common::Value uris = common::Value::NewList();
+  while (data < end) {
+    const size_t length = std::strlen(data);
+    uris.Append(std::string(data, length));
+    data += length + 1;
+  }
+  out.Set("uris", std::move(uris));
+  return out;
+}
+}  // namespace
+
+HistoryStore::~HistoryStore() { Close(); }
+
+bool HistoryStore::Open(const std::string& dir, std::string* error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  index_.Close();
+  heap_.Close();
+  hosts_.clear();
+  if (!index_.Open(dir + "/history.idx", sizeof(HistoryHeader), error) ||
+      !heap_.Open(dir + "/history.heap", sizeof(HistoryHeapHeader), error)) {
+    index_.Close();
+    heap_.Close();
+    return false;
+  }
+
+  HistoryHeader* head = HistoryHeaderOf(index_);
+  auto* heap_head = reinterpret_cast<HistoryHeapHeader*>(heap_.data());
+  static const char kZero[8] = {};
+  if (std::memcmp(head->magic, kZero, 8) == 0 &&
+      std::memcmp(heap_head->magic, kZero, 8) == 0) {
+    std::memcpy(head->magic, kHistoryIndexMagic, 8);
+    std::memcpy(heap_head->magic, kHistoryHeapMagic, 8);
+    heap_head->size = sizeof(HistoryHeapHeader);
+  } else if (std::memcmp(head->magic, kHistoryIndexMagic, 8) != 0 ||
+             std::memcmp(heap_head->magic, kHistoryHeapMagic, 8) != 0 ||
+             sizeof(HistoryHeader) + head->count * sizeof(HistoryRow) >
+                 index_.size() ||
+             heap_head->size > heap_.size()) {
+    *error = "Not a history store: " + dir;
+    index_.Close();
+    heap_.Close();
+    return false;
+  }
+
+  for (uint64_t i = 0; i < head->count; ++i) {
+    const HistoryRow* row = HistoryRowOf(index_, i);
+    HostChain& chain = hosts_[std::string(heap_.data() + row->strings)];
+    chain.last = i + 1;
+    ++chain.rows;
+  }
+  return true;
+}
+
+void HistoryStore::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!index_.is_open()) {
+    return;
+  }
+  index_.Sync();
+  heap_.Sync();
+  index_.Close();
+  heap_.Close();
+  hosts_.clear();
+  started_.clear();
+}
+
+bool HistoryStore::is_open() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return index_.is_open();
+}
+
+void HistoryStore::OnDownloadEvent(aria2_session_t* session,
+                                   aria2_download_event_t event,
+                                   aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!index_.is_open()) {
+    return;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  switch (event) {
+    case ARIA2_EVENT_ON_DOWNLOAD_START:
+      // Keeps the first start; the duration includes pauses.
+      started_.emplace(gid, now);
+      return;
+    case ARIA2_EVENT_ON_DOWNLOAD_COMPLETE:
+    case ARIA2_EVENT_ON_DOWNLOAD_ERROR:
+    case ARIA2_EVENT_ON_DOWNLOAD_STOP:
+      break;
+    default:
+      return;
+  }
+  int64_t duration_ms = 0;
+  auto it = started_.find(gid);
+  if (it != started_.end()) {
+    duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      now - it->second)
+                      .count();
+    started_.erase(it);
+  }
+  AppendLocked(session, event, gid, duration_ms);
+}
+
+bool HistoryStore::AppendLocked(aria2_session_t* session,
+                                aria2_download_event_t event, aria2_gid_t gid,
+                                int64_t duration_ms) {
+  aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+  if (handle == nullptr) {
+    return false;
+  }
+  HistoryRow row;
+  std::memset(&row, 0, sizeof(row));
+  row.gid = gid;
+  row.duration_ms = duration_ms;
+  row.total_length = aria2_download_handle_get_total_length(handle);
+  row.completed_length = aria2_download_handle_get_completed_length(handle);
+  row.error_code = aria2_download_handle_get_error_code(handle);
+  row.status = static_cast<uint8_t>(
+      event == ARIA2_EVENT_ON_DOWNLOAD_COMPLETE ? common::kStatusComplete
+      : event == ARIA2_EVENT_ON_DOWNLOAD_ERROR  ? common::kStatusError
+                                                : common::kStatusRemoved);
+
+  // The host of the first used URI, or of the first URI if none was used.
+  std::string host;
+  std::string path;
+  std::vector<std::string> uris;
+  aria2_file_data_t* files = nullptr;
+  size_t files_count = 0;
+  if (aria2_download_handle_get_files(handle, &files, &files_count) == 0 &&
+      files != nullptr) {
+    if (files_count > 0 && files[0].path != nullptr) {
+      path = files[0].path;
+    }
+    for (size_t i = 0; i < files_count; ++i) {
+      for (size_t j = 0; j < files[i].uris_count; ++j) {
+        const aria2_uri_data_t& uri = files[i].uris[j];
+        if (uri.uri == nullptr) {
+          continue;
+        }
+        if (host.empty() && uri.status == ARIA2_URI_USED) {
+          host = common::UriHost(uri.uri);
+        }
+        if (std::find(uris.begin(), uris.end(), uri.uri) == uris.end()) {
+          uris.emplace_back(uri.uri);
+        }
+      }
+    }
+    aria2_free_file_data_array(files, files_count);
+  }
+  aria2_delete_download_handle(handle);
+  if (host.empty() && !uris.empty()) {
+    host = common::UriHost(uris.front());
+  }
+
+  size_t strings_size = host.size() + path.size() + 2;
+  for (const std::string& uri : uris) {
+    strings_size += uri.size() + 1;
+  }
+  const uint64_t count = HistoryHeaderOf(index_)->count;
+  const uint64_t heap_size =
+      reinterpret_cast<HistoryHeapHeader*>(heap_.data())->size;
+  std::string error;
+  if (!index_.Reserve(sizeof(HistoryHeader) + (count + 1) * sizeof(HistoryRow),
+                      &error) ||
+      !heap_.Reserve(heap_size + strings_size, &error)) {
+    // A failed remap leaves the store unusable; reopen it to retry.
+    index_.Close();
+    heap_.Close();
+    hosts_.clear();
+    return false;
+  }
+
+  char* out = heap_.data() + heap_size;
+  std::memcpy(out, host.c_str(), host.size() + 1);
+  out += host.size() + 1;
+  std::memcpy(out, path.c_str(), path.size() + 1);
+  out += path.size() + 1;
+  for (const std::string& uri : uris) {
+    std::memcpy(out, uri.c_str(), uri.size() + 1);
+    out += uri.size() + 1;
+  }
+  reinterpret_cast<HistoryHeapHeader*>(heap_.data())->size =
+      heap_size + strings_size;
+
+  row.strings = heap_size;
+  row.strings_size = static_cast<uint32_t>(strings_size);
+  row.finished_ms = NowUnixMs();
+  if (count > 0) {
+    row.finished_ms =
+        std::max(row.finished_ms, HistoryRowOf(index_, count - 1)->finished_ms);
+  }
+  HostChain& chain = hosts_[host];
+  row.prev_same_host = static_cast<uint32_t>(chain.last);
+  chain.last = count + 1;
+  ++chain.rows;
+  *HistoryRowOf(index_, count) = row;
+  // Publish the row only once it is complete.
+  ++HistoryHeaderOf(index_)->count;
+  return true;
+}
+
+void HistoryStore::MarkFailed(aria2_gid_t gid, int32_t error_code) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!index_.is_open()) {
+    return;
+  }
+  for (uint64_t i = HistoryHeaderOf(index_)->count; i > 0; --i) {
+    HistoryRow* row = HistoryRowOf(index_, i - 1);
+    if (row->gid == gid) {
+      row->status = static_cast<uint8_t>(common::kStatusError);
+      row->error_code = error_code;
+      return;
+    }
+  }
+}
+
+common::Value HistoryStore::Query(const HistoryFilter& filter, int64_t offset,
+                                  int64_t limit) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewList();
+  if (!index_.is_open() || limit <= 0) {
+    return out;
+  }
+  const uint64_t count = HistoryHeaderOf(index_)->count;
+  const uint64_t lo = filter.since_ms < 0
+                          ? 0
+                          : LowerBoundByTime(index_, count, filter.since_ms);
+  const uint64_t hi = filter.until_ms < 0
+                          ? count
+                          : LowerBoundByTime(index_, count, filter.until_ms);
+  if (lo >= hi) {
+    return out;
+  }
+
+  auto matches = [&filter](const HistoryRow& row) {
+    return filter.status < 0 || row.status == filter.status;
+  };
+  int64_t skip = offset;
+  auto take = [&](const HistoryRow& row) {
+    if (!matches(row)) {
+      return true;
+    }
+    if (skip > 0) {
+      --skip;
+      return true;
+    }
+    out.Append(DescribeRow(heap_, row));
+    return --limit > 0;
+  };
+
+  if (!filter.host.empty()) {
+    auto chain = hosts_.find(filter.host);
+    if (chain == hosts_.end()) {
+      return out;
+    }
+    for (uint64_t next = chain->second.last; next > lo;) {
+      const uint64_t index = next - 1;
+      const HistoryRow* row = HistoryRowOf(index_, index);
+      next = row->prev_same_host;
+      if (index >= hi) {
+        continue;
+      }
+      if (!take(*row)) {
+        break;
+      }
+    }
+    return out;
+  }
+
+  uint64_t next = hi;
+  if (filter.status < 0) {
+    // Every row matches; jump over the skipped ones.
+    const uint64_t span = hi - lo;
+    next = static_cast<uint64_t>(skip) >= span ? lo : hi - skip;
+    skip = 0;
+  }
+  while (next > lo && take(*HistoryRowOf(index_, next - 1))) {
+    --next;
+  }
+  return out;
+}
+
+common::Value HistoryStore::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewMap();
+  out.Set("open", index_.is_open());
+  if (!index_.is_open()) {
+    return out;
+  }
+  const uint64_t count = HistoryHeaderOf(index_)->count;
+  out.Set("rows", static_cast<int64_t>(count));
+  out.Set("hosts", static_cast<int64_t>(hosts_.size()));
+  out.Set("bytes",
+          static_cast<int64_t>(
+              sizeof(HistoryHeader) + count * sizeof(HistoryRow) +
+              reinterpret_cast<HistoryHeapHeader*>(heap_.data())->size));
+  return out;
+}
+
+void HistoryStore::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  started_.clear();
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
@@ -0,0 +1,85 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_HISTORY_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_HISTORY_H_
+
+#include <aria2_c_api.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "aria2_mapped_file.h"
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+struct HistoryFilter {
+  std::string host;      // Empty for any host.
+  int64_t since_ms = -1;  // Finished at or after; -1 for no bound.
+  int64_t until_ms = -1;  // Finished before; -1 for no bound.
+  int status = -1;        // common::DownloadStatus; -1 for any.
+};
+
+// Append-only record of finished downloads, kept on disk instead of in
+// aria2 or Dart memory.
+//
+// Like the virtual queue, the store is two memory-mapped files in its
+// directory: fixed-size rows (history.idx) and a string heap with the host,
+// path and URIs of each row (history.heap). Rows are appended from the
+// download event callback in finish order with the finish time clamped to
+// be non-decreasing, so the row order itself is the time index and a time
+// range is found by binary search. Each row also links to the previous row
+// of the same host; the chain heads are rebuilt by one scan on Open, which
+// makes a host query cost O(rows of that host) rather than O(rows).
+// Queries return the newest rows first.
+class HistoryStore {
+ public:
+  ~HistoryStore();
+
+  bool Open(const std::string& dir, std::string* error);
+  void Close();
+  bool is_open() const;
+
+  // Runs in the download event callback.
+  void OnDownloadEvent(aria2_session_t* session, aria2_download_event_t event,
+                       aria2_gid_t gid);
+
+  // Turns the newest row of |gid| into a failure with |error_code|, for a
+  // download that aria2 completed but that failed a later check.
+  void MarkFailed(aria2_gid_t gid, int32_t error_code);
+
+  // List of {gid, status, errorCode, finishedAt, durationMs, totalLength,
+  // completedLength, averageSpeed, host, path, uris} for the matching rows,
+  // skipping |offset| of them.
+  common::Value Query(const HistoryFilter& filter, int64_t offset,
+                      int64_t limit) const;
+
+  // {open, rows, hosts, bytes}.
+  common::Value Describe() const;
+
+  // Forgets the start times of downloads still running.
+  void Reset();
+
+ private:
+  struct HostChain {
+    uint64_t last = 0;  // Row index + 1 of the newest row; 0 for none.
+    int64_t rows = 0;
+  };
+
+  bool AppendLocked(aria2_session_t* session, aria2_download_event_t event,
+                    aria2_gid_t gid, int64_t duration_ms);
+
+  mutable std::mutex mutex_;
+  common::MappedFile index_;
+  common::MappedFile heap_;
+  std::unordered_map<std::string, HostChain> hosts_;
+  std::unordered_map<aria2_gid_t, std::chrono::steady_clock::time_point>
+      started_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_HISTORY_H_
@@ -0,0 +1,291 @@
+#include "aria2_hoststats.h"
+
+#include <algorithm>
+#include <set>
+
+#include "aria2_helpers.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+constexpr auto kHostSampleInterval = std::chrono::seconds(1);
+
+struct DownloadSample {
+  int64_t completed = 0;
+  int speed = 0;
+  std::vector<std::string> hosts;  // Distinct hosts of the used URIs.
+};
+
+bool ReadDownloadSample(aria2_session_t* session, aria2_gid_t gid,
+                        DownloadSample* out) {
+  aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+  if (handle == nullptr) {
+    return false;
+  }
+  out->completed = aria2_download_handle_get_completed_length(handle);
+  out->speed = aria2_download_handle_get_download_speed(handle);
+  aria2_file_data_t* files = nullptr;
+  size_t files_count = 0;
+  if (aria2_download_handle_get_files(handle, &files, &files_count) == 0 &&
+      files != nullptr) {
+    std::set<std::string> seen;
+    for (size_t i = 0; i < files_count; ++i) {
+      for (size_t j = 0; j < files[i].uris_count; ++j) {
+        const aria2_uri_data_t& uri = files[i].uris[j];
+        if (uri.uri == nullptr || uri.status != ARIA2_URI_USED) {
+          continue;
+        }
+        std::string host = common::UriHost(uri.uri);
+        if (!host.empty() && seen.insert(host).second) {
+          out->hosts.push_back(std::move(host));
+        }
+      }
+    }
+    aria2_free_file_data_array(files, files_count);
+  }
+  aria2_delete_download_handle(handle);
+  return true;
+}
+
+std::vector<aria2_gid_t> ListActiveDownloads(aria2_session_t* session) {
+  std::vector<aria2_gid_t> out;
+  aria2_gid_t* gids = nullptr;
+  size_t count = 0;
+  if (aria2_get_active_download(session, &gids, &count) == 0 && gids != nullptr) {
+    out.assign(gids, gids + count);
+  }
+  if (gids != nullptr) {
+    aria2_free(gids);
+  }
+  return out;
+}
+
+double Ewma(double current, double sample, bool first) {
+  return first ? sample
+               : HostStatsTable::kAlpha * sample +
+                     (1 - HostStatsTable::kAlpha) * current;
+}
+}  // namespace
+
+double HostScore(const HostRecord& record) {
+  if (record.samples == 0 && record.errors == 0 && record.completions == 0) {
+    return -1;
+  }
+  const double success =
+      static_cast<double>(record.completions + 1) /
+      static_cast<double>(record.completions + record.errors + 1);
+  const double latency_s =
+      record.latency_ms < 0 ? 0 : record.latency_ms / 1000.0;
+  return record.speed * success / (1 + latency_s);
+}
+
+void HostStatsTable::OnDownloadStart(aria2_session_t* session,
+                                     aria2_gid_t gid) {
+  DownloadSample sample;
+  if (!ReadDownloadSample(session, gid, &sample)) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  Tracked& tracked = downloads_[gid];
+  tracked.started = std::chrono::steady_clock::now();
+  tracked.completed = sample.completed;
+  tracked.first_byte = false;
+}
+
+void HostStatsTable::OnDownloadError(aria2_session_t* session,
+                                     aria2_gid_t gid) {
+  DownloadSample sample;
+  const bool read = ReadDownloadSample(session, gid, &sample);
+  std::lock_guard<std::mutex> lock(mutex_);
+  downloads_.erase(gid);
+  if (!read) {
+    return;
+  }
+  for (const std::string& host : sample.hosts) {
+    ++hosts_[host].errors;
+  }
+}
+
+void HostStatsTable::OnDownloadComplete(aria2_session_t* session,
+                                        aria2_gid_t gid) {
+  DownloadSample sample;
+  const bool read = ReadDownloadSample(session, gid, &sample);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = downloads_.find(gid);
+  if (!read) {
+    if (it != downloads_.end()) {
+      downloads_.erase(it);
+    }
+    return;
+  }
+  // Bytes that arrived after the last sample still count for the hosts.
+  const int64_t delta =
+      it == downloads_.end() ? 0 : sample.completed - it->second.completed;
+  if (it != downloads_.end()) {
+    downloads_.erase(it);
+  }
+  for (const std::string& host : sample.hosts) {
+    HostRecord& record = hosts_[host];
+    ++record.completions;
+    if (delta > 0) {
+      record.bytes += delta / static_cast<int64_t>(sample.hosts.size());
+    }
+  }
+}
+
+void HostStatsTable::OnDownloadStop(aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  downloads_.erase(gid);
+}
+
+void HostStatsTable::OnTick(aria2_session_t* session) {
+  const auto now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (now - last_tick_ < kHostSampleInterval) {
+      return;
+    }
+    last_tick_ = now;
+  }
+
+  for (aria2_gid_t gid : ListActiveDownloads(session)) {
+    DownloadSample sample;
+    if (!ReadDownloadSample(session, gid, &sample) || sample.hosts.empty()) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = downloads_.find(gid);
+    if (it == downloads_.end()) {
+      // Started before this table saw it (e.g. a restored session); begin
+      // counting from here without a latency figure.
+      Tracked& tracked = downloads_[gid];
+      tracked.started = now;
+      tracked.completed = sample.completed;
+      tracked.first_byte = true;
+      continue;
+    }
+    Tracked& tracked = it->second;
+    const int64_t delta = std::max<int64_t>(0, sample.completed - tracked.completed);
+    tracked.completed = sample.completed;
+    const auto share = static_cast<int64_t>(sample.hosts.size());
+    for (const std::string& host : sample.hosts) {
+      HostRecord& record = hosts_[host];
+      const bool first = record.samples == 0;
+      record.bytes += delta / share;
+      record.speed = Ewma(record.speed, static_cast<double>(sample.speed) / share,
+                          first);
+      ++record.samples;
+      if (!tracked.first_byte && delta > 0) {
+        const double latency_ms =
+            std::chrono::duration<double, std::milli>(now - tracked.started)
+                .count();
+        record.latency_ms =
+            Ewma(record.latency_ms, latency_ms, record.latency_ms < 0);
+      }
+    }
+    if (delta > 0) {
+      tracked.first_byte = true;
+    }
+  }
+}
+
+void HostStatsTable::RecordSample(const std::string& host, int64_t bytes,
+                                  double speed) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  HostRecord& record = hosts_[host];
+  record.bytes += bytes;
+  record.speed = Ewma(record.speed, speed, record.samples == 0);
+  ++record.samples;
+}
+
+void HostStatsTable::RecordLatency(const std::string& host,
+                                   double latency_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  HostRecord& record = hosts_[host];
+  record.latency_ms = Ewma(record.latency_ms, latency_ms, record.latency_ms < 0);
+}
+
+std::vector<std::string> HostStatsTable::RankUris(
+    std::vector<std::string> uris) const {
+  std::vector<double> scores;
+  scores.reserve(uris.size());
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::string& uri : uris) {
+      auto it = hosts_.find(common::UriHost(uri));
+      scores.push_back(it == hosts_.end() ? -1 : HostScore(it->second));
+    }
+  }
+  double known_sum = 0;
+  int known = 0;
+  for (double score : scores) {
+    if (score >= 0) {
+      known_sum += score;
+      ++known;
+    }
+  }
+  if (known == 0) {
+    return uris;
+  }
+  const double unknown_score = known_sum / known;
+  std::vector<size_t> order(uris.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+    if (scores[i] < 0) {
+      scores[i] = unknown_score;
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [&scores](size_t a, size_t b) {
+    return scores[a] > scores[b];
+  });
+  std::vector<std::string> ranked;
+  ranked.reserve(uris.size());
+  for (size_t index : order) {
+    ranked.push_back(std::move(uris[index]));
+  }
+  return ranked;
+}
+
+common::Value HostStatsTable::Describe() const {
+  std::vector<std::pair<double, const std::string*>> order;
+  common::Value out = common::Value::NewList();
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& entry : hosts_) {
+    order.emplace_back(HostScore(entry.second), &entry.first);
+  }
+  std::sort(order.begin(), order.end(),
+            [](const std::pair<double, const std::string*>& a,
+               const std::pair<double, const std::string*>& b) {
+              return a.first != b.first ? a.first > b.first
+                                        : *a.second < *b.second;
+            });
+  for (const auto& item : order) {
+    const HostRecord& record = hosts_.at(*item.second);
+    common::Value host = common::Value::NewMap();
+    host.Set("host", *item.second);
+    host.Set("bytes", record.bytes);
+    host.Set("speed", record.speed);
+    host.Set("latencyMs", record.latency_ms);
+    host.Set("errors", record.errors);
+    host.Set("completions", record.completions);
+    host.Set("samples", record.samples);
+    host.Set("score", item.first);
+    out.Append(std::move(host));
+  }
+  return out;
+}
+
+void HostStatsTable::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  hosts_.clear();
+}
+
+void HostStatsTable::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  downloads_.clear();
+  last_tick_ = std::chrono::steady_clock::time_point();
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
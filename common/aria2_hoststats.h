@@ -0,0 +1,83 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_HOSTSTATS_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_HOSTSTATS_H_
+
+#include <aria2_c_api.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// What has been measured for one host.
+struct HostRecord {
+  int64_t bytes = 0;
+  double speed = 0;          // EWMA of bytes/s per download using the host.
+  double latency_ms = -1;    // EWMA of time to first byte; -1 until measured.
+  int64_t errors = 0;        // Downloads that failed while using the host.
+  int64_t completions = 0;   // Downloads that completed while using it.
+  int64_t samples = 0;
+};
+
+// Quality used to rank mirrors: speed discounted by the failure ratio and by
+// latency. Returns -1 for a host with nothing measured yet.
+double HostScore(const HostRecord& record);
+
+// Native per-host throughput and health table.
+//
+// OnTick samples the active downloads once a second and charges the progress
+// and speed of each one evenly to the hosts of its used URIs (aria2 does not
+// report per-connection figures). The first progress seen after a download
+// started gives a coarse time to first byte. Errors and completions come from
+// the download event callback. The table outlives sessions so the next
+// multi-mirror download starts on the hosts that did well before; only the
+// per-download bookkeeping is dropped by Reset.
+class HostStatsTable {
+ public:
+  static constexpr double kAlpha = 0.3;
+
+  void OnDownloadStart(aria2_session_t* session, aria2_gid_t gid);
+  void OnDownloadError(aria2_session_t* session, aria2_gid_t gid);
+  void OnDownloadComplete(aria2_session_t* session, aria2_gid_t gid);
+  void OnDownloadStop(aria2_gid_t gid);
+  void OnTick(aria2_session_t* session);
+
+  void RecordSample(const std::string& host, int64_t bytes, double speed);
+  void RecordLatency(const std::string& host, double latency_ms);
+
+  // Stable-sorts |uris| best host first. Hosts without measurements get the
+  // mean score of the measured ones, so they are tried before hosts that did
+  // poorly and after hosts that did well.
+  std::vector<std::string> RankUris(std::vector<std::string> uris) const;
+
+  // List of {host, bytes, speed, latencyMs, errors, completions, samples,
+  // score}, best first.
+  common::Value Describe() const;
+
+  // Drops the measurements as well.
+  void Clear();
+  void Reset();
+
+ private:
+  struct Tracked {
+    std::chrono::steady_clock::time_point started;
+    int64_t completed = 0;
+    bool first_byte = false;
+  };
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, HostRecord> hosts_;
+  std::unordered_map<aria2_gid_t, Tracked> downloads_;
+  std::chrono::steady_clock::time_point last_tick_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_HOSTSTATS_H_
@@ -0,0 +1,358 @@
+#include "aria2_import.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+constexpr auto kImportSliceBudget = std::chrono::milliseconds(50);
+constexpr auto kImportReportInterval = std::chrono::milliseconds(250);
+constexpr size_t kImportBufferSize = 1 << 16;
+constexpr size_t kMaxCachedOptionSets = 1024;
+constexpr size_t kMaxErrorsPerReport = 200;
+
+std::string TrimSpace(const std::string& text) {
+  size_t begin = 0;
+  size_t end = text.size();
+  while (begin < end && std::isspace(static_cast<unsigned char>(text[begin]))) {
+    ++begin;
+  }
+  while (end > begin &&
+         std::isspace(static_cast<unsigned char>(text[end - 1]))) {
+    --end;
+  }
+  return text.substr(begin, end - begin);
+}
+
+bool IsOptionName(const std::string& name) {
+  if (name.empty()) {
+    return false;
+  }
+  for (char c : name) {
+    if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-') {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+struct InputImporter::Job {
+  std::string path;
+  std::vector<char> buffer;
+  std::ifstream in;
+  bool to_virtual_queue = false;
+  std::vector<std::pair<std::string, std::string>> base_options;
+  std::unordered_map<std::string, std::shared_ptr<const OptionSet>> option_sets;
+
+  bool has_entry = false;
+  Entry entry;
+
+  // Consecutive virtual-queue entries sharing one option set.
+  std::shared_ptr<const OptionSet> batch_options;
+  std::vector<std::vector<std::string>> batch;
+  std::vector<int64_t> batch_lines;
+
+  int64_t lines = 0;
+  int64_t entries = 0;
+  int64_t added = 0;
+  int64_t failed = 0;
+  int64_t bytes = 0;
+  int64_t total_bytes = -1;
+  std::vector<std::pair<int64_t, std::string>> errors;
+  bool cancelled = false;
+  std::string fatal;
+  std::chrono::steady_clock::time_point last_report;
+};
+
+InputImporter::InputImporter() = default;
+
+InputImporter::~InputImporter() = default;
+
+bool InputImporter::Start(
+    const std::string& path, bool to_virtual_queue,
+    std::vector<std::pair<std::string, std::string>> options,
+    std::string* error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (job_ != nullptr) {
+    *error = "An import is already running";
+    return false;
+  }
+  auto job = std::make_unique<Job>();
+  job->path = path;
+  job->buffer.resize(kImportBufferSize);
+  job->in.rdbuf()->pubsetbuf(job->buffer.data(),
+                             static_cast<std::streamsize>(job->buffer.size()));
+  job->in.open(path, std::ios::in | std::ios::binary);
+  if (!job->in.is_open()) {
+    *error = "Cannot open " + path;
+    return false;
+  }
+  job->in.seekg(0, std::ios::end);
+  job->total_bytes = static_cast<int64_t>(job->in.tellg());
+  job->in.seekg(0, std::ios::beg);
+  job->to_virtual_queue = to_virtual_queue;
+  job->base_options = std::move(options);
+  job->last_report = std::chrono::steady_clock::now();
+  job_ = std::move(job);
+  return true;
+}
+
+bool InputImporter::running() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return job_ != nullptr;
+}
+
+void InputImporter::Cancel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (job_ != nullptr) {
+    job_->cancelled = true;
+  }
+}
+
+std::shared_ptr<const InputImporter::OptionSet> InputImporter::LookupOptions(
+    const std::string& block) {
+  auto it = job_->option_sets.find(block);
+  if (it != job_->option_sets.end()) {
+    return it->second;
+  }
+  // Per-entry options such as "out=" make every block distinct; keep the
+  // cache bounded instead of growing with the file.
+  if (job_->option_sets.size() >= kMaxCachedOptionSets) {
+    job_->option_sets.clear();
+  }
+
+  auto set = std::make_shared<OptionSet>();
+  set->options = job_->base_options;
+  size_t start = 0;
+  while (start < block.size()) {
+    size_t end = block.find('\n', start);
+    if (end == std::string::npos) {
+      end = block.size();
+    }
+    const std::string line = block.substr(start, end - start);
+    start = end + 1;
+    const size_t eq = line.find('=');
+    const std::string name =
+        eq == std::string::npos ? std::string() : TrimSpace(line.substr(0, eq));
+    if (!IsOptionName(name)) {
+      set->error = "Invalid option line '" + line + "'";
+      break;
+    }
+    const std::string value = line.substr(eq + 1);
+    bool replaced = false;
+    for (auto& option : set->options) {
+      if (option.first == name) {
+        option.second = value;
+        replaced = true;
+      }
+    }
+    if (!replaced) {
+      set->options.emplace_back(name, value);
+    }
+  }
+  if (set->error.empty()) {
+    for (const auto& option : set->options) {
+      set->key_vals.Add(option.first, option.second);
+    }
+  }
+  job_->option_sets.emplace(block, set);
+  return set;
+}
+
+void InputImporter::Fail(int64_t line, std::string message) {
+  ++job_->failed;
+  if (job_->errors.size() < kMaxErrorsPerReport) {
+    job_->errors.emplace_back(line, std::move(message));
+  }
+}
+
+void InputImporter::AddEntry(aria2_session_t* session,
+                             VirtualQueue* virtual_queue,
+                             std::vector<ImportedDownload>* added) {
+  Entry entry = std::move(job_->entry);
+  job_->entry = Entry();
+  job_->has_entry = false;
+  ++job_->entries;
+  std::shared_ptr<const OptionSet> options = LookupOptions(entry.option_block);
+  if (!options->error.empty()) {
+    Fail(entry.line, options->error);
+    return;
+  }
+
+  if (job_->to_virtual_queue) {
+    if (options != job_->batch_options) {
+      FlushVirtual(virtual_queue);
+      job_->batch_options = options;
+    }
+    job_->batch.push_back(std::move(entry.uris));
+    job_->batch_lines.push_back(entry.line);
+    return;
+  }
+
+  std::vector<const char*> uri_ptrs;
+  uri_ptrs.reserve(entry.uris.size());
+  for (const std::string& uri : entry.uris) {
+    uri_ptrs.push_back(uri.c_str());
+  }
+  ImportedDownload download;
+  const int ret = aria2_add_uri(session, &download.gid, uri_ptrs.data(),
+                                uri_ptrs.size(), options->key_vals.data(),
+                                options->key_vals.count(), -1);
+  if (ret != 0) {
+    Fail(entry.line, "aria2_add_uri failed with code " + std::to_string(ret));
+    return;
+  }
+  ++job_->added;
+  download.uris = std::move(entry.uris);
+  download.options = options->options;
+  added->push_back(std::move(download));
+}
+
+void InputImporter::FlushVirtual(VirtualQueue* virtual_queue) {
+  if (job_->batch.empty()) {
+    return;
+  }
+  std::string error;
+  const int64_t first =
+      virtual_queue->Append(job_->batch, job_->batch_options->options, &error);
+  if (first < 0) {
+    for (int64_t line : job_->batch_lines) {
+      Fail(line, error);
+    }
+    job_->fatal = error;
+  } else {
+    job_->added += static_cast<int64_t>(job_->batch.size());
+  }
+  job_->batch.clear();
+  job_->batch_lines.clear();
+}
+
+bool InputImporter::OnTick(aria2_session_t* session,
+                           VirtualQueue* virtual_queue,
+                           std::vector<ImportedDownload>* added,
+                           common::Value* progress) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (job_ == nullptr) {
+    return false;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  bool done = job_->cancelled || !job_->fatal.empty();
+  std::string line;
+  for (int count = 0; !done; ++count) {
+    if ((count & 63) == 63 &&
+        std::chrono::steady_clock::now() - start >= kImportSliceBudget) {
+      break;
+    }
+    if (!std::getline(job_->in, line)) {
+      if (job_->has_entry) {
+        AddEntry(session, virtual_queue, added);
+      }
+      done = true;
+      break;
+    }
+    ++job_->lines;
+    // The last line may lack its newline.
+    job_->bytes = std::min(job_->bytes + static_cast<int64_t>(line.size()) + 1,
+                           job_->total_bytes);
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    if (line[0] == ' ' || line[0] == '\t') {
+      const std::string option = TrimSpace(line);
+      if (option.empty()) {
+        continue;
+      }
+      if (!job_->has_entry) {
+        Fail(job_->lines, "Option line without a URI line");
+        continue;
+      }
+      if (!job_->entry.option_block.empty()) {
+        job_->entry.option_block += '\n';
+      }
+      job_->entry.option_block += option;
+      continue;
+    }
+    if (job_->has_entry) {
+      AddEntry(session, virtual_queue, added);
+    }
+    job_->has_entry = true;
+    job_->entry.line = job_->lines;
+    size_t field_start = 0;
+    while (field_start <= line.size()) {
+      size_t tab = line.find('\t', field_start);
+      if (tab == std::string::npos) {
+        tab = line.size();
+      }
+      std::string uri = TrimSpace(line.substr(field_start, tab - field_start));
+      if (!uri.empty()) {
+        job_->entry.uris.push_back(std::move(uri));
+      }
+      field_start = tab + 1;
+    }
+    if (!job_->fatal.empty()) {
+      done = true;
+    }
+  }
+  if (job_->to_virtual_queue && virtual_queue != nullptr) {
+    FlushVirtual(virtual_queue);
+    done = done || !job_->fatal.empty();
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  if (!done && now - job_->last_report < kImportReportInterval) {
+    return false;
+  }
+  job_->last_report = now;
+  *progress = Report(done);
+  if (done) {
+    job_.reset();
+  }
+  return true;
+}
+
+bool InputImporter::Abort(const std::string& reason, common::Value* progress) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (job_ == nullptr) {
+    return false;
+  }
+  job_->fatal = reason;
+  *progress = Report(true);
+  job_.reset();
+  return true;
+}
+
+common::Value InputImporter::Report(bool done) {
+  common::Value out = common::Value::NewMap();
+  out.Set("path", job_->path);
+  out.Set("lines", job_->lines);
+  out.Set("entries", job_->entries);
+  out.Set("added", job_->added);
+  out.Set("failed", job_->failed);
+  out.Set("bytes", job_->bytes);
+  out.Set("totalBytes", job_->total_bytes);
+  common::Value errors = common::Value::NewList();
+  for (auto& error : job_->errors) {
+    common::Value item = common::Value::NewMap();
+    item.Set("line", error.first);
+    item.Set("message", std::move(error.second));
+    errors.Append(std::move(item));
+  }
+  job_->errors.clear();
+  out.Set("errors", std::move(errors));
+  out.Set("done", done);
+  out.Set("cancelled", job_->cancelled);
+  if (!job_->fatal.empty()) {
+    out.Set("error", job_->fatal);
+  }
+  return out;
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
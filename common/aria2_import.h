@@ -0,0 +1,97 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_IMPORT_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_IMPORT_H_
+
+#include <aria2_c_api.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "aria2_helpers.h"
+#include "aria2_value.h"
+#include "aria2_virtual_queue.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// A download added to the session by an import, for the scheduler.
+struct ImportedDownload {
+  aria2_gid_t gid = 0;
+  std::vector<std::string> uris;
+  std::vector<std::pair<std::string, std::string>> options;
+};
+
+// Streaming importer for aria2 input files ("--input-file" format: one line
+// of TAB-separated URIs per download, followed by indented key=value option
+// lines; '#' starts a comment).
+//
+// The file is read incrementally on the thread driving aria2_run, within a
+// small time budget per tick, so a manifest of any size never sits in memory
+// or crosses the platform channel. Each distinct option block is parsed,
+// validated and merged with the import-wide options once and then reused.
+// Entries go to the session or, on request, to the virtual queue. Progress
+// with the per-line errors found since the previous report is returned at
+// most every 250 ms and once more when the import ends.
+class InputImporter {
+ public:
+  InputImporter();
+  ~InputImporter();
+
+  InputImporter(const InputImporter&) = delete;
+  InputImporter& operator=(const InputImporter&) = delete;
+
+  // Fails when an import is running or |path| cannot be opened.
+  bool Start(const std::string& path, bool to_virtual_queue,
+             std::vector<std::pair<std::string, std::string>> options,
+             std::string* error);
+
+  bool running() const;
+
+  // Stops reading; the final report follows on the next tick.
+  void Cancel();
+
+  // Imports the next slice. Returns true with |progress| set when a report
+  // is due: {path, lines, entries, added, failed, bytes, totalBytes,
+  // errors: [{line, message}], done, cancelled, error}.
+  bool OnTick(aria2_session_t* session, VirtualQueue* virtual_queue,
+              std::vector<ImportedDownload>* added, common::Value* progress);
+
+  // Ends a running import because the session is going away. Returns true
+  // with the final report in |progress| when there was one.
+  bool Abort(const std::string& reason, common::Value* progress);
+
+ private:
+  struct OptionSet {
+    std::string error;  // Empty when valid.
+    std::vector<std::pair<std::string, std::string>> options;
+    common::KeyVals key_vals;
+  };
+
+  struct Entry {
+    int64_t line = 0;
+    std::vector<std::string> uris;
+    std::string option_block;
+  };
+
+  struct Job;
+
+  std::shared_ptr<const OptionSet> LookupOptions(const std::string& block);
+  void AddEntry(aria2_session_t* session, VirtualQueue* virtual_queue,
+                std::vector<ImportedDownload>* added);
+  void Fail(int64_t line, std::string message);
+  void FlushVirtual(VirtualQueue* virtual_queue);
+  common::Value Report(bool done);
+
+  mutable std::mutex mutex_;
+  std::unique_ptr<Job> job_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_IMPORT_H_
@@ -0,0 +1,606 @@
+#include "aria2_journal.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "aria2_helpers.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+constexpr char kLogMagic[8] = {'F', 'A', 'J', 'N', 'L', 'O', 'G', '1'};
+constexpr char kSnapshotMagic[8] = {'F', 'A', 'J', 'N', 'S', 'N', 'A', 'P'};
+constexpr size_t kJournalLogSize = 4 * 1024 * 1024;
+constexpr size_t kJournalCheckpointAt = kJournalLogSize / 4 * 3;
+
+enum JournalRecordType : uint8_t {
+  kJournalAdded = 1,
+  kJournalOptions = 2,
+  kJournalPaused = 3,
+  kJournalResumed = 4,
+  kJournalFinished = 5,
+};
+
+struct JournalFileHeader {
+  char magic[8];
+  uint64_t generation;
+  uint64_t reserved[2];
+};
+static_assert(sizeof(JournalFileHeader) == 32, "header layout is on disk");
+
+// Each record is {uint32 payload size, uint32 checksum} followed by the
+// payload: uint8 type, uint64 gid, uint32 URI count, uint32 option count,
+// then the URIs and option keys/values as NUL-terminated strings. A zero
+// size ends the log; a checksum mismatch marks a torn tail.
+constexpr size_t kRecordHeaderSize = 8;
+constexpr size_t kPayloadFixedSize = 17;
+
+struct JournalRecord {
+  uint8_t type = 0;
+  aria2_gid_t gid = 0;
+  std::vector<std::string> uris;
+  SessionJournal::Options options;
+};
+
+uint32_t JournalChecksum(const char* data, size_t size) {
+  // FNV-1a.
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<uint8_t>(data[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+template <typename T>
+void PutRaw(std::string* out, T value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T GetRaw(const char* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+void EncodeJournalRecord(std::string* out, uint8_t type, aria2_gid_t gid,
+                         const std::vector<std::string>& uris,
+                         const SessionJournal::Options& options) {
+  const size_t start = out->size();
+  PutRaw<uint32_t>(out, 0);
+  PutRaw<uint32_t>(out, 0);
+  PutRaw<uint8_t>(out, type);
+  PutRaw<uint64_t>(out, gid);
+  PutRaw<uint32_t>(out, static_cast<uint32_t>(uris.size()));
+  PutRaw<uint32_t>(out, static_cast<uint32_t>(options.size()));
+  for (const std::string& uri : uris) {
+    out->append(uri.c_str(), uri.size() + 1);
+  }
+  for (const auto& option : options) {
+    out->append(option.first.c_str(), option.first.size() + 1);
+    out->append(option.second.c_str(), option.second.size() + 1);
+  }
+  const char* payload = out->data() + start + kRecordHeaderSize;
+  const uint32_t size =
+      static_cast<uint32_t>(out->size() - start - kRecordHeaderSize);
+  const uint32_t checksum = JournalChecksum(payload, size);
+  std::memcpy(&(*out)[start], &size, sizeof(size));
+  std::memcpy(&(*out)[start + 4], &checksum, sizeof(checksum));
+}
+
+bool ReadJournalString(const char** data, const char* end, std::string* out) {
+  const void* nul = std::memchr(*data, '\0', static_cast<size_t>(end - *data));
+  if (nul == nullptr) {
+    return false;
+  }
+  const char* stop = static_cast<const char*>(nul);
+  out->assign(*data, stop);
+  *data = stop + 1;
+  return true;
+}
+
+bool DecodeJournalPayload(const char* data, size_t size, JournalRecord* out) {
+  if (size < kPayloadFixedSize) {
+    return false;
+  }
+  const char* end = data + size;
+  out->type = GetRaw<uint8_t>(data);
+  out->gid = GetRaw<uint64_t>(data + 1);
+  const uint32_t uri_count = GetRaw<uint32_t>(data + 9);
+  const uint32_t option_count = GetRaw<uint32_t>(data + 13);
+  data += kPayloadFixedSize;
+  out->uris.clear();
+  out->options.clear();
+  std::string value;
+  for (uint32_t i = 0; i < uri_count; ++i) {
+    if (!ReadJournalString(&data, end, &value)) {
+      return false;
+    }
+    out->uris.push_back(value);
+  }
+  for (uint32_t i = 0; i < option_count; ++i) {
+    std::string key;
+    if (!ReadJournalString(&data, end, &key) ||
+        !ReadJournalString(&data, end, &value)) {
+      return false;
+    }
+    out->options.emplace_back(std::move(key), value);
+  }
+  return true;
+}
+
+void MergeOptions(SessionJournal::Options* into,
+                  const SessionJournal::Options& changes) {
+  for (const auto& change : changes) {
+    auto it = std::find_if(into->begin(), into->end(),
+                           [&change](const std::pair<std::string, std::string>&
+                                         option) {
+                             return option.first == change.first;
+                           });
+    if (it != into->end()) {
+      it->second = change.second;
+    } else {
+      into->push_back(change);
+    }
+  }
+}
+
+std::string LogPath(const std::string& dir, uint64_t generation) {
+  return dir + "/journal-" + std::to_string(generation) + ".log";
+}
+
+std::string SnapshotPath(const std::string& dir) {
+  return dir + "/journal.snapshot";
+}
+
+// Maps |path| and checks its header; returns false when it is missing or
+// is not a journal file of the expected kind.
+bool OpenJournalFile(const std::string& path, const char (&magic)[8],
+                     common::MappedFile* file, uint64_t* generation) {
+  std::string error;
+  if (!common::FileExists(path) ||
+      !file->Open(path, sizeof(JournalFileHeader), &error)) {
+    return false;
+  }
+  const auto* header = reinterpret_cast<const JournalFileHeader*>(file->data());
+  if (std::memcmp(header->magic, magic, 8) != 0) {
+    file->Close();
+    return false;
+  }
+  *generation = header->generation;
+  return true;
+}
+
+// Deletes the logs below |generation|, walking down until one is missing.
+void RemoveLogsBelow(const std::string& dir, uint64_t generation) {
+  while (generation > 1 &&
+         common::RemoveFile(LogPath(dir, generation - 1))) {
+    --generation;
+  }
+}
+}  // namespace
+
+SessionJournal::~SessionJournal() { Close(); }
+
+bool SessionJournal::Open(aria2_session_t* session, const std::string& dir,
+                          bool restore, std::vector<aria2_gid_t>* restored,
+                          std::string* error) {
+  Close();
+  std::lock_guard<std::mutex> lock(mutex_);
+  dir_ = dir;
+  live_.clear();
+  stats_ = Stats();
+  next_seq_ = 0;
+
+  // The snapshot covers everything before the log of its generation; the
+  // logs from that generation on are replayed in order.
+  uint64_t generation = 1;
+  common::MappedFile file;
+  if (OpenJournalFile(SnapshotPath(dir), kSnapshotMagic, &file, &generation)) {
+    if (restore) {
+      ReplayLocked(file.data(), file.size());
+    }
+    file.Close();
+  }
+  snapshot_generation_ = generation;
+  uint64_t last = generation;
+  for (uint64_t next = generation;; ++next) {
+    uint64_t found = 0;
+    if (!OpenJournalFile(LogPath(dir, next), kLogMagic, &file, &found) ||
+        found != next) {
+      break;
+    }
+    if (restore) {
+      ReplayLocked(file.data(), file.size());
+    }
+    file.Close();
+    last = next;
+  }
+  generation_ = last;
+
+  if (restore) {
+    std::vector<std::pair<aria2_gid_t, const Live*>> order;
+    order.reserve(live_.size());
+    for (const auto& item : live_) {
+      order.emplace_back(item.first, &item.second);
+    }
+    std::sort(order.begin(), order.end(),
+              [](const std::pair<aria2_gid_t, const Live*>& a,
+                 const std::pair<aria2_gid_t, const Live*>& b) {
+                return a.second->seq < b.second->seq;
+              });
+    std::vector<aria2_gid_t> failed;
+    for (const auto& item : order) {
+      const Live& entry = *item.second;
+      common::KeyVals options;
+      for (const auto& option : entry.options) {
+        if (option.first != "gid" && option.first != "pause") {
+          options.Add(option.first, option.second);
+        }
+      }
+      options.Add("gid", common::GidToHex(item.first));
+      if (entry.paused) {
+        options.Add("pause", "true");
+      }
+      std::vector<const char*> uri_ptrs;
+      uri_ptrs.reserve(entry.uris.size());
+      for (const std::string& uri : entry.uris) {
+        uri_ptrs.push_back(uri.c_str());
+      }
+      aria2_gid_t gid = 0;
+      if (aria2_add_uri(session, &gid, uri_ptrs.data(), uri_ptrs.size(),
+                        options.data(), options.count(), -1) == 0) {
+        restored->push_back(gid);
+      } else {
+        failed.push_back(item.first);
+      }
+    }
+    for (aria2_gid_t gid : failed) {
+      live_.erase(gid);
+    }
+    stats_.restored = static_cast<int64_t>(restored->size());
+    stats_.restore_failed = static_cast<int64_t>(failed.size());
+  }
+
+  // Start from a fresh checkpoint of what was restored (or of nothing).
+  uint64_t checkpoint = 0;
+  std::vector<std::pair<aria2_gid_t, Live>> copy =
+      RotateLocked(&checkpoint, error);
+  if (!log_.is_open()) {
+    return false;
+  }
+  if (!WriteSnapshot(dir_, copy, checkpoint, error)) {
+    log_.Close();
+    return false;
+  }
+  RemoveLogsBelow(dir_, checkpoint);
+  snapshot_generation_ = checkpoint;
+  return true;
+}
+
+void SessionJournal::Close() {
+  JoinCompactor();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!log_.is_open()) {
+    return;
+  }
+  log_.Sync();
+  log_.Close();
+  live_.clear();
+  dirty_ = false;
+}
+
+bool SessionJournal::is_open() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return log_.is_open();
+}
+
+bool SessionJournal::StartLogLocked(uint64_t generation, std::string* error) {
+  log_.Close();
+  const std::string path = LogPath(dir_, generation);
+  common::RemoveFile(path);
+  if (!log_.Open(path, kJournalLogSize, error)) {
+    return false;
+  }
+  auto* header = reinterpret_cast<JournalFileHeader*>(log_.data());
+  std::memcpy(header->magic, kLogMagic, 8);
+  header->generation = generation;
+  log_end_ = sizeof(JournalFileHeader);
+  generation_ = generation;
+  dirty_ = true;
+  return true;
+}
+
+void SessionJournal::AppendLocked(uint8_t type, aria2_gid_t gid,
+                                  const std::vector<std::string>& uris,
+                                  const Options& options) {
+  std::string record;
+  EncodeJournalRecord(&record, type, gid, uris, options);
+  std::string error;
+  // Keep a zero size after the record so replay stops there.
+  if (!log_.Reserve(log_end_ + record.size() + kRecordHeaderSize, &error)) {
+    log_.Close();
+    return;
+  }
+  std::memcpy(log_.data() + log_end_, record.data(), record.size());
+  log_end_ += record.size();
+  dirty_ = true;
+  ++stats_.records;
+}
+
+bool SessionJournal::ReplayLocked(const char* data, size_t size) {
+  size_t offset = sizeof(JournalFileHeader);
+  JournalRecord record;
+  while (offset + kRecordHeaderSize <= size) {
+    const uint32_t length = GetRaw<uint32_t>(data + offset);
+    const uint32_t checksum = GetRaw<uint32_t>(data + offset + 4);
+    const char* payload = data + offset + kRecordHeaderSize;
+    if (length == 0 || length > size - offset - kRecordHeaderSize) {
+      break;
+    }
+    if (JournalChecksum(payload, length) != checksum ||
+        !DecodeJournalPayload(payload, length, &record)) {
+      return false;
+    }
+    offset += kRecordHeaderSize + length;
+
+    auto it = live_.find(record.gid);
+    switch (record.type) {
+      case kJournalAdded: {
+        Live& entry = live_[record.gid];
+        entry.seq = next_seq_++;
+        entry.paused = false;
+        entry.uris = std::move(record.uris);
+        entry.options = std::move(record.options);
+        break;
+      }
+      case kJournalOptions:
+        if (it != live_.end()) {
+          MergeOptions(&it->second.options, record.options);
+        }
+        break;
+      case kJournalPaused:
+      case kJournalResumed:
+        if (it != live_.end()) {
+          it->second.paused = record.type == kJournalPaused;
+        }
+        break;
+      case kJournalFinished:
+        if (it != live_.end()) {
+          live_.erase(it);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return true;
+}
+
+std::vector<std::pair<aria2_gid_t, SessionJournal::Live>>
+SessionJournal::RotateLocked(uint64_t* generation, std::string* error) {
+  std::vector<std::pair<aria2_gid_t, Live>> copy;
+  if (log_.is_open()) {
+    log_.Sync();
+  }
+  *generation = generation_ + 1;
+  if (!StartLogLocked(*generation, error)) {
+    log_.Close();
+    return copy;
+  }
+  copy.reserve(live_.size());
+  for (const auto& item : live_) {
+    copy.emplace_back(item.first, item.second);
+  }
+  std::sort(copy.begin(), copy.end(),
+            [](const std::pair<aria2_gid_t, Live>& a,
+               const std::pair<aria2_gid_t, Live>& b) {
+              return a.second.seq < b.second.seq;
+            });
+  return copy;
+}
+
+bool SessionJournal::WriteSnapshot(
+    const std::string& dir,
+    const std::vector<std::pair<aria2_gid_t, Live>>& live,
+    uint64_t generation, std::string* error) {
+  std::string body;
+  JournalFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kSnapshotMagic, 8);
+  header.generation = generation;
+  body.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (const auto& item : live) {
+    EncodeJournalRecord(&body, kJournalAdded, item.first, item.second.uris,
+                        item.second.options);
+    if (item.second.paused) {
+      EncodeJournalRecord(&body, kJournalPaused, item.first, {}, {});
+    }
+  }
+  // Zero terminator.
+  PutRaw<uint32_t>(&body, 0);
+
+  const std::string path = SnapshotPath(dir);
+  const std::string temp = path + ".tmp";
+  common::RemoveFile(temp);
+  common::MappedFile file;
+  if (!file.Open(temp, body.size(), error)) {
+    return false;
+  }
+  std::memcpy(file.data(), body.data(), body.size());
+  const bool synced = file.Sync();
+  file.Close();
+  if (!synced) {
+    *error = "Cannot sync " + temp;
+    common::RemoveFile(temp);
+    return false;
+  }
+  return common::RenameFile(temp, path, error);
+}
+
+void SessionJournal::OnAdded(aria2_gid_t gid,
+                             const std::vector<std::string>& uris,
+                             const Options& options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // A gid already live was just restored.
+  if (!log_.is_open() || uris.empty() || live_.count(gid) > 0) {
+    return;
+  }
+  Live& entry = live_[gid];
+  entry.seq = next_seq_++;
+  entry.uris = uris;
+  entry.options = options;
+  AppendLocked(kJournalAdded, gid, uris, options);
+}
+
+void SessionJournal::OnOptionsChanged(aria2_gid_t gid,
+                                      const Options& options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = live_.find(gid);
+  if (!log_.is_open() || it == live_.end()) {
+    return;
+  }
+  MergeOptions(&it->second.options, options);
+  AppendLocked(kJournalOptions, gid, {}, options);
+}
+
+void SessionJournal::OnDownloadEvent(aria2_session_t* session,
+                                     aria2_download_event_t event,
+                                     aria2_gid_t gid) {
+  if (event == ARIA2_EVENT_ON_DOWNLOAD_STOP &&
+      common::GetDownloadStatus(session, gid) != common::kStatusRemoved) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = live_.find(gid);
+  if (!log_.is_open() || it == live_.end()) {
+    return;
+  }
+  switch (event) {
+    case ARIA2_EVENT_ON_DOWNLOAD_PAUSE:
+      if (!it->second.paused) {
+        it->second.paused = true;
+        AppendLocked(kJournalPaused, gid, {}, {});
+      }
+      break;
+    case ARIA2_EVENT_ON_DOWNLOAD_START:
+      if (it->second.paused) {
+        it->second.paused = false;
+        AppendLocked(kJournalResumed, gid, {}, {});
+      }
+      break;
+    case ARIA2_EVENT_ON_DOWNLOAD_COMPLETE:
+    case ARIA2_EVENT_ON_DOWNLOAD_ERROR:
+    case ARIA2_EVENT_ON_DOWNLOAD_STOP:
+      live_.erase(it);
+      AppendLocked(kJournalFinished, gid, {}, {});
+      break;
+    default:
+      break;
+  }
+}
+
+void SessionJournal::OnTick() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!log_.is_open()) {
+    return;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  if (dirty_ &&
+      now - last_commit_ >= std::chrono::milliseconds(kJournalCommitMs)) {
+    // One sync covers every record appended since the last one.
+    log_.Sync();
+    dirty_ = false;
+    last_commit_ = now;
+    ++stats_.commits;
+  }
+  if (log_end_ < kJournalCheckpointAt || compacting_.load()) {
+    return;
+  }
+  if (compactor_.joinable()) {
+    // The previous checkpoint has finished; only the thread exit is left.
+    compactor_.join();
+  }
+  uint64_t generation = 0;
+  std::string error;
+  std::vector<std::pair<aria2_gid_t, Live>> copy =
+      RotateLocked(&generation, &error);
+  if (!log_.is_open()) {
+    return;
+  }
+  compacting_.store(true);
+  compactor_ = std::thread([this, dir = dir_, copy = std::move(copy),
+                            generation]() {
+    std::string error;
+    const bool written = WriteSnapshot(dir, copy, generation, &error);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (written) {
+        RemoveLogsBelow(dir, generation);
+        snapshot_generation_ = generation;
+        ++stats_.checkpoints;
+      }
+    }
+    compacting_.store(false);
+  });
+}
+
+bool SessionJournal::Checkpoint(std::string* error) {
+  JoinCompactor();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!log_.is_open()) {
+    *error = "The journal is not open";
+    return false;
+  }
+  uint64_t generation = 0;
+  std::vector<std::pair<aria2_gid_t, Live>> copy =
+      RotateLocked(&generation, error);
+  if (!log_.is_open() || !WriteSnapshot(dir_, copy, generation, error)) {
+    return false;
+  }
+  RemoveLogsBelow(dir_, generation);
+  snapshot_generation_ = generation;
+  ++stats_.checkpoints;
+  return true;
+}
+
+void SessionJournal::JoinCompactor() {
+  std::thread compactor;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    compactor = std::move(compactor_);
+  }
+  if (compactor.joinable()) {
+    compactor.join();
+  }
+}
+
+SessionJournal::Stats SessionJournal::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.live = static_cast<int64_t>(live_.size());
+  return stats;
+}
+
+common::Value SessionJournal::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewMap();
+  out.Set("open", log_.is_open());
+  out.Set("dir", dir_);
+  out.Set("generation", static_cast<int64_t>(generation_));
+  out.Set("snapshotGeneration", static_cast<int64_t>(snapshot_generation_));
+  out.Set("logBytes", static_cast<int64_t>(log_.is_open() ? log_end_ : 0));
+  out.Set("compacting", compacting_.load());
+  out.Set("live", static_cast<int64_t>(live_.size()));
+  out.Set("records", stats_.records);
+  out.Set("commits", stats_.commits);
+  out.Set("checkpoints", stats_.checkpoints);
+  out.Set("restored", stats_.restored);
+  out.Set("restoreFailed", stats_.restore_failed);
+  return out;
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
@@ -0,0 +1,126 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_JOURNAL_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_JOURNAL_H_
+
+#include <aria2_c_api.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "aria2_mapped_file.h"
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// Crash-safe record of the URI downloads added through the plugin, for
+// restoring them into a new session.
+//
+// Every add, option change, pause, resume and finish is appended to a
+// memory-mapped log (journal-<generation>.log, sized up front). Appends
+// land in MAP_SHARED pages and so survive a process crash at once; OnTick
+// group-commits them to disk at most every kJournalCommitMs. When the log
+// is three quarters full a compactor thread writes the downloads still
+// live to journal.snapshot and switches to a fresh log; logs older than
+// the snapshot are deleted once it is in place. Restoring loads the
+// snapshot, replays the logs after it and re-adds the downloads with their
+// original gids, options and paused state.
+//
+// Torrent and metalink downloads carry no URIs and are not journaled.
+class SessionJournal {
+ public:
+  using Options = std::vector<std::pair<std::string, std::string>>;
+
+  static constexpr int kJournalCommitMs = 100;
+
+  struct Stats {
+    int64_t live = 0;
+    int64_t records = 0;
+    int64_t commits = 0;
+    int64_t checkpoints = 0;
+    int64_t restored = 0;
+    int64_t restore_failed = 0;
+  };
+
+  SessionJournal() = default;
+  ~SessionJournal();
+
+  SessionJournal(const SessionJournal&) = delete;
+  SessionJournal& operator=(const SessionJournal&) = delete;
+
+  // Opens the journal in |dir|. With |restore| the recorded downloads are
+  // re-added to |session| and returned in |restored|; otherwise whatever
+  // was recorded there is discarded.
+  bool Open(aria2_session_t* session, const std::string& dir, bool restore,
+            std::vector<aria2_gid_t>* restored, std::string* error);
+  // Commits outstanding records and waits for a running checkpoint.
+  void Close();
+  bool is_open() const;
+
+  void OnAdded(aria2_gid_t gid, const std::vector<std::string>& uris,
+               const Options& options);
+  void OnOptionsChanged(aria2_gid_t gid, const Options& options);
+  // Runs in the download event callback. Downloads halted by a session
+  // shutdown also report a stop; they stay live so a restore resumes them.
+  void OnDownloadEvent(aria2_session_t* session, aria2_download_event_t event,
+                       aria2_gid_t gid);
+
+  // Group commit and checkpoint trigger.
+  void OnTick();
+
+  // Writes a checkpoint now and waits for it.
+  bool Checkpoint(std::string* error);
+
+  Stats GetStats() const;
+  // {open, dir, generation, snapshotGeneration, logBytes, compacting, live,
+  // records, commits, checkpoints, restored, restoreFailed}.
+  common::Value Describe() const;
+
+ private:
+  struct Live {
+    uint64_t seq = 0;  // Add order, kept by checkpoints.
+    bool paused = false;
+    std::vector<std::string> uris;
+    Options options;
+  };
+
+  bool StartLogLocked(uint64_t generation, std::string* error);
+  void AppendLocked(uint8_t type, aria2_gid_t gid,
+                    const std::vector<std::string>& uris,
+                    const Options& options);
+  bool ReplayLocked(const char* data, size_t size);
+  // Switches to a new log and returns the live set to write out.
+  std::vector<std::pair<aria2_gid_t, Live>> RotateLocked(
+      uint64_t* generation, std::string* error);
+  static bool WriteSnapshot(
+      const std::string& dir,
+      const std::vector<std::pair<aria2_gid_t, Live>>& live,
+      uint64_t generation, std::string* error);
+  void JoinCompactor();
+
+  mutable std::mutex mutex_;
+  std::string dir_;
+  common::MappedFile log_;
+  size_t log_end_ = 0;
+  uint64_t generation_ = 0;
+  uint64_t snapshot_generation_ = 0;
+  uint64_t next_seq_ = 0;
+  bool dirty_ = false;
+  std::unordered_map<aria2_gid_t, Live> live_;
+  Stats stats_;
+  std::chrono::steady_clock::time_point last_commit_;
+
+  std::thread compactor_;
+  std::atomic<bool> compacting_{false};
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_JOURNAL_H_
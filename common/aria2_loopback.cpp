@@ -0,0 +1,207 @@
+#include "aria2_loopback.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <utility>
+
+namespace flutter_aria2 {
+namespace common {
+
+namespace {
+constexpr int kLoopbackAcceptWaitMs = 200;
+constexpr int kLoopbackIoTimeoutMs = 5000;
+constexpr size_t kLoopbackChunkBytes = 64 * 1024;
+constexpr size_t kLoopbackMaxHeaderBytes = 16 * 1024;
+// Longest sleep of a throttled connection, so Stop() is not held up.
+constexpr auto kLoopbackMaxPause = std::chrono::milliseconds(50);
+}  // namespace
+
+LoopbackHttpServer::LoopbackHttpServer(std::string prefix, int64_t size,
+                                       int count)
+    : prefix_(std::move(prefix)),
+      size_(size),
+      last_byte_(static_cast<size_t>(count)) {
+  pattern_.resize(kLoopbackChunkBytes + 256);
+  for (size_t i = 0; i < pattern_.size(); ++i) {
+    pattern_[i] = ContentAt(static_cast<int64_t>(i));
+  }
+}
+
+LoopbackHttpServer::~LoopbackHttpServer() {
+  Stop();
+}
+
+bool LoopbackHttpServer::Start() {
+  listener_ = TcpListenLoopback(&port_);
+  if (listener_ == kInvalidSocket) {
+    return false;
+  }
+  acceptor_ = std::thread([this]() { AcceptLoop(); });
+  return true;
+}
+
+void LoopbackHttpServer::Stop() {
+  stopping_.store(true);
+  if (acceptor_.joinable()) {
+    acceptor_.join();
+  }
+  CloseSocket(listener_);
+  listener_ = kInvalidSocket;
+  std::vector<std::thread> connections;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    connections.swap(connections_);
+  }
+  for (std::thread& connection : connections) {
+    connection.join();
+  }
+}
+
+std::string LoopbackHttpServer::FileName(int index) const {
+  return prefix_ + std::to_string(index) + ".bin";
+}
+
+std::string LoopbackHttpServer::Url(int index) const {
+  return "http://127.0.0.1:" + std::to_string(port_) + "/" + FileName(index);
+}
+
+LoopbackHttpServer::Clock::time_point LoopbackHttpServer::LastByteSent(
+    int index) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return last_byte_[static_cast<size_t>(index)];
+}
+
+void LoopbackHttpServer::AcceptLoop() {
+  while (!stopping_.load()) {
+    const SocketHandle sock =
+        TcpAccept(listener_, kLoopbackAcceptWaitMs, kLoopbackIoTimeoutMs);
+    if (sock == kInvalidSocket) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    connections_.emplace_back([this, sock]() {
+      Serve(sock);
+      CloseSocket(sock);
+    });
+  }
+}
+
+int LoopbackHttpServer::FileIndex(const std::string& path) const {
+  for (size_t i = 0; i < last_byte_.size(); ++i) {
+    if (path == "/" + FileName(static_cast<int>(i))) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+void LoopbackHttpServer::Serve(SocketHandle sock) {
+  std::string request;
+  char buffer[4096];
+  while (request.find("\r\n\r\n") == std::string::npos) {
+    if (request.size() > kLoopbackMaxHeaderBytes || stopping_.load()) {
+      return;
+    }
+    const int n = RecvSome(sock, buffer, sizeof(buffer));
+    if (n <= 0) {
+      return;
+    }
+    request.append(buffer, static_cast<size_t>(n));
+  }
+
+  const bool head = request.compare(0, 5, "HEAD ") == 0;
+  const size_t path_begin = request.find(' ') + 1;
+  const size_t path_end = request.find(' ', path_begin);
+  const int index =
+      FileIndex(request.substr(path_begin, path_end - path_begin));
+  if (index < 0) {
+    SendAll(sock,
+            "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n"
+            "Connection: close\r\n\r\n");
+    return;
+  }
+
+  int64_t begin = 0;
+  int64_t end = size_ - 1;
+  bool ranged = false;
+  std::string lower = request;
+  for (char& c : lower) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  const size_t range = lower.find("\r\nrange: bytes=");
+  if (range != std::string::npos) {
+    const char* spec = request.c_str() + range + 15;
+    char* dash = nullptr;
+    begin = std::strtoll(spec, &dash, 10);
+    if (*dash == '-' && std::isdigit(static_cast<unsigned char>(dash[1]))) {
+      end = std::min(end,
+                     static_cast<int64_t>(std::strtoll(dash + 1, nullptr, 10)));
+    }
+    ranged = true;
+  }
+  if (begin > end) {
+    SendAll(sock,
+            "HTTP/1.1 416 Range Not Satisfiable\r\n"
+            "Content-Length: 0\r\nConnection: close\r\n\r\n");
+    return;
+  }
+
+  std::string header = ranged ? "HTTP/1.1 206 Partial Content\r\n"
+                              : "HTTP/1.1 200 OK\r\n";
+  if (ranged) {
+    header += "Content-Range: bytes " + std::to_string(begin) + "-" +
+              std::to_string(end) + "/" + std::to_string(size_) + "\r\n";
+  }
+  header += "Content-Length: " + std::to_string(end - begin + 1) +
+            "\r\nAccept-Ranges: bytes\r\n"
+            "Content-Type: application/octet-stream\r\n"
+            "Connection: close\r\n\r\n";
+  if (!SendAll(sock, header) || head) {
+    return;
+  }
+  if (SendBody(sock, begin, end) && end == size_ - 1) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    last_byte_[static_cast<size_t>(index)] = Clock::now();
+  }
+}
+
+bool LoopbackHttpServer::SendBody(SocketHandle sock, int64_t begin,
+                                  int64_t end) {
+  // A throttled connection sends about 20 chunks a second, each released
+  // once the bytes before it are due at |rate_limit_|.
+  size_t chunk = kLoopbackChunkBytes;
+  if (rate_limit_ > 0) {
+    chunk = static_cast<size_t>(std::max<int64_t>(
+        1, std::min<int64_t>(rate_limit_ / 20, kLoopbackChunkBytes)));
+  }
+  const Clock::time_point start = Clock::now();
+  int64_t sent = 0;
+  const int64_t total = end - begin + 1;
+  while (sent < total) {
+    if (stopping_.load()) {
+      return false;
+    }
+    if (rate_limit_ > 0) {
+      const Clock::time_point due =
+          start + std::chrono::microseconds(sent * 1000000 / rate_limit_);
+      const Clock::time_point now = Clock::now();
+      if (due > now) {
+        std::this_thread::sleep_for(
+            std::min<Clock::duration>(due - now, kLoopbackMaxPause));
+        continue;
+      }
+    }
+    const size_t n =
+        static_cast<size_t>(std::min<int64_t>(total - sent, chunk));
+    const size_t phase = static_cast<size_t>((begin + sent) % 256);
+    if (!SendAll(sock, pattern_.substr(phase, n))) {
+      return false;
+    }
+    sent += static_cast<int64_t>(n);
+  }
+  return true;
+}
+
+}  // namespace common
+}  // namespace flutter_aria2
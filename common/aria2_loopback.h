@@ -0,0 +1,78 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_LOOPBACK_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_LOOPBACK_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "aria2_net.h"
+
+namespace flutter_aria2 {
+namespace common {
+
+// Loopback HTTP server for synthetic workloads: |count| files of |size|
+// bytes named |prefix|<index>.bin, with Range support. Every response closes
+// its connection, so aria2 opens one connection per segment. Used by the
+// autotune benchmark and as a local stand-in server in tests.
+class LoopbackHttpServer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  LoopbackHttpServer(std::string prefix, int64_t size, int count);
+  ~LoopbackHttpServer();
+
+  LoopbackHttpServer(const LoopbackHttpServer&) = delete;
+  LoopbackHttpServer& operator=(const LoopbackHttpServer&) = delete;
+
+  // Caps every connection at |bytes_per_second|, so throughput grows with
+  // the number of connections like on a server with per-connection limits.
+  // 0 means unlimited. Must be set before Start().
+  void set_rate_limit(int64_t bytes_per_second) {
+    rate_limit_ = bytes_per_second;
+  }
+
+  bool Start();
+  void Stop();
+
+  int port() const { return port_; }
+  std::string FileName(int index) const;
+  std::string Url(int index) const;
+
+  // When the last byte of file |index| went out; empty if it never did.
+  Clock::time_point LastByteSent(int index);
+
+  // Byte at |offset| of every served file.
+  static char ContentAt(int64_t offset) {
+    return static_cast<char>(offset * 31 + 7);
+  }
+
+ private:
+  void AcceptLoop();
+  int FileIndex(const std::string& path) const;
+  void Serve(SocketHandle sock);
+  // Sends bytes [begin, end] of a file at the configured rate.
+  bool SendBody(SocketHandle sock, int64_t begin, int64_t end);
+
+  const std::string prefix_;
+  const int64_t size_;
+  int64_t rate_limit_ = 0;
+  // ContentAt() repeats every 256 bytes; the extra period lets any offset
+  // start a full chunk.
+  std::string pattern_;
+  SocketHandle listener_ = kInvalidSocket;
+  int port_ = 0;
+  std::atomic<bool> stopping_{false};
+  std::thread acceptor_;
+  std::mutex mutex_;
+  std::vector<std::thread> connections_;
+  std::vector<Clock::time_point> last_byte_;
+};
+
+}  // namespace common
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_LOOPBACK_H_
@@ -0,0 +1,689 @@
+#include "aria2_mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+namespace flutter_aria2 {
+namespace common {
+
+namespace {
+constexpr size_t kMinMappingSize = 64 * 1024;
+
+#ifdef _WIN32
+std::wstring WidePath(const std::string& path) {
+  const int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1,
+                                         nullptr, 0);
+  if (length <= 0) {
+    return std::wstring();
+  }
+  std::wstring wide(static_cast<size_t>(length), L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide[0], length);
+  wide.resize(static_cast<size_t>(length - 1));
+  return wide;
+}
+
+std::string NarrowPath(const wchar_t* wide) {
+  const int length =
+      WideCharToMultiByte(CP_UTF8, 0, wide, -1, nullptr, 0, nullptr, nullptr);
+  if (length <= 0) {
+    return std::string();
+  }
+  std::string narrow(static_cast<size_t>(length), '\0');
+  WideCharToMultiByte(CP_UTF8, 0, wide, -1, &narrow[0], length, nullptr,
+                      nullptr);
+  narrow.resize(static_cast<size_t>(length - 1));
+  return narrow;
+}
+
+std::string LastErrorText(const char* what) {
+  return std::string(what) + " failed with error " +
+         std::to_string(GetLastError());
+}
+#else
+std::string LastErrorText(const char* what) {
+  return std::string(what) + ": " + std::strerror(errno);
+}
+
+bool WriteAll(int fd, const void* data, size_t size) {
+  const auto* bytes = static_cast<const char*>(data);
+  while (size > 0) {
+    const ssize_t n = ::write(fd, bytes, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    bytes += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+#endif
+
+// Creates |path| exclusively and fills it with |data|.
+bool WriteNewTemporaryFile(const std::string& path, const void* data,
+                           size_t size, std::string* error) {
+#ifdef _WIN32
+  HANDLE file = CreateFileW(WidePath(path).c_str(), GENERIC_WRITE, 0, nullptr,
+                            CREATE_NEW, FILE_ATTRIBUTE_TEMPORARY, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    *error = LastErrorText("CreateFileW");
+    return false;
+  }
+  const auto* bytes = static_cast<const char*>(data);
+  bool ok = true;
+  while (ok && size > 0) {
+    DWORD written = 0;
+    const DWORD chunk = static_cast<DWORD>(
+        std::min<size_t>(size, 64 * 1024 * 1024));
+    ok = WriteFile(file, bytes, chunk, &written, nullptr) != 0 && written > 0;
+    bytes += written;
+    size -= written;
+  }
+  if (!ok) {
+    *error = LastErrorText("WriteFile");
+  }
+  CloseHandle(file);
+#else
+  const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                        0600);
+  if (fd < 0) {
+    *error = LastErrorText("open");
+    return false;
+  }
+  const bool ok = WriteAll(fd, data, size);
+  if (!ok) {
+    *error = LastErrorText("write");
+  }
+  ::close(fd);
+#endif
+  if (!ok) {
+    RemoveFile(path);
+  }
+  return ok;
+}
+}  // namespace
+
+MappedFile::~MappedFile() { Close(); }
+
+bool MappedFile::Open(const std::string& path, size_t min_size,
+                      std::string* error) {
+  Close();
+  path_ = path;
+#ifdef _WIN32
+  HANDLE file = CreateFileW(WidePath(path).c_str(),
+                            GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                            nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    *error = LastErrorText("CreateFileW");
+    return false;
+  }
+  file_ = file;
+  LARGE_INTEGER existing;
+  const size_t current =
+      GetFileSizeEx(file, &existing) ? static_cast<size_t>(existing.QuadPart)
+                                     : 0;
+#else
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    *error = LastErrorText("open");
+    return false;
+  }
+  struct stat st;
+  const size_t current =
+      fstat(fd_, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+#endif
+  if (!Map(std::max({current, min_size, kMinMappingSize}), error)) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+bool MappedFile::Reserve(size_t min_size, std::string* error) {
+  if (min_size <= size_) {
+    return true;
+  }
+  const size_t grown = std::max(min_size, size_ * 2);
+  Unmap();
+  return Map(grown, error);
+}
+
+bool MappedFile::Map(size_t size, std::string* error) {
+#ifdef _WIN32
+  LARGE_INTEGER length;
+  length.QuadPart = static_cast<LONGLONG>(size);
+  // Mapping a file past its end extends it with zeros.
+  HANDLE mapping = CreateFileMappingW(static_cast<HANDLE>(file_), nullptr,
+                                      PAGE_READWRITE, length.HighPart,
+                                      length.LowPart, nullptr);
+  if (mapping == nullptr) {
+    *error = LastErrorText("CreateFileMappingW");
+    return false;
+  }
+  void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+  if (view == nullptr) {
+    *error = LastErrorText("MapViewOfFile");
+    CloseHandle(mapping);
+    return false;
+  }
+  mapping_ = mapping;
+  data_ = static_cast<char*>(view);
+#else
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    *error = LastErrorText("fstat");
+    return false;
+  }
+  if (static_cast<size_t>(st.st_size) < size &&
+      ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+    *error = LastErrorText("ftruncate");
+    return false;
+  }
+  void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (view == MAP_FAILED) {
+    *error = LastErrorText("mmap");
+    return false;
+  }
+  data_ = static_cast<char*>(view);
+#endif
+  size_ = size;
+  return true;
+}
+
+void MappedFile::Unmap() {
+  if (data_ == nullptr) {
+    return;
+  }
+#ifdef _WIN32
+  UnmapViewOfFile(data_);
+  CloseHandle(static_cast<HANDLE>(mapping_));
+  mapping_ = nullptr;
+#else
+  munmap(data_, size_);
+#endif
+  data_ = nullptr;
+  size_ = 0;
+}
+
+bool MappedFile::Sync() {
+  if (data_ == nullptr) {
+    return false;
+  }
+#ifdef _WIN32
+  return FlushViewOfFile(data_, size_) != 0 &&
+         FlushFileBuffers(static_cast<HANDLE>(file_)) != 0;
+#else
+  return msync(data_, size_, MS_SYNC) == 0;
+#endif
+}
+
+void MappedFile::Close() {
+  Unmap();
+#ifdef _WIN32
+  if (file_ != nullptr) {
+    CloseHandle(static_cast<HANDLE>(file_));
+    file_ = nullptr;
+  }
+#else
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+#endif
+}
+
+InputFile::~InputFile() { Close(); }
+
+bool InputFile::Open(const std::string& path) {
+  Close();
+#ifdef _WIN32
+  HANDLE file = CreateFileW(
+      WidePath(path).c_str(), GENERIC_READ,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+      OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  file_ = file;
+#else
+  fd_ = ::open(path.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    return false;
+  }
+#endif
+  return true;
+}
+
+void InputFile::Close() {
+#ifdef _WIN32
+  if (file_ != nullptr) {
+    CloseHandle(static_cast<HANDLE>(file_));
+    file_ = nullptr;
+  }
+#else
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+#endif
+}
+
+bool InputFile::is_open() const {
+#ifdef _WIN32
+  return file_ != nullptr;
+#else
+  return fd_ >= 0;
+#endif
+}
+
+int64_t InputFile::ReadAt(int64_t offset, void* buffer, size_t size) {
+#ifdef _WIN32
+  OVERLAPPED at = {};
+  at.Offset = static_cast<DWORD>(offset);
+  at.OffsetHigh = static_cast<DWORD>(offset >> 32);
+  DWORD read = 0;
+  if (!ReadFile(static_cast<HANDLE>(file_), buffer, static_cast<DWORD>(size),
+                &read, &at)) {
+    return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+  }
+  return static_cast<int64_t>(read);
+#else
+  const ssize_t read = ::pread(fd_, buffer, size, static_cast<off_t>(offset));
+  return read < 0 ? -1 : static_cast<int64_t>(read);
+#endif
+}
+
+MappedInput::~MappedInput() { Close(); }
+
+bool MappedInput::Open(const std::string& path, std::string* error) {
+  Close();
+#ifdef _WIN32
+  HANDLE file = CreateFileW(WidePath(path).c_str(), GENERIC_READ,
+                            FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    *error = LastErrorText("CreateFileW");
+    return false;
+  }
+  LARGE_INTEGER length;
+  if (!GetFileSizeEx(file, &length) || length.QuadPart <= 0 ||
+      static_cast<uint64_t>(length.QuadPart) > SIZE_MAX) {
+    *error = "File is empty or too large to map";
+    CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  // The mapping keeps the file open.
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    *error = LastErrorText("CreateFileMappingW");
+    return false;
+  }
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == nullptr) {
+    *error = LastErrorText("MapViewOfFile");
+    CloseHandle(mapping);
+    return false;
+  }
+  mapping_ = mapping;
+  data_ = static_cast<char*>(view);
+  size_ = static_cast<size_t>(length.QuadPart);
+#else
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = LastErrorText("open");
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0 ||
+      static_cast<uint64_t>(st.st_size) > SIZE_MAX) {
+    *error = "File is empty or too large to map";
+    ::close(fd);
+    return false;
+  }
+  const size_t size = static_cast<size_t>(st.st_size);
+  void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps the file open.
+  ::close(fd);
+  if (view == MAP_FAILED) {
+    *error = LastErrorText("mmap");
+    return false;
+  }
+  madvise(view, size, MADV_SEQUENTIAL);
+  data_ = static_cast<char*>(view);
+  size_ = size;
+#endif
+  return true;
+}
+
+void MappedInput::Close() {
+  if (data_ == nullptr) {
+    return;
+  }
+#ifdef _WIN32
+  UnmapViewOfFile(data_);
+  CloseHandle(static_cast<HANDLE>(mapping_));
+  mapping_ = nullptr;
+#else
+  munmap(data_, size_);
+#endif
+  data_ = nullptr;
+  size_ = 0;
+}
+
+void MappedInput::WillNeed(size_t offset, size_t length) {
+  if (data_ == nullptr || offset >= size_) {
+    return;
+  }
+  length = std::min(length, size_ - offset);
+#ifdef _WIN32
+  // Windows reads mapped files ahead on its own once access is sequential;
+  // PrefetchVirtualMemory is not available before Windows 8.
+  (void)length;
+#else
+  // madvise wants a page-aligned start.
+  const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t start = offset & ~(page - 1);
+  madvise(data_ + start, length + (offset - start), MADV_WILLNEED);
+#endif
+}
+
+MemoryFile::~MemoryFile() { Close(); }
+
+bool MemoryFile::Open(const void* data, size_t size,
+                      const std::string& fallback_dir, std::string* error) {
+  Close();
+#if defined(__linux__) && defined(SYS_memfd_create)
+  // Called through syscall(): the libc wrapper needs glibc 2.27 or
+  // Android API level 30. 1 is MFD_CLOEXEC.
+  const int fd = static_cast<int>(syscall(SYS_memfd_create, "flutter_aria2",
+                                          1u));
+  if (fd >= 0) {
+    if (WriteAll(fd, data, size)) {
+      fd_ = fd;
+      path_ = "/proc/self/fd/" + std::to_string(fd);
+      return true;
+    }
+    ::close(fd);
+  }
+#endif
+  static std::atomic<uint32_t> counter{0};
+#ifdef _WIN32
+  const unsigned long pid = GetCurrentProcessId();
+#else
+  const unsigned long pid = static_cast<unsigned long>(getpid());
+#endif
+  for (const std::string& dir : {TemporaryDirectory(), fallback_dir}) {
+    if (dir.empty()) {
+      continue;
+    }
+    const std::string path = dir + "/.flutter_aria2-" + std::to_string(pid) +
+                             "-" + std::to_string(counter++) + ".tmp";
+    if (WriteNewTemporaryFile(path, data, size, error)) {
+      path_ = path;
+      temporary_ = true;
+      return true;
+    }
+  }
+  if (error->empty()) {
+    *error = "No writable temporary directory";
+  }
+  return false;
+}
+
+void MemoryFile::Close() {
+#ifndef _WIN32
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+#endif
+  if (temporary_) {
+    RemoveFile(path_);
+    temporary_ = false;
+  }
+  path_.clear();
+}
+
+std::string TemporaryDirectory() {
+#ifdef _WIN32
+  wchar_t buffer[MAX_PATH + 1];
+  const DWORD length = GetTempPathW(MAX_PATH + 1, buffer);
+  if (length == 0 || length > MAX_PATH) {
+    return std::string();
+  }
+  buffer[length - 1] = L'\0';  // Drop the trailing backslash.
+  return NarrowPath(buffer);
+#else
+#ifdef __linux__
+  if (::access("/dev/shm", W_OK | X_OK) == 0) {
+    return "/dev/shm";
+  }
+#endif
+  const char* dir = std::getenv("TMPDIR");
+  const std::string path = dir != nullptr && *dir != '\0' ? dir : "/tmp";
+  return ::access(path.c_str(), W_OK | X_OK) == 0 ? path : std::string();
+#endif
+}
+
+bool FileExists(const std::string& path) {
+#ifdef _WIN32
+  return GetFileAttributesW(WidePath(path).c_str()) != INVALID_FILE_ATTRIBUTES;
+#else
+  struct stat st;
+  return stat(path.c_str(), &st) == 0;
+#endif
+}
+
+bool RemoveFile(const std::string& path) {
+#ifdef _WIN32
+  return DeleteFileW(WidePath(path).c_str()) != 0;
+#else
+  return std::remove(path.c_str()) == 0;
+#endif
+}
+
+bool RenameFile(const std::string& from, const std::string& to,
+                std::string* error) {
+#ifdef _WIN32
+  if (!MoveFileExW(WidePath(from).c_str(), WidePath(to).c_str(),
+                   MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+    *error = LastErrorText("MoveFileExW");
+    return false;
+  }
+#else
+  if (std::rename(from.c_str(), to.c_str()) != 0) {
+    *error = LastErrorText("rename");
+    return false;
+  }
+#endif
+  return true;
+}
+
+bool StatFile(const std::string& path, int64_t* size, int64_t* mtime_ns) {
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExW(WidePath(path).c_str(), GetFileExInfoStandard,
+                            &data) ||
+      (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+    return false;
+  }
+  *size = (static_cast<int64_t>(data.nFileSizeHigh) << 32) |
+          data.nFileSizeLow;
+  // FILETIME counts 100 ns intervals since 1601-01-01.
+  const int64_t ticks =
+      (static_cast<int64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+      data.ftLastWriteTime.dwLowDateTime;
+  *mtime_ns = (ticks - 116444736000000000LL) * 100;
+#else
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    return false;
+  }
+  *size = static_cast<int64_t>(st.st_size);
+#ifdef __APPLE__
+  *mtime_ns = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000LL +
+              st.st_mtimespec.tv_nsec;
+#else
+  *mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL +
+              st.st_mtim.tv_nsec;
+#endif
+#endif
+  return true;
+}
+
+bool ReadWholeFile(const std::string& path, std::string* contents) {
+#ifdef _WIN32
+  HANDLE file = CreateFileW(WidePath(path).c_str(), GENERIC_READ,
+                            FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  contents->clear();
+  char buffer[16 * 1024];
+  DWORD read = 0;
+  bool ok = true;
+  while ((ok = ReadFile(file, buffer, sizeof(buffer), &read, nullptr) != 0) &&
+         read > 0) {
+    contents->append(buffer, read);
+  }
+  CloseHandle(file);
+  return ok;
+#else
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  contents->clear();
+  char buffer[16 * 1024];
+  ssize_t read;
+  while ((read = ::read(fd, buffer, sizeof(buffer))) > 0) {
+    contents->append(buffer, static_cast<size_t>(read));
+  }
+  ::close(fd);
+  return read == 0;
+#endif
+}
+
+bool IsDirectory(const std::string& path) {
+#ifdef _WIN32
+  const DWORD attributes = GetFileAttributesW(WidePath(path).c_str());
+  return attributes != INVALID_FILE_ATTRIBUTES &&
+         (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+bool ListDirectory(const std::string& path,
+                   std::vector<DirectoryEntry>* entries) {
+  entries->clear();
+#ifdef _WIN32
+  WIN32_FIND_DATAW data;
+  HANDLE find = FindFirstFileW(WidePath(path + "\\*").c_str(), &data);
+  if (find == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  do {
+    DirectoryEntry entry;
+    entry.name = NarrowPath(data.cFileName);
+    if (entry.name == "." || entry.name == "..") {
+      continue;
+    }
+    entry.directory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    entries->push_back(std::move(entry));
+  } while (FindNextFileW(find, &data));
+  FindClose(find);
+#else
+  DIR* dir = opendir(path.c_str());
+  if (dir == nullptr) {
+    return false;
+  }
+  while (const dirent* item = readdir(dir)) {
+    DirectoryEntry entry;
+    entry.name = item->d_name;
+    if (entry.name == "." || entry.name == "..") {
+      continue;
+    }
+    entry.directory = IsDirectory(path + "/" + entry.name);
+    entries->push_back(std::move(entry));
+  }
+  closedir(dir);
+#endif
+  std::sort(entries->begin(), entries->end(),
+            [](const DirectoryEntry& a, const DirectoryEntry& b) {
+              return a.name < b.name;
+            });
+  return true;
+}
+
+bool WriteFileAtomic(const std::string& path, const std::string& contents,
+                     std::string* error) {
+  const std::string temp = path + ".tmp";
+#ifdef _WIN32
+  HANDLE file = CreateFileW(WidePath(temp).c_str(), GENERIC_WRITE, 0, nullptr,
+                            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    *error = LastErrorText("CreateFileW");
+    return false;
+  }
+  DWORD written = 0;
+  const bool ok =
+      WriteFile(file, contents.data(), static_cast<DWORD>(contents.size()),
+                &written, nullptr) != 0 &&
+      written == contents.size();
+  if (!ok) {
+    *error = LastErrorText("WriteFile");
+  }
+  CloseHandle(file);
+#else
+  const int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    *error = LastErrorText("open");
+    return false;
+  }
+  size_t done = 0;
+  while (done < contents.size()) {
+    const ssize_t n =
+        ::write(fd, contents.data() + done, contents.size() - done);
+    if (n <= 0) {
+      break;
+    }
+    done += static_cast<size_t>(n);
+  }
+  const bool ok = done == contents.size();
+  if (!ok) {
+    *error = LastErrorText("write");
+  }
+  ::close(fd);
+#endif
+  if (!ok) {
+    RemoveFile(temp);
+    return false;
+  }
+  return RenameFile(temp, path, error);
+}
+
+}  // namespace common
+}  // namespace flutter_aria2
@@ -0,0 +1,174 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_MAPPED_FILE_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace flutter_aria2 {
+namespace common {
+
+// A read-write memory mapping of a whole file that can grow, over mmap /
+// CreateFileMapping. Native stores keep their own logical size in a header
+// and use the mapping as capacity, so growth is amortized by doubling.
+// Growing remaps the file: pointers into data() are invalidated.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Opens or creates |path| (UTF-8) and maps at least |min_size| bytes,
+  // extending the file with zeros when it is shorter.
+  bool Open(const std::string& path, size_t min_size, std::string* error);
+
+  // Makes at least |min_size| bytes available, at least doubling the
+  // mapping when it has to grow.
+  bool Reserve(size_t min_size, std::string* error);
+
+  // Writes dirty pages back to the file.
+  bool Sync();
+
+  void Close();
+
+  bool is_open() const { return data_ != nullptr; }
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+  const std::string& path() const { return path_; }
+
+ private:
+  bool Map(size_t size, std::string* error);
+  void Unmap();
+
+  std::string path_;
+  char* data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void* file_ = nullptr;
+  void* mapping_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+};
+
+// Positional reads of a file that aria2 may be writing at the same time.
+class InputFile {
+ public:
+  InputFile() = default;
+  ~InputFile();
+
+  InputFile(const InputFile&) = delete;
+  InputFile& operator=(const InputFile&) = delete;
+
+  bool Open(const std::string& path);
+  void Close();
+  bool is_open() const;
+
+  // Returns the number of bytes read at |offset|, 0 at the end of the file
+  // or -1 on error.
+  int64_t ReadAt(int64_t offset, void* buffer, size_t size);
+
+ private:
+#ifdef _WIN32
+  void* file_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+};
+
+// A read-only mapping of a whole file, for reading large inputs without
+// copying them through a buffer. Fails for empty files and, on 32-bit
+// builds, for files larger than the address space allows.
+class MappedInput {
+ public:
+  MappedInput() = default;
+  ~MappedInput();
+
+  MappedInput(const MappedInput&) = delete;
+  MappedInput& operator=(const MappedInput&) = delete;
+
+  bool Open(const std::string& path, std::string* error);
+  void Close();
+
+  bool is_open() const { return data_ != nullptr; }
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Asks the OS to start reading [offset, offset + length) in ahead of use.
+  void WillNeed(size_t offset, size_t length);
+
+ private:
+  char* data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void* mapping_ = nullptr;
+#endif
+};
+
+// Exposes an in-memory payload under a file path, for aria2 APIs that only
+// take paths. On Linux and Android the payload lives in an anonymous memfd
+// reached through /proc/self/fd, so nothing is written to disk. Elsewhere
+// it goes to a temporary file that is never synced and is removed by Close.
+class MemoryFile {
+ public:
+  MemoryFile() = default;
+  ~MemoryFile();
+
+  MemoryFile(const MemoryFile&) = delete;
+  MemoryFile& operator=(const MemoryFile&) = delete;
+
+  // Temporary files go to TemporaryDirectory(), or to |fallback_dir| when
+  // that fails.
+  bool Open(const void* data, size_t size, const std::string& fallback_dir,
+            std::string* error);
+  void Close();
+
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+  bool temporary_ = false;
+#ifndef _WIN32
+  int fd_ = -1;
+#endif
+};
+
+struct DirectoryEntry {
+  std::string name;
+  bool directory = false;
+};
+
+// A writable directory for short-lived files: the memory-backed /dev/shm on
+// Linux when available, otherwise the system temporary directory. Empty
+// when there is none (Android apps have no shared one).
+std::string TemporaryDirectory();
+
+// File operations on UTF-8 paths for stores that rotate their files.
+
+bool FileExists(const std::string& path);
+bool RemoveFile(const std::string& path);
+// Renames |from| over |to|, replacing it atomically where the platform
+// allows it.
+bool RenameFile(const std::string& from, const std::string& to,
+                std::string* error);
+// Size and modification time (nanoseconds since the epoch) of a regular
+// file.
+bool StatFile(const std::string& path, int64_t* size, int64_t* mtime_ns);
+bool ReadWholeFile(const std::string& path, std::string* contents);
+bool IsDirectory(const std::string& path);
+// Entries of the directory |path| without "." and "..", sorted by name.
+// Symbolic links are followed.
+bool ListDirectory(const std::string& path,
+                   std::vector<DirectoryEntry>* entries);
+// Writes |contents| to a temporary file next to |path| and renames it over
+// |path|, so readers see either the old or the new file.
+bool WriteFileAtomic(const std::string& path, const std::string& contents,
+                     std::string* error);
+
+}  // namespace common
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_MAPPED_FILE_H_
@@ -0,0 +1,1283 @@
+#include "aria2_methods.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "aria2_helpers.h"
+#include "aria2_mapped_file.h"
+#include "aria2_sha.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+const char kNotImplemented[] = "NOT_IMPLEMENTED";
+
+namespace {
+
+using common::Value;
+
+using MethodHandler = const char* (*)(RuntimeState* state, const Value& args,
+                                      Value* result, std::string* message);
+
+aria2_gid_t GidArg(const Value& args) {
+  return aria2_hex_to_gid(args.Get("gid").AsString().c_str());
+}
+
+const char* Fail(std::string* message, const char* code, std::string text) {
+  *message = std::move(text);
+  return code;
+}
+
+const char* PriorityArg(const Value& args, Priority* out, std::string* message) {
+  const Value& value = args.Get("priority");
+  if (!value.IsInt() || !PriorityFromInt(value.AsInt(), out)) {
+    return Fail(message, "BAD_ARGS", "Invalid 'priority'");
+  }
+  return nullptr;
+}
+
+// ──────── Add download ────────
+
+// The directory a download added with |options| is saved to.
+std::string DownloadDir(RuntimeState* state, const common::KeyVals& options) {
+  if (const std::string* dir = options.Find("dir")) {
+    return *dir;
+  }
+  std::string dir;
+  if (char* value = aria2_get_global_option(state->session, "dir")) {
+    dir = value;
+    aria2_free(value);
+  }
+  return dir;
+}
+
+// Reads "expectedSha256" ({file index: hex digest}) and "computeSha256".
+// Sets |*watch| when the download's files should be hashed.
+const char* ChecksumArgs(const Value& args, bool* watch,
+                         std::map<int, std::string>* expected,
+                         std::string* message) {
+  for (const auto& item : args.Get("expectedSha256").AsMap()) {
+    const int index = std::atoi(item.first.c_str());
+    std::string digest = item.second.AsString();
+    bool valid = index > 0 && digest.size() == 64;
+    for (char& c : digest) {
+      valid = valid && std::isxdigit(static_cast<unsigned char>(c)) != 0;
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    if (!valid) {
+      return Fail(message, "BAD_ARGS",
+                  "Invalid 'expectedSha256' entry for file " + item.first);
+    }
+    (*expected)[index] = std::move(digest);
+  }
+  *watch = !expected->empty() || args.Get("computeSha256").AsBool();
+  return nullptr;
+}
+
+const char* AddUri(RuntimeState* state, const Value& args, Value* result,
+                   std::string* message) {
+  const Value& uris = args.Get("uris");
+  if (!uris.IsList()) {
+    return Fail(message, "BAD_ARGS", "Missing 'uris'");
+  }
+  Priority priority = Priority::kNormal;
+  if (args.Has("priority")) {
+    if (const char* err = PriorityArg(args, &priority, message)) {
+      return err;
+    }
+  }
+  bool watch = false;
+  std::map<int, std::string> expected;
+  if (const char* err = ChecksumArgs(args, &watch, &expected, message)) {
+    return err;
+  }
+
+  std::vector<std::string> uri_strings = uris.AsStringList();
+  const std::string first_uri = uri_strings.empty() ? "" : uri_strings[0];
+  if (args.Get("rankMirrors").AsBool()) {
+    // aria2 hands out URIs in list order, so the best mirrors get the first
+    // connections.
+    uri_strings = state->hosts.RankUris(std::move(uri_strings));
+  }
+  std::vector<const char*> uri_ptrs;
+  uri_ptrs.reserve(uri_strings.size());
+  for (const std::string& uri : uri_strings) {
+    uri_ptrs.push_back(uri.c_str());
+  }
+  common::KeyVals options;
+  options.FromValue(args.Get("options"));
+  const int position = static_cast<int>(args.Get("position").AsInt(-1));
+  std::string resume_key;
+  if (state->resume.is_open()) {
+    const std::string* out = options.Find("out");
+    resume_key = ResumeCache::UriKey(first_uri, DownloadDir(state, options),
+                                     out != nullptr ? *out : "");
+    state->resume.Prepare(resume_key, "", &options);
+  }
+
+  aria2_gid_t gid;
+  const int ret = aria2_add_uri(state->session, &gid, uri_ptrs.data(),
+                                uri_ptrs.size(), options.data(),
+                                options.count(), position);
+  if (ret != 0) {
+    return Fail(message, "ARIA2_ERROR",
+                "aria2_add_uri failed with code " + std::to_string(ret));
+  }
+  if (!resume_key.empty()) {
+    state->resume.Track(gid, resume_key, "");
+  }
+  if (watch) {
+    state->checksums.Watch(gid, std::move(expected));
+  }
+  DownloadHints hints;
+  hints.size = args.Get("sizeHint").AsInt(-1);
+  hints.deadline = args.Get("deadline").AsInt(-1);
+  hints.uris = std::move(uri_strings);
+  for (size_t i = 0; i < options.keys.size(); ++i) {
+    hints.options.emplace_back(options.keys[i], options.values[i]);
+  }
+  OnDownloadAdded(state, gid, priority, std::move(hints));
+  *result = Value(common::GidToHex(gid));
+  return nullptr;
+}
+
+// Adds the torrent at |torrent_file|. |resume_id| names it in the
+// fast-resume cache and |resume_source| is the file the cache checks for
+// changes, empty when the torrent only exists in memory.
+const char* AddTorrentFile(RuntimeState* state, const Value& args,
+                           const std::string& torrent_file,
+                           const std::string& resume_id,
+                           const std::string& resume_source, Value* result,
+                           std::string* message) {
+  bool watch = false;
+  std::map<int, std::string> expected;
+  if (const char* err = ChecksumArgs(args, &watch, &expected, message)) {
+    return err;
+  }
+  std::vector<std::string> webseeds = args.Get("webseedUris").AsStringList();
+  std::vector<const char*> webseed_ptrs;
+  webseed_ptrs.reserve(webseeds.size());
+  for (const std::string& uri : webseeds) {
+    webseed_ptrs.push_back(uri.c_str());
+  }
+  common::KeyVals options;
+  options.FromValue(args.Get("options"));
+  const int position = static_cast<int>(args.Get("position").AsInt(-1));
+  std::string resume_key;
+  if (state->resume.is_open()) {
+    resume_key =
+        ResumeCache::TorrentKey(resume_id, DownloadDir(state, options));
+    state->resume.Prepare(resume_key, resume_source, &options);
+  }
+
+  aria2_gid_t gid;
+  const int ret =
+      webseed_ptrs.empty()
+          ? aria2_add_torrent_simple(state->session, &gid,
+                                     torrent_file.c_str(), options.data(),
+                                     options.count(), position)
+          : aria2_add_torrent(state->session, &gid, torrent_file.c_str(),
+                              webseed_ptrs.data(), webseed_ptrs.size(),
+                              options.data(), options.count(), position);
+  if (ret != 0) {
+    return Fail(message, "ARIA2_ERROR",
+                "aria2_add_torrent failed with code " + std::to_string(ret));
+  }
+  if (!resume_key.empty()) {
+    state->resume.Track(gid, resume_key, resume_source);
+  }
+  if (watch) {
+    state->checksums.Watch(gid, std::move(expected));
+  }
+  OnDownloadAdded(state, gid, Priority::kNormal, DownloadHints());
+  *result = Value(common::GidToHex(gid));
+  return nullptr;
+}
+
+const char* AddTorrent(RuntimeState* state, const Value& args, Value* result,
+                       std::string* message) {
+  const std::string torrent_file = args.Get("torrentFile").AsString();
+  return AddTorrentFile(state, args, torrent_file, torrent_file, torrent_file,
+                        result, message);
+}
+
+// aria2 only reads torrents and metalinks from files, but parses them before
+// the add call returns, so an in-memory payload is exposed through a
+// MemoryFile for the duration of the call.
+const char* StagePayload(RuntimeState* state, const Value& args,
+                         const char* key, common::MemoryFile* file,
+                         std::string* message) {
+  const Value::Bytes& payload = args.Get(key).AsBytes();
+  if (payload.empty()) {
+    return Fail(message, "BAD_ARGS", std::string("Missing '") + key + "'");
+  }
+  common::KeyVals options;
+  options.FromValue(args.Get("options"));
+  std::string error;
+  if (!file->Open(payload.data(), payload.size(), DownloadDir(state, options),
+                  &error)) {
+    return Fail(message, "IO_ERROR", "Cannot stage '" + std::string(key) +
+                                         "': " + error);
+  }
+  return nullptr;
+}
+
+const char* AddTorrentBytes(RuntimeState* state, const Value& args,
+                            Value* result, std::string* message) {
+  common::MemoryFile file;
+  if (const char* err = StagePayload(state, args, "torrent", &file, message)) {
+    return err;
+  }
+  // The payload has no stable path, so the cache knows it by content.
+  std::string resume_id;
+  if (state->resume.is_open()) {
+    const Value::Bytes& payload = args.Get("torrent").AsBytes();
+    common::Sha256 hash;
+    hash.Update(payload.data(), payload.size());
+    resume_id = "sha256:" + hash.HexDigest();
+  }
+  return AddTorrentFile(state, args, file.path(), resume_id, "", result,
+                        message);
+}
+
+const char* AddMetalinkFile(RuntimeState* state, const Value& args,
+                            const std::string& metalink_file, Value* result,
+                            std::string* message) {
+  common::KeyVals options;
+  options.FromValue(args.Get("options"));
+  const int position = static_cast<int>(args.Get("position").AsInt(-1));
+
+  aria2_gid_t* gids = nullptr;
+  size_t gids_count = 0;
+  const int ret =
+      aria2_add_metalink(state->session, &gids, &gids_count,
+                         metalink_file.c_str(), options.data(),
+                         options.count(), position);
+  if (ret != 0) {
+    if (gids != nullptr) {
+      aria2_free(gids);
+    }
+    return Fail(message, "ARIA2_ERROR",
+                "aria2_add_metalink failed with code " + std::to_string(ret));
+  }
+  Value list = Value::NewList();
+  for (size_t i = 0; i < gids_count; ++i) {
+    OnDownloadAdded(state, gids[i], Priority::kNormal, DownloadHints());
+    list.Append(common::GidToHex(gids[i]));
+  }
+  if (gids != nullptr) {
+    aria2_free(gids);
+  }
+  *result = std::move(list);
+  return nullptr;
+}
+
+const char* AddMetalink(RuntimeState* state, const Value& args, Value* result,
+                        std::string* message) {
+  return AddMetalinkFile(state, args, args.Get("metalinkFile").AsString(),
+                         result, message);
+}
+
+const char* AddMetalinkBytes(RuntimeState* state, const Value& args,
+                             Value* result, std::string* message) {
+  common::MemoryFile file;
+  if (const char* err =
+          StagePayload(state, args, "metalink", &file, message)) {
+    return err;
+  }
+  return AddMetalinkFile(state, args, file.path(), result, message);
+}
+
+// Downloads into a staging file managed by MemoryFetcher; the data arrives
+// with "onFetchComplete". Fetches skip the fast-resume cache and the journal.
+const char* FetchToMemory(RuntimeState* state, const Value& args,
+                          Value* result, std::string* message) {
+  std::vector<std::string> uris = args.Get("uris").AsStringList();
+  if (uris.empty()) {
+    return Fail(message, "BAD_ARGS", "Missing 'uris'");
+  }
+  const int64_t max_bytes = args.Get("maxBytes").AsInt(kDefaultFetchMaxBytes);
+  if (max_bytes <= 0) {
+    return Fail(message, "BAD_ARGS", "Invalid 'maxBytes'");
+  }
+  Priority priority = Priority::kNormal;
+  if (args.Has("priority")) {
+    if (const char* err = PriorityArg(args, &priority, message)) {
+      return err;
+    }
+  }
+  if (args.Get("rankMirrors").AsBool()) {
+    uris = state->hosts.RankUris(std::move(uris));
+  }
+  std::vector<const char*> uri_ptrs;
+  uri_ptrs.reserve(uris.size());
+  for (const std::string& uri : uris) {
+    uri_ptrs.push_back(uri.c_str());
+  }
+  common::KeyVals options;
+  options.FromValue(args.Get("options"));
+  std::string path = state->fetches.Prepare(DownloadDir(state, options),
+                                            &options);
+
+  aria2_gid_t gid;
+  const int ret = aria2_add_uri(state->session, &gid, uri_ptrs.data(),
+                                uri_ptrs.size(), options.data(),
+                                options.count(), -1);
+  if (ret != 0) {
+    return Fail(message, "ARIA2_ERROR",
+                "aria2_add_uri failed with code " + std::to_string(ret));
+  }
+  state->fetches.Track(gid, std::move(path), max_bytes);
+  OnDownloadAdded(state, gid, priority, DownloadHints());
+  *result = Value(common::GidToHex(gid));
+  return nullptr;
+}
+
+// ──────── Per-download options ────────
+
+const char* ChangeOption(RuntimeState* state, const Value& args, Value* result,
+                         std::string* /*message*/) {
+  const aria2_gid_t gid = aria2_hex_to_gid(args.Get("gid").AsString().c_str());
+  common::KeyVals options;
+  options.FromValue(args.Get("options"));
+  const int ret = aria2_change_option(state->session, gid, options.data(),
+                                      options.count());
+  if (ret == 0) {
+    SessionJournal::Options changed;
+    for (size_t i = 0; i < options.keys.size(); ++i) {
+      changed.emplace_back(options.keys[i], options.values[i]);
+    }
+    state->journal.OnOptionsChanged(gid, changed);
+  }
+  *result = Value(ret);
+  return nullptr;
+}
+
+// ──────── Download registry ────────
+
+const char* RegistryPage(RuntimeState* state, DownloadRegistry::Bucket bucket,
+                         const Value& args, Value* result,
+                         std::string* message) {
+  const int64_t offset = args.Get("offset").AsInt(0);
+  const int64_t limit = args.Get("limit").AsInt(100);
+  if (offset < 0 || limit < 0) {
+    return Fail(message, "BAD_ARGS", "'offset' and 'limit' must not be negative");
+  }
+  Value list = Value::NewList();
+  for (aria2_gid_t gid : state->registry.Page(
+           bucket, static_cast<size_t>(offset), static_cast<size_t>(limit))) {
+    list.Append(common::GidToHex(gid));
+  }
+  *result = std::move(list);
+  return nullptr;
+}
+
+const char* GetWaitingDownloads(RuntimeState* state, const Value& args,
+                                Value* result, std::string* message) {
+  return RegistryPage(state, DownloadRegistry::Bucket::kWaiting, args, result,
+                      message);
+}
+
+const char* GetStoppedDownloads(RuntimeState* state, const Value& args,
+                                Value* result, std::string* message) {
+  return RegistryPage(state, DownloadRegistry::Bucket::kStopped, args, result,
+                      message);
+}
+
+const char* GetDownloadSummary(RuntimeState* state, const Value& /*args*/,
+                               Value* result, std::string* /*message*/) {
+  *result = state->registry.Describe();
+  return nullptr;
+}
+
+// ──────── Priority classes ────────
+
+const char* SetDownloadPriority(RuntimeState* state, const Value& args,
+                                Value* result, std::string* message) {
+  Priority priority = Priority::kNormal;
+  if (const char* err = PriorityArg(args, &priority, message)) {
+    return err;
+  }
+  const aria2_gid_t gid = GidArg(args);
+  if (common::GetDownloadStatus(state->session, gid) < 0) {
+    return Fail(message, "HANDLE_FAILED",
+                "No download for gid " + args.Get("gid").AsString());
+  }
+  state->scheduler.SetPriority(gid, priority);
+  *result = Value(0);
+  return nullptr;
+}
+
+const char* GetDownloadPriority(RuntimeState* state, const Value& args,
+                                Value* result, std::string* /*message*/) {
+  *result = Value(static_cast<int32_t>(state->scheduler.GetPriority(GidArg(args))));
+  return nullptr;
+}
+
+const char* ReorderByPriority(RuntimeState* state, const Value& /*args*/,
+                              Value* result, std::string* /*message*/) {
+  *result = Value(static_cast<int32_t>(state->scheduler.Reorder()));
+  return nullptr;
+}
+
+// ──────── Queue policy ────────
+
+const char* SetQueuePolicy(RuntimeState* state, const Value& args,
+                           Value* result, std::string* message) {
+  QueuePolicy policy = QueuePolicy::kFifo;
+  const Value& value = args.Get("policy");
+  if (!value.IsInt() || !QueuePolicyFromInt(value.AsInt(), &policy)) {
+    return Fail(message, "BAD_ARGS", "Invalid 'policy'");
+  }
+  *result = Value(static_cast<int32_t>(state->scheduler.SetPolicy(policy)));
+  return nullptr;
+}
+
+const char* GetQueuePolicy(RuntimeState* state, const Value& /*args*/,
+                           Value* result, std::string* /*message*/) {
+  *result = Value(static_cast<int32_t>(state->scheduler.GetPolicy()));
+  return nullptr;
+}
+
+const char* SetDownloadDeadline(RuntimeState* state, const Value& args,
+                                Value* result, std::string* message) {
+  const aria2_gid_t gid = GidArg(args);
+  if (common::GetDownloadStatus(state->session, gid) < 0) {
+    return Fail(message, "HANDLE_FAILED",
+                "No download for gid " + args.Get("gid").AsString());
+  }
+  state->scheduler.SetDeadline(gid, args.Get("deadline").AsInt(-1));
+  *result = Value(0);
+  return nullptr;
+}
+
+// ──────── Adaptive concurrency ────────
+
+const char* EnableAdaptiveConcurrency(RuntimeState* state, const Value& args,
+                                      Value* result, std::string* message) {
+  ConcurrencyConfig config;
+  auto read = [&args](const char* key, int def) {
+    return static_cast<int>(args.Get(key).AsInt(def));
+  };
+  config.min.split = read("minSplit", config.min.split);
+  config.max.split = read("maxSplit", config.max.split);
+  config.min.max_connection_per_server =
+      read("minConnectionPerServer", config.min.max_connection_per_server);
+  config.max.max_connection_per_server =
+      read("maxConnectionPerServer", config.max.max_connection_per_server);
+  config.min.max_concurrent_downloads =
+      read("minConcurrentDownloads", config.min.max_concurrent_downloads);
+  config.max.max_concurrent_downloads =
+      read("maxConcurrentDownloads", config.max.max_concurrent_downloads);
+  config.sample_interval_ms =
+      read("sampleIntervalMs", config.sample_interval_ms);
+
+  if (config.min.split < 1 || config.min.split > config.max.split ||
+      config.min.max_connection_per_server < 1 ||
+      config.min.max_connection_per_server >
+          config.max.max_connection_per_server ||
+      config.min.max_concurrent_downloads < 1 ||
+      config.min.max_concurrent_downloads >
+          config.max.max_concurrent_downloads) {
+    return Fail(message, "BAD_ARGS", "Invalid concurrency bounds");
+  }
+  if (config.sample_interval_ms < 500) {
+    return Fail(message, "BAD_ARGS", "'sampleIntervalMs' must be >= 500");
+  }
+  state->concurrency.Enable(state->session, config);
+  *result = state->concurrency.Describe();
+  return nullptr;
+}
+
+const char* DisableAdaptiveConcurrency(RuntimeState* state,
+                                       const Value& /*args*/, Value* result,
+                                       std::string* /*message*/) {
+  state->concurrency.Disable();
+  *result = Value();
+  return nullptr;
+}
+
+// ──────── Retry ────────
+
+const char* SetRetryPolicy(RuntimeState* state, const Value& args,
+                           Value* result, std::string* message) {
+  RetryPolicy policy;
+  auto read = [&args](const char* key, int def) {
+    return static_cast<int>(args.Get(key).AsInt(def));
+  };
+  policy.enabled = args.Get("enabled").AsBool(true);
+  policy.max_attempts = read("maxAttempts", policy.max_attempts);
+  policy.base_delay_ms = read("baseDelayMs", policy.base_delay_ms);
+  policy.max_delay_ms = read("maxDelayMs", policy.max_delay_ms);
+  policy.multiplier = args.Get("multiplier").AsDouble(policy.multiplier);
+  policy.jitter = args.Get("jitter").AsDouble(policy.jitter);
+  policy.breaker_threshold = read("breakerThreshold", policy.breaker_threshold);
+  policy.breaker_cooldown_ms =
+      read("breakerCooldownMs", policy.breaker_cooldown_ms);
+
+  if (policy.max_attempts < 0 || policy.base_delay_ms < 0 ||
+      policy.max_delay_ms < policy.base_delay_ms || policy.multiplier < 1 ||
+      policy.jitter < 0 || policy.jitter > 1 || policy.breaker_threshold < 1 ||
+      policy.breaker_cooldown_ms < 0) {
+    return Fail(message, "BAD_ARGS", "Invalid retry policy");
+  }
+  state->retry.SetPolicy(policy);
+  *result = state->retry.Describe();
+  return nullptr;
+}
+
+const char* GetRetryStats(RuntimeState* state, const Value& /*args*/,
+                          Value* result, std::string* /*message*/) {
+  *result = state->retry.Describe();
+  return nullptr;
+}
+
+// ──────── Retention ────────
+
+const char* SetRetentionPolicy(RuntimeState* state, const Value& args,
+                               Value* result, std::string* message) {
+  RetentionPolicy policy;
+  policy.max_count = args.Get("maxCount").AsInt(-1);
+  policy.max_age_ms = args.Get("maxAgeMs").AsInt(-1);
+  policy.max_bytes = args.Get("maxBytes").AsInt(-1);
+  policy.archive_path = args.Get("archivePath").AsString();
+  if (policy.max_count < -1 || policy.max_age_ms < -1 ||
+      policy.max_bytes < -1) {
+    return Fail(message, "BAD_ARGS", "Invalid retention policy");
+  }
+  std::string error;
+  if (!state->retention.SetPolicy(policy, &error)) {
+    return Fail(message, "IO_ERROR", error);
+  }
+  *result = state->retention.Describe();
+  return nullptr;
+}
+
+const char* GetRetentionStats(RuntimeState* state, const Value& /*args*/,
+                              Value* result, std::string* /*message*/) {
+  *result = state->retention.Describe();
+  return nullptr;
+}
+
+// ──────── Host statistics ────────
+
+const char* GetHostStats(RuntimeState* state, const Value& args, Value* result,
+                         std::string* /*message*/) {
+  *result = state->hosts.Describe();
+  if (args.Get("clear").AsBool()) {
+    state->hosts.Clear();
+  }
+  return nullptr;
+}
+
+// ──────── Virtual queue ────────
+
+const char* OpenVirtualQueue(RuntimeState* state, const Value& args,
+                             Value* result, std::string* message) {
+  const std::string dir = args.Get("dir").AsString();
+  if (dir.empty()) {
+    return Fail(message, "BAD_ARGS", "Missing 'dir'");
+  }
+  const int lookahead = static_cast<int>(args.Get("lookahead").AsInt(2));
+  if (lookahead < 0) {
+    return Fail(message, "BAD_ARGS", "'lookahead' must not be negative");
+  }
+  std::string error;
+  if (!state->virtual_queue.Open(dir, lookahead, &error)) {
+    return Fail(message, "IO_ERROR", error);
+  }
+  *result = state->virtual_queue.Describe();
+  return nullptr;
+}
+
+const char* CloseVirtualQueue(RuntimeState* state, const Value& /*args*/,
+                              Value* result, std::string* /*message*/) {
+  state->virtual_queue.Close();
+  *result = Value();
+  return nullptr;
+}
+
+const char* AddVirtualUris(RuntimeState* state, const Value& args,
+                           Value* result, std::string* message) {
+  const Value& entries = args.Get("entries");
+  if (!entries.IsList()) {
+    return Fail(message, "BAD_ARGS", "Missing 'entries'");
+  }
+  std::vector<std::vector<std::string>> uri_lists;
+  uri_lists.reserve(entries.AsList().size());
+  for (const Value& entry : entries.AsList()) {
+    uri_lists.push_back(entry.AsStringList());
+    if (uri_lists.back().empty()) {
+      return Fail(message, "BAD_ARGS", "Every entry needs at least one URI");
+    }
+  }
+  std::vector<std::pair<std::string, std::string>> options;
+  const Value& option_map = args.Get("options");
+  if (option_map.IsMap()) {
+    for (const auto& option : option_map.AsMap()) {
+      options.emplace_back(option.first, option.second.AsString());
+    }
+  }
+  std::string error;
+  const int64_t first = state->virtual_queue.Append(uri_lists, options, &error);
+  if (first < 0) {
+    return Fail(message, "IO_ERROR", error);
+  }
+  *result = Value(first);
+  return nullptr;
+}
+
+const char* GetVirtualEntry(RuntimeState* state, const Value& args,
+                            Value* result, std::string* message) {
+  if (!state->virtual_queue.Describe(args.Get("id").AsInt(-1), result)) {
+    return Fail(message, "BAD_ARGS",
+                "No virtual entry " + std::to_string(args.Get("id").AsInt(-1)));
+  }
+  return nullptr;
+}
+
+const char* GetVirtualQueueStats(RuntimeState* state, const Value& /*args*/,
+                                 Value* result, std::string* /*message*/) {
+  *result = state->virtual_queue.Describe();
+  return nullptr;
+}
+
+// ──────── History ────────
+
+const char* OpenHistory(RuntimeState* state, const Value& args, Value* result,
+                        std::string* message) {
+  const std::string dir = args.Get("dir").AsString();
+  if (dir.empty()) {
+    return Fail(message, "BAD_ARGS", "Missing 'dir'");
+  }
+  std::string error;
+  if (!state->history.Open(dir, &error)) {
+    return Fail(message, "IO_ERROR", error);
+  }
+  *result = state->history.Describe();
+  return nullptr;
+}
+
+const char* CloseHistory(RuntimeState* state, const Value& /*args*/,
+                         Value* result, std::string* /*message*/) {
+  state->history.Close();
+  *result = Value();
+  return nullptr;
+}
+
+const char* QueryHistory(RuntimeState* state, const Value& args,
+                         Value* result, std::string* message) {
+  if (!state->history.is_open()) {
+    return Fail(message, "BAD_ARGS", "Call openHistory() first");
+  }
+  HistoryFilter filter;
+  filter.host = args.Get("host").AsString();
+  filter.since_ms = args.Get("since").AsInt(-1);
+  filter.until_ms = args.Get("until").AsInt(-1);
+  filter.status = static_cast<int>(args.Get("status").AsInt(-1));
+  const int64_t offset = args.Get("offset").AsInt(0);
+  const int64_t limit = args.Get("limit").AsInt(100);
+  if (offset < 0 || limit < 0) {
+    return Fail(message, "BAD_ARGS", "'offset' and 'limit' must not be negative");
+  }
+  *result = state->history.Query(filter, offset, limit);
+  return nullptr;
+}
+
+const char* GetHistoryStats(RuntimeState* state, const Value& /*args*/,
+                            Value* result, std::string* /*message*/) {
+  *result = state->history.Describe();
+  return nullptr;
+}
+
+// ──────── Session journal ────────
+
+const char* OpenJournal(RuntimeState* state, const Value& args, Value* result,
+                        std::string* message) {
+  const std::string dir = args.Get("dir").AsString();
+  if (dir.empty()) {
+    return Fail(message, "BAD_ARGS", "Missing 'dir'");
+  }
+  std::vector<aria2_gid_t> restored;
+  std::string error;
+  if (!state->journal.Open(state->session, dir,
+                           args.Get("restore").AsBool(true), &restored,
+                           &error)) {
+    return Fail(message, "IO_ERROR", error);
+  }
+  Value gids = Value::NewList();
+  for (aria2_gid_t gid : restored) {
+    OnDownloadAdded(state, gid, Priority::kNormal, DownloadHints());
+    gids.Append(common::GidToHex(gid));
+  }
+  *result = state->journal.Describe();
+  result->Set("restoredGids", std::move(gids));
+  return nullptr;
+}
+
+const char* CloseJournal(RuntimeState* state, const Value& /*args*/,
+                         Value* result, std::string* /*message*/) {
+  state->journal.Close();
+  *result = Value();
+  return nullptr;
+}
+
+const char* CheckpointJournal(RuntimeState* state, const Value& /*args*/,
+                              Value* result, std::string* message) {
+  if (!state->journal.is_open()) {
+    return Fail(message, "BAD_ARGS", "Call openJournal() first");
+  }
+  std::string error;
+  if (!state->journal.Checkpoint(&error)) {
+    return Fail(message, "IO_ERROR", error);
+  }
+  *result = state->journal.Describe();
+  return nullptr;
+}
+
+const char* GetJournalStats(RuntimeState* state, const Value& /*args*/,
+                            Value* result, std::string* /*message*/) {
+  *result = state->journal.Describe();
+  return nullptr;
+}
+
+// ──────── Fast resume ────────
+
+const char* OpenResumeCache(RuntimeState* state, const Value& args,
+                            Value* result, std::string* message) {
+  const std::string dir = args.Get("dir").AsString();
+  if (dir.empty()) {
+    return Fail(message, "BAD_ARGS", "Missing 'dir'");
+  }
+  std::string error;
+  if (!state->resume.Open(dir, &error)) {
+    return Fail(message, "IO_ERROR", error);
+  }
+  *result = state->resume.Describe();
+  return nullptr;
+}
+
+const char* CloseResumeCache(RuntimeState* state, const Value& /*args*/,
+                             Value* result, std::string* /*message*/) {
+  state->resume.Close();
+  *result = Value();
+  return nullptr;
+}
+
+const char* SaveResumeState(RuntimeState* state, const Value& /*args*/,
+                            Value* result, std::string* message) {
+  if (!state->resume.is_open()) {
+    return Fail(message, "BAD_ARGS", "Call openResumeCache() first");
+  }
+  *result = Value(state->resume.SaveAll(state->session));
+  return nullptr;
+}
+
+const char* GetResumeCacheStats(RuntimeState* state, const Value& /*args*/,
+                                Value* result, std::string* /*message*/) {
+  *result = state->resume.Describe();
+  return nullptr;
+}
+
+// ──────── Input file import ────────
+
+const char* ImportInputFile(RuntimeState* state, const Value& args,
+                            Value* result, std::string* message) {
+  const std::string path = args.Get("path").AsString();
+  if (path.empty()) {
+    return Fail(message, "BAD_ARGS", "Missing 'path'");
+  }
+  const bool to_virtual_queue = args.Get("virtualQueue").AsBool();
+  if (to_virtual_queue && !state->virtual_queue.is_open()) {
+    return Fail(message, "BAD_ARGS",
+                "Call openVirtualQueue() before importing into it");
+  }
+  std::vector<std::pair<std::string, std::string>> options;
+  const Value& option_map = args.Get("options");
+  if (option_map.IsMap()) {
+    for (const auto& option : option_map.AsMap()) {
+      options.emplace_back(option.first, option.second.AsString());
+    }
+  }
+  if (state->importer.running()) {
+    return Fail(message, "IMPORT_RUNNING", "An import is already running");
+  }
+  std::string error;
+  if (!state->importer.Start(path, to_virtual_queue, std::move(options),
+                             &error)) {
+    return Fail(message, "IO_ERROR", error);
+  }
+  *result = Value();
+  return nullptr;
+}
+
+const char* CancelImport(RuntimeState* state, const Value& /*args*/,
+                         Value* result, std::string* /*message*/) {
+  state->importer.Cancel();
+  *result = Value();
+  return nullptr;
+}
+
+// ──────── Metrics ────────
+
+const char* GetNativeMetrics(RuntimeState* state, const Value& args,
+                             Value* result, std::string* /*message*/) {
+  const QueueScheduler::Stats stats = state->scheduler.GetStats();
+  Value scheduler = Value::NewMap();
+  scheduler.Set("tracked", stats.tracked);
+  scheduler.Set("preempted", stats.preempted);
+  scheduler.Set("totalPreemptions", stats.total_preemptions);
+  scheduler.Set("totalResumes", stats.total_resumes);
+  scheduler.Set("totalPolicyMoves", stats.total_policy_moves);
+  scheduler.Set("policy", static_cast<int32_t>(state->scheduler.GetPolicy()));
+
+  Value out = Value::NewMap();
+  out.Set("scheduler", std::move(scheduler));
+  out.Set("concurrency", state->concurrency.Describe());
+  out.Set("retry", state->retry.Describe());
+  out.Set("hosts", state->hosts.Describe());
+  out.Set("virtualQueue", state->virtual_queue.Describe());
+  out.Set("registry", state->registry.Describe());
+  out.Set("retention", state->retention.Describe());
+  out.Set("journal", state->journal.Describe());
+  out.Set("resume", state->resume.Describe());
+  out.Set("checksums", state->checksums.Describe());
+  out.Set("fetches", state->fetches.Describe());
+  out.Set("streams", state->streams.Describe());
+  out.Set("bitfields", state->bitfields.Describe());
+  out.Set("groups", state->groups.Describe());
+  out.Set("speeds", state->speeds.Describe());
+  out.Set("triggers", state->triggers.Describe());
+  out.Set("subscriptions", state->subscriptions.Describe());
+  out.Set("waiters", state->waiters.Describe());
+  out.Set("methods", state->timings.Describe());
+  out.Set("events", state->metrics.Snapshot(args.Get("clear").AsBool()));
+  *result = std::move(out);
+  return nullptr;
+}
+
+// ──────── Autotune ────────
+
+const char* Autotune(RuntimeState* state, const Value& args, Value* result,
+                     std::string* message) {
+  if (const char* err = RequireInitialized(state)) {
+    return Fail(message, err, "Call libraryInit() before autotune()");
+  }
+  if (const char* err = RequireNoSession(state)) {
+    return Fail(message, err, "Call sessionFinal() before autotune()");
+  }
+  AutotuneConfig config;
+  config.dir = args.Get("dir").AsString();
+  if (config.dir.empty()) {
+    return Fail(message, "BAD_ARGS", "Missing 'dir'");
+  }
+  auto read_list = [&args](const char* key, std::vector<std::string>* out) {
+    if (args.Has(key)) {
+      *out = args.Get(key).AsStringList();
+    }
+    return !out->empty();
+  };
+  if (!read_list("diskCache", &config.disk_cache) ||
+      !read_list("fileAllocation", &config.file_allocation) ||
+      !read_list("pieceLength", &config.piece_length)) {
+    return Fail(message, "BAD_ARGS", "Option lists must not be empty");
+  }
+  config.workload_bytes = args.Get("workloadBytes").AsInt(config.workload_bytes);
+  config.file_count =
+      static_cast<int>(args.Get("fileCount").AsInt(config.file_count));
+  config.run_timeout_ms =
+      static_cast<int>(args.Get("runTimeoutMs").AsInt(config.run_timeout_ms));
+  if (config.file_count < 1 || config.file_count > 16) {
+    return Fail(message, "BAD_ARGS", "'fileCount' must be in [1, 16]");
+  }
+  if (config.workload_bytes < config.file_count * int64_t{1024 * 1024}) {
+    return Fail(message, "BAD_ARGS",
+                "'workloadBytes' must be at least 1 MiB per file");
+  }
+
+  const bool started = state->autotune.Start(
+      std::move(config), [state](Value out) {
+        EmitEvent(state, "onAutotuneComplete", std::move(out));
+      });
+  if (!started) {
+    return Fail(message, "AUTOTUNE_RUNNING",
+                "An autotune benchmark is already running");
+  }
+  *result = Value();
+  return nullptr;
+}
+
+const char* CancelAutotune(RuntimeState* state, const Value& /*args*/,
+                           Value* result, std::string* /*message*/) {
+  state->autotune.Cancel();
+  *result = Value();
+  return nullptr;
+}
+
+// ──────── Torrent creation ────────
+
+const char* CreateTorrent(RuntimeState* state, const Value& args,
+                          Value* result, std::string* message) {
+  TorrentConfig config;
+  config.paths = args.Get("paths").AsStringList();
+  config.output = args.Get("output").AsString();
+  if (config.paths.empty() || config.output.empty()) {
+    return Fail(message, "BAD_ARGS", "Missing 'paths' or 'output'");
+  }
+  config.piece_length = args.Get("pieceLength").AsInt(0);
+  if (config.piece_length != 0 &&
+      (config.piece_length < kMinTorrentPieceLength ||
+       config.piece_length > kMaxTorrentPieceLength ||
+       (config.piece_length & (config.piece_length - 1)) != 0)) {
+    return Fail(message, "BAD_ARGS",
+                "'pieceLength' must be a power of two from 16 KiB to 64 MiB");
+  }
+  config.trackers = args.Get("trackers").AsStringList();
+  config.webseeds = args.Get("webseeds").AsStringList();
+  config.comment = args.Get("comment").AsString();
+  config.private_torrent = args.Get("private").AsBool();
+  config.threads = static_cast<int>(args.Get("threads").AsInt(0));
+
+  const bool started = state->torrents.Start(
+      std::move(config), [state](Value out) {
+        EmitEvent(state, "onTorrentCreated", std::move(out));
+      });
+  if (!started) {
+    return Fail(message, "TORRENT_RUNNING",
+                "A torrent is already being created");
+  }
+  *result = Value();
+  return nullptr;
+}
+
+const char* CancelCreateTorrent(RuntimeState* state, const Value& /*args*/,
+                                Value* result, std::string* /*message*/) {
+  state->torrents.Cancel();
+  *result = Value();
+  return nullptr;
+}
+
+const char* GetCreateTorrentProgress(RuntimeState* state,
+                                     const Value& /*args*/, Value* result,
+                                     std::string* /*message*/) {
+  *result = state->torrents.Progress();
+  return nullptr;
+}
+
+// ──────── Progressive streams ────────
+
+const char* OpenProgressiveStream(RuntimeState* state, const Value& args,
+                                  Value* result, std::string* message) {
+  const Value& id = args.Get("id");
+  if (!id.IsInt()) {
+    return Fail(message, "BAD_ARGS", "Missing 'id'");
+  }
+  const int file_index = static_cast<int>(args.Get("fileIndex").AsInt(1));
+  std::string error;
+  if (!state->streams.Open(state->session, id.AsInt(), GidArg(args),
+                           file_index, &error)) {
+    return Fail(message, "BAD_ARGS", error);
+  }
+  *result = Value();
+  return nullptr;
+}
+
+const char* CloseProgressiveStream(RuntimeState* state, const Value& args,
+                                   Value* result, std::string* /*message*/) {
+  state->streams.Close(args.Get("id").AsInt());
+  *result = Value();
+  return nullptr;
+}
+
+// ──────── Piece bitfield ────────
+
+const char* GetPieceBitfield(RuntimeState* state, const Value& args,
+                             Value* result, std::string* message) {
+  const aria2_gid_t gid = GidArg(args);
+  if (!state->bitfields.Query(state->session, gid,
+                              args.Get("sinceSeq").AsInt(-1), result)) {
+    return Fail(message, "HANDLE_FAILED",
+                "No download for gid " + args.Get("gid").AsString());
+  }
+  return nullptr;
+}
+
+// ──────── Download groups ────────
+
+const char* GetGroupProgress(RuntimeState* state, const Value& args,
+                             Value* result, std::string* message) {
+  if (!state->groups.Progress(state->session, GidArg(args), result)) {
+    return Fail(message, "HANDLE_FAILED",
+                "No download for gid " + args.Get("gid").AsString());
+  }
+  return nullptr;
+}
+
+const char* ApplyToGroup(RuntimeState* state, const Value& args,
+                         DownloadGroups::Action action, Value* result,
+                         std::string* message) {
+  const int applied = state->groups.Apply(state->session, GidArg(args), action,
+                                          args.Get("force").AsBool(false));
+  if (applied < 0) {
+    return Fail(message, "HANDLE_FAILED",
+                "No download for gid " + args.Get("gid").AsString());
+  }
+  *result = Value(static_cast<int64_t>(applied));
+  return nullptr;
+}
+
+const char* PauseGroup(RuntimeState* state, const Value& args, Value* result,
+                       std::string* message) {
+  return ApplyToGroup(state, args, DownloadGroups::Action::kPause, result,
+                      message);
+}
+
+const char* UnpauseGroup(RuntimeState* state, const Value& args,
+                         Value* result, std::string* message) {
+  return ApplyToGroup(state, args, DownloadGroups::Action::kUnpause, result,
+                      message);
+}
+
+const char* RemoveGroup(RuntimeState* state, const Value& args, Value* result,
+                        std::string* message) {
+  return ApplyToGroup(state, args, DownloadGroups::Action::kRemove, result,
+                      message);
+}
+
+// ──────── Speed history ────────
+
+const char* SetSpeedHistoryPolicy(RuntimeState* state, const Value& args,
+                                  Value* result, std::string* message) {
+  SpeedHistoryPolicy policy = state->speeds.GetPolicy();
+  policy.interval_ms = args.Get("intervalMs").AsInt(policy.interval_ms);
+  policy.samples = args.Get("samples").AsInt(policy.samples);
+  policy.smoothing_ms = args.Get("smoothingMs").AsInt(policy.smoothing_ms);
+  policy.max_downloads = args.Get("maxDownloads").AsInt(policy.max_downloads);
+  std::string error;
+  if (!state->speeds.SetPolicy(policy, &error)) {
+    return Fail(message, "BAD_ARGS", error);
+  }
+  *result = state->speeds.Describe();
+  return nullptr;
+}
+
+const char* GetSpeedHistory(RuntimeState* state, const Value& args,
+                            Value* result, std::string* message) {
+  if (!state->speeds.Query(GidArg(args), result)) {
+    return Fail(message, "HANDLE_FAILED",
+                "No speed history for gid " + args.Get("gid").AsString());
+  }
+  return nullptr;
+}
+
+// ──────── Progress triggers ────────
+
+const char* RegisterProgressTrigger(RuntimeState* state, const Value& args,
+                                    Value* result, std::string* message) {
+  ProgressTriggerSpec spec;
+  if (args.Has("gid")) {
+    spec.gid = GidArg(args);
+    if (spec.gid == 0) {
+      return Fail(message, "BAD_ARGS", "Invalid 'gid'");
+    }
+  }
+  spec.percent_step = args.Get("percentStep").AsDouble(0);
+  spec.speed_delta_pct = args.Get("speedDeltaPct").AsDouble(0);
+  for (const Value& boundary : args.Get("etaBoundaries").AsList()) {
+    spec.eta_boundaries.push_back(boundary.AsInt());
+  }
+  spec.min_interval_ms = args.Get("minIntervalMs").AsInt(0);
+  if (spec.percent_step < 0 || spec.percent_step > 100 ||
+      spec.speed_delta_pct < 0 || spec.min_interval_ms < 0) {
+    return Fail(message, "BAD_ARGS", "Invalid progress trigger");
+  }
+  if (spec.percent_step == 0 && spec.speed_delta_pct == 0 &&
+      spec.eta_boundaries.empty()) {
+    return Fail(message, "BAD_ARGS",
+                "Set percentStep, speedDeltaPct or etaBoundaries");
+  }
+  *result = Value(state->triggers.Register(std::move(spec)));
+  return nullptr;
+}
+
+const char* UnregisterProgressTrigger(RuntimeState* state, const Value& args,
+                                      Value* result,
+                                      std::string* /*message*/) {
+  *result = Value(state->triggers.Unregister(args.Get("id").AsInt()));
+  return nullptr;
+}
+
+// ──────── Event subscriptions ────────
+
+// {name, eventMask, gids?}; without gids the subscription covers every
+// download.
+const char* SetEventFilter(RuntimeState* state, const Value& args,
+                           Value* result, std::string* message) {
+  const std::string name = args.Get("name").AsString();
+  const Value& mask = args.Get("eventMask");
+  if (name.empty() || !mask.IsInt() || mask.AsInt() < 0 ||
+      mask.AsInt() > 0xFFFFFFFFLL) {
+    return Fail(message, "BAD_ARGS", "Invalid event filter");
+  }
+  const bool all_gids = !args.Has("gids");
+  std::vector<aria2_gid_t> gids;
+  for (const std::string& hex : args.Get("gids").AsStringList()) {
+    const aria2_gid_t gid = aria2_hex_to_gid(hex.c_str());
+    if (gid == 0) {
+      return Fail(message, "BAD_ARGS", "Invalid gid " + hex);
+    }
+    gids.push_back(gid);
+  }
+  std::string error;
+  if (!state->subscriptions.Set(name, static_cast<uint32_t>(mask.AsInt()),
+                                all_gids, gids, &error)) {
+    return Fail(message, "BAD_ARGS", error);
+  }
+  *result = Value(true);
+  return nullptr;
+}
+
+const char* ClearEventFilter(RuntimeState* state, const Value& args,
+                             Value* result, std::string* /*message*/) {
+  *result = Value(state->subscriptions.Remove(args.Get("name").AsString()));
+  return nullptr;
+}
+
+// ──────── Method timings ────────
+
+const char* GetMethodTimings(RuntimeState* state, const Value& args,
+                             Value* result, std::string* /*message*/) {
+  *result = state->timings.Describe();
+  if (args.Get("clear").AsBool()) {
+    state->timings.Clear();
+  }
+  return nullptr;
+}
+
+// ──────── Waiters ────────
+
+// {id, gids, timeoutMs?}. Resolved by an "onDownloadSettled" event with the
+// same id.
+const char* AwaitDownloads(RuntimeState* state, const Value& args,
+                           Value* result, std::string* message) {
+  const Value& id = args.Get("id");
+  const std::vector<std::string> hexes = args.Get("gids").AsStringList();
+  const int64_t timeout_ms = args.Get("timeoutMs").AsInt(0);
+  if (!id.IsInt() || hexes.empty() || timeout_ms < 0) {
+    return Fail(message, "BAD_ARGS", "Expected 'id' and non-empty 'gids'");
+  }
+  std::vector<aria2_gid_t> gids;
+  for (const std::string& hex : hexes) {
+    const aria2_gid_t gid = aria2_hex_to_gid(hex.c_str());
+    if (common::GetDownloadStatus(state->session, gid) < 0) {
+      return Fail(message, "HANDLE_FAILED", "Unknown gid " + hex);
+    }
+    gids.push_back(gid);
+  }
+  std::string error;
+  if (!state->waiters.Add(id.AsInt(), gids, timeout_ms, &error)) {
+    return Fail(message, "BAD_ARGS", error);
+  }
+  *result = Value(true);
+  return nullptr;
+}
+
+struct MethodEntry {
+  MethodHandler handler;
+  bool requires_session;
+};
+
+const std::unordered_map<std::string, MethodEntry>& Methods() {
+  static const auto* methods = new std::unordered_map<std::string, MethodEntry>{
+      {"addUri", {&AddUri, true}},
+      {"addTorrent", {&AddTorrent, true}},
+      {"addMetalink", {&AddMetalink, true}},
+      {"addTorrentBytes", {&AddTorrentBytes, true}},
+      {"addMetalinkBytes", {&AddMetalinkBytes, true}},
+      {"fetchToMemory", {&FetchToMemory, true}},
+      {"changeOption", {&ChangeOption, true}},
+      {"getWaitingDownloads", {&GetWaitingDownloads, true}},
+      {"getStoppedDownloads", {&GetStoppedDownloads, true}},
+      {"getDownloadSummary", {&GetDownloadSummary, true}},
+      {"setDownloadPriority", {&SetDownloadPriority, true}},
+      {"getDownloadPriority", {&GetDownloadPriority, true}},
+      {"reorderByPriority", {&ReorderByPriority, true}},
+      {"setQueuePolicy", {&SetQueuePolicy, true}},
+      {"getQueuePolicy", {&GetQueuePolicy, true}},
+      {"setDownloadDeadline", {&SetDownloadDeadline, true}},
+      {"enableAdaptiveConcurrency", {&EnableAdaptiveConcurrency, true}},
+      {"disableAdaptiveConcurrency", {&DisableAdaptiveConcurrency, false}},
+      {"setRetryPolicy", {&SetRetryPolicy, false}},
+      {"getRetryStats", {&GetRetryStats, false}},
+      {"setRetentionPolicy", {&SetRetentionPolicy, false}},
+      {"getRetentionStats", {&GetRetentionStats, false}},
+      {"getHostStats", {&GetHostStats, false}},
+      {"openVirtualQueue", {&OpenVirtualQueue, false}},
+      {"closeVirtualQueue", {&CloseVirtualQueue, false}},
+      {"addVirtualUris", {&AddVirtualUris, false}},
+      {"getVirtualEntry", {&GetVirtualEntry, false}},
+      {"getVirtualQueueStats", {&GetVirtualQueueStats, false}},
+      {"openHistory", {&OpenHistory, false}},
+      {"closeHistory", {&CloseHistory, false}},
+      {"queryHistory", {&QueryHistory, false}},
+      {"getHistoryStats", {&GetHistoryStats, false}},
+      {"openJournal", {&OpenJournal, true}},
+      {"closeJournal", {&CloseJournal, true}},
+      {"checkpointJournal", {&CheckpointJournal, true}},
+      {"getJournalStats", {&GetJournalStats, true}},
+      {"openResumeCache", {&OpenResumeCache, false}},
+      {"closeResumeCache", {&CloseResumeCache, false}},
+      {"saveResumeState", {&SaveResumeState, true}},
+      {"getResumeCacheStats", {&GetResumeCacheStats, false}},
+      {"importInputFile", {&ImportInputFile, true}},
+      {"cancelImport", {&CancelImport, false}},
+      {"getNativeMetrics", {&GetNativeMetrics, false}},
+      {"autotune", {&Autotune, false}},
+      {"cancelAutotune", {&CancelAutotune, false}},
+      {"createTorrent", {&CreateTorrent, false}},
+      {"cancelCreateTorrent", {&CancelCreateTorrent, false}},
+      {"getCreateTorrentProgress", {&GetCreateTorrentProgress, false}},
+      {"openProgressiveStream", {&OpenProgressiveStream, true}},
+      {"closeProgressiveStream", {&CloseProgressiveStream, false}},
+      {"getPieceBitfield", {&GetPieceBitfield, true}},
+      {"getGroupProgress", {&GetGroupProgress, true}},
+      {"pauseGroup", {&PauseGroup, true}},
+      {"unpauseGroup", {&UnpauseGroup, true}},
+      {"removeGroup", {&RemoveGroup, true}},
+      {"setSpeedHistoryPolicy", {&SetSpeedHistoryPolicy, false}},
+      {"getSpeedHistory", {&GetSpeedHistory, false}},
+      {"registerProgressTrigger", {&RegisterProgressTrigger, true}},
+      {"unregisterProgressTrigger", {&UnregisterProgressTrigger, false}},
+      {"setEventFilter", {&SetEventFilter, false}},
+      {"clearEventFilter", {&ClearEventFilter, false}},
+      {"awaitDownloads", {&AwaitDownloads, true}},
+      {"getMethodTimings", {&GetMethodTimings, false}},
+  };
+  return *methods;
+}
+
+}  // namespace
+
+const char* InvokeMethod(RuntimeState* state, const std::string& method,
+                         const Value& args, Value* result,
+                         std::string* message) {
+  auto it = Methods().find(method);
+  if (it == Methods().end()) {
+    *message = "Method not implemented: " + method;
+    return kNotImplemented;
+  }
+  if (it->second.requires_session) {
+    if (const char* err = RequireSession(state)) {
+      *message = "No active session";
+      return err;
+    }
+  }
+  return it->second.handler(state, args, result, message);
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
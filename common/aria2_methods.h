@@ -0,0 +1,26 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_METHODS_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_METHODS_H_
+
+#include <string>
+
+#include "aria2_core.h"
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// Error code returned by InvokeMethod when |method| has no shared handler;
+// platforms then answer with their own "not implemented" response.
+extern const char kNotImplemented[];
+
+// Runs the platform-independent implementation of a channel method.
+// Returns nullptr on success with |result| filled in; otherwise a static error
+// code string with a human-readable |message|.
+const char* InvokeMethod(RuntimeState* state, const std::string& method,
+                         const common::Value& args, common::Value* result,
+                         std::string* message);
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_METHODS_H_
@@ -0,0 +1,42 @@
+#include "aria2_metrics.h"
+
+#include <chrono>
+#include <utility>
+
+namespace flutter_aria2 {
+namespace core {
+
+void MetricsLog::Record(const char* component, common::Value data) {
+  const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (events_.size() >= capacity_) {
+    events_.pop_front();
+  }
+  events_.push_back(Event{now, component, std::move(data)});
+}
+
+common::Value MetricsLog::Snapshot(bool clear) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value list = common::Value::NewList();
+  for (const Event& event : events_) {
+    common::Value item = common::Value::NewMap();
+    item.Set("timestamp", event.timestamp_ms);
+    item.Set("component", event.component);
+    item.Set("data", event.data);
+    list.Append(std::move(item));
+  }
+  if (clear) {
+    events_.clear();
+  }
+  return list;
+}
+
+void MetricsLog::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.clear();
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
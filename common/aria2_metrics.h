@@ -0,0 +1,46 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_METRICS_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_METRICS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// Bounded, thread-safe log of decisions taken by the native components.
+// Exposed to Dart through the "getNativeMetrics" method.
+class MetricsLog {
+ public:
+  explicit MetricsLog(size_t capacity = 256) : capacity_(capacity) {}
+
+  // Appends an event of |component| with a map |data|; the oldest event is
+  // dropped once the log is full.
+  void Record(const char* component, common::Value data);
+
+  // Returns the events as a list of {timestamp, component, data} maps,
+  // optionally clearing the log.
+  common::Value Snapshot(bool clear);
+
+  void Clear();
+
+ private:
+  struct Event {
+    int64_t timestamp_ms;
+    std::string component;
+    common::Value data;
+  };
+
+  size_t capacity_;
+  std::mutex mutex_;
+  std::deque<Event> events_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_METRICS_H_
@@ -0,0 +1,432 @@
+#include "aria2_net.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace flutter_aria2 {
+namespace common {
+
+#ifdef _WIN32
+const SocketHandle kInvalidSocket = static_cast<SocketHandle>(INVALID_SOCKET);
+#else
+const SocketHandle kInvalidSocket = -1;
+#endif
+
+namespace {
+
+// A peer that hangs up mid-response must fail the send, not raise SIGPIPE.
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+bool EnsureSocketsInitialized() {
+#ifdef _WIN32
+  static std::once_flag once;
+  static bool ok = false;
+  std::call_once(once, []() {
+    WSADATA data;
+    ok = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+  });
+  return ok;
+#else
+  return true;
+#endif
+}
+
+void SetBlocking(SocketHandle sock, bool blocking) {
+#ifdef _WIN32
+  u_long mode = blocking ? 0 : 1;
+  ioctlsocket(static_cast<SOCKET>(sock), FIONBIO, &mode);
+#else
+  int flags = fcntl(sock, F_GETFL, 0);
+  if (flags < 0) {
+    return;
+  }
+  fcntl(sock, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+#endif
+}
+
+void SetIoTimeout(SocketHandle sock, int timeout_ms) {
+#ifdef _WIN32
+  DWORD tv = static_cast<DWORD>(timeout_ms);
+#else
+  timeval tv;
+  tv.tv_sec = timeout_ms / 1000;
+  tv.tv_usec = (timeout_ms % 1000) * 1000;
+#endif
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO,
+             reinterpret_cast<const char*>(&tv), sizeof(tv));
+  setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO,
+             reinterpret_cast<const char*>(&tv), sizeof(tv));
+}
+
+// Waits up to |timeout_ms| for |sock| to become writable (or readable).
+// poll() rather than select(): an fd_set cannot hold descriptors at or
+// above FD_SETSIZE, which a busy app reaches easily. Winsock's fd_set is a
+// list of handles and has no such limit on their values.
+bool WaitSocket(SocketHandle sock, bool write, int timeout_ms) {
+#ifdef _WIN32
+  fd_set set;
+  FD_ZERO(&set);
+  FD_SET(static_cast<SOCKET>(sock), &set);
+  timeval tv;
+  tv.tv_sec = timeout_ms / 1000;
+  tv.tv_usec = (timeout_ms % 1000) * 1000;
+  return select(0, write ? nullptr : &set, write ? &set : nullptr, nullptr,
+                &tv) == 1;
+#else
+  pollfd fd = {};
+  fd.fd = sock;
+  fd.events = write ? POLLOUT : POLLIN;
+  int ret;
+  do {
+    ret = poll(&fd, 1, timeout_ms);
+  } while (ret < 0 && errno == EINTR);
+  return ret == 1;
+#endif
+}
+
+bool ConnectWithTimeout(SocketHandle sock, const sockaddr* addr,
+                        socklen_t addr_len, int timeout_ms) {
+  SetBlocking(sock, false);
+  int ret = connect(sock, addr, addr_len);
+  bool connected = ret == 0;
+  if (!connected) {
+#ifdef _WIN32
+    const bool pending = WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    const bool pending = errno == EINPROGRESS;
+#endif
+    if (pending) {
+      if (WaitSocket(sock, true, timeout_ms)) {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        getsockopt(sock, SOL_SOCKET, SO_ERROR,
+                   reinterpret_cast<char*>(&error), &len);
+        connected = error == 0;
+      }
+    }
+  }
+  SetBlocking(sock, true);
+  return connected;
+}
+
+// A name lookup running on its own thread. Whichever of the lookup and its
+// caller finishes last frees the result.
+struct PendingLookup {
+  std::mutex mutex;
+  std::condition_variable done_cv;
+  bool done = false;
+  bool abandoned = false;
+  addrinfo* results = nullptr;
+};
+
+// getaddrinfo cannot be interrupted and can block far longer than any
+// timeout we use, so it runs on a detached thread the caller stops waiting
+// for after |timeout_ms| or once |cancel| is set. Numeric hosts are
+// resolved inline.
+addrinfo* ResolveWithTimeout(const std::string& host,
+                             const std::string& service, int timeout_ms,
+                             const std::atomic<bool>* cancel) {
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_NUMERICHOST;
+  addrinfo* results = nullptr;
+  if (getaddrinfo(host.c_str(), service.c_str(), &hints, &results) == 0) {
+    return results;
+  }
+
+  auto lookup = std::make_shared<PendingLookup>();
+  std::thread([lookup, host, service]() {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &results) != 0) {
+      results = nullptr;
+    }
+    std::lock_guard<std::mutex> lock(lookup->mutex);
+    if (lookup->abandoned) {
+      if (results != nullptr) {
+        freeaddrinfo(results);
+      }
+      return;
+    }
+    lookup->results = results;
+    lookup->done = true;
+    lookup->done_cv.notify_all();
+  }).detach();
+
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(timeout_ms);
+  std::unique_lock<std::mutex> lock(lookup->mutex);
+  while (!lookup->done && std::chrono::steady_clock::now() < deadline &&
+         (cancel == nullptr || !cancel->load())) {
+    // Short waits so a cancel is seen promptly.
+    lookup->done_cv.wait_for(lock, std::chrono::milliseconds(50));
+  }
+  if (!lookup->done) {
+    lookup->abandoned = true;
+    return nullptr;
+  }
+  return lookup->results;
+}
+
+}  // namespace
+
+SocketHandle TcpConnect(const std::string& host, int port, int timeout_ms,
+                        const std::atomic<bool>* cancel) {
+  if (!EnsureSocketsInitialized()) {
+    return kInvalidSocket;
+  }
+  addrinfo* results =
+      ResolveWithTimeout(host, std::to_string(port), timeout_ms, cancel);
+  if (results == nullptr) {
+    return kInvalidSocket;
+  }
+  SocketHandle sock = kInvalidSocket;
+  for (addrinfo* ai = results; ai != nullptr; ai = ai->ai_next) {
+    sock = static_cast<SocketHandle>(
+        socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol));
+    if (sock == kInvalidSocket) {
+      continue;
+    }
+    if (ConnectWithTimeout(sock, ai->ai_addr,
+                           static_cast<socklen_t>(ai->ai_addrlen),
+                           timeout_ms)) {
+      break;
+    }
+    CloseSocket(sock);
+    sock = kInvalidSocket;
+  }
+  freeaddrinfo(results);
+  if (sock != kInvalidSocket) {
+    SetIoTimeout(sock, timeout_ms);
+  }
+  return sock;
+}
+
+bool SendAll(SocketHandle sock, const std::string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    const int n = static_cast<int>(
+        send(sock, data.data() + sent, static_cast<int>(data.size() - sent),
+             kSendFlags));
+    if (n <= 0) {
+      return false;
+    }
+    sent += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+std::string RecvUpTo(SocketHandle sock, size_t max_bytes) {
+  std::string out;
+  char buffer[4096];
+  while (out.size() < max_bytes) {
+    const int n = static_cast<int>(recv(sock, buffer, sizeof(buffer), 0));
+    if (n <= 0) {
+      break;
+    }
+    out.append(buffer, static_cast<size_t>(n));
+  }
+  return out;
+}
+
+int RecvSome(SocketHandle sock, char* buffer, size_t size) {
+  return static_cast<int>(recv(sock, buffer, static_cast<int>(size), 0));
+}
+
+void CloseSocket(SocketHandle sock) {
+  if (sock == kInvalidSocket) {
+    return;
+  }
+#ifdef _WIN32
+  closesocket(static_cast<SOCKET>(sock));
+#else
+  close(sock);
+#endif
+}
+
+SocketHandle TcpListenLoopback(int* port) {
+  if (!EnsureSocketsInitialized()) {
+    return kInvalidSocket;
+  }
+  SocketHandle sock =
+      static_cast<SocketHandle>(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+  if (sock == kInvalidSocket) {
+    return kInvalidSocket;
+  }
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t addr_len = sizeof(addr);
+  if (bind(sock, reinterpret_cast<const sockaddr*>(&addr), addr_len) != 0 ||
+      listen(sock, 16) != 0 ||
+      getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &addr_len) != 0) {
+    CloseSocket(sock);
+    return kInvalidSocket;
+  }
+  *port = ntohs(addr.sin_port);
+  return sock;
+}
+
+SocketHandle TcpAccept(SocketHandle listener, int wait_ms, int io_timeout_ms) {
+  if (!WaitSocket(listener, false, wait_ms)) {
+    return kInvalidSocket;
+  }
+  SocketHandle sock =
+      static_cast<SocketHandle>(accept(listener, nullptr, nullptr));
+  if (sock != kInvalidSocket) {
+    SetIoTimeout(sock, io_timeout_ms);
+  }
+  return sock;
+}
+
+bool ParseHttpUrl(const std::string& url, HttpUrl* out) {
+  static const char kScheme[] = "http://";
+  if (url.compare(0, sizeof(kScheme) - 1, kScheme) != 0) {
+    return false;
+  }
+  const size_t host_begin = sizeof(kScheme) - 1;
+  size_t path_begin = url.find('/', host_begin);
+  if (path_begin == std::string::npos) {
+    path_begin = url.size();
+  }
+  std::string authority = url.substr(host_begin, path_begin - host_begin);
+  const size_t at = authority.rfind('@');
+  if (at != std::string::npos) {
+    authority.erase(0, at + 1);
+  }
+  if (authority.empty()) {
+    return false;
+  }
+
+  HttpUrl parsed;
+  size_t port_sep = std::string::npos;
+  if (authority[0] == '[') {
+    const size_t close = authority.find(']');
+    if (close == std::string::npos) {
+      return false;
+    }
+    parsed.host = authority.substr(1, close - 1);
+    if (close + 1 < authority.size() && authority[close + 1] == ':') {
+      port_sep = close + 1;
+    }
+  } else {
+    port_sep = authority.find(':');
+    parsed.host = authority.substr(0, port_sep);
+  }
+  if (port_sep != std::string::npos) {
+    parsed.port = std::atoi(authority.c_str() + port_sep + 1);
+    if (parsed.port <= 0 || parsed.port > 65535) {
+      return false;
+    }
+  }
+  if (path_begin < url.size()) {
+    parsed.path = url.substr(path_begin);
+    const size_t fragment = parsed.path.find('#');
+    if (fragment != std::string::npos) {
+      parsed.path.erase(fragment);
+    }
+  }
+  *out = std::move(parsed);
+  return true;
+}
+
+std::string ResolveHttpLocation(const std::string& base,
+                                const std::string& location) {
+  if (location.find("://") != std::string::npos) {
+    return location;
+  }
+  if (location.compare(0, 2, "//") == 0) {
+    return "http:" + location;
+  }
+  static const char kScheme[] = "http://";
+  size_t path_begin = base.find('/', sizeof(kScheme) - 1);
+  if (path_begin == std::string::npos) {
+    path_begin = base.size();
+  }
+  const std::string origin = base.substr(0, path_begin);
+  std::string base_path = base.substr(path_begin);
+  base_path.erase(std::min(base_path.find_first_of("?#"), base_path.size()));
+  if (base_path.empty()) {
+    base_path = "/";
+  }
+  if (location.empty() || location[0] == '#') {
+    return origin + base_path;
+  }
+  if (location[0] == '?') {
+    return origin + base_path + location;
+  }
+
+  std::string merged =
+      location[0] == '/'
+          ? location
+          : base_path.substr(0, base_path.rfind('/') + 1) + location;
+  const size_t query = std::min(merged.find_first_of("?#"), merged.size());
+  const std::string suffix = merged.substr(query);
+  merged.erase(query);
+  // Drops "." and ".." segments (RFC 3986, section 5.2.4).
+  std::vector<std::string> segments;
+  size_t pos = 1;
+  while (pos <= merged.size()) {
+    size_t end = merged.find('/', pos);
+    if (end == std::string::npos) {
+      end = merged.size();
+    }
+    const std::string segment = merged.substr(pos, end - pos);
+    const bool last = end == merged.size();
+    if (segment == "..") {
+      if (!segments.empty()) {
+        segments.pop_back();
+      }
+      if (last) {
+        segments.emplace_back();
+      }
+    } else if (segment == ".") {
+      if (last) {
+        segments.emplace_back();
+      }
+    } else {
+      segments.push_back(segment);
+    }
+    pos = end + 1;
+  }
+  std::string path;
+  for (const std::string& segment : segments) {
+    path += "/" + segment;
+  }
+  if (path.empty()) {
+    path = "/";
+  }
+  return origin + path + suffix;
+}
+
+}  // namespace common
+}  // namespace flutter_aria2
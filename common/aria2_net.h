@@ -0,0 +1,66 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_NET_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_NET_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace flutter_aria2 {
+namespace common {
+
+// Minimal blocking TCP helpers over BSD sockets / Winsock, used by native
+// components that talk to HTTP servers outside of aria2 (size probes) or
+// serve aria2 from loopback (autotune benchmark).
+
+#ifdef _WIN32
+using SocketHandle = uintptr_t;
+#else
+using SocketHandle = int;
+#endif
+
+extern const SocketHandle kInvalidSocket;
+
+// Connects to |host|:|port| with |timeout_ms| applied to the name lookup,
+// connect, send and receive. A set |cancel| abandons the lookup. Returns
+// kInvalidSocket on failure.
+SocketHandle TcpConnect(const std::string& host, int port, int timeout_ms,
+                        const std::atomic<bool>* cancel = nullptr);
+
+bool SendAll(SocketHandle sock, const std::string& data);
+
+// Reads until the peer closes, an error occurs or |max_bytes| are buffered.
+std::string RecvUpTo(SocketHandle sock, size_t max_bytes);
+
+// Reads whatever is available, blocking up to the socket timeout. Returns
+// the byte count, 0 when the peer closed, or -1 on error or timeout.
+int RecvSome(SocketHandle sock, char* buffer, size_t size);
+
+void CloseSocket(SocketHandle sock);
+
+// Listens on 127.0.0.1 with an ephemeral port stored in |port|. Returns
+// kInvalidSocket on failure.
+SocketHandle TcpListenLoopback(int* port);
+
+// Waits up to |wait_ms| for a connection on |listener|; the accepted socket
+// gets |io_timeout_ms| as its send/receive timeout. Returns kInvalidSocket on
+// timeout or error.
+SocketHandle TcpAccept(SocketHandle listener, int wait_ms, int io_timeout_ms);
+
+struct HttpUrl {
+  std::string host;
+  int port = 80;
+  std::string path = "/";
+};
+
+// Parses a plain "http://" URL; returns false for any other scheme.
+bool ParseHttpUrl(const std::string& url, HttpUrl* out);
+
+// Resolves a Location header against the "http://" URL it came from.
+// Absolute URIs are returned as is.
+std::string ResolveHttpLocation(const std::string& base,
+                                const std::string& location);
+
+}  // namespace common
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_NET_H_
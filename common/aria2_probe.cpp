@@ -0,0 +1,319 @@
+#include "aria2_probe.h"
+
+#include <cctype>
+#include <cstdlib>
+
+#include "aria2_net.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+constexpr size_t kWorkerCount = 2;
+constexpr int kProbeTimeoutMs = 3000;
+constexpr int kMaxRedirects = 3;
+constexpr size_t kMaxHeaderBytes = 16 * 1024;
+
+struct HttpHead {
+  int status = 0;
+  int64_t content_length = -1;
+  int64_t range_total = -1;
+  std::string location;
+};
+
+std::string Lower(std::string s) {
+  for (char& c : s) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return s;
+}
+
+std::string Trim(const std::string& s) {
+  size_t begin = s.find_first_not_of(" \t");
+  if (begin == std::string::npos) {
+    return "";
+  }
+  size_t end = s.find_last_not_of(" \t\r");
+  return s.substr(begin, end - begin + 1);
+}
+
+std::string Base64(const std::string& in) {
+  static const char kAlphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  for (size_t i = 0; i < in.size(); i += 3) {
+    uint32_t chunk = static_cast<uint8_t>(in[i]) << 16;
+    if (i + 1 < in.size()) {
+      chunk |= static_cast<uint8_t>(in[i + 1]) << 8;
+    }
+    if (i + 2 < in.size()) {
+      chunk |= static_cast<uint8_t>(in[i + 2]);
+    }
+    out.push_back(kAlphabet[(chunk >> 18) & 63]);
+    out.push_back(kAlphabet[(chunk >> 12) & 63]);
+    out.push_back(i + 1 < in.size() ? kAlphabet[(chunk >> 6) & 63] : '=');
+    out.push_back(i + 2 < in.size() ? kAlphabet[chunk & 63] : '=');
+  }
+  return out;
+}
+
+// Whether aria2 would reach |host| through the proxy. no-proxy entries are
+// matched as aria2 does for names: ".example.com" matches its subdomains,
+// anything else only the same host. Network masks are not evaluated, so a
+// host they would exempt still counts as proxied.
+bool UsesProxy(const ProbeSettings& settings, const std::string& host) {
+  if (settings.proxy.empty()) {
+    return false;
+  }
+  const std::string name = Lower(host);
+  size_t begin = 0;
+  while (begin <= settings.no_proxy.size()) {
+    size_t end = settings.no_proxy.find(',', begin);
+    if (end == std::string::npos) {
+      end = settings.no_proxy.size();
+    }
+    const std::string entry =
+        Lower(Trim(settings.no_proxy.substr(begin, end - begin)));
+    begin = end + 1;
+    if (entry.empty()) {
+      continue;
+    }
+    if (entry[0] == '.' ? name.size() > entry.size() &&
+                              name.compare(name.size() - entry.size(),
+                                           entry.size(), entry) == 0
+                        : name == entry) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// |origin| is the host the probe started at; credentials are not sent to
+// another host a redirect leads to.
+bool Request(const common::HttpUrl& url, const char* method, bool range,
+             const ProbeSettings& settings, const std::string& origin,
+             const std::atomic<bool>* cancel, HttpHead* out) {
+  common::SocketHandle sock =
+      common::TcpConnect(url.host, url.port, kProbeTimeoutMs, cancel);
+  if (sock == common::kInvalidSocket) {
+    return false;
+  }
+  std::string request = std::string(method) + " " + url.path + " HTTP/1.1\r\n";
+  request += "Host: " + url.host;
+  if (url.port != 80) {
+    request += ":" + std::to_string(url.port);
+  }
+  request += "\r\nUser-Agent: " + settings.user_agent +
+             "\r\nAccept: */*\r\nConnection: close\r\n";
+  if (range) {
+    request += "Range: bytes=0-0\r\n";
+  }
+  if (!settings.user.empty() && Lower(url.host) == Lower(origin)) {
+    request += "Authorization: Basic " +
+               Base64(settings.user + ":" + settings.password) + "\r\n";
+  }
+  for (const std::string& header : settings.headers) {
+    request += header + "\r\n";
+  }
+  request += "\r\n";
+
+  std::string response;
+  if (common::SendAll(sock, request)) {
+    // A HEAD response carries no body; for the range GET at most one byte
+    // follows the headers, so reading to EOF is cheap.
+    response = common::RecvUpTo(sock, kMaxHeaderBytes);
+  }
+  common::CloseSocket(sock);
+
+  const size_t header_end = response.find("\r\n\r\n");
+  if (response.compare(0, 5, "HTTP/") != 0 || header_end == std::string::npos) {
+    return false;
+  }
+  size_t line_end = response.find("\r\n");
+  const size_t status_pos = response.find(' ');
+  if (status_pos == std::string::npos || status_pos > line_end) {
+    return false;
+  }
+  out->status = std::atoi(response.c_str() + status_pos + 1);
+
+  size_t pos = line_end + 2;
+  while (pos < header_end) {
+    line_end = response.find("\r\n", pos);
+    const std::string line = response.substr(pos, line_end - pos);
+    pos = line_end + 2;
+    const size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+    const std::string name = Lower(Trim(line.substr(0, colon)));
+    const std::string value = Trim(line.substr(colon + 1));
+    if (name == "content-length") {
+      out->content_length = std::strtoll(value.c_str(), nullptr, 10);
+    } else if (name == "content-range") {
+      // "bytes 0-0/12345"; "*" means the total is unknown.
+      const size_t slash = value.rfind('/');
+      if (slash != std::string::npos && value.compare(slash + 1, 1, "*") != 0) {
+        out->range_total = std::strtoll(value.c_str() + slash + 1, nullptr, 10);
+      }
+    } else if (name == "location") {
+      out->location = value;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+SizeProber::~SizeProber() {
+  Stop();
+}
+
+ProbeSettings SizeProber::ReadSettings(aria2_session_t* session,
+                                       aria2_gid_t gid) {
+  ProbeSettings settings;
+  aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+  if (handle == nullptr) {
+    return settings;
+  }
+  // The download's value, or the global one it inherits.
+  auto option = [handle](const char* name) {
+    char* value = aria2_download_handle_get_option(handle, name);
+    std::string out = value == nullptr ? "" : value;
+    aria2_free(value);
+    return out;
+  };
+  const std::string user_agent = option("user-agent");
+  if (!user_agent.empty()) {
+    settings.user_agent = user_agent;
+  }
+  // aria2 joins repeated headers with newlines.
+  const std::string headers = option("header");
+  size_t begin = 0;
+  while (begin < headers.size()) {
+    size_t end = headers.find('\n', begin);
+    if (end == std::string::npos) {
+      end = headers.size();
+    }
+    const std::string header = Trim(headers.substr(begin, end - begin));
+    if (!header.empty()) {
+      settings.headers.push_back(header);
+    }
+    begin = end + 1;
+  }
+  settings.user = option("http-user");
+  settings.password = option("http-passwd");
+  settings.proxy = option("http-proxy");
+  if (settings.proxy.empty()) {
+    settings.proxy = option("all-proxy");
+  }
+  settings.no_proxy = option("no-proxy");
+  aria2_delete_download_handle(handle);
+  return settings;
+}
+
+void SizeProber::Submit(aria2_gid_t gid, std::vector<std::string> uris,
+                        ProbeSettings settings) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stopping_ = false;
+  cancel_.store(false);
+  jobs_.push_back(Job{gid, std::move(uris), std::move(settings)});
+  if (workers_.size() < kWorkerCount) {
+    workers_.emplace_back(&SizeProber::WorkerLoop, this);
+  }
+  cv_.notify_one();
+}
+
+std::vector<std::pair<aria2_gid_t, int64_t>> SizeProber::TakeResults() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::pair<aria2_gid_t, int64_t>> out;
+  out.swap(results_);
+  return out;
+}
+
+void SizeProber::Stop() {
+  std::vector<std::thread> workers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    cancel_.store(true);
+    jobs_.clear();
+    results_.clear();
+    workers.swap(workers_);
+  }
+  cv_.notify_all();
+  for (std::thread& worker : workers) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+int64_t SizeProber::ProbeUri(const std::string& uri,
+                             const ProbeSettings& settings,
+                             const std::atomic<bool>* cancel) {
+  std::string current = uri;
+  std::string origin;
+  for (int redirect = 0; redirect <= kMaxRedirects; ++redirect) {
+    common::HttpUrl url;
+    if (!common::ParseHttpUrl(current, &url) ||
+        UsesProxy(settings, url.host) ||
+        (cancel != nullptr && cancel->load())) {
+      return -1;
+    }
+    if (origin.empty()) {
+      origin = url.host;
+    }
+    HttpHead head;
+    if (Request(url, "HEAD", false, settings, origin, cancel, &head) &&
+        head.status >= 200 &&
+        head.status < 300 && head.content_length >= 0) {
+      return head.content_length;
+    }
+    if (head.status >= 300 && head.status < 400 && !head.location.empty()) {
+      current = common::ResolveHttpLocation(current, head.location);
+      continue;
+    }
+    // Some servers reject HEAD; a one-byte range request reports the total.
+    HttpHead range;
+    if (Request(url, "GET", true, settings, origin, cancel, &range)) {
+      if (range.status == 206 && range.range_total >= 0) {
+        return range.range_total;
+      }
+      if (range.status >= 200 && range.status < 300 &&
+          range.content_length >= 0) {
+        return range.content_length;
+      }
+    }
+    return -1;
+  }
+  return -1;
+}
+
+void SizeProber::WorkerLoop() {
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+      if (stopping_) {
+        return;
+      }
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+    int64_t size = -1;
+    for (const std::string& uri : job.uris) {
+      size = ProbeUri(uri, job.settings, &cancel_);
+      if (size >= 0) {
+        break;
+      }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!stopping_) {
+      results_.emplace_back(job.gid, size);
+    }
+  }
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
@@ -0,0 +1,84 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_PROBE_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_PROBE_H_
+
+#include <aria2_c_api.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace flutter_aria2 {
+namespace core {
+
+// What aria2 sends for a download, taken from its options so a probe is
+// answered like the download itself would be.
+struct ProbeSettings {
+  std::string user_agent = "aria2";
+  std::vector<std::string> headers;  // "Name: value" lines of "header".
+  std::string user;                  // http-user, sent as basic auth.
+  std::string password;              // http-passwd.
+  std::string proxy;                 // http-proxy, else all-proxy.
+  std::string no_proxy;              // Comma-separated hosts and domains.
+};
+
+// Small worker pool that discovers the size of not-yet-started downloads
+// with an HTTP HEAD request, falling back to a one-byte range GET. Only plain
+// http:// URIs can be probed, and only when aria2 would fetch them directly:
+// a URI behind a proxy, like anything else, reports an unknown size (-1).
+class SizeProber {
+ public:
+  SizeProber() = default;
+  ~SizeProber();
+
+  SizeProber(const SizeProber&) = delete;
+  SizeProber& operator=(const SizeProber&) = delete;
+
+  // Reads the settings of |gid| from aria2; call it on the thread driving
+  // aria2_run.
+  static ProbeSettings ReadSettings(aria2_session_t* session, aria2_gid_t gid);
+
+  // Queues |uris| of |gid|; workers are started lazily.
+  void Submit(aria2_gid_t gid, std::vector<std::string> uris,
+              ProbeSettings settings);
+
+  // Returns and clears the finished (gid, size) pairs.
+  std::vector<std::pair<aria2_gid_t, int64_t>> TakeResults();
+
+  // Drops pending work and joins the workers. A probe in flight gives up
+  // its name lookup at once and otherwise ends within one request timeout.
+  void Stop();
+
+  // Synchronously probes a single URI, following up to three redirects.
+  // Returns -1 when no length could be determined or |cancel| was set.
+  static int64_t ProbeUri(const std::string& uri,
+                          const ProbeSettings& settings,
+                          const std::atomic<bool>* cancel = nullptr);
+
+ private:
+  struct Job {
+    aria2_gid_t gid;
+    std::vector<std::string> uris;
+    ProbeSettings settings;
+  };
+
+  void WorkerLoop();
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Job> jobs_;
+  std::vector<std::pair<aria2_gid_t, int64_t>> results_;
+  std::vector<std::thread> workers_;
+  bool stopping_ = false;
+  std::atomic<bool> cancel_{false};
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_PROBE_H_
@@ -0,0 +1,289 @@
+#include "aria2_registry.h"
+
+#include <algorithm>
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+constexpr int32_t kEmpty = -1;
+constexpr int32_t kTombstone = -2;
+constexpr size_t kInitialTableSize = 64;
+
+// gids are random already; mix anyway so sequential ones spread out.
+size_t MixGid(aria2_gid_t gid) {
+  uint64_t x = gid + 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return static_cast<size_t>(x ^ (x >> 31));
+}
+}  // namespace
+
+DownloadRegistry::DownloadRegistry() : table_(kInitialTableSize, kEmpty) {}
+
+int DownloadRegistry::BucketOf(uint8_t status) {
+  switch (status) {
+    case kActive:
+      return static_cast<int>(Bucket::kActive);
+    case kWaiting:
+      return static_cast<int>(Bucket::kWaiting);
+    default:
+      return static_cast<int>(Bucket::kStopped);
+  }
+}
+
+int32_t DownloadRegistry::Find(aria2_gid_t gid) const {
+  const size_t mask = table_.size() - 1;
+  for (size_t slot = MixGid(gid) & mask;; slot = (slot + 1) & mask) {
+    const int32_t index = table_[slot];
+    if (index == kEmpty) {
+      return -1;
+    }
+    if (index >= 0 && nodes_[index].gid == gid) {
+      return index;
+    }
+  }
+}
+
+int32_t DownloadRegistry::Insert(aria2_gid_t gid) {
+  if ((table_used_ + 1) * 2 > table_.size()) {
+    // Grow when live entries dominate; otherwise just sweep tombstones.
+    const size_t live = nodes_.size() - free_nodes_.size();
+    Rehash((live + 1) * 4 > table_.size() ? table_.size() * 2 : table_.size());
+  }
+  int32_t index;
+  if (!free_nodes_.empty()) {
+    index = free_nodes_.back();
+    free_nodes_.pop_back();
+    nodes_[index] = Node();
+  } else {
+    index = static_cast<int32_t>(nodes_.size());
+    nodes_.emplace_back();
+  }
+  nodes_[index].gid = gid;
+
+  const size_t mask = table_.size() - 1;
+  size_t slot = MixGid(gid) & mask;
+  while (table_[slot] >= 0) {
+    slot = (slot + 1) & mask;
+  }
+  if (table_[slot] == kEmpty) {
+    ++table_used_;
+  }
+  table_[slot] = index;
+  return index;
+}
+
+void DownloadRegistry::Rehash(size_t capacity) {
+  std::vector<int32_t> table(capacity, kEmpty);
+  const size_t mask = capacity - 1;
+  table_used_ = 0;
+  for (int32_t index : table_) {
+    if (index < 0) {
+      continue;
+    }
+    size_t slot = MixGid(nodes_[index].gid) & mask;
+    while (table[slot] != kEmpty) {
+      slot = (slot + 1) & mask;
+    }
+    table[slot] = index;
+    ++table_used_;
+  }
+  table_.swap(table);
+}
+
+void DownloadRegistry::Link(int32_t index) {
+  Node& node = nodes_[index];
+  List& list = lists_[BucketOf(node.status)];
+  node.prev = list.tail;
+  node.next = -1;
+  if (list.tail >= 0) {
+    nodes_[list.tail].next = index;
+  } else {
+    list.head = index;
+  }
+  list.tail = index;
+  ++list.size;
+  ++counts_[node.status];
+  ++version_;
+}
+
+void DownloadRegistry::Unlink(int32_t index) {
+  Node& node = nodes_[index];
+  List& list = lists_[BucketOf(node.status)];
+  if (node.prev >= 0) {
+    nodes_[node.prev].next = node.next;
+  } else {
+    list.head = node.next;
+  }
+  if (node.next >= 0) {
+    nodes_[node.next].prev = node.prev;
+  } else {
+    list.tail = node.prev;
+  }
+  node.prev = node.next = -1;
+  --list.size;
+  --counts_[node.status];
+  ++version_;
+}
+
+void DownloadRegistry::SetStatus(int32_t index, uint8_t status) {
+  Node& node = nodes_[index];
+  if (node.status == status) {
+    return;
+  }
+  if (BucketOf(node.status) == BucketOf(status)) {
+    --counts_[node.status];
+    node.status = status;
+    ++counts_[status];
+    return;
+  }
+  Unlink(index);
+  node.status = status;
+  Link(index);
+}
+
+void DownloadRegistry::OnAdded(aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  int32_t index = Find(gid);
+  if (index >= 0) {
+    SetStatus(index, kWaiting);
+    return;
+  }
+  index = Insert(gid);
+  nodes_[index].status = kWaiting;
+  Link(index);
+}
+
+void DownloadRegistry::OnDownloadEvent(aria2_download_event_t event,
+                                       aria2_gid_t gid) {
+  uint8_t status;
+  switch (event) {
+    case ARIA2_EVENT_ON_DOWNLOAD_START:
+      status = kActive;
+      break;
+    case ARIA2_EVENT_ON_DOWNLOAD_PAUSE:
+      status = kWaiting;
+      break;
+    case ARIA2_EVENT_ON_DOWNLOAD_STOP:
+      status = kRemoved;
+      break;
+    case ARIA2_EVENT_ON_DOWNLOAD_COMPLETE:
+      status = kComplete;
+      break;
+    case ARIA2_EVENT_ON_DOWNLOAD_ERROR:
+      status = kError;
+      break;
+    default:
+      // Seeding after ARIA2_EVENT_ON_BT_DOWNLOAD_COMPLETE is still active.
+      return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  int32_t index = Find(gid);
+  if (index < 0) {
+    // Downloads aria2 adds on its own (e.g. a torrent following a .torrent
+    // URI) first show up here.
+    index = Insert(gid);
+    nodes_[index].status = status;
+    Link(index);
+    return;
+  }
+  SetStatus(index, status);
+}
+
+bool DownloadRegistry::Erase(aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const size_t mask = table_.size() - 1;
+  for (size_t slot = MixGid(gid) & mask;; slot = (slot + 1) & mask) {
+    const int32_t index = table_[slot];
+    if (index == kEmpty) {
+      return false;
+    }
+    if (index >= 0 && nodes_[index].gid == gid) {
+      Unlink(index);
+      table_[slot] = kTombstone;
+      free_nodes_.push_back(index);
+      return true;
+    }
+  }
+}
+
+std::vector<aria2_gid_t> DownloadRegistry::Page(Bucket bucket, size_t offset,
+                                                size_t limit) const {
+  std::vector<aria2_gid_t> out;
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int which = static_cast<int>(bucket);
+  const List& list = lists_[which];
+  if (offset >= list.size || limit == 0) {
+    return out;
+  }
+  int32_t index;
+  if (cursor_.bucket == which && cursor_.version == version_ &&
+      cursor_.offset == offset) {
+    index = cursor_.node;
+  } else if (offset > list.size / 2) {
+    index = list.tail;
+    for (size_t i = list.size - 1; i > offset; --i) {
+      index = nodes_[index].prev;
+    }
+  } else {
+    index = list.head;
+    for (size_t i = 0; i < offset; ++i) {
+      index = nodes_[index].next;
+    }
+  }
+  out.reserve(std::min(limit, list.size - offset));
+  while (index >= 0 && out.size() < limit) {
+    out.push_back(nodes_[index].gid);
+    index = nodes_[index].next;
+  }
+  cursor_.bucket = which;
+  cursor_.offset = offset + out.size();
+  cursor_.node = index;
+  cursor_.version = version_;
+  return out;
+}
+
+DownloadRegistry::Summary DownloadRegistry::GetSummary() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Summary summary;
+  summary.active = counts_[kActive];
+  summary.waiting = counts_[kWaiting];
+  summary.complete = counts_[kComplete];
+  summary.error = counts_[kError];
+  summary.removed = counts_[kRemoved];
+  return summary;
+}
+
+common::Value DownloadRegistry::Describe() const {
+  const Summary summary = GetSummary();
+  common::Value out = common::Value::NewMap();
+  out.Set("active", summary.active);
+  out.Set("waiting", summary.waiting);
+  out.Set("complete", summary.complete);
+  out.Set("error", summary.error);
+  out.Set("removed", summary.removed);
+  out.Set("stopped", summary.complete + summary.error + summary.removed);
+  out.Set("total", summary.active + summary.waiting + summary.complete +
+                       summary.error + summary.removed);
+  return out;
+}
+
+void DownloadRegistry::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  nodes_.clear();
+  free_nodes_.clear();
+  table_.assign(kInitialTableSize, kEmpty);
+  table_used_ = 0;
+  for (List& list : lists_) {
+    list = List();
+  }
+  for (int64_t& count : counts_) {
+    count = 0;
+  }
+  ++version_;
+  cursor_ = PageCursor();
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
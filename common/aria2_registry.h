@@ -0,0 +1,110 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_REGISTRY_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_REGISTRY_H_
+
+#include <aria2_c_api.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// Native index of every download added through the plugin, so waiting and
+// stopped downloads can be listed without a Dart-side mirror.
+//
+// Entries live in a node pool addressed by an open-addressing gid table
+// (linear probing, tombstones, rehash at half load) and are threaded on one
+// intrusive doubly-linked list per bucket: active, waiting (including
+// paused, as in aria2's tellWaiting) and stopped (complete, error,
+// removed). Lists keep the order in which downloads entered the bucket, not
+// aria2's queue positions. A page request walks from the previous page's
+// end when it continues it, so paging through a bucket costs O(limit) per
+// page.
+class DownloadRegistry {
+ public:
+  enum class Bucket { kActive = 0, kWaiting = 1, kStopped = 2 };
+
+  struct Summary {
+    int64_t active = 0;
+    int64_t waiting = 0;
+    int64_t complete = 0;
+    int64_t error = 0;
+    int64_t removed = 0;
+  };
+
+  DownloadRegistry();
+
+  // A download was added; it waits until aria2 starts it.
+  void OnAdded(aria2_gid_t gid);
+  void OnDownloadEvent(aria2_download_event_t event, aria2_gid_t gid);
+
+  // Forgets |gid|. Returns false when it was not registered.
+  bool Erase(aria2_gid_t gid);
+
+  std::vector<aria2_gid_t> Page(Bucket bucket, size_t offset,
+                                size_t limit) const;
+  Summary GetSummary() const;
+  // {active, waiting, complete, error, removed, stopped, total}.
+  common::Value Describe() const;
+
+  void Reset();
+
+ private:
+  enum : uint8_t {
+    kActive = 0,
+    kWaiting,
+    kComplete,
+    kError,
+    kRemoved,
+    kStatusCount,
+  };
+
+  struct Node {
+    aria2_gid_t gid = 0;
+    int32_t prev = -1;
+    int32_t next = -1;
+    uint8_t status = kWaiting;
+  };
+
+  struct List {
+    int32_t head = -1;
+    int32_t tail = -1;
+    size_t size = 0;
+  };
+
+  // Where the last page ended, to continue from there.
+  struct PageCursor {
+    int bucket = -1;
+    size_t offset = 0;
+    int32_t node = -1;
+    uint64_t version = 0;
+  };
+
+  static int BucketOf(uint8_t status);
+
+  int32_t Find(aria2_gid_t gid) const;
+  int32_t Insert(aria2_gid_t gid);
+  void Rehash(size_t capacity);
+  void Link(int32_t index);
+  void Unlink(int32_t index);
+  void SetStatus(int32_t index, uint8_t status);
+
+  mutable std::mutex mutex_;
+  std::vector<Node> nodes_;
+  std::vector<int32_t> free_nodes_;
+  std::vector<int32_t> table_;  // Node index, kEmpty or kTombstone.
+  size_t table_used_ = 0;       // Live slots plus tombstones.
+  List lists_[3];
+  int64_t counts_[kStatusCount] = {};
+  uint64_t version_ = 0;  // Bumped on every list change.
+  mutable PageCursor cursor_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_REGISTRY_H_
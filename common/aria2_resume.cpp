@@ -0,0 +1,449 @@
+#include "aria2_resume.h"
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "aria2_mapped_file.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+constexpr char kResumeMagic[8] = {'A', '2', 'F', 'R', 'E', 'S', '0', '2'};
+
+// Host-order fields for the cache entry, which never leaves the machine.
+template <typename T>
+void PutHostField(std::string* out, T value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void PutHostString(std::string* out, const std::string& value) {
+  PutHostField(out, static_cast<uint32_t>(value.size()));
+  out->append(value);
+}
+
+template <typename T>
+bool TakeHostField(const std::string& in, size_t* pos, T* value) {
+  if (in.size() - *pos < sizeof(T)) {
+    return false;
+  }
+  std::memcpy(value, in.data() + *pos, sizeof(T));
+  *pos += sizeof(T);
+  return true;
+}
+
+bool TakeHostString(const std::string& in, size_t* pos, std::string* value) {
+  uint32_t size = 0;
+  if (!TakeHostField(in, pos, &size) || in.size() - *pos < size) {
+    return false;
+  }
+  value->assign(in, *pos, size);
+  *pos += size;
+  return true;
+}
+
+// aria2 control files of version 1 are big-endian.
+void PutBigEndian(std::string* out, uint64_t value, int bytes) {
+  for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+    out->push_back(static_cast<char>((value >> shift) & 0xff));
+  }
+}
+
+}  // namespace
+
+std::string EncodeResumeEntry(const ResumeEntry& entry) {
+  std::string out(kResumeMagic, sizeof(kResumeMagic));
+  PutHostString(&out, entry.key);
+  PutHostString(&out, entry.control_path);
+  PutHostField(&out, entry.control_size);
+  PutHostField(&out, entry.control_mtime_ns);
+  PutHostString(&out, entry.info_hash);
+  PutHostField(&out, entry.piece_length);
+  PutHostField(&out, entry.total_length);
+  PutHostField(&out, entry.upload_length);
+  PutHostString(&out, entry.bitfield);
+  PutHostField(&out, static_cast<uint32_t>(entry.files.size()));
+  for (const ResumeFile& file : entry.files) {
+    PutHostString(&out, file.path);
+    PutHostField(&out, file.size);
+    PutHostField(&out, file.mtime_ns);
+  }
+  return out;
+}
+
+bool DecodeResumeEntry(const std::string& in, ResumeEntry* entry) {
+  if (in.size() < sizeof(kResumeMagic) ||
+      std::memcmp(in.data(), kResumeMagic, sizeof(kResumeMagic)) != 0) {
+    return false;
+  }
+  size_t pos = sizeof(kResumeMagic);
+  uint32_t count = 0;
+  if (!TakeHostString(in, &pos, &entry->key) ||
+      !TakeHostString(in, &pos, &entry->control_path) ||
+      !TakeHostField(in, &pos, &entry->control_size) ||
+      !TakeHostField(in, &pos, &entry->control_mtime_ns) ||
+      !TakeHostString(in, &pos, &entry->info_hash) ||
+      !TakeHostField(in, &pos, &entry->piece_length) ||
+      !TakeHostField(in, &pos, &entry->total_length) ||
+      !TakeHostField(in, &pos, &entry->upload_length) ||
+      !TakeHostString(in, &pos, &entry->bitfield) ||
+      !TakeHostField(in, &pos, &count)) {
+    return false;
+  }
+  entry->files.clear();
+  for (uint32_t i = 0; i < count; ++i) {
+    ResumeFile file;
+    if (!TakeHostString(in, &pos, &file.path) ||
+        !TakeHostField(in, &pos, &file.size) ||
+        !TakeHostField(in, &pos, &file.mtime_ns)) {
+      return false;
+    }
+    entry->files.push_back(std::move(file));
+  }
+  return pos == in.size();
+}
+
+std::string EncodeControlFile(const ResumeEntry& entry) {
+  std::string out;
+  PutBigEndian(&out, 1, 2);
+  // Bit 0 of the extension: the info hash must match the torrent.
+  PutBigEndian(&out, entry.info_hash.empty() ? 0 : 1, 4);
+  PutBigEndian(&out, entry.info_hash.size(), 4);
+  out.append(entry.info_hash);
+  PutBigEndian(&out, entry.piece_length, 4);
+  PutBigEndian(&out, static_cast<uint64_t>(entry.total_length), 8);
+  PutBigEndian(&out, static_cast<uint64_t>(entry.upload_length), 8);
+  PutBigEndian(&out, entry.bitfield.size(), 4);
+  out.append(entry.bitfield);
+  PutBigEndian(&out, 0, 4);
+  return out;
+}
+
+namespace {
+
+bool StatMatches(const ResumeFile& file) {
+  int64_t size = 0;
+  int64_t mtime_ns = 0;
+  return common::StatFile(file.path, &size, &mtime_ns) &&
+         size == file.size && mtime_ns == file.mtime_ns;
+}
+
+bool StatInto(const std::string& path, std::vector<ResumeFile>* files) {
+  ResumeFile file;
+  file.path = path;
+  if (!common::StatFile(path, &file.size, &file.mtime_ns)) {
+    return false;
+  }
+  files->push_back(std::move(file));
+  return true;
+}
+
+// The control file of a torrent, read from its BT meta info: a multi-file
+// torrent keeps it next to the directory named after the torrent. Empty
+// when the handle carries no meta info, which is the case for the stopped
+// result aria2 hands out once a download has been halted.
+std::string TorrentControlPath(aria2_download_handle_t* handle) {
+  std::string path;
+  aria2_bt_meta_info_data_t meta =
+      aria2_download_handle_get_bt_meta_info(handle);
+  if (meta.mode == ARIA2_BT_FILE_MODE_MULTI && meta.name != nullptr) {
+    char* dir = aria2_download_handle_get_dir(handle);
+    if (dir != nullptr) {
+      path = std::string(dir) + "/" + meta.name + ".aria2";
+      aria2_free(dir);
+    }
+  } else if (meta.mode == ARIA2_BT_FILE_MODE_SINGLE) {
+    aria2_file_data_t* files = nullptr;
+    size_t files_count = 0;
+    if (aria2_download_handle_get_files(handle, &files, &files_count) == 0 &&
+        files != nullptr && files_count > 0 && files[0].path != nullptr &&
+        files[0].path[0] != '\0') {
+      path = std::string(files[0].path) + ".aria2";
+    }
+    if (files != nullptr) {
+      aria2_free_file_data_array(files, files_count);
+    }
+  }
+  aria2_free_bt_meta_info_data(&meta);
+  return path;
+}
+
+// Reads what SaveLocked needs from aria2. Fails for downloads without
+// pieces on disk yet. |control_path| is where a torrent's control file was
+// found while the download was live; it is updated when |handle| has the
+// meta info, and a torrent is not saved while it is unknown.
+bool ReadResumeEntry(aria2_session_t* session, aria2_gid_t gid,
+                     const std::string& source, std::string* control_path,
+                     ResumeEntry* entry) {
+  aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+  if (handle == nullptr) {
+    return false;
+  }
+  entry->piece_length = static_cast<uint32_t>(
+      aria2_download_handle_get_piece_length(handle));
+  entry->total_length = aria2_download_handle_get_total_length(handle);
+  entry->upload_length = aria2_download_handle_get_upload_length(handle);
+  aria2_binary_t bitfield = aria2_download_handle_get_bitfield(handle);
+  if (bitfield.data != nullptr) {
+    entry->bitfield.assign(reinterpret_cast<const char*>(bitfield.data),
+                           bitfield.length);
+  }
+  aria2_free_binary(&bitfield);
+  aria2_binary_t info_hash = aria2_download_handle_get_info_hash(handle);
+  if (info_hash.data != nullptr) {
+    entry->info_hash.assign(reinterpret_cast<const char*>(info_hash.data),
+                            info_hash.length);
+  }
+  aria2_free_binary(&info_hash);
+
+  bool ok = entry->piece_length > 0 && entry->total_length > 0 &&
+            !entry->bitfield.empty() &&
+            (source.empty() || StatInto(source, &entry->files));
+  aria2_file_data_t* files = nullptr;
+  size_t files_count = 0;
+  if (ok && aria2_download_handle_get_files(handle, &files, &files_count) == 0 &&
+      files != nullptr && files_count > 0) {
+    for (size_t i = 0; i < files_count && ok; ++i) {
+      // Unselected files of a torrent may legitimately not exist.
+      if (files[i].path == nullptr || files[i].path[0] == '\0') {
+        ok = false;
+      } else if (!StatInto(files[i].path, &entry->files) &&
+                 files[i].selected) {
+        ok = false;
+      }
+    }
+    if (ok) {
+      entry->control_path = std::string(files[0].path) + ".aria2";
+    }
+  } else {
+    ok = false;
+  }
+  if (files != nullptr) {
+    aria2_free_file_data_array(files, files_count);
+  }
+  if (ok && !entry->info_hash.empty()) {
+    const std::string live = TorrentControlPath(handle);
+    if (!live.empty()) {
+      *control_path = live;
+    }
+    entry->control_path = *control_path;
+    ok = !entry->control_path.empty();
+  }
+  if (ok && !common::StatFile(entry->control_path, &entry->control_size,
+                              &entry->control_mtime_ns)) {
+    entry->control_size = -1;
+  }
+  aria2_delete_download_handle(handle);
+  return ok;
+}
+
+uint64_t KeyDigest(const std::string& key) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : key) {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  return hash;
+}
+}  // namespace
+
+bool ResumeCache::Open(const std::string& dir, std::string* error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!common::FileExists(dir)) {
+    *error = "No such directory: " + dir;
+    return false;
+  }
+  dir_ = dir;
+  stats_ = Stats();
+  return true;
+}
+
+void ResumeCache::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  dir_.clear();
+  tracked_.clear();
+}
+
+bool ResumeCache::is_open() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !dir_.empty();
+}
+
+std::string ResumeCache::UriKey(const std::string& uri, const std::string& dir,
+                                const std::string& out) {
+  return "uri\n" + uri + "\n" + dir + "\n" + out;
+}
+
+std::string ResumeCache::TorrentKey(const std::string& torrent_file,
+                                    const std::string& dir) {
+  return "torrent\n" + torrent_file + "\n" + dir;
+}
+
+std::string ResumeCache::EntryPath(const std::string& key) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return EntryPathLocked(key);
+}
+
+std::string ResumeCache::EntryPathLocked(const std::string& key) const {
+  char name[24];
+  std::snprintf(name, sizeof(name), "%016llx",
+                static_cast<unsigned long long>(KeyDigest(key)));
+  return dir_ + "/" + name + ".resume";
+}
+
+ResumeOutcome ResumeCache::Prepare(const std::string& key,
+                                   const std::string& source,
+                                   common::KeyVals* options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (dir_.empty()) {
+    return ResumeOutcome::kNone;
+  }
+  const std::string path = EntryPathLocked(key);
+  std::string contents;
+  ResumeEntry entry;
+  if (!common::ReadWholeFile(path, &contents) ||
+      !DecodeResumeEntry(contents, &entry) || entry.key != key) {
+    ++stats_.misses;
+    return ResumeOutcome::kNone;
+  }
+  bool valid = !entry.files.empty() &&
+               (source.empty() || entry.files.front().path == source);
+  for (const ResumeFile& file : entry.files) {
+    if (!valid) {
+      break;
+    }
+    valid = StatMatches(file);
+  }
+  // The control file aria2 left on pause also lists the pieces that were
+  // in flight; it is only replaced when it is gone or was touched since.
+  if (valid) {
+    ResumeFile control;
+    control.path = entry.control_path;
+    control.size = entry.control_size;
+    control.mtime_ns = entry.control_mtime_ns;
+    std::string error;
+    valid = (entry.control_size >= 0 && StatMatches(control)) ||
+            common::WriteFileAtomic(entry.control_path,
+                                    EncodeControlFile(entry), &error);
+  }
+  if (valid) {
+    options->Set("check-integrity", "false");
+    ++stats_.hits;
+    return ResumeOutcome::kHit;
+  }
+  options->Set("check-integrity", "true");
+  ++stats_.stale;
+  return ResumeOutcome::kStale;
+}
+
+void ResumeCache::Track(aria2_gid_t gid, const std::string& key,
+                        const std::string& source) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (dir_.empty()) {
+    return;
+  }
+  // The entry is spent either way once the download runs and its files
+  // change; it is kept until then in case the add fails.
+  common::RemoveFile(EntryPathLocked(key));
+  Tracked& tracked = tracked_[gid];
+  tracked.key = key;
+  tracked.source = source;
+}
+
+bool ResumeCache::SaveLocked(aria2_session_t* session, aria2_gid_t gid,
+                             Tracked& tracked) {
+  ResumeEntry entry;
+  entry.key = tracked.key;
+  std::string error;
+  if (!ReadResumeEntry(session, gid, tracked.source, &tracked.control_path,
+                       &entry) ||
+      !common::WriteFileAtomic(EntryPathLocked(tracked.key),
+                               EncodeResumeEntry(entry), &error)) {
+    ++stats_.save_errors;
+    return false;
+  }
+  ++stats_.saved;
+  return true;
+}
+
+void ResumeCache::OnDownloadEvent(aria2_session_t* session,
+                                  aria2_download_event_t event,
+                                  aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = tracked_.find(gid);
+  if (dir_.empty() || it == tracked_.end()) {
+    return;
+  }
+  switch (event) {
+    case ARIA2_EVENT_ON_DOWNLOAD_START:
+      if (it->second.control_path.empty()) {
+        aria2_download_handle_t* handle =
+            aria2_get_download_handle(session, gid);
+        if (handle != nullptr) {
+          it->second.control_path = TorrentControlPath(handle);
+          aria2_delete_download_handle(handle);
+        }
+      }
+      break;
+    case ARIA2_EVENT_ON_DOWNLOAD_PAUSE:
+      SaveLocked(session, gid, it->second);
+      break;
+    case ARIA2_EVENT_ON_DOWNLOAD_STOP:
+      // Halted by a session shutdown rather than removed.
+      if (common::GetDownloadStatus(session, gid) != common::kStatusRemoved) {
+        SaveLocked(session, gid, it->second);
+      }
+      tracked_.erase(it);
+      break;
+    case ARIA2_EVENT_ON_DOWNLOAD_COMPLETE:
+    case ARIA2_EVENT_ON_DOWNLOAD_ERROR:
+      tracked_.erase(it);
+      break;
+    default:
+      break;
+  }
+}
+
+int64_t ResumeCache::SaveAll(aria2_session_t* session) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  int64_t saved = 0;
+  if (dir_.empty()) {
+    return saved;
+  }
+  for (auto& item : tracked_) {
+    const int status = common::GetDownloadStatus(session, item.first);
+    if (status != common::kStatusComplete &&
+        status != common::kStatusRemoved &&
+        SaveLocked(session, item.first, item.second)) {
+      ++saved;
+    }
+  }
+  return saved;
+}
+
+ResumeCache::Stats ResumeCache::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+common::Value ResumeCache::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewMap();
+  out.Set("open", !dir_.empty());
+  out.Set("dir", dir_);
+  out.Set("tracked", static_cast<int64_t>(tracked_.size()));
+  out.Set("saved", stats_.saved);
+  out.Set("saveErrors", stats_.save_errors);
+  out.Set("hits", stats_.hits);
+  out.Set("stale", stats_.stale);
+  out.Set("misses", stats_.misses);
+  return out;
+}
+
+void ResumeCache::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  tracked_.clear();
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
@@ -0,0 +1,142 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_RESUME_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_RESUME_H_
+
+#include <aria2_c_api.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "aria2_helpers.h"
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// Outcome of looking a download up in the fast-resume cache before adding
+// it.
+enum class ResumeOutcome {
+  kNone = 0,   // Nothing cached; the add is left alone.
+  kHit = 1,    // Files unchanged; aria2 resumes from the cached pieces.
+  kStale = 2,  // Files changed since the snapshot; full verification.
+};
+
+struct ResumeFile {
+  std::string path;
+  int64_t size = 0;
+  int64_t mtime_ns = 0;
+};
+
+// What is saved for one download. The source file (the torrent) is listed
+// first in |files| when there is one.
+struct ResumeEntry {
+  std::string key;
+  std::string control_path;
+  // The control file aria2 wrote when the download paused; size -1 when
+  // there was none.
+  int64_t control_size = -1;
+  int64_t control_mtime_ns = 0;
+  std::string info_hash;
+  uint32_t piece_length = 0;
+  int64_t total_length = 0;
+  int64_t upload_length = 0;
+  std::string bitfield;
+  std::vector<ResumeFile> files;
+};
+
+// Cache entry format, in host byte order. Decoding fails on anything but a
+// complete entry.
+std::string EncodeResumeEntry(const ResumeEntry& entry);
+bool DecodeResumeEntry(const std::string& in, ResumeEntry* entry);
+// A control file as aria2 itself writes it (version 1), without the
+// in-flight pieces, which aria2 downloads again.
+std::string EncodeControlFile(const ResumeEntry& entry);
+
+// Fast-resume cache for partially downloaded files.
+//
+// When a download pauses, or is halted by a session shutdown, its piece
+// bitfield is saved to the cache directory together with the size and
+// modification time of every file (and of the torrent it came from). Entries
+// are keyed by what the download was added from (URI or torrent path plus
+// target directory), so re-adding the same download after a restart finds
+// its entry without touching the data.
+//
+// A matching entry whose files are all unchanged turns check-integrity off,
+// so aria2 resumes from its control file (<path>.aria2) without rehashing.
+// The control file aria2 wrote on pause is kept as is when its size and
+// modification time still match the snapshot; when it is gone or changed,
+// it is rewritten (format version 1) from the cached bitfield, and pieces
+// that were only partly written are downloaded again. If anything else
+// changed, the entry is dropped and check-integrity is turned on.
+class ResumeCache {
+ public:
+  struct Stats {
+    int64_t saved = 0;
+    int64_t save_errors = 0;
+    int64_t hits = 0;
+    int64_t stale = 0;
+    int64_t misses = 0;
+  };
+
+  bool Open(const std::string& dir, std::string* error);
+  void Close();
+  bool is_open() const;
+
+  // Identity of a download for the cache. |dir| is the effective download
+  // directory.
+  static std::string UriKey(const std::string& uri, const std::string& dir,
+                            const std::string& out);
+  static std::string TorrentKey(const std::string& torrent_file,
+                                const std::string& dir);
+  // File the entry for |key| is saved to.
+  std::string EntryPath(const std::string& key) const;
+
+  // Looks up |key| before the download is added and adjusts |options| as
+  // described above. |source| is the torrent file, or empty for URIs. The
+  // entry stays in the cache until Track, so a failed add keeps it.
+  ResumeOutcome Prepare(const std::string& key, const std::string& source,
+                        common::KeyVals* options);
+  // Remembers which entry a download added after Prepare belongs to and
+  // drops the entry, which is spent once the download runs.
+  void Track(aria2_gid_t gid, const std::string& key,
+             const std::string& source);
+
+  // Runs in the download event callback.
+  void OnDownloadEvent(aria2_session_t* session, aria2_download_event_t event,
+                       aria2_gid_t gid);
+
+  // Saves every tracked download that is not finished. Returns the number
+  // saved.
+  int64_t SaveAll(aria2_session_t* session);
+
+  Stats GetStats() const;
+  // {open, dir, tracked, saved, saveErrors, hits, stale, misses}.
+  common::Value Describe() const;
+
+  // Forgets the downloads of the ended session; the cache stays open.
+  void Reset();
+
+ private:
+  struct Tracked {
+    std::string key;
+    std::string source;
+    // Control file of a torrent, read while the download is live: the
+    // handle of a halted download has no BT meta info to derive it from.
+    std::string control_path;
+  };
+
+  bool SaveLocked(aria2_session_t* session, aria2_gid_t gid, Tracked& tracked);
+  std::string EntryPathLocked(const std::string& key) const;
+
+  mutable std::mutex mutex_;
+  std::string dir_;
+  std::unordered_map<aria2_gid_t, Tracked> tracked_;
+  Stats stats_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_RESUME_H_
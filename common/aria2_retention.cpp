@@ -0,0 +1,256 @@
+#include "aria2_retention.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "aria2_helpers.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+constexpr auto kRetentionInterval = std::chrono::seconds(1);
+// Rough per-result footprint of aria2's DownloadResult (option set, file
+// entries, bookkeeping) before paths and URIs are counted.
+constexpr int64_t kResultBaseBytes = 512;
+// Results aria2 may take in on top of the retained ones before the next
+// tick raises its limit; doubled after a tick that saw more finish.
+constexpr int64_t kResultHeadroom = 16;
+
+// Reads the summary of |gid| from aria2 and estimates what aria2 keeps for
+// it.
+void ReadFinishedResult(aria2_session_t* session, aria2_gid_t gid,
+                        int64_t* total_length, int64_t* completed_length,
+                        int32_t* error_code, int64_t* bytes) {
+  *bytes = kResultBaseBytes;
+  aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+  if (handle == nullptr) {
+    return;
+  }
+  *total_length = aria2_download_handle_get_total_length(handle);
+  *completed_length = aria2_download_handle_get_completed_length(handle);
+  *error_code = aria2_download_handle_get_error_code(handle);
+  aria2_file_data_t* files = nullptr;
+  size_t files_count = 0;
+  if (aria2_download_handle_get_files(handle, &files, &files_count) == 0 &&
+      files != nullptr) {
+    for (size_t i = 0; i < files_count; ++i) {
+      if (files[i].path != nullptr) {
+        *bytes += static_cast<int64_t>(std::strlen(files[i].path));
+      }
+      for (size_t j = 0; j < files[i].uris_count; ++j) {
+        if (files[i].uris[j].uri != nullptr) {
+          *bytes += static_cast<int64_t>(std::strlen(files[i].uris[j].uri));
+        }
+      }
+    }
+    aria2_free_file_data_array(files, files_count);
+  }
+  aria2_delete_download_handle(handle);
+}
+
+const char* FinishedStatusName(aria2_download_event_t event) {
+  switch (event) {
+    case ARIA2_EVENT_ON_DOWNLOAD_ERROR:
+      return "error";
+    case ARIA2_EVENT_ON_DOWNLOAD_STOP:
+      return "removed";
+    default:
+      return "complete";
+  }
+}
+}  // namespace
+
+RetentionManager::~RetentionManager() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CloseArchiveLocked();
+}
+
+bool RetentionManager::SetPolicy(const RetentionPolicy& policy,
+                                 std::string* error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (policy.archive_path != policy_.archive_path || archive_ == nullptr) {
+    CloseArchiveLocked();
+    if (!policy.archive_path.empty()) {
+      archive_ = std::fopen(policy.archive_path.c_str(), "ab");
+      if (archive_ == nullptr) {
+        if (error != nullptr) {
+          *error = "Cannot open " + policy.archive_path + ": " +
+                   std::strerror(errno);
+        }
+        policy_.archive_path.clear();
+        return false;
+      }
+    }
+  }
+  policy_ = policy;
+  if (!policy_.enabled()) {
+    finished_.clear();
+    stats_.retained = 0;
+    stats_.bytes = 0;
+  }
+  return true;
+}
+
+RetentionPolicy RetentionManager::GetPolicy() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return policy_;
+}
+
+void RetentionManager::OnDownloadFinished(aria2_session_t* session,
+                                          aria2_download_event_t event,
+                                          aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!policy_.enabled()) {
+    return;
+  }
+  Finished result;
+  result.gid = gid;
+  result.event = event;
+  result.finished = std::chrono::steady_clock::now();
+  result.finished_at_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  ReadFinishedResult(session, gid, &result.total_length,
+                     &result.completed_length, &result.error_code,
+                     &result.bytes);
+  stats_.bytes += result.bytes;
+  finished_.push_back(result);
+  stats_.retained = static_cast<int64_t>(finished_.size());
+  ++finished_since_tick_;
+}
+
+bool RetentionManager::OverLimitLocked(
+    std::chrono::steady_clock::time_point now) const {
+  if (finished_.empty()) {
+    return false;
+  }
+  if (policy_.max_count >= 0 &&
+      static_cast<int64_t>(finished_.size()) > policy_.max_count) {
+    return true;
+  }
+  if (policy_.max_bytes >= 0 && stats_.bytes > policy_.max_bytes) {
+    return true;
+  }
+  return policy_.max_age_ms >= 0 &&
+         now - finished_.front().finished >
+             std::chrono::milliseconds(policy_.max_age_ms);
+}
+
+std::vector<aria2_gid_t> RetentionManager::OnTick(aria2_session_t* session) {
+  std::vector<aria2_gid_t> evicted;
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto now = std::chrono::steady_clock::now();
+  if (now - last_tick_ < kRetentionInterval) {
+    return evicted;
+  }
+  last_tick_ = now;
+
+  if (!policy_.enabled()) {
+    if (applied_limit_ >= 0) {
+      common::KeyVals options;
+      options.Add("max-download-result", std::to_string(original_limit_));
+      aria2_change_global_option(session, options.data(), options.count());
+      applied_limit_ = -1;
+    }
+    return evicted;
+  }
+
+  while (OverLimitLocked(now)) {
+    const Finished& oldest = finished_.front();
+    ArchiveLocked(oldest);
+    evicted.push_back(oldest.gid);
+    stats_.bytes -= oldest.bytes;
+    finished_.pop_front();
+  }
+  stats_.evicted += static_cast<int64_t>(evicted.size());
+  stats_.retained = static_cast<int64_t>(finished_.size());
+  if (archive_ != nullptr && !evicted.empty()) {
+    std::fflush(archive_);
+  }
+
+  // Keep aria2 from holding more results than the plugin retains. A count
+  // limit alone keeps both sides in step. Otherwise the retained count lags
+  // by one tick of new results, so aria2 gets headroom above it: without
+  // it, a limit of 0 after an idle period would make aria2 drop the next
+  // result as soon as it is stored.
+  int64_t limit = policy_.max_count;
+  if (policy_.max_age_ms >= 0 || policy_.max_bytes >= 0) {
+    limit = static_cast<int64_t>(finished_.size()) +
+            std::max(kResultHeadroom, 2 * finished_since_tick_);
+  }
+  finished_since_tick_ = 0;
+  if (limit != applied_limit_) {
+    if (applied_limit_ < 0) {
+      original_limit_ =
+          common::GetGlobalOptionInt(session, "max-download-result", 1000);
+    }
+    common::KeyVals options;
+    options.Add("max-download-result", std::to_string(limit));
+    aria2_change_global_option(session, options.data(), options.count());
+    applied_limit_ = limit;
+  }
+  return evicted;
+}
+
+void RetentionManager::ArchiveLocked(const Finished& result) {
+  if (archive_ == nullptr) {
+    return;
+  }
+  const std::string gid = common::GidToHex(result.gid);
+  if (std::fprintf(archive_, "%s\t%s\t%d\t%lld\t%lld\t%lld\n", gid.c_str(),
+                   FinishedStatusName(result.event), result.error_code,
+                   static_cast<long long>(result.total_length),
+                   static_cast<long long>(result.completed_length),
+                   static_cast<long long>(result.finished_at_ms)) < 0) {
+    ++stats_.archive_errors;
+  } else {
+    ++stats_.archived;
+  }
+}
+
+void RetentionManager::CloseArchiveLocked() {
+  if (archive_ != nullptr) {
+    std::fclose(archive_);
+    archive_ = nullptr;
+  }
+}
+
+RetentionManager::Stats RetentionManager::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+common::Value RetentionManager::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewMap();
+  out.Set("enabled", policy_.enabled());
+  out.Set("maxCount", policy_.max_count);
+  out.Set("maxAgeMs", policy_.max_age_ms);
+  out.Set("maxBytes", policy_.max_bytes);
+  out.Set("archivePath", policy_.archive_path);
+  out.Set("retained", stats_.retained);
+  out.Set("bytes", stats_.bytes);
+  out.Set("evicted", stats_.evicted);
+  out.Set("archived", stats_.archived);
+  out.Set("archiveErrors", stats_.archive_errors);
+  return out;
+}
+
+void RetentionManager::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  finished_.clear();
+  stats_.retained = 0;
+  stats_.bytes = 0;
+  applied_limit_ = -1;
+  original_limit_ = -1;
+  finished_since_tick_ = 0;
+  if (archive_ != nullptr) {
+    std::fflush(archive_);
+  }
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
@@ -0,0 +1,116 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_RETENTION_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_RETENTION_H_
+
+#include <aria2_c_api.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+struct RetentionPolicy {
+  int64_t max_count = -1;   // Finished results kept; -1 for no limit.
+  int64_t max_age_ms = -1;  // -1 for no limit.
+  int64_t max_bytes = -1;   // Estimated metadata of the kept results.
+  // When set, evicted results are appended to this file as one
+  // tab-separated line: gid, status, errorCode, totalLength,
+  // completedLength, finishedAt (ms since the epoch).
+  std::string archive_path;
+
+  bool enabled() const {
+    return max_count >= 0 || max_age_ms >= 0 || max_bytes >= 0;
+  }
+};
+
+// Bounds the finished (complete, error, removed) download results kept by
+// aria2 and by the plugin.
+//
+// While a policy is set, OnDownloadFinished records a fixed-size summary of
+// every result in finish order; OnTick pops the oldest ones off the front
+// while the count, age or byte limit is exceeded and returns their gids so
+// the caller can drop them from the other components. The libaria2 API has
+// no call to purge a single result, so aria2's own "max-download-result" is
+// set to the count limit, or for age and byte limits to the retained count
+// plus some headroom for results finishing before the next tick; aria2
+// trims its oldest results to that count when the next one arrives. The
+// byte figure is an estimate of what aria2 holds per result: a fixed
+// overhead plus file paths and URIs.
+class RetentionManager {
+ public:
+  struct Stats {
+    int64_t retained = 0;
+    int64_t bytes = 0;
+    int64_t evicted = 0;
+    int64_t archived = 0;
+    int64_t archive_errors = 0;
+  };
+
+  RetentionManager() = default;
+  ~RetentionManager();
+
+  RetentionManager(const RetentionManager&) = delete;
+  RetentionManager& operator=(const RetentionManager&) = delete;
+
+  // Fails when the archive file cannot be opened for appending. Disabling
+  // the policy forgets the recorded results without evicting them.
+  bool SetPolicy(const RetentionPolicy& policy, std::string* error);
+  RetentionPolicy GetPolicy() const;
+
+  // Records a result; |event| is COMPLETE, ERROR or STOP. Runs in the
+  // download event callback.
+  void OnDownloadFinished(aria2_session_t* session,
+                          aria2_download_event_t event, aria2_gid_t gid);
+
+  // Evicts at most once a second. Returns the evicted gids.
+  std::vector<aria2_gid_t> OnTick(aria2_session_t* session);
+
+  Stats GetStats() const;
+  // {enabled, maxCount, maxAgeMs, maxBytes, archivePath, retained, bytes,
+  // evicted, archived, archiveErrors}.
+  common::Value Describe() const;
+
+  // The results went away with the session; the policy and the archive
+  // stay.
+  void Reset();
+
+ private:
+  struct Finished {
+    aria2_gid_t gid = 0;
+    std::chrono::steady_clock::time_point finished;
+    int64_t finished_at_ms = 0;
+    int64_t total_length = 0;
+    int64_t completed_length = 0;
+    int64_t bytes = 0;
+    int32_t error_code = 0;
+    aria2_download_event_t event = ARIA2_EVENT_ON_DOWNLOAD_COMPLETE;
+  };
+
+  bool OverLimitLocked(std::chrono::steady_clock::time_point now) const;
+  void ArchiveLocked(const Finished& result);
+  void CloseArchiveLocked();
+
+  mutable std::mutex mutex_;
+  RetentionPolicy policy_;
+  std::deque<Finished> finished_;
+  std::FILE* archive_ = nullptr;
+  Stats stats_;
+  // Last "max-download-result" handed to aria2 and the value it replaced,
+  // restored once the policy is disabled; -1 when not set.
+  int64_t applied_limit_ = -1;
+  int original_limit_ = -1;
+  int64_t finished_since_tick_ = 0;
+  std::chrono::steady_clock::time_point last_tick_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_RETENTION_H_
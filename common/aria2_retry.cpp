@@ -0,0 +1,368 @@
+#include "aria2_retry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <set>
+
+#include "aria2_helpers.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+constexpr auto kRetryTickInterval = std::chrono::milliseconds(250);
+
+// What the retry engine needs from a failed download, read while its handle
+// is still available in the event callback.
+struct FailedDownload {
+  int error_code = 0;
+  std::vector<std::string> uris;
+  std::vector<std::string> used_hosts;
+  std::vector<std::pair<std::string, std::string>> options;
+};
+
+// Returns false for downloads that cannot be re-added from URIs alone
+// (torrents, multi-file metalinks, downloads without URIs).
+bool ReadFailedDownload(aria2_session_t* session, aria2_gid_t gid,
+                        FailedDownload* out) {
+  aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+  if (handle == nullptr) {
+    return false;
+  }
+  out->error_code = aria2_download_handle_get_error_code(handle);
+
+  aria2_file_data_t* files = nullptr;
+  size_t files_count = 0;
+  bool single_file = false;
+  if (aria2_download_handle_get_files(handle, &files, &files_count) == 0 &&
+      files != nullptr) {
+    single_file = files_count == 1;
+    std::set<std::string> seen_uris;
+    std::set<std::string> seen_hosts;
+    for (size_t i = 0; single_file && i < files[0].uris_count; ++i) {
+      const aria2_uri_data_t& uri = files[0].uris[i];
+      if (uri.uri == nullptr) {
+        continue;
+      }
+      if (seen_uris.insert(uri.uri).second) {
+        out->uris.push_back(uri.uri);
+      }
+      const std::string host = common::UriHost(uri.uri);
+      if (uri.status == ARIA2_URI_USED && !host.empty() &&
+          seen_hosts.insert(host).second) {
+        out->used_hosts.push_back(host);
+      }
+    }
+    aria2_free_file_data_array(files, files_count);
+  }
+
+  aria2_key_val_t* options = nullptr;
+  size_t options_count = 0;
+  if (aria2_download_handle_get_options(handle, &options, &options_count) ==
+          0 &&
+      options != nullptr) {
+    for (size_t i = 0; i < options_count; ++i) {
+      // A fixed gid would collide with the failed download.
+      if (options[i].key == nullptr || options[i].value == nullptr ||
+          std::strcmp(options[i].key, "gid") == 0) {
+        continue;
+      }
+      out->options.emplace_back(options[i].key, options[i].value);
+    }
+    aria2_free_key_vals(options, options_count);
+  }
+  aria2_delete_download_handle(handle);
+  return single_file && !out->uris.empty();
+}
+
+std::vector<std::string> UsedHosts(aria2_session_t* session, aria2_gid_t gid) {
+  std::vector<std::string> hosts;
+  aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+  if (handle == nullptr) {
+    return hosts;
+  }
+  aria2_file_data_t* files = nullptr;
+  size_t files_count = 0;
+  if (aria2_download_handle_get_files(handle, &files, &files_count) == 0 &&
+      files != nullptr) {
+    for (size_t i = 0; i < files_count; ++i) {
+      for (size_t j = 0; j < files[i].uris_count; ++j) {
+        const aria2_uri_data_t& uri = files[i].uris[j];
+        if (uri.uri != nullptr && uri.status == ARIA2_URI_USED) {
+          hosts.push_back(common::UriHost(uri.uri));
+        }
+      }
+    }
+    aria2_free_file_data_array(files, files_count);
+  }
+  aria2_delete_download_handle(handle);
+  return hosts;
+}
+}  // namespace
+
+bool IsTransientErrorCode(int error_code) {
+  switch (error_code) {
+    case 1:   // Unknown error.
+    case 2:   // Timeout.
+    case 5:   // Below lowest-speed-limit.
+    case 6:   // Network problem.
+    case 8:   // Server does not support resume.
+    case 19:  // Name resolution failed.
+    case 21:  // FTP command failed.
+    case 22:  // Unexpected HTTP response header.
+    case 29:  // Server overloaded or in maintenance.
+      return true;
+    default:
+      return false;
+  }
+}
+
+int64_t BackoffDelayMs(const RetryPolicy& policy, int attempt, double unit) {
+  const double exponential =
+      policy.base_delay_ms *
+      std::pow(policy.multiplier, static_cast<double>(std::max(attempt, 1) - 1));
+  const double capped =
+      std::min(exponential, static_cast<double>(policy.max_delay_ms));
+  const double factor = 1.0 + policy.jitter * (2.0 * unit - 1.0);
+  return std::max<int64_t>(0, static_cast<int64_t>(capped * factor));
+}
+
+bool CircuitBreaker::OnFailure(TimePoint now, int threshold, int cooldown_ms) {
+  const auto cooldown = std::chrono::milliseconds(cooldown_ms);
+  if (state_ == State::kHalfOpen) {
+    // The trial failed: back to open for another cooldown.
+    state_ = State::kOpen;
+    open_until_ = now + cooldown;
+    return true;
+  }
+  ++failures_;
+  if (state_ == State::kClosed && failures_ >= threshold) {
+    state_ = State::kOpen;
+    open_until_ = now + cooldown;
+    return true;
+  }
+  return false;
+}
+
+void CircuitBreaker::OnSuccess() {
+  state_ = State::kClosed;
+  failures_ = 0;
+}
+
+bool CircuitBreaker::Admit(TimePoint now, int cooldown_ms) {
+  if (state_ == State::kClosed) {
+    return true;
+  }
+  if (now < open_until_) {
+    return false;
+  }
+  state_ = State::kHalfOpen;
+  open_until_ = now + std::chrono::milliseconds(cooldown_ms);
+  return true;
+}
+
+RetryEngine::RetryEngine() : random_(std::random_device()()) {}
+
+void RetryEngine::SetPolicy(const RetryPolicy& policy) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  policy_ = policy;
+  if (!policy_.enabled) {
+    pending_.clear();
+  }
+}
+
+RetryPolicy RetryEngine::GetPolicy() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return policy_;
+}
+
+bool RetryEngine::OnDownloadError(aria2_session_t* session, aria2_gid_t gid,
+                                  Priority priority, RetryAction* action) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  int spent = 0;
+  auto spent_it = attempts_.find(gid);
+  if (spent_it != attempts_.end()) {
+    spent = spent_it->second;
+    attempts_.erase(spent_it);
+  }
+  if (!policy_.enabled) {
+    return false;
+  }
+  FailedDownload failed;
+  if (!ReadFailedDownload(session, gid, &failed)) {
+    return false;
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  const bool transient = IsTransientErrorCode(failed.error_code);
+  if (transient) {
+    for (const std::string& host : failed.used_hosts) {
+      if (breakers_[host].OnFailure(now, policy_.breaker_threshold,
+                                    policy_.breaker_cooldown_ms)) {
+        ++stats_.breaker_opens;
+      }
+    }
+  }
+
+  action->gid = gid;
+  action->attempt = spent + 1;
+  action->error_code = failed.error_code;
+  action->priority = priority;
+  action->uris = failed.uris;
+  if (!transient || spent >= policy_.max_attempts) {
+    action->kind = RetryActionKind::kGaveUp;
+    action->reason = transient ? "attempts" : "permanent";
+    ++stats_.gave_up;
+    return true;
+  }
+
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  Pending pending;
+  pending.gid = gid;
+  pending.attempt = spent + 1;
+  pending.error_code = failed.error_code;
+  pending.priority = priority;
+  action->delay_ms = BackoffDelayMs(policy_, pending.attempt, unit(random_));
+  pending.due = now + std::chrono::milliseconds(action->delay_ms);
+  pending.uris = std::move(failed.uris);
+  pending.options = std::move(failed.options);
+  pending_.push_back(std::move(pending));
+  action->kind = RetryActionKind::kScheduled;
+  action->reason = "transient";
+  ++stats_.scheduled;
+  return true;
+}
+
+void RetryEngine::OnDownloadComplete(aria2_session_t* session,
+                                     aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  attempts_.erase(gid);
+  if (breakers_.empty()) {
+    return;
+  }
+  for (const std::string& host : UsedHosts(session, gid)) {
+    auto it = breakers_.find(host);
+    if (it != breakers_.end()) {
+      it->second.OnSuccess();
+    }
+  }
+}
+
+std::vector<RetryAction> RetryEngine::OnTick(aria2_session_t* session) {
+  std::vector<RetryAction> actions;
+  const auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (pending_.empty() || now - last_tick_ < kRetryTickInterval) {
+    return actions;
+  }
+  last_tick_ = now;
+
+  std::vector<Pending> waiting;
+  for (Pending& pending : pending_) {
+    if (now < pending.due) {
+      waiting.push_back(std::move(pending));
+      continue;
+    }
+    std::vector<std::string> admitted;
+    auto reopen = CircuitBreaker::TimePoint::max();
+    for (const std::string& uri : pending.uris) {
+      auto it = breakers_.find(common::UriHost(uri));
+      if (it == breakers_.end() ||
+          it->second.Admit(now, policy_.breaker_cooldown_ms)) {
+        admitted.push_back(uri);
+      } else {
+        reopen = std::min(reopen, it->second.open_until());
+      }
+    }
+    if (admitted.empty()) {
+      // Every mirror sits behind an open breaker; wait for the first one.
+      pending.due = reopen;
+      waiting.push_back(std::move(pending));
+      continue;
+    }
+
+    std::vector<const char*> uri_ptrs;
+    for (const std::string& uri : admitted) {
+      uri_ptrs.push_back(uri.c_str());
+    }
+    common::KeyVals options;
+    for (const auto& option : pending.options) {
+      options.Add(option.first, option.second);
+    }
+    RetryAction action;
+    action.gid = pending.gid;
+    action.attempt = pending.attempt;
+    action.error_code = pending.error_code;
+    action.priority = pending.priority;
+    action.uris = std::move(admitted);
+    action.options = pending.options;
+    if (aria2_add_uri(session, &action.new_gid, uri_ptrs.data(),
+                      uri_ptrs.size(), options.data(), options.count(),
+                      -1) == 0) {
+      action.kind = RetryActionKind::kRetried;
+      action.reason = "retried";
+      attempts_[action.new_gid] = pending.attempt;
+      ++stats_.retried;
+    } else {
+      action.kind = RetryActionKind::kGaveUp;
+      action.reason = "add failed";
+      ++stats_.gave_up;
+    }
+    actions.push_back(std::move(action));
+  }
+  pending_.swap(waiting);
+  return actions;
+}
+
+bool RetryEngine::IsPending(aria2_gid_t gid) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const Pending& pending : pending_) {
+    if (pending.gid == gid) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void RetryEngine::Forget(aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  attempts_.erase(gid);
+}
+
+RetryEngine::Stats RetryEngine::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.pending = static_cast<int>(pending_.size());
+  return stats;
+}
+
+common::Value RetryEngine::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewMap();
+  out.Set("enabled", policy_.enabled);
+  out.Set("pending", static_cast<int32_t>(pending_.size()));
+  out.Set("scheduled", stats_.scheduled);
+  out.Set("retried", stats_.retried);
+  out.Set("gaveUp", stats_.gave_up);
+  out.Set("breakerOpens", stats_.breaker_opens);
+  common::Value open_hosts = common::Value::NewList();
+  for (const auto& entry : breakers_) {
+    if (entry.second.state() != CircuitBreaker::State::kClosed) {
+      open_hosts.Append(entry.first);
+    }
+  }
+  out.Set("openHosts", std::move(open_hosts));
+  return out;
+}
+
+void RetryEngine::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_.clear();
+  attempts_.clear();
+  breakers_.clear();
+  stats_ = Stats();
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
@@ -0,0 +1,156 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_RETRY_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_RETRY_H_
+
+#include <aria2_c_api.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "aria2_scheduler.h"
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// Whether an aria2 error code (the exit status list in aria2's manual) is
+// worth retrying. Timeouts, network and name resolution problems, bad
+// responses and overloaded servers are transient; missing resources, local
+// file system trouble, checksum failures and bad input are permanent.
+bool IsTransientErrorCode(int error_code);
+
+struct RetryPolicy {
+  bool enabled = false;
+  int max_attempts = 5;  // Re-adds per original download.
+  int base_delay_ms = 1000;
+  int max_delay_ms = 60000;
+  double multiplier = 2.0;
+  double jitter = 0.2;  // Delay is scaled by a random factor in 1 +/- jitter.
+  int breaker_threshold = 5;  // Consecutive transient failures per host.
+  int breaker_cooldown_ms = 60000;
+};
+
+// Exponential backoff before re-add number |attempt| (1-based), capped at
+// max_delay_ms; |unit| in [0, 1) selects the jitter.
+int64_t BackoffDelayMs(const RetryPolicy& policy, int attempt, double unit);
+
+// Per-host circuit breaker. Opens after |threshold| consecutive failures;
+// once the cooldown has passed a single trial attempt is admitted
+// (half-open), and its outcome closes or reopens the breaker.
+class CircuitBreaker {
+ public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  enum class State { kClosed, kOpen, kHalfOpen };
+
+  // Returns true when this failure opened the breaker.
+  bool OnFailure(TimePoint now, int threshold, int cooldown_ms);
+  void OnSuccess();
+
+  // Whether a new attempt may start now. The first call after the cooldown
+  // moves to half-open and admits the trial; a trial that never reports
+  // back is replaced after another cooldown.
+  bool Admit(TimePoint now, int cooldown_ms);
+
+  State state() const { return state_; }
+  TimePoint open_until() const { return open_until_; }
+
+ private:
+  State state_ = State::kClosed;
+  int failures_ = 0;
+  TimePoint open_until_;
+};
+
+enum class RetryActionKind {
+  kScheduled = 0,
+  kRetried = 1,
+  kGaveUp = 2,
+};
+
+// Outcome reported to Dart as "onRetryEvent"; values mirror the Dart
+// `Aria2RetryAction` enum.
+struct RetryAction {
+  RetryActionKind kind = RetryActionKind::kScheduled;
+  aria2_gid_t gid = 0;      // The download that failed.
+  aria2_gid_t new_gid = 0;  // The re-added download (kRetried).
+  int attempt = 0;
+  int error_code = 0;
+  int64_t delay_ms = 0;
+  Priority priority = Priority::kNormal;
+  std::vector<std::string> uris;
+  std::vector<std::pair<std::string, std::string>> options;
+  const char* reason = "";
+};
+
+// Native retry engine for URI downloads.
+//
+// OnDownloadError runs in the download event callback: it classifies the
+// error code, charges transient failures to the hosts that were used and
+// schedules a re-add with exponential backoff and jitter. OnTick re-adds due
+// downloads with their original options, leaving out mirrors whose circuit
+// breaker is open and postponing the attempt while none is admitted. The
+// policy survives session changes; pending work and host state do not.
+class RetryEngine {
+ public:
+  struct Stats {
+    int pending = 0;
+    int64_t scheduled = 0;
+    int64_t retried = 0;
+    int64_t gave_up = 0;
+    int64_t breaker_opens = 0;
+  };
+
+  RetryEngine();
+
+  void SetPolicy(const RetryPolicy& policy);
+  RetryPolicy GetPolicy() const;
+
+  // Returns true with |action| filled when the error was handled, either by
+  // scheduling a retry or by giving up.
+  bool OnDownloadError(aria2_session_t* session, aria2_gid_t gid,
+                       Priority priority, RetryAction* action);
+  void OnDownloadComplete(aria2_session_t* session, aria2_gid_t gid);
+  // Whether a retry of |gid| is scheduled and not yet re-added.
+  bool IsPending(aria2_gid_t gid) const;
+  // Drops what is kept for |gid| once its result is evicted.
+  void Forget(aria2_gid_t gid);
+
+  std::vector<RetryAction> OnTick(aria2_session_t* session);
+
+  Stats GetStats() const;
+  // {enabled, pending, scheduled, retried, gaveUp, breakerOpens, openHosts}.
+  common::Value Describe() const;
+
+  void Reset();
+
+ private:
+  struct Pending {
+    aria2_gid_t gid = 0;
+    int attempt = 0;
+    int error_code = 0;
+    Priority priority = Priority::kNormal;
+    std::chrono::steady_clock::time_point due;
+    std::vector<std::string> uris;
+    std::vector<std::pair<std::string, std::string>> options;
+  };
+
+  mutable std::mutex mutex_;
+  RetryPolicy policy_;
+  std::mt19937 random_;
+  std::vector<Pending> pending_;
+  // Attempts already spent by re-added downloads, keyed by their new gid.
+  std::unordered_map<aria2_gid_t, int> attempts_;
+  std::unordered_map<std::string, CircuitBreaker> breakers_;
+  Stats stats_;
+  std::chrono::steady_clock::time_point last_tick_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_RETRY_H_
@@ -0,0 +1,480 @@
+#include "aria2_scheduler.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "aria2_helpers.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+constexpr auto kTickInterval = std::chrono::milliseconds(500);
+constexpr int kDefaultMaxConcurrent = 5;
+
+std::vector<aria2_gid_t> ActiveGids(aria2_session_t* session) {
+  std::vector<aria2_gid_t> out;
+  aria2_gid_t* gids = nullptr;
+  size_t count = 0;
+  if (aria2_get_active_download(session, &gids, &count) == 0 && gids != nullptr) {
+    out.assign(gids, gids + count);
+  }
+  if (gids != nullptr) {
+    aria2_free(gids);
+  }
+  return out;
+}
+
+aria2_offset_mode_t OffsetMode(common::OffsetMode mode) {
+  return static_cast<aria2_offset_mode_t>(mode);
+}
+}  // namespace
+
+bool PriorityFromInt(int64_t value, Priority* out) {
+  if (value < static_cast<int64_t>(Priority::kCritical) ||
+      value > static_cast<int64_t>(Priority::kBackground)) {
+    return false;
+  }
+  *out = static_cast<Priority>(value);
+  return true;
+}
+
+bool QueuePolicyFromInt(int64_t value, QueuePolicy* out) {
+  if (value < static_cast<int64_t>(QueuePolicy::kFifo) ||
+      value > static_cast<int64_t>(QueuePolicy::kEarliestDeadlineFirst)) {
+    return false;
+  }
+  *out = static_cast<QueuePolicy>(value);
+  return true;
+}
+
+void QueueScheduler::Track(aria2_gid_t gid, Priority priority,
+                           DownloadHints hints) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry& entry = EntryLocked(gid);
+  entry.priority = priority;
+  entry.size = hints.size;
+  entry.deadline = hints.deadline;
+  if (entry.size < 0) {
+    entry.uris = std::move(hints.uris);
+    if (policy_ == QueuePolicy::kShortestJobFirst) {
+      ProbeLocked(gid, &entry);
+    }
+  }
+  if (policy_ != QueuePolicy::kFifo) {
+    queue_dirty_ = true;
+  }
+  if (priority == Priority::kCritical) {
+    promote_.push_back(gid);
+  }
+}
+
+void QueueScheduler::SetPriority(aria2_gid_t gid, Priority priority) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  EntryLocked(gid).priority = priority;
+  if (priority == Priority::kCritical) {
+    promote_.push_back(gid);
+  }
+}
+
+Priority QueueScheduler::GetPriority(aria2_gid_t gid) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(gid);
+  return it == entries_.end() ? Priority::kNormal : it->second.priority;
+}
+
+void QueueScheduler::SetDeadline(aria2_gid_t gid, int64_t deadline) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  EntryLocked(gid).deadline = deadline;
+  if (policy_ == QueuePolicy::kEarliestDeadlineFirst) {
+    queue_dirty_ = true;
+  }
+}
+
+int QueueScheduler::SetPolicy(QueuePolicy policy) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  policy_ = policy;
+  if (policy == QueuePolicy::kShortestJobFirst) {
+    for (auto& item : entries_) {
+      if (item.second.size < 0) {
+        ProbeLocked(item.first, &item.second);
+      }
+    }
+  }
+  reorder_requested_ = true;
+  return ReorderCandidatesLocked();
+}
+
+QueuePolicy QueueScheduler::GetPolicy() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return policy_;
+}
+
+int QueueScheduler::Reorder() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  reorder_requested_ = true;
+  return ReorderCandidatesLocked();
+}
+
+int QueueScheduler::ReorderCandidatesLocked() const {
+  if (policy_ != QueuePolicy::kFifo) {
+    return static_cast<int>(entries_.size());
+  }
+  int count = 0;
+  for (const auto& item : entries_) {
+    if (item.second.priority != Priority::kNormal) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void QueueScheduler::ApplyRequestsLocked(aria2_session_t* session) {
+  for (aria2_gid_t gid : probe_) {
+    auto it = entries_.find(gid);
+    if (it != entries_.end()) {
+      prober_.Submit(gid, it->second.uris,
+                     SizeProber::ReadSettings(session, gid));
+    }
+  }
+  probe_.clear();
+  if (reorder_requested_) {
+    reorder_requested_ = false;
+    ReorderLocked(session);
+  }
+  if (promote_.empty()) {
+    return;
+  }
+  std::vector<aria2_gid_t> promote;
+  promote.swap(promote_);
+  for (aria2_gid_t gid : promote) {
+    auto it = entries_.find(gid);
+    if (it == entries_.end() || it->second.priority != Priority::kCritical) {
+      continue;
+    }
+    if (WaitingLocked(session, gid, &it->second)) {
+      aria2_change_position(session, gid, 0, OffsetMode(common::kOffsetSet));
+    }
+  }
+  PreemptLocked(session, CountWaitingCriticalLocked(session));
+}
+
+int QueueScheduler::ReorderLocked(aria2_session_t* session) {
+  std::vector<Candidate> head;
+  std::vector<Candidate> tail;
+  for (auto& item : entries_) {
+    const Priority priority = item.second.priority;
+    if (priority == Priority::kNormal && policy_ == QueuePolicy::kFifo) {
+      continue;
+    }
+    if (!WaitingLocked(session, item.first, &item.second)) {
+      continue;
+    }
+    (priority == Priority::kBackground ? tail : head)
+        .emplace_back(item.first, &item.second);
+  }
+  auto before = [this](const Candidate& a, const Candidate& b) {
+    return BeforeLocked(a, b);
+  };
+  std::sort(head.begin(), head.end(), before);
+  std::sort(tail.begin(), tail.end(), before);
+  queue_dirty_ = false;
+
+  int moved = 0;
+  for (size_t i = 0; i < head.size(); ++i) {
+    if (aria2_change_position(session, head[i].first, static_cast<int>(i),
+                              OffsetMode(common::kOffsetSet)) >= 0) {
+      ++moved;
+    }
+  }
+  // Moving each one to the end in sequence order keeps them FIFO at the tail.
+  for (const auto& item : tail) {
+    if (aria2_change_position(session, item.first, 0,
+                              OffsetMode(common::kOffsetEnd)) >= 0) {
+      ++moved;
+    }
+  }
+  if (policy_ != QueuePolicy::kFifo) {
+    total_policy_moves_ += moved;
+  }
+  return moved;
+}
+
+int QueueScheduler::ReorderHeadLocked(aria2_session_t* session) {
+  // Only the downloads aria2 will start next matter, so place the best
+  // max-concurrent-downloads candidates instead of re-sorting everything.
+  std::vector<Candidate> waiting;
+  for (auto& item : entries_) {
+    if (item.second.priority == Priority::kBackground) {
+      continue;
+    }
+    if (WaitingLocked(session, item.first, &item.second)) {
+      waiting.emplace_back(item.first, &item.second);
+    }
+  }
+  const size_t count = std::min(
+      waiting.size(),
+      static_cast<size_t>(std::max(1, common::GetGlobalOptionInt(
+                                          session, "max-concurrent-downloads",
+                                          kDefaultMaxConcurrent))));
+  std::partial_sort(waiting.begin(), waiting.begin() + count, waiting.end(),
+                    [this](const Candidate& a, const Candidate& b) {
+                      return BeforeLocked(a, b);
+                    });
+  int moved = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (aria2_change_position(session, waiting[i].first, static_cast<int>(i),
+                              OffsetMode(common::kOffsetSet)) >= 0) {
+      ++moved;
+    }
+  }
+  total_policy_moves_ += moved;
+  return moved;
+}
+
+void QueueScheduler::OnDownloadEvent(aria2_session_t* /*session*/,
+                                     aria2_download_event_t event,
+                                     aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(gid);
+  if (it == entries_.end()) {
+    return;
+  }
+  switch (event) {
+    case ARIA2_EVENT_ON_DOWNLOAD_START:
+      it->second.state = QueueState::kActive;
+      it->second.preempted = false;
+      break;
+    case ARIA2_EVENT_ON_DOWNLOAD_PAUSE:
+      it->second.state = QueueState::kPaused;
+      break;
+    case ARIA2_EVENT_ON_DOWNLOAD_STOP:
+    case ARIA2_EVENT_ON_DOWNLOAD_COMPLETE:
+    case ARIA2_EVENT_ON_DOWNLOAD_ERROR:
+      entries_.erase(it);
+      if (policy_ != QueuePolicy::kFifo) {
+        queue_dirty_ = true;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void QueueScheduler::OnTick(aria2_session_t* session) {
+  const auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(mutex_);
+  ApplyRequestsLocked(session);
+  if (entries_.empty() || now - last_tick_ < kTickInterval) {
+    return;
+  }
+  last_tick_ = now;
+  for (const auto& result : prober_.TakeResults()) {
+    auto it = entries_.find(result.first);
+    if (it == entries_.end()) {
+      continue;
+    }
+    it->second.probing = false;
+    it->second.uris.clear();
+    if (result.second >= 0) {
+      it->second.size = result.second;
+      queue_dirty_ = queue_dirty_ || policy_ == QueuePolicy::kShortestJobFirst;
+    }
+  }
+  const int demand = CountWaitingCriticalLocked(session);
+  if (demand > 0) {
+    PreemptLocked(session, demand);
+  } else {
+    ResumeLocked(session);
+  }
+  if (queue_dirty_ && policy_ != QueuePolicy::kFifo) {
+    queue_dirty_ = false;
+    ReorderHeadLocked(session);
+  }
+}
+
+QueueScheduler::Stats QueueScheduler::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats;
+  stats.tracked = static_cast<int>(entries_.size());
+  for (const auto& item : entries_) {
+    if (item.second.preempted) {
+      ++stats.preempted;
+    }
+  }
+  stats.total_preemptions = total_preemptions_;
+  stats.total_resumes = total_resumes_;
+  stats.total_policy_moves = total_policy_moves_;
+  return stats;
+}
+
+void QueueScheduler::Reset() {
+  prober_.Stop();
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  next_seq_ = 0;
+  policy_ = QueuePolicy::kFifo;
+  queue_dirty_ = false;
+  reorder_requested_ = false;
+  promote_.clear();
+  probe_.clear();
+  total_preemptions_ = 0;
+  total_resumes_ = 0;
+  total_policy_moves_ = 0;
+}
+
+QueueScheduler::Entry& QueueScheduler::EntryLocked(aria2_gid_t gid) {
+  auto inserted = entries_.emplace(gid, Entry());
+  Entry& entry = inserted.first->second;
+  if (inserted.second) {
+    entry.seq = next_seq_++;
+  }
+  return entry;
+}
+
+bool QueueScheduler::WaitingLocked(aria2_session_t* session, aria2_gid_t gid,
+                                   Entry* entry) const {
+  if (entry->state == QueueState::kPaused) {
+    RefreshLocked(session, gid, entry);
+  }
+  return entry->state == QueueState::kWaiting;
+}
+
+void QueueScheduler::RefreshLocked(aria2_session_t* session, aria2_gid_t gid,
+                                   Entry* entry) const {
+  switch (common::GetDownloadStatus(session, gid)) {
+    case common::kStatusWaiting:
+      entry->state = QueueState::kWaiting;
+      break;
+    case common::kStatusActive:
+      entry->state = QueueState::kActive;
+      break;
+    default:
+      entry->state = QueueState::kPaused;
+      break;
+  }
+}
+
+void QueueScheduler::ProbeLocked(aria2_gid_t gid, Entry* entry) {
+  if (entry->probing || entry->uris.empty()) {
+    return;
+  }
+  entry->probing = true;
+  probe_.push_back(gid);
+}
+
+int64_t QueueScheduler::PolicyKeyLocked(const Entry& entry) const {
+  constexpr int64_t kUnknown = std::numeric_limits<int64_t>::max();
+  switch (policy_) {
+    case QueuePolicy::kShortestJobFirst:
+      return entry.size >= 0 ? entry.size : kUnknown;
+    case QueuePolicy::kEarliestDeadlineFirst:
+      return entry.deadline >= 0 ? entry.deadline : kUnknown;
+    case QueuePolicy::kFifo:
+      break;
+  }
+  return 0;
+}
+
+bool QueueScheduler::BeforeLocked(const Candidate& a,
+                                  const Candidate& b) const {
+  if (a.second->priority != b.second->priority) {
+    return a.second->priority < b.second->priority;
+  }
+  const int64_t key_a = PolicyKeyLocked(*a.second);
+  const int64_t key_b = PolicyKeyLocked(*b.second);
+  if (key_a != key_b) {
+    return key_a < key_b;
+  }
+  return a.second->seq < b.second->seq;
+}
+
+int QueueScheduler::CountWaitingCriticalLocked(aria2_session_t* session) {
+  int count = 0;
+  for (auto& item : entries_) {
+    Entry& entry = item.second;
+    if (entry.priority != Priority::kCritical ||
+        entry.state == QueueState::kActive) {
+      continue;
+    }
+    // Pausing a waiting download has no event, and a stale waiting
+    // critical download would keep background ones preempted.
+    RefreshLocked(session, item.first, &entry);
+    if (entry.state == QueueState::kWaiting) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void QueueScheduler::PreemptLocked(aria2_session_t* session, int demand) {
+  if (demand <= 0) {
+    return;
+  }
+  const std::vector<aria2_gid_t> active = ActiveGids(session);
+  const int max_concurrent = common::GetGlobalOptionInt(
+      session, "max-concurrent-downloads", kDefaultMaxConcurrent);
+  int need = demand - (max_concurrent - static_cast<int>(active.size()));
+
+  std::vector<std::pair<uint64_t, aria2_gid_t>> victims;
+  for (aria2_gid_t gid : active) {
+    auto it = entries_.find(gid);
+    if (it == entries_.end() || it->second.priority != Priority::kBackground) {
+      continue;
+    }
+    if (it->second.preempted) {
+      // Already asked to pause but still winding down; its slot is coming.
+      --need;
+      continue;
+    }
+    victims.emplace_back(it->second.seq, gid);
+  }
+  if (need <= 0) {
+    return;
+  }
+  // Newest background downloads lose their slot first.
+  std::sort(victims.rbegin(), victims.rend());
+  for (const auto& victim : victims) {
+    if (need <= 0) {
+      break;
+    }
+    if (aria2_pause_download(session, victim.second, 0) == 0) {
+      entries_[victim.second].preempted = true;
+      ++total_preemptions_;
+      --need;
+    }
+  }
+}
+
+void QueueScheduler::ResumeLocked(aria2_session_t* session) {
+  std::vector<std::pair<uint64_t, aria2_gid_t>> preempted;
+  for (const auto& item : entries_) {
+    if (item.second.preempted) {
+      preempted.emplace_back(item.second.seq, item.first);
+    }
+  }
+  if (preempted.empty()) {
+    return;
+  }
+  const int max_concurrent = common::GetGlobalOptionInt(
+      session, "max-concurrent-downloads", kDefaultMaxConcurrent);
+  int free_slots = max_concurrent - static_cast<int>(ActiveGids(session).size());
+  std::sort(preempted.begin(), preempted.end());
+  for (const auto& item : preempted) {
+    if (free_slots <= 0) {
+      break;
+    }
+    if (aria2_unpause_download(session, item.second) == 0) {
+      Entry& entry = entries_[item.second];
+      entry.preempted = false;
+      entry.state = QueueState::kWaiting;
+      ++total_resumes_;
+      --free_slots;
+    }
+  }
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
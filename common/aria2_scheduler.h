@@ -0,0 +1,168 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_SCHEDULER_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_SCHEDULER_H_
+
+#include <aria2_c_api.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "aria2_probe.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// Priority classes, in the order of the Dart `Aria2Priority` enum.
+enum class Priority {
+  kCritical = 0,
+  kHigh = 1,
+  kNormal = 2,
+  kBackground = 3,
+};
+
+bool PriorityFromInt(int64_t value, Priority* out);
+
+// Order of waiting downloads inside a priority class, in the order of the
+// Dart `Aria2QueuePolicy` enum.
+enum class QueuePolicy {
+  kFifo = 0,
+  kShortestJobFirst = 1,
+  kEarliestDeadlineFirst = 2,
+};
+
+bool QueuePolicyFromInt(int64_t value, QueuePolicy* out);
+
+// What the plugin knows about a download when it is added.
+struct DownloadHints {
+  int64_t size = -1;      // Total length in bytes, -1 when unknown.
+  int64_t deadline = -1;  // Milliseconds since the epoch, -1 for none.
+  std::vector<std::string> uris;  // Candidates for size probing.
+  std::vector<std::pair<std::string, std::string>> options;  // As added.
+};
+
+// Native priority classes and queue policies on top of aria2's FIFO waiting
+// queue.
+//
+// Critical downloads preempt background ones: when no slot under
+// max-concurrent-downloads is free, active background downloads are paused
+// and are unpaused again once no critical download is left waiting. Within a
+// class, waiting downloads are ordered by the active QueuePolicy; with a
+// non-FIFO policy the head of the queue is re-evaluated on the tick after a
+// download finishes or is added, so only the next few starts get moved.
+//
+// Whether a download is waiting is read from aria2 once when it is tracked
+// and then followed through its start and pause events. Only paused
+// downloads, which aria2 unpauses without an event, and critical ones,
+// which it can pause while waiting without one, are read again.
+//
+// aria2 is only called from OnTick, on the thread driving aria2_run. The
+// method-thread entry points (Track, SetPriority, SetPolicy, Reorder) only
+// update the entries and queue the moves they imply for the next tick;
+// aria2 does not start a queued download before that tick anyway.
+class QueueScheduler {
+ public:
+  struct Stats {
+    int tracked = 0;
+    int preempted = 0;
+    int64_t total_preemptions = 0;
+    int64_t total_resumes = 0;
+    int64_t total_policy_moves = 0;
+  };
+
+  // Starts tracking a newly added download. With shortest-job-first active,
+  // an unknown size is probed from |hints.uris| in the background, starting
+  // on the next tick.
+  void Track(aria2_gid_t gid, Priority priority, DownloadHints hints);
+
+  // Records |gid| with |priority|; on the next tick a critical download
+  // moves to the head of the waiting queue and preempts background downloads
+  // if needed.
+  void SetPriority(aria2_gid_t gid, Priority priority);
+
+  // Sets or clears (-1) the deadline used by earliest-deadline-first.
+  void SetDeadline(aria2_gid_t gid, int64_t deadline);
+
+  // Switches the policy and reorders the whole waiting queue once on the next
+  // tick. Returns the number of tracked downloads that reorder will place.
+  int SetPolicy(QueuePolicy policy);
+  QueuePolicy GetPolicy() const;
+
+  // Untracked downloads report Priority::kNormal.
+  Priority GetPriority(aria2_gid_t gid) const;
+
+  // On the next tick, moves waiting critical/high downloads to the queue head
+  // and background downloads to its tail in a single pass; with FIFO, normal
+  // downloads keep their relative order, otherwise they are sorted by the
+  // policy right after the high ones. Returns the number of tracked downloads
+  // that pass will place.
+  int Reorder();
+
+  void OnDownloadEvent(aria2_session_t* session, aria2_download_event_t event,
+                       aria2_gid_t gid);
+  void OnTick(aria2_session_t* session);
+
+  Stats GetStats() const;
+  void Reset();
+
+ private:
+  enum class QueueState {
+    kWaiting,
+    kActive,
+    kPaused,  // Or not known yet; read from aria2 when it matters.
+  };
+
+  struct Entry {
+    Priority priority = Priority::kNormal;
+    QueueState state = QueueState::kPaused;
+    uint64_t seq = 0;
+    bool preempted = false;
+    int64_t size = -1;
+    int64_t deadline = -1;
+    bool probing = false;
+    std::vector<std::string> uris;
+  };
+
+  using Candidate = std::pair<aria2_gid_t, const Entry*>;
+
+  // New entries start in the unknown state and are read on the next tick.
+  Entry& EntryLocked(aria2_gid_t gid);
+  // Whether |entry| is in aria2's waiting queue; re-reads paused entries.
+  bool WaitingLocked(aria2_session_t* session, aria2_gid_t gid,
+                     Entry* entry) const;
+  void RefreshLocked(aria2_session_t* session, aria2_gid_t gid,
+                     Entry* entry) const;
+  void ProbeLocked(aria2_gid_t gid, Entry* entry);
+  int64_t PolicyKeyLocked(const Entry& entry) const;
+  bool BeforeLocked(const Candidate& a, const Candidate& b) const;
+  int ReorderCandidatesLocked() const;
+  void ApplyRequestsLocked(aria2_session_t* session);
+  int ReorderLocked(aria2_session_t* session);
+  int ReorderHeadLocked(aria2_session_t* session);
+  int CountWaitingCriticalLocked(aria2_session_t* session);
+  void PreemptLocked(aria2_session_t* session, int demand);
+  void ResumeLocked(aria2_session_t* session);
+
+  mutable std::mutex mutex_;
+  std::unordered_map<aria2_gid_t, Entry> entries_;
+  uint64_t next_seq_ = 0;
+  QueuePolicy policy_ = QueuePolicy::kFifo;
+  bool queue_dirty_ = false;
+  bool reorder_requested_ = false;
+  std::vector<aria2_gid_t> promote_;  // Critical downloads to move to the head.
+  // Downloads to probe on the next tick, where their options can be read.
+  std::vector<aria2_gid_t> probe_;
+  int64_t total_preemptions_ = 0;
+  int64_t total_resumes_ = 0;
+  int64_t total_policy_moves_ = 0;
+  std::chrono::steady_clock::time_point last_tick_;
+  SizeProber prober_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_SCHEDULER_H_
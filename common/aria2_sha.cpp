@@ -0,0 +1,426 @@
+#include "aria2_sha.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+#define FLUTTER_ARIA2_SHA_NI 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define FLUTTER_ARIA2_TARGET_SHA
+#else
+#include <cpuid.h>
+#define FLUTTER_ARIA2_TARGET_SHA __attribute__((target("sha,sse4.1")))
+#endif
+#endif
+
+namespace flutter_aria2 {
+namespace common {
+
+namespace {
+alignas(16) constexpr uint32_t kSha256Rounds[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+using BlockKernel = void (*)(uint32_t* state, const uint8_t* data,
+                             size_t blocks);
+
+inline uint32_t RotateRight(uint32_t value, int bits) {
+  return (value >> bits) | (value << (32 - bits));
+}
+
+inline uint32_t LoadBigEndian(const uint8_t* data) {
+  return (static_cast<uint32_t>(data[0]) << 24) |
+         (static_cast<uint32_t>(data[1]) << 16) |
+         (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+}
+
+void Sha1PortableBlocks(uint32_t* state, const uint8_t* data, size_t blocks) {
+  uint32_t w[80];
+  for (; blocks > 0; --blocks, data += 64) {
+    for (int i = 0; i < 16; ++i) {
+      w[i] = LoadBigEndian(data + i * 4);
+    }
+    for (int i = 16; i < 80; ++i) {
+      w[i] = RotateRight(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 31);
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4];
+    auto round = [&](int i, uint32_t f, uint32_t k) {
+      const uint32_t t = RotateRight(a, 27) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = RotateRight(b, 2);
+      b = a;
+      a = t;
+    };
+    for (int i = 0; i < 20; ++i) {
+      round(i, d ^ (b & (c ^ d)), 0x5a827999);
+    }
+    for (int i = 20; i < 40; ++i) {
+      round(i, b ^ c ^ d, 0x6ed9eba1);
+    }
+    for (int i = 40; i < 60; ++i) {
+      round(i, (b & c) | (d & (b | c)), 0x8f1bbcdc);
+    }
+    for (int i = 60; i < 80; ++i) {
+      round(i, b ^ c ^ d, 0xca62c1d6);
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+  }
+}
+
+void Sha256PortableBlocks(uint32_t* state, const uint8_t* data, size_t blocks) {
+  uint32_t w[64];
+  for (; blocks > 0; --blocks, data += 64) {
+    for (int i = 0; i < 16; ++i) {
+      w[i] = LoadBigEndian(data + i * 4);
+    }
+    for (int i = 16; i < 64; ++i) {
+      const uint32_t s0 = RotateRight(w[i - 15], 7) ^
+                          RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      const uint32_t s1 = RotateRight(w[i - 2], 17) ^
+                          RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+      const uint32_t s1 =
+          RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+      const uint32_t choose = (e & f) ^ (~e & g);
+      const uint32_t t1 = h + s1 + choose + kSha256Rounds[i] + w[i];
+      const uint32_t s0 =
+          RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+      const uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + s0 + majority;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+  }
+}
+
+#ifdef FLUTTER_ARIA2_SHA_NI
+// SHA-1 rounds 4g..4g+3 on the SHA extensions. |e| takes the next four
+// message words and |e_next| the state needed by the following group; the
+// schedule finishes |next| (W[g + 1]) and advances |after| and |previous|.
+template <int kGroup>
+FLUTTER_ARIA2_TARGET_SHA inline void Sha1NiGroup(
+    __m128i* abcd, __m128i* e, __m128i* e_next, const __m128i& current,
+    __m128i* next, __m128i* after, __m128i* previous) {
+  if (kGroup == 0) {
+    *e = _mm_add_epi32(*e, current);
+  } else {
+    *e = _mm_sha1nexte_epu32(*e, current);
+  }
+  *e_next = *abcd;
+  if (kGroup >= 3 && kGroup <= 18) {
+    *next = _mm_sha1msg2_epu32(*next, current);
+  }
+  *abcd = _mm_sha1rnds4_epu32(*abcd, *e, kGroup / 5);
+  if (kGroup >= 1 && kGroup <= 16) {
+    *previous = _mm_sha1msg1_epu32(*previous, current);
+  }
+  if (kGroup >= 2 && kGroup <= 17) {
+    *after = _mm_xor_si128(*after, current);
+  }
+}
+
+FLUTTER_ARIA2_TARGET_SHA
+void Sha1NiBlocks(uint32_t* state, const uint8_t* data, size_t blocks) {
+  const __m128i byte_swap =
+      _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+  __m128i abcd = _mm_shuffle_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1b);
+  __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+  __m128i e1;
+
+  for (; blocks > 0; --blocks, data += 64) {
+    const __m128i abcd_saved = abcd;
+    const __m128i e_saved = e0;
+    const auto* words = reinterpret_cast<const __m128i*>(data);
+    __m128i w0 = _mm_shuffle_epi8(_mm_loadu_si128(words), byte_swap);
+    __m128i w1 = _mm_shuffle_epi8(_mm_loadu_si128(words + 1), byte_swap);
+    __m128i w2 = _mm_shuffle_epi8(_mm_loadu_si128(words + 2), byte_swap);
+    __m128i w3 = _mm_shuffle_epi8(_mm_loadu_si128(words + 3), byte_swap);
+    Sha1NiGroup<0>(&abcd, &e0, &e1, w0, &w1, &w2, &w3);
+    Sha1NiGroup<1>(&abcd, &e1, &e0, w1, &w2, &w3, &w0);
+    Sha1NiGroup<2>(&abcd, &e0, &e1, w2, &w3, &w0, &w1);
+    Sha1NiGroup<3>(&abcd, &e1, &e0, w3, &w0, &w1, &w2);
+    Sha1NiGroup<4>(&abcd, &e0, &e1, w0, &w1, &w2, &w3);
+    Sha1NiGroup<5>(&abcd, &e1, &e0, w1, &w2, &w3, &w0);
+    Sha1NiGroup<6>(&abcd, &e0, &e1, w2, &w3, &w0, &w1);
+    Sha1NiGroup<7>(&abcd, &e1, &e0, w3, &w0, &w1, &w2);
+    Sha1NiGroup<8>(&abcd, &e0, &e1, w0, &w1, &w2, &w3);
+    Sha1NiGroup<9>(&abcd, &e1, &e0, w1, &w2, &w3, &w0);
+    Sha1NiGroup<10>(&abcd, &e0, &e1, w2, &w3, &w0, &w1);
+    Sha1NiGroup<11>(&abcd, &e1, &e0, w3, &w0, &w1, &w2);
+    Sha1NiGroup<12>(&abcd, &e0, &e1, w0, &w1, &w2, &w3);
+    Sha1NiGroup<13>(&abcd, &e1, &e0, w1, &w2, &w3, &w0);
+    Sha1NiGroup<14>(&abcd, &e0, &e1, w2, &w3, &w0, &w1);
+    Sha1NiGroup<15>(&abcd, &e1, &e0, w3, &w0, &w1, &w2);
+    Sha1NiGroup<16>(&abcd, &e0, &e1, w0, &w1, &w2, &w3);
+    Sha1NiGroup<17>(&abcd, &e1, &e0, w1, &w2, &w3, &w0);
+    Sha1NiGroup<18>(&abcd, &e0, &e1, w2, &w3, &w0, &w1);
+    Sha1NiGroup<19>(&abcd, &e1, &e0, w3, &w0, &w1, &w2);
+    e0 = _mm_sha1nexte_epu32(e0, e_saved);
+    abcd = _mm_add_epi32(abcd, abcd_saved);
+  }
+
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state),
+                   _mm_shuffle_epi32(abcd, 0x1b));
+  state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+// SHA-256 rounds 4i..4i+3 on the SHA extensions. Message words are scheduled one
+// group ahead: group i finishes |next| (W[i + 1]) and starts |previous|
+// (W[i - 1]).
+FLUTTER_ARIA2_TARGET_SHA
+inline void Sha256NiGroup(int i, __m128i* state0, __m128i* state1,
+                       const __m128i& current, __m128i* next,
+                       __m128i* previous) {
+  __m128i msg = _mm_add_epi32(
+      current, _mm_load_si128(
+                   reinterpret_cast<const __m128i*>(&kSha256Rounds[i * 4])));
+  *state1 = _mm_sha256rnds2_epu32(*state1, *state0, msg);
+  if (i >= 3 && i <= 14) {
+    *next = _mm_add_epi32(*next, _mm_alignr_epi8(current, *previous, 4));
+    *next = _mm_sha256msg2_epu32(*next, current);
+  }
+  msg = _mm_shuffle_epi32(msg, 0x0e);
+  *state0 = _mm_sha256rnds2_epu32(*state0, *state1, msg);
+  if (i >= 1 && i <= 12) {
+    *previous = _mm_sha256msg1_epu32(*previous, current);
+  }
+}
+
+FLUTTER_ARIA2_TARGET_SHA
+void Sha256NiBlocks(uint32_t* state, const uint8_t* data, size_t blocks) {
+  const __m128i byte_swap =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+  __m128i state1 =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+  tmp = _mm_shuffle_epi32(tmp, 0xb1);        // CDAB
+  state1 = _mm_shuffle_epi32(state1, 0x1b);  // EFGH
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);  // ABEF
+  state1 = _mm_blend_epi16(state1, tmp, 0xf0);       // CDGH
+
+  for (; blocks > 0; --blocks, data += 64) {
+    const __m128i abef = state0;
+    const __m128i cdgh = state1;
+    const auto* words = reinterpret_cast<const __m128i*>(data);
+    __m128i w0 = _mm_shuffle_epi8(_mm_loadu_si128(words), byte_swap);
+    __m128i w1 = _mm_shuffle_epi8(_mm_loadu_si128(words + 1), byte_swap);
+    __m128i w2 = _mm_shuffle_epi8(_mm_loadu_si128(words + 2), byte_swap);
+    __m128i w3 = _mm_shuffle_epi8(_mm_loadu_si128(words + 3), byte_swap);
+    // Spelled out so that every group is inlined with a constant index.
+    Sha256NiGroup(0, &state0, &state1, w0, &w1, &w3);
+    Sha256NiGroup(1, &state0, &state1, w1, &w2, &w0);
+    Sha256NiGroup(2, &state0, &state1, w2, &w3, &w1);
+    Sha256NiGroup(3, &state0, &state1, w3, &w0, &w2);
+    Sha256NiGroup(4, &state0, &state1, w0, &w1, &w3);
+    Sha256NiGroup(5, &state0, &state1, w1, &w2, &w0);
+    Sha256NiGroup(6, &state0, &state1, w2, &w3, &w1);
+    Sha256NiGroup(7, &state0, &state1, w3, &w0, &w2);
+    Sha256NiGroup(8, &state0, &state1, w0, &w1, &w3);
+    Sha256NiGroup(9, &state0, &state1, w1, &w2, &w0);
+    Sha256NiGroup(10, &state0, &state1, w2, &w3, &w1);
+    Sha256NiGroup(11, &state0, &state1, w3, &w0, &w2);
+    Sha256NiGroup(12, &state0, &state1, w0, &w1, &w3);
+    Sha256NiGroup(13, &state0, &state1, w1, &w2, &w0);
+    Sha256NiGroup(14, &state0, &state1, w2, &w3, &w1);
+    Sha256NiGroup(15, &state0, &state1, w3, &w0, &w2);
+    state0 = _mm_add_epi32(state0, abef);
+    state1 = _mm_add_epi32(state1, cdgh);
+  }
+
+  tmp = _mm_shuffle_epi32(state0, 0x1b);        // FEBA
+  state1 = _mm_shuffle_epi32(state1, 0xb1);     // DCHG
+  state0 = _mm_blend_epi16(tmp, state1, 0xf0);  // DCBA
+  state1 = _mm_alignr_epi8(state1, tmp, 8);     // ABEF
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+bool CpuHasShaNi() {
+#ifdef _MSC_VER
+  int regs[4];
+  __cpuid(regs, 0);
+  if (regs[0] < 7) {
+    return false;
+  }
+  __cpuid(regs, 1);
+  const bool sse41 = (regs[2] & (1 << 19)) != 0;
+  __cpuidex(regs, 7, 0);
+  return sse41 && (regs[1] & (1 << 29)) != 0;
+#else
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || (ecx & bit_SSE4_1) == 0) {
+    return false;
+  }
+  return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+         (ebx & (1u << 29)) != 0;
+#endif
+}
+#endif
+
+std::atomic<bool> force_portable_sha{false};
+
+bool UseShaNi() {
+#ifdef FLUTTER_ARIA2_SHA_NI
+  static const bool available = CpuHasShaNi();
+  return available && !force_portable_sha.load(std::memory_order_relaxed);
+#else
+  return false;
+#endif
+}
+
+BlockKernel Sha1Blocks() {
+#ifdef FLUTTER_ARIA2_SHA_NI
+  if (UseShaNi()) {
+    return &Sha1NiBlocks;
+  }
+#endif
+  return &Sha1PortableBlocks;
+}
+
+BlockKernel Sha256Blocks() {
+#ifdef FLUTTER_ARIA2_SHA_NI
+  if (UseShaNi()) {
+    return &Sha256NiBlocks;
+  }
+#endif
+  return &Sha256PortableBlocks;
+}
+
+// Runs the whole 64-byte blocks of |data| through |blocks|, carrying the
+// rest over in |buffer|.
+void Absorb(BlockKernel blocks, uint32_t* state, uint8_t* buffer,
+            size_t* buffered, const uint8_t* data, size_t size) {
+  if (*buffered > 0) {
+    const size_t take = std::min(size, 64 - *buffered);
+    std::memcpy(buffer + *buffered, data, take);
+    *buffered += take;
+    data += take;
+    size -= take;
+    if (*buffered < 64) {
+      return;
+    }
+    blocks(state, buffer, 1);
+    *buffered = 0;
+  }
+  if (size >= 64) {
+    blocks(state, data, size / 64);
+    data += size & ~static_cast<size_t>(63);
+    size &= 63;
+  }
+  std::memcpy(buffer, data, size);
+  *buffered = size;
+}
+
+// Appends the padding and the big-endian bit length.
+void Pad(BlockKernel blocks, uint32_t* state, uint8_t* buffer,
+         size_t* buffered, uint64_t length) {
+  const uint64_t bits = length * 8;
+  uint8_t tail[128] = {0x80};
+  const size_t pad = (*buffered < 56 ? 56 : 120) - *buffered;
+  for (int i = 0; i < 8; ++i) {
+    tail[pad + i] = static_cast<uint8_t>(bits >> (56 - i * 8));
+  }
+  Absorb(blocks, state, buffer, buffered, tail, pad + 8);
+}
+}  // namespace
+
+void ForcePortableShaKernels(bool force) {
+  force_portable_sha.store(force, std::memory_order_relaxed);
+}
+
+void Sha1::Reset() {
+  static const uint32_t kInitial[5] = {0x67452301, 0xefcdab89, 0x98badcfe,
+                                       0x10325476, 0xc3d2e1f0};
+  std::memcpy(state_, kInitial, sizeof(state_));
+  length_ = 0;
+  buffered_ = 0;
+}
+
+void Sha1::Update(const void* data, size_t size) {
+  length_ += size;
+  Absorb(Sha1Blocks(), state_, buffer_, &buffered_,
+         static_cast<const uint8_t*>(data), size);
+}
+
+void Sha1::Digest(uint8_t out[kDigestSize]) {
+  Pad(Sha1Blocks(), state_, buffer_, &buffered_, length_);
+  for (int i = 0; i < 5; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      out[i * 4 + j] = static_cast<uint8_t>(state_[i] >> (24 - j * 8));
+    }
+  }
+}
+
+const char* Sha1::Kernel() { return UseShaNi() ? "sha-ni" : "portable"; }
+
+void Sha256::Reset() {
+  static const uint32_t kInitial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                       0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                       0x1f83d9ab, 0x5be0cd19};
+  std::memcpy(state_, kInitial, sizeof(state_));
+  length_ = 0;
+  buffered_ = 0;
+}
+
+void Sha256::Update(const void* data, size_t size) {
+  length_ += size;
+  Absorb(Sha256Blocks(), state_, buffer_, &buffered_,
+         static_cast<const uint8_t*>(data), size);
+}
+
+std::string Sha256::HexDigest() {
+  Pad(Sha256Blocks(), state_, buffer_, &buffered_, length_);
+
+  static const char kHex[] = "0123456789abcdef";
+  std::string out(64, '0');
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      const uint8_t byte = static_cast<uint8_t>(state_[i] >> (24 - j * 8));
+      out[i * 8 + j * 2] = kHex[byte >> 4];
+      out[i * 8 + j * 2 + 1] = kHex[byte & 0xf];
+    }
+  }
+  return out;
+}
+
+const char* Sha256::Kernel() { return UseShaNi() ? "sha-ni" : "portable"; }
+
+}  // namespace common
+}  // namespace flutter_aria2
@@ -0,0 +1,63 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_SHA_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_SHA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace flutter_aria2 {
+namespace common {
+
+// Incremental SHA-1 and SHA-256. Whole blocks go through the SHA extensions
+// on x86 CPUs that have them (picked at run time) and a portable kernel
+// elsewhere.
+
+// Makes both hashes use the portable kernel from now on even where the SHA
+// extensions are available, so tests can check it against them.
+void ForcePortableShaKernels(bool force);
+
+class Sha1 {
+ public:
+  static constexpr size_t kDigestSize = 20;
+
+  Sha1() { Reset(); }
+
+  void Reset();
+  void Update(const void* data, size_t size);
+  // Finishes the digest into |out|. Call Reset before hashing again.
+  void Digest(uint8_t out[kDigestSize]);
+
+  // "sha-ni" or "portable".
+  static const char* Kernel();
+
+ private:
+  uint32_t state_[5];
+  uint64_t length_ = 0;
+  uint8_t buffer_[64];
+  size_t buffered_ = 0;
+};
+
+class Sha256 {
+ public:
+  Sha256() { Reset(); }
+
+  void Reset();
+  void Update(const void* data, size_t size);
+  // Finishes the digest and returns it as lower-case hex. Call Reset before
+  // hashing again.
+  std::string HexDigest();
+
+  // "sha-ni" or "portable".
+  static const char* Kernel();
+
+ private:
+  uint32_t state_[8];
+  uint64_t length_ = 0;
+  uint8_t buffer_[64];
+  size_t buffered_ = 0;
+};
+
+}  // namespace common
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_SHA_H_
@@ -0,0 +1,263 @@
+#include "aria2_speed.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+std::vector<aria2_gid_t> SampledGids(aria2_session_t* session) {
+  std::vector<aria2_gid_t> out;
+  aria2_gid_t* gids = nullptr;
+  size_t count = 0;
+  if (aria2_get_active_download(session, &gids, &count) == 0 && gids != nullptr) {
+    out.assign(gids, gids + count);
+  }
+  if (gids != nullptr) {
+    aria2_free(gids);
+  }
+  return out;
+}
+
+int64_t WallClockMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+SpeedEstimate EstimateFromSpeed(int64_t avg_speed, int64_t total_length,
+                                int64_t completed_length) {
+  SpeedEstimate out;
+  out.avg_speed = avg_speed;
+  const int64_t remaining = total_length - completed_length;
+  if (total_length > 0 && remaining <= 0) {
+    out.eta_seconds = 0;
+  } else if (total_length > 0 && avg_speed > 0) {
+    out.eta_seconds = (remaining + avg_speed - 1) / avg_speed;
+  }
+  return out;
+}
+}  // namespace
+
+bool SpeedHistory::SetPolicy(const SpeedHistoryPolicy& policy,
+                             std::string* error) {
+  if (policy.interval_ms < kMinSpeedIntervalMs) {
+    *error = "intervalMs must be at least " +
+             std::to_string(kMinSpeedIntervalMs);
+    return false;
+  }
+  if (policy.samples < 2 || policy.samples > kMaxSpeedSamples) {
+    *error = "samples must be within [2, " + std::to_string(kMaxSpeedSamples) +
+             "]";
+    return false;
+  }
+  if (policy.smoothing_ms <= 0) {
+    *error = "smoothingMs must be positive";
+    return false;
+  }
+  if (policy.max_downloads < 1 || policy.max_downloads > kMaxSpeedDownloads) {
+    *error = "maxDownloads must be within [1, " +
+             std::to_string(kMaxSpeedDownloads) + "]";
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (policy.samples != policy_.samples ||
+      policy.max_downloads != policy_.max_downloads) {
+    ClearLocked();
+  }
+  policy_ = policy;
+  return true;
+}
+
+SpeedHistoryPolicy SpeedHistory::GetPolicy() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return policy_;
+}
+
+size_t SpeedHistory::AcquireLocked(aria2_gid_t gid) {
+  auto it = index_.find(gid);
+  if (it != index_.end()) {
+    return it->second;
+  }
+  const size_t capacity = static_cast<size_t>(policy_.max_downloads);
+  if (free_slots_.empty() && slots_.size() < capacity) {
+    const size_t old_count = slots_.size();
+    const size_t new_count =
+        std::min(capacity, std::max<size_t>(8, old_count * 2));
+    slab_.resize(new_count * static_cast<size_t>(policy_.samples));
+    slots_.resize(new_count);
+    for (size_t i = new_count; i > old_count; --i) {
+      free_slots_.push_back(i - 1);
+    }
+  }
+  if (free_slots_.empty()) {
+    size_t victim = kNoSlot;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+      if (slots_[i].active) {
+        continue;
+      }
+      if (victim == kNoSlot ||
+          LastLocked(i).time_ms < LastLocked(victim).time_ms) {
+        victim = i;
+      }
+    }
+    if (victim == kNoSlot) {
+      return kNoSlot;
+    }
+    index_.erase(slots_[victim].gid);
+    free_slots_.push_back(victim);
+  }
+  const size_t index = free_slots_.back();
+  free_slots_.pop_back();
+  slots_[index] = Slot();
+  slots_[index].gid = gid;
+  index_[gid] = index;
+  return index;
+}
+
+const SpeedHistory::Sample& SpeedHistory::LastLocked(size_t index) const {
+  const size_t samples = static_cast<size_t>(policy_.samples);
+  const Slot& slot = slots_[index];
+  return slab_[index * samples + (slot.head + samples - 1) % samples];
+}
+
+void SpeedHistory::OnTick(aria2_session_t* session) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto now = std::chrono::steady_clock::now();
+  if (now - last_tick_ < std::chrono::milliseconds(policy_.interval_ms)) {
+    return;
+  }
+  last_tick_ = now;
+  const std::vector<aria2_gid_t> gids = SampledGids(session);
+  // Mark first, so the active downloads' slots are not reclaimed below.
+  for (Slot& slot : slots_) {
+    slot.active = false;
+  }
+  for (aria2_gid_t gid : gids) {
+    auto it = index_.find(gid);
+    if (it != index_.end()) {
+      slots_[it->second].active = true;
+    }
+  }
+  const int64_t now_ms = WallClockMs();
+  const size_t samples = static_cast<size_t>(policy_.samples);
+  for (aria2_gid_t gid : gids) {
+    aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+    if (handle == nullptr) {
+      continue;
+    }
+    Sample sample;
+    sample.time_ms = now_ms;
+    sample.completed = aria2_download_handle_get_completed_length(handle);
+    sample.speed = aria2_download_handle_get_download_speed(handle);
+    const int64_t total_length = aria2_download_handle_get_total_length(handle);
+    aria2_delete_download_handle(handle);
+
+    const size_t index = AcquireLocked(gid);
+    if (index == kNoSlot) {
+      continue;
+    }
+    Slot& slot = slots_[index];
+    if (slot.count == 0) {
+      slot.avg_speed = static_cast<double>(sample.speed);
+    } else {
+      const double dt = static_cast<double>(
+          std::max<int64_t>(0, now_ms - LastLocked(index).time_ms));
+      const double alpha =
+          1 - std::exp(-dt / static_cast<double>(policy_.smoothing_ms));
+      slot.avg_speed += alpha * (static_cast<double>(sample.speed) -
+                                 slot.avg_speed);
+    }
+    slot.active = true;
+    slot.total_length = total_length;
+    slab_[index * samples + slot.head] = sample;
+    slot.head = (slot.head + 1) % samples;
+    slot.count = std::min(slot.count + 1, samples);
+  }
+}
+
+SpeedEstimate SpeedHistory::Estimate(aria2_gid_t gid, int64_t total_length,
+                                     int64_t completed_length,
+                                     int64_t instant_speed) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(gid);
+  if (it == index_.end()) {
+    return EstimateFromSpeed(instant_speed, total_length, completed_length);
+  }
+  const Slot& slot = slots_[it->second];
+  return EstimateFromSpeed(
+      slot.active ? std::llround(slot.avg_speed) : 0, total_length,
+      completed_length);
+}
+
+bool SpeedHistory::Query(aria2_gid_t gid, common::Value* out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(gid);
+  if (it == index_.end()) {
+    return false;
+  }
+  const size_t index = it->second;
+  const Slot& slot = slots_[index];
+  const size_t samples = static_cast<size_t>(policy_.samples);
+  const SpeedEstimate estimate = EstimateFromSpeed(
+      slot.active ? std::llround(slot.avg_speed) : 0, slot.total_length,
+      LastLocked(index).completed);
+  common::Value timestamps = common::Value::NewList();
+  common::Value completed = common::Value::NewList();
+  common::Value speeds = common::Value::NewList();
+  for (size_t i = 0; i < slot.count; ++i) {
+    const Sample& sample =
+        slab_[index * samples + (slot.head + samples - slot.count + i) %
+                                    samples];
+    timestamps.Append(sample.time_ms);
+    completed.Append(sample.completed);
+    speeds.Append(sample.speed);
+  }
+  *out = common::Value::NewMap();
+  out->Set("intervalMs", policy_.interval_ms);
+  out->Set("avgSpeed", estimate.avg_speed);
+  out->Set("eta", estimate.eta_seconds);
+  out->Set("timestamps", std::move(timestamps));
+  out->Set("completed", std::move(completed));
+  out->Set("speeds", std::move(speeds));
+  return true;
+}
+
+void SpeedHistory::Forget(aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(gid);
+  if (it == index_.end()) {
+    return;
+  }
+  free_slots_.push_back(it->second);
+  index_.erase(it);
+}
+
+common::Value SpeedHistory::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewMap();
+  out.Set("intervalMs", policy_.interval_ms);
+  out.Set("samples", policy_.samples);
+  out.Set("smoothingMs", policy_.smoothing_ms);
+  out.Set("maxDownloads", policy_.max_downloads);
+  out.Set("tracked", static_cast<int64_t>(index_.size()));
+  out.Set("slabBytes", static_cast<int64_t>(slab_.capacity() * sizeof(Sample)));
+  return out;
+}
+
+void SpeedHistory::ClearLocked() {
+  std::vector<Sample>().swap(slab_);
+  slots_.clear();
+  free_slots_.clear();
+  index_.clear();
+}
+
+void SpeedHistory::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ClearLocked();
+  last_tick_ = std::chrono::steady_clock::time_point();
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
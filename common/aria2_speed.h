@@ -0,0 +1,115 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_SPEED_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_SPEED_H_
+
+#include <aria2_c_api.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+struct SpeedHistoryPolicy {
+  int64_t interval_ms = 1000;    // Between two samples of a download.
+  int64_t samples = 120;         // Kept per download.
+  int64_t smoothing_ms = 10000;  // Time constant of the average speed.
+  int64_t max_downloads = 256;   // Histories kept at once.
+};
+
+struct SpeedEstimate {
+  int64_t avg_speed = 0;     // Bytes per second.
+  int64_t eta_seconds = -1;  // -1 when unknown.
+};
+
+// Samples (timestamp, completed length, download speed) of every active
+// download on the run-loop thread and keeps the last |samples| of each in a
+// ring, next to an exponentially weighted average of the speed whose
+// weights decay with the time between samples, not their number.
+//
+// All rings live in one slab of |max_downloads| * |samples| entries, grown
+// by doubling the slot count up to that size. A download takes a slot the
+// first time it is sampled and keeps it until retention forgets it; when
+// every slot is taken, the slot of the download sampled longest ago that is
+// no longer active is reused, and new downloads go unsampled while every
+// slot belongs to an active one.
+class SpeedHistory {
+ public:
+  static constexpr int64_t kMinSpeedIntervalMs = 100;
+  static constexpr int64_t kMaxSpeedSamples = 3600;
+  static constexpr int64_t kMaxSpeedDownloads = 4096;
+
+  SpeedHistory() = default;
+
+  SpeedHistory(const SpeedHistory&) = delete;
+  SpeedHistory& operator=(const SpeedHistory&) = delete;
+
+  // Fails for values out of range. Changing |samples| or |max_downloads|
+  // drops the recorded histories.
+  bool SetPolicy(const SpeedHistoryPolicy& policy, std::string* error);
+  SpeedHistoryPolicy GetPolicy() const;
+
+  // Samples the active downloads once per |interval_ms|.
+  void OnTick(aria2_session_t* session);
+
+  // Average speed and remaining time of |gid|. Downloads that are not
+  // active average 0; downloads not sampled yet use |instant_speed|.
+  SpeedEstimate Estimate(aria2_gid_t gid, int64_t total_length,
+                         int64_t completed_length,
+                         int64_t instant_speed) const;
+
+  // Fills |out| with {intervalMs, avgSpeed, eta, timestamps (ms since the
+  // epoch), completed, speeds}, oldest sample first. Returns false when
+  // |gid| has no history.
+  bool Query(aria2_gid_t gid, common::Value* out) const;
+
+  void Forget(aria2_gid_t gid);
+
+  // {intervalMs, samples, smoothingMs, maxDownloads, tracked, slabBytes}.
+  common::Value Describe() const;
+
+  // Drops the histories; the policy stays.
+  void Reset();
+
+ private:
+  struct Sample {
+    int64_t time_ms = 0;
+    int64_t completed = 0;
+    int64_t speed = 0;
+  };
+
+  struct Slot {
+    aria2_gid_t gid = 0;
+    bool active = false;  // Sampled on the last tick.
+    size_t head = 0;      // Next sample to write.
+    size_t count = 0;
+    double avg_speed = 0;
+    int64_t total_length = 0;
+  };
+
+  static constexpr size_t kNoSlot = static_cast<size_t>(-1);
+
+  // Returns kNoSlot when every slot belongs to an active download.
+  size_t AcquireLocked(aria2_gid_t gid);
+  const Sample& LastLocked(size_t index) const;
+  void ClearLocked();
+
+  mutable std::mutex mutex_;
+  SpeedHistoryPolicy policy_;
+  std::vector<Sample> slab_;  // slots_.size() * policy_.samples entries.
+  std::vector<Slot> slots_;
+  std::vector<size_t> free_slots_;
+  std::unordered_map<aria2_gid_t, size_t> index_;
+  std::chrono::steady_clock::time_point last_tick_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_SPEED_H_
@@ -0,0 +1,264 @@
+#include "aria2_stream.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "aria2_helpers.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+// Head of each file that torrents fetch first while streamed.
+constexpr char kStreamPrioritizeHead[] = "head=16M";
+
+// Asks aria2 to fetch |gid| from the start. Changing these options restarts
+// an active download, so they are only set when they differ.
+void RequestInOrderPieces(aria2_session_t* session, aria2_gid_t gid,
+                          aria2_download_handle_t* handle) {
+  common::KeyVals options;
+  char* selector =
+      aria2_download_handle_get_option(handle, "stream-piece-selector");
+  if (selector == nullptr || std::string(selector) != "inorder") {
+    options.Add("stream-piece-selector", "inorder");
+  }
+  aria2_free(selector);
+  aria2_binary_t info_hash = aria2_download_handle_get_info_hash(handle);
+  if (info_hash.length > 0) {
+    char* prioritize =
+        aria2_download_handle_get_option(handle, "bt-prioritize-piece");
+    if (prioritize == nullptr || *prioritize == '\0') {
+      options.Add("bt-prioritize-piece", kStreamPrioritizeHead);
+    }
+    aria2_free(prioritize);
+  }
+  aria2_free_binary(&info_hash);
+  if (options.count() > 0) {
+    aria2_change_option(session, gid, options.data(), options.count());
+  }
+}
+}  // namespace
+
+bool ProgressiveStreams::Open(aria2_session_t* session, int64_t id,
+                              aria2_gid_t gid, int file_index,
+                              std::string* error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (streams_.count(id) > 0) {
+    *error = "Stream " + std::to_string(id) + " is already open";
+    return false;
+  }
+  const int status = common::GetDownloadStatus(session, gid);
+  if (status < 0) {
+    *error = "No download " + common::GidToHex(gid);
+    return false;
+  }
+  if (status == common::kStatusError || status == common::kStatusRemoved) {
+    *error = "Download " + common::GidToHex(gid) + " has stopped";
+    return false;
+  }
+  auto stream = std::make_unique<Stream>();
+  stream->gid = gid;
+  stream->file_index = file_index;
+  stream->complete = status == common::kStatusComplete;
+  if (AvailableLocked(session, stream.get()) < 0) {
+    *error = stream->error;
+    return false;
+  }
+  if (!stream->complete) {
+    if (aria2_download_handle_t* handle =
+            aria2_get_download_handle(session, gid)) {
+      RequestInOrderPieces(session, gid, handle);
+      aria2_delete_download_handle(handle);
+    }
+  }
+  streams_[id] = std::move(stream);
+  // Deliver what is already there on the next tick.
+  last_tick_ = std::chrono::steady_clock::time_point();
+  return true;
+}
+
+bool ProgressiveStreams::Close(int64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return streams_.erase(id) > 0;
+}
+
+void ProgressiveStreams::OnDownloadEvent(aria2_download_event_t event,
+                                         aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& item : streams_) {
+    Stream& stream = *item.second;
+    if (stream.gid != gid) {
+      continue;
+    }
+    switch (event) {
+      case ARIA2_EVENT_ON_DOWNLOAD_COMPLETE:
+      case ARIA2_EVENT_ON_BT_DOWNLOAD_COMPLETE:
+        stream.complete = true;
+        break;
+      case ARIA2_EVENT_ON_DOWNLOAD_ERROR:
+        stream.error = "Download failed";
+        break;
+      case ARIA2_EVENT_ON_DOWNLOAD_STOP:
+        stream.error = "Download was removed";
+        break;
+      default:
+        break;
+    }
+  }
+  if (event == ARIA2_EVENT_ON_DOWNLOAD_COMPLETE ||
+      event == ARIA2_EVENT_ON_BT_DOWNLOAD_COMPLETE) {
+    last_tick_ = std::chrono::steady_clock::time_point();
+  }
+}
+
+int64_t ProgressiveStreams::AvailableLocked(aria2_session_t* session,
+                                            Stream* stream) {
+  aria2_download_handle_t* handle =
+      aria2_get_download_handle(session, stream->gid);
+  if (handle == nullptr) {
+    stream->error = "Download is gone";
+    return -1;
+  }
+  const int64_t total = aria2_download_handle_get_total_length(handle);
+  int64_t prefix = total;
+  if (!stream->complete) {
+    aria2_binary_t bitfield = aria2_download_handle_get_bitfield(handle);
+    prefix = bitfield.data == nullptr
+                 ? 0
+                 : common::CompletedPrefix(
+                       bitfield,
+                       static_cast<int64_t>(
+                           aria2_download_handle_get_piece_length(handle)),
+                       total);
+    aria2_free_binary(&bitfield);
+  }
+  if (stream->path.empty()) {
+    aria2_file_data_t* files = nullptr;
+    size_t files_count = 0;
+    if (aria2_download_handle_get_files(handle, &files, &files_count) == 0 &&
+        files != nullptr) {
+      int64_t offset = 0;
+      for (size_t i = 0; i < files_count; ++i) {
+        if (files[i].index == stream->file_index) {
+          if (files[i].selected == 0) {
+            stream->error = "File " + std::to_string(stream->file_index) +
+                            " is not selected";
+          } else if (files[i].path != nullptr && *files[i].path != '\0') {
+            stream->path = files[i].path;
+            stream->offset = offset;
+            stream->length = files[i].length;
+          }
+          break;
+        }
+        offset += files[i].length;
+      }
+      // aria2 lists the files as soon as it knows their number.
+      if (files_count > 0 &&
+          (stream->file_index < 1 ||
+           stream->file_index > static_cast<int>(files_count))) {
+        stream->error = "No file " + std::to_string(stream->file_index);
+      }
+      aria2_free_file_data_array(files, files_count);
+    }
+  }
+  aria2_delete_download_handle(handle);
+  if (!stream->error.empty()) {
+    return -1;
+  }
+  if (stream->path.empty()) {
+    return 0;
+  }
+  return std::max<int64_t>(
+      0, std::min(prefix - stream->offset, stream->length));
+}
+
+void ProgressiveStreams::ReadLocked(int64_t id, Stream* stream,
+                                    int64_t available,
+                                    std::vector<StreamChunk>* out) {
+  int64_t budget = kStreamTickBytes;
+  while (stream->sent < available && budget > 0) {
+    if (!stream->input.is_open() && !stream->input.Open(stream->path)) {
+      stream->error = "Cannot open " + stream->path;
+      return;
+    }
+    StreamChunk chunk;
+    chunk.id = id;
+    chunk.offset = stream->sent;
+    chunk.data.resize(static_cast<size_t>(std::min<int64_t>(
+        {available - stream->sent, budget,
+         static_cast<int64_t>(kStreamChunkBytes)})));
+    const int64_t read = stream->input.ReadAt(stream->sent, chunk.data.data(),
+                                              chunk.data.size());
+    if (read <= 0) {
+      stream->error = "Cannot read " + stream->path;
+      return;
+    }
+    chunk.data.resize(static_cast<size_t>(read));
+    stream->sent += read;
+    budget -= read;
+    bytes_streamed_ += read;
+    out->push_back(std::move(chunk));
+  }
+}
+
+std::vector<StreamChunk> ProgressiveStreams::OnTick(aria2_session_t* session) {
+  std::vector<StreamChunk> out;
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto now = std::chrono::steady_clock::now();
+  if (streams_.empty() ||
+      now - last_tick_ < std::chrono::milliseconds(kStreamTickMs)) {
+    return out;
+  }
+  last_tick_ = now;
+  for (auto it = streams_.begin(); it != streams_.end();) {
+    Stream& stream = *it->second;
+    if (stream.error.empty()) {
+      const int64_t available = AvailableLocked(session, &stream);
+      if (available > stream.sent) {
+        ReadLocked(it->first, &stream, available, &out);
+      }
+    }
+    const bool finished = !stream.path.empty() && stream.complete &&
+                          stream.sent == stream.length;
+    if (!finished && stream.error.empty()) {
+      ++it;
+      continue;
+    }
+    if (out.empty() || out.back().id != it->first) {
+      StreamChunk chunk;
+      chunk.id = it->first;
+      chunk.offset = stream.sent;
+      out.push_back(std::move(chunk));
+    }
+    out.back().done = true;
+    out.back().error = stream.error;
+    it = streams_.erase(it);
+  }
+  return out;
+}
+
+common::Value ProgressiveStreams::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewMap();
+  out.Set("open", static_cast<int64_t>(streams_.size()));
+  out.Set("bytesStreamed", bytes_streamed_);
+  return out;
+}
+
+std::vector<StreamChunk> ProgressiveStreams::Reset(const std::string& reason) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<StreamChunk> out;
+  for (const auto& item : streams_) {
+    StreamChunk chunk;
+    chunk.id = item.first;
+    chunk.offset = item.second->sent;
+    chunk.done = true;
+    chunk.error = reason;
+    out.push_back(std::move(chunk));
+  }
+  streams_.clear();
+  return out;
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
@@ -0,0 +1,99 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_STREAM_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_STREAM_H_
+
+#include <aria2_c_api.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "aria2_mapped_file.h"
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+struct StreamChunk {
+  int64_t id = 0;
+  int64_t offset = 0;  // Of |data| within the file.
+  common::Value::Bytes data;
+  bool done = false;   // The stream ends with this chunk.
+  std::string error;   // Set with |done| when the stream failed.
+};
+
+// Streams files of in-flight downloads to Dart as their data arrives.
+//
+// Opening a stream switches the download to in-order piece selection
+// ("stream-piece-selector=inorder"; for torrents, which aria2 always fetches
+// rarest first, "bt-prioritize-piece" on the head of each file). On every
+// tick the completed prefix of the download's data is computed from aria2's
+// piece bitfield, and the bytes of the file that it newly covers are read
+// with positional reads and handed out as chunks. The stream ends when the
+// download completes and every byte was delivered, or with an error when
+// the download fails or is removed.
+class ProgressiveStreams {
+ public:
+  static constexpr int kStreamTickMs = 50;
+  static constexpr size_t kStreamChunkBytes = 1 << 20;
+  // Read per stream and tick, so one fast stream cannot stall the others.
+  static constexpr int64_t kStreamTickBytes = 4 << 20;
+
+  ProgressiveStreams() = default;
+
+  ProgressiveStreams(const ProgressiveStreams&) = delete;
+  ProgressiveStreams& operator=(const ProgressiveStreams&) = delete;
+
+  // Starts streaming file |file_index| (1-based) of |gid| under |id|, which
+  // the caller picks. Fails for unknown downloads, ids in use and, when the
+  // files are already known, invalid or unselected files.
+  bool Open(aria2_session_t* session, int64_t id, aria2_gid_t gid,
+            int file_index, std::string* error);
+
+  // Returns false when |id| is not open.
+  bool Close(int64_t id);
+
+  // Runs in the download event callback.
+  void OnDownloadEvent(aria2_download_event_t event, aria2_gid_t gid);
+
+  // Newly available data, at most every kStreamTickMs.
+  std::vector<StreamChunk> OnTick(aria2_session_t* session);
+
+  // {open, bytesStreamed}.
+  common::Value Describe() const;
+
+  // Ends every stream with |reason|.
+  std::vector<StreamChunk> Reset(const std::string& reason);
+
+ private:
+  struct Stream {
+    aria2_gid_t gid = 0;
+    int file_index = 0;
+    std::string path;  // Empty until aria2 knows the file.
+    int64_t offset = 0;  // Of the file within the download's data.
+    int64_t length = 0;
+    int64_t sent = 0;
+    bool complete = false;
+    std::string error;
+    common::InputFile input;
+  };
+
+  // Fills in the file of |stream| once aria2 knows it and returns the bytes
+  // of the file that are complete, or -1 with |stream->error| set.
+  int64_t AvailableLocked(aria2_session_t* session, Stream* stream);
+  void ReadLocked(int64_t id, Stream* stream, int64_t available,
+                  std::vector<StreamChunk>* out);
+
+  mutable std::mutex mutex_;
+  std::map<int64_t, std::unique_ptr<Stream>> streams_;
+  std::chrono::steady_clock::time_point last_tick_;
+  int64_t bytes_streamed_ = 0;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_STREAM_H_
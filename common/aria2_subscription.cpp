@@ -0,0 +1,189 @@
+#include "aria2_subscription.h"
+
+#include <utility>
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+// Events a burst of callbacks can queue before the vector grows; keeps the
+// callback itself free of allocations in the common case.
+constexpr size_t kQueuedEventsReserve = 256;
+}  // namespace
+
+EventSubscriptions::EventSubscriptions() {
+  queue_.events.reserve(kQueuedEventsReserve);
+}
+
+bool EventSubscriptions::Set(const std::string& name, uint32_t event_mask,
+                             bool all_gids,
+                             const std::vector<aria2_gid_t>& gids,
+                             std::string* error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Subscription* target = nullptr;
+  Subscription* unused = nullptr;
+  for (Subscription& slot : slots_) {
+    if (slot.used && slot.name == name) {
+      target = &slot;
+      break;
+    }
+    if (!slot.used && unused == nullptr) {
+      unused = &slot;
+    }
+  }
+  if (target != nullptr) {
+    ResolveNamesLocked(1u << static_cast<uint32_t>(target - slots_));
+  }
+  if (target == nullptr) {
+    if (unused == nullptr) {
+      *error = "At most " + std::to_string(kMaxEventSubscriptions) +
+               " event subscriptions";
+      return false;
+    }
+    target = unused;
+  }
+  target->used = true;
+  target->name = name;
+  target->event_mask = event_mask;
+  target->all_gids = all_gids;
+  target->gids.clear();
+  if (!all_gids) {
+    target->gids.insert(gids.begin(), gids.end());
+  }
+  filtering_.store(true);
+  return true;
+}
+
+bool EventSubscriptions::Remove(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  bool removed = false;
+  bool any = false;
+  for (size_t i = 0; i < kMaxEventSubscriptions; ++i) {
+    Subscription& slot = slots_[i];
+    if (slot.used && slot.name == name) {
+      ResolveNamesLocked(1u << i);
+      slot = Subscription();
+      removed = true;
+    }
+    any = any || slot.used;
+  }
+  filtering_.store(any);
+  return removed;
+}
+
+uint32_t EventSubscriptions::Match(aria2_download_event_t event,
+                                   aria2_gid_t gid) {
+  const uint32_t bit = 1u << static_cast<uint32_t>(event);
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint32_t slots = 0;
+  for (size_t i = 0; i < kMaxEventSubscriptions; ++i) {
+    const Subscription& slot = slots_[i];
+    if (slot.used && (slot.event_mask & bit) != 0 &&
+        (slot.all_gids || slot.gids.count(gid) > 0)) {
+      slots |= 1u << i;
+    }
+  }
+  if (slots == 0) {
+    ++dropped_;
+  }
+  return slots;
+}
+
+void EventSubscriptions::Enqueue(aria2_download_event_t event, aria2_gid_t gid,
+                                 uint32_t slots, common::Value fields) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_.events.push_back(
+      Queued{event, gid, slots, std::move(fields), common::Value()});
+}
+
+void EventSubscriptions::EnqueueAfter(const char* method,
+                                      common::Value payload) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_.after.emplace_back(method, std::move(payload));
+}
+
+bool EventSubscriptions::HasQueued() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !queue_.events.empty() || !queue_.after.empty();
+}
+
+EventSubscriptions::Batch EventSubscriptions::Take() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ResolveNamesLocked(~0u);
+  Batch out = std::move(queue_);
+  queue_ = Batch();
+  queue_.events.reserve(kQueuedEventsReserve);
+  if (!out.events.empty()) {
+    forwarded_ += static_cast<int64_t>(out.events.size());
+    ++batches_;
+  }
+  return out;
+}
+
+common::Value EventSubscriptions::NamesLocked(uint32_t slots) const {
+  common::Value out = common::Value::NewList();
+  for (size_t i = 0; i < kMaxEventSubscriptions; ++i) {
+    if ((slots & (1u << i)) != 0 && slots_[i].used) {
+      out.Append(slots_[i].name);
+    }
+  }
+  return out;
+}
+
+void EventSubscriptions::ResolveNamesLocked(uint32_t slots) {
+  for (Queued& queued : queue_.events) {
+    if (queued.names.IsNull() && (queued.slots & slots) != 0) {
+      queued.names = NamesLocked(queued.slots);
+    }
+  }
+}
+
+void EventSubscriptions::OnRetried(aria2_gid_t old_gid, aria2_gid_t new_gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Subscription& slot : slots_) {
+    if (slot.used && slot.gids.count(old_gid) > 0) {
+      slot.gids.insert(new_gid);
+    }
+  }
+}
+
+void EventSubscriptions::Forget(aria2_gid_t gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Subscription& slot : slots_) {
+    slot.gids.erase(gid);
+  }
+}
+
+common::Value EventSubscriptions::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value list = common::Value::NewList();
+  for (const Subscription& slot : slots_) {
+    if (!slot.used) {
+      continue;
+    }
+    common::Value entry = common::Value::NewMap();
+    entry.Set("name", slot.name);
+    entry.Set("eventMask", static_cast<int64_t>(slot.event_mask));
+    entry.Set("gids", slot.all_gids ? int64_t{-1}
+                                    : static_cast<int64_t>(slot.gids.size()));
+    list.Append(std::move(entry));
+  }
+  common::Value out = common::Value::NewMap();
+  out.Set("subscriptions", std::move(list));
+  out.Set("forwarded", forwarded_);
+  out.Set("dropped", dropped_);
+  out.Set("batches", batches_);
+  return out;
+}
+
+void EventSubscriptions::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_ = Batch();
+  queue_.events.reserve(kQueuedEventsReserve);
+  for (Subscription& slot : slots_) {
+    slot.gids.clear();
+  }
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
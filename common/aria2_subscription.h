@@ -0,0 +1,114 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_SUBSCRIPTION_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_SUBSCRIPTION_H_
+
+#include <aria2_c_api.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// Named filters over the download events forwarded to Dart.
+//
+// Without subscriptions every event is forwarded on its own, as before.
+// Once one is set, the event callback asks Match() first, before any
+// payload or gid string is built, and drops events no subscription wants;
+// the others are queued with the slots of the subscriptions they matched
+// and leave as a single batch per run-loop iteration, so N events cost one
+// hop to the platform thread instead of N.
+class EventSubscriptions {
+ public:
+  static constexpr size_t kMaxEventSubscriptions = 32;
+
+  struct Queued {
+    aria2_download_event_t event;
+    aria2_gid_t gid;
+    uint32_t slots;  // Bit i: subscription slot i matched.
+    // Fields sent besides event and gid, such as the digests of a checksum
+    // result; null for plain events.
+    common::Value fields;
+    // Names of the matched subscriptions, filled in by Take(), or earlier
+    // when one of them is replaced or removed while the event is queued.
+    common::Value names;
+  };
+
+  // What Take() hands over: the queued events, then the (method, payload)
+  // events that must follow them, such as group events of queued members.
+  struct Batch {
+    std::vector<Queued> events;
+    std::vector<std::pair<const char*, common::Value>> after;
+  };
+
+  EventSubscriptions();
+
+  EventSubscriptions(const EventSubscriptions&) = delete;
+  EventSubscriptions& operator=(const EventSubscriptions&) = delete;
+
+  // Adds or replaces subscription |name|. |event_mask| has bit (1 << event)
+  // set for each wanted aria2_download_event_t; |all_gids| ignores |gids|.
+  // Fails when kMaxEventSubscriptions other names are taken.
+  bool Set(const std::string& name, uint32_t event_mask, bool all_gids,
+           const std::vector<aria2_gid_t>& gids, std::string* error);
+  // Returns false when |name| is not subscribed.
+  bool Remove(const std::string& name);
+
+  bool filtering() const { return filtering_.load(); }
+
+  // Slots of the subscriptions that want |event| of |gid|; 0 drops it.
+  // Does not allocate.
+  uint32_t Match(aria2_download_event_t event, aria2_gid_t gid);
+  void Enqueue(aria2_download_event_t event, aria2_gid_t gid, uint32_t slots,
+               common::Value fields = common::Value());
+  // Emitted after the queued events, keeping the order they were raised in.
+  void EnqueueAfter(const char* method, common::Value payload);
+  bool HasQueued() const;
+  Batch Take();
+
+  // A retried download keeps the subscriptions of the one it replaces.
+  void OnRetried(aria2_gid_t old_gid, aria2_gid_t new_gid);
+  void Forget(aria2_gid_t gid);
+
+  // {subscriptions: [{name, eventMask, gids}], forwarded, dropped, batches}.
+  // gids is -1 for subscriptions to every download.
+  common::Value Describe() const;
+
+  // Drops the queue and the gids of the ended session; the subscriptions
+  // themselves stay.
+  void Reset();
+
+ private:
+  struct Subscription {
+    bool used = false;
+    std::string name;
+    uint32_t event_mask = 0;
+    bool all_gids = true;
+    std::unordered_set<aria2_gid_t> gids;
+  };
+
+  // Names of the subscriptions in |slots| that are still set.
+  common::Value NamesLocked(uint32_t slots) const;
+  // Fixes the names of queued events matched by a slot in |slots| before
+  // that slot changes.
+  void ResolveNamesLocked(uint32_t slots);
+
+  mutable std::mutex mutex_;
+  std::atomic<bool> filtering_{false};
+  Subscription slots_[kMaxEventSubscriptions];
+  Batch queue_;
+  int64_t forwarded_ = 0;
+  int64_t dropped_ = 0;
+  int64_t batches_ = 0;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_SUBSCRIPTION_H_
@@ -0,0 +1,46 @@
+#include "aria2_timing.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace flutter_aria2 {
+namespace core {
+
+void MethodTimings::Record(const std::string& method, int64_t main_us,
+                           int64_t worker_us) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats& stats = methods_[method];
+  ++stats.calls;
+  stats.main_us += main_us;
+  stats.main_max_us = std::max(stats.main_max_us, main_us);
+  if (main_us > kSlowMainThreadUs) {
+    ++stats.slow_on_main;
+  }
+  stats.worker_us += worker_us;
+  stats.worker_max_us = std::max(stats.worker_max_us, worker_us);
+}
+
+common::Value MethodTimings::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewMap();
+  for (const auto& item : methods_) {
+    const Stats& stats = item.second;
+    common::Value entry = common::Value::NewMap();
+    entry.Set("calls", stats.calls);
+    entry.Set("mainUs", stats.main_us);
+    entry.Set("mainMaxUs", stats.main_max_us);
+    entry.Set("slowOnMain", stats.slow_on_main);
+    entry.Set("workerUs", stats.worker_us);
+    entry.Set("workerMaxUs", stats.worker_max_us);
+    out.Set(item.first, std::move(entry));
+  }
+  return out;
+}
+
+void MethodTimings::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  methods_.clear();
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
@@ -0,0 +1,55 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_TIMING_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_TIMING_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// Per-method time a platform spends on a channel call, split between the
+// UI thread (taking the call, sending the response) and the worker that
+// decoded the arguments and ran the handler, so a method that still blocks
+// the UI shows up. Native-to-Dart events are recorded under their event name,
+// with the send on the UI thread and the payload conversion on the emitting
+// thread as the worker share.
+class MethodTimings {
+ public:
+  // UI-thread time above which a call counts as slow.
+  static constexpr int64_t kSlowMainThreadUs = 1000;
+
+  MethodTimings() = default;
+
+  MethodTimings(const MethodTimings&) = delete;
+  MethodTimings& operator=(const MethodTimings&) = delete;
+
+  void Record(const std::string& method, int64_t main_us, int64_t worker_us);
+
+  // {method: {calls, mainUs, mainMaxUs, slowOnMain, workerUs,
+  // workerMaxUs}}; empty on platforms that do not record.
+  common::Value Describe() const;
+
+  void Clear();
+
+ private:
+  struct Stats {
+    int64_t calls = 0;
+    int64_t main_us = 0;
+    int64_t main_max_us = 0;
+    int64_t slow_on_main = 0;
+    int64_t worker_us = 0;
+    int64_t worker_max_us = 0;
+  };
+
+  mutable std::mutex mutex_;
+  std::map<std::string, Stats> methods_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_TIMING_H_
@@ -0,0 +1,536 @@
+#include "aria2_torrent.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <utility>
+
+#include "aria2_mapped_file.h"
+#include "aria2_sha.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+// Work is handed out in runs of consecutive pieces of about this size, so
+// each thread reads sequentially and can prefetch a whole run at once.
+constexpr int64_t kTorrentBatchBytes = 4 * 1024 * 1024;
+constexpr size_t kTorrentReadChunk = 1 << 20;
+constexpr int kTorrentMaxThreads = 32;
+constexpr int kTorrentMaxDepth = 64;
+
+bool IsSeparator(char c) {
+#ifdef _WIN32
+  return c == '/' || c == '\\';
+#else
+  return c == '/';
+#endif
+}
+
+std::string TrimSeparators(std::string path) {
+  while (path.size() > 1 && IsSeparator(path.back())) {
+    path.pop_back();
+  }
+  return path;
+}
+
+// Splits |path| into its directory ("." when there is none) and last
+// component.
+void SplitPath(const std::string& path, std::string* dir, std::string* base) {
+  size_t slash = path.size();
+  while (slash > 0 && !IsSeparator(path[slash - 1])) {
+    --slash;
+  }
+  *base = path.substr(slash);
+  if (slash == 0) {
+    *dir = ".";
+  } else {
+    *dir = slash == 1 ? path.substr(0, 1) : path.substr(0, slash - 1);
+  }
+}
+
+void BencodeString(const std::string& value, std::string* out) {
+  out->append(std::to_string(value.size()));
+  out->push_back(':');
+  out->append(value);
+}
+
+void BencodeInt(int64_t value, std::string* out) {
+  out->push_back('i');
+  out->append(std::to_string(value));
+  out->push_back('e');
+}
+
+// Reads pieces for one hashing thread, keeping the file it read last open.
+class PieceReader {
+ public:
+  bool Select(const std::string& path, int index, std::string* error) {
+    if (index == index_) {
+      return true;
+    }
+    mapping_.Close();
+    input_.Close();
+    index_ = -1;
+    std::string map_error;
+    if (!mapping_.Open(path, &map_error) && !input_.Open(path)) {
+      *error = "Cannot read " + path + ": " + map_error;
+      return false;
+    }
+    index_ = index;
+    return true;
+  }
+
+  void WillNeed(int64_t offset, int64_t length) {
+    if (mapping_.is_open() && length > 0) {
+      mapping_.WillNeed(static_cast<size_t>(offset),
+                        static_cast<size_t>(length));
+    }
+  }
+
+  bool Hash(int64_t offset, int64_t length, common::Sha1* hash) {
+    if (mapping_.is_open()) {
+      if (offset + length > static_cast<int64_t>(mapping_.size())) {
+        return false;
+      }
+      hash->Update(mapping_.data() + offset, static_cast<size_t>(length));
+      return true;
+    }
+    buffer_.resize(kTorrentReadChunk);
+    while (length > 0) {
+      const size_t want = static_cast<size_t>(
+          std::min<int64_t>(length, static_cast<int64_t>(buffer_.size())));
+      const int64_t read = input_.ReadAt(offset, buffer_.data(), want);
+      if (read <= 0) {
+        return false;
+      }
+      hash->Update(buffer_.data(), static_cast<size_t>(read));
+      offset += read;
+      length -= read;
+    }
+    return true;
+  }
+
+ private:
+  int index_ = -1;
+  common::MappedInput mapping_;
+  common::InputFile input_;
+  std::vector<char> buffer_;
+};
+}  // namespace
+
+int64_t PickPieceLength(int64_t total_length) {
+  int64_t length = 256 * 1024;
+  while (length < 16 * 1024 * 1024 && total_length / length > 2000) {
+    length *= 2;
+  }
+  return length;
+}
+
+TorrentCreator::~TorrentCreator() {
+  Stop();
+}
+
+bool TorrentCreator::Start(TorrentConfig config, Callback on_done) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_.load()) {
+    return false;
+  }
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+  cancel_.store(false);
+  silent_.store(false);
+  hashed_bytes_.store(0);
+  total_bytes_.store(0);
+  running_.store(true);
+  worker_ = std::thread(
+      [this, config = std::move(config), on_done = std::move(on_done)]() {
+        Run(config, on_done);
+      });
+  return true;
+}
+
+common::Value TorrentCreator::Progress() const {
+  common::Value out = common::Value::NewMap();
+  out.Set("running", running_.load());
+  out.Set("hashedBytes", hashed_bytes_.load());
+  out.Set("totalBytes", total_bytes_.load());
+  return out;
+}
+
+void TorrentCreator::Cancel() {
+  cancel_.store(true);
+}
+
+void TorrentCreator::Stop() {
+  silent_.store(true);
+  cancel_.store(true);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+bool TorrentCreator::CollectFiles(const TorrentConfig& config,
+                                  std::string* name, std::string* seed_dir,
+                                  bool* single_file,
+                                  std::vector<SourceFile>* files,
+                                  std::string* error) {
+  std::string parent;
+  std::vector<std::string> roots;
+  for (const std::string& raw : config.paths) {
+    const std::string path = TrimSeparators(raw);
+    std::string dir;
+    std::string base;
+    SplitPath(path, &dir, &base);
+    if (base.empty()) {
+      *error = "Invalid path '" + raw + "'";
+      return false;
+    }
+    if (roots.empty()) {
+      parent = dir;
+    } else if (dir != parent) {
+      *error = "All paths must be in the same directory";
+      return false;
+    }
+    roots.push_back(base);
+  }
+
+  // The torrent root is the single path itself or the common directory.
+  std::string root;
+  std::vector<std::string> prefix;
+  if (roots.size() == 1) {
+    root = parent + "/" + roots[0];
+    *name = roots[0];
+    *seed_dir = parent;
+    *single_file = !common::IsDirectory(root);
+  } else {
+    root = parent;
+    std::string grandparent;
+    SplitPath(TrimSeparators(parent), &grandparent, name);
+    if (name->empty() || *name == "." || *name == "..") {
+      *error = "Cannot name a torrent after '" + parent + "'";
+      return false;
+    }
+    *seed_dir = grandparent;
+    *single_file = false;
+  }
+
+  int64_t offset = 0;
+  auto add_file = [&](const std::string& path,
+                      std::vector<std::string> components) {
+    int64_t size = 0;
+    int64_t mtime_ns = 0;
+    if (!common::StatFile(path, &size, &mtime_ns)) {
+      // Sockets, devices and the like are not published.
+      return;
+    }
+    SourceFile file;
+    file.path = path;
+    file.components = std::move(components);
+    file.offset = offset;
+    file.length = size;
+    offset += size;
+    files->push_back(std::move(file));
+  };
+  std::function<bool(const std::string&, std::vector<std::string>&, int)>
+      walk = [&](const std::string& dir, std::vector<std::string>& components,
+                 int depth) {
+        if (depth > kTorrentMaxDepth) {
+          *error = "Directory tree under " + root + " is too deep";
+          return false;
+        }
+        std::vector<common::DirectoryEntry> entries;
+        if (!common::ListDirectory(dir, &entries)) {
+          *error = "Cannot list " + dir;
+          return false;
+        }
+        for (const common::DirectoryEntry& entry : entries) {
+          const std::string path = dir + "/" + entry.name;
+          components.push_back(entry.name);
+          if (entry.directory) {
+            if (!walk(path, components, depth + 1)) {
+              return false;
+            }
+          } else {
+            add_file(path, components);
+          }
+          components.pop_back();
+        }
+        return true;
+      };
+
+  if (*single_file) {
+    if (!common::FileExists(root)) {
+      *error = "No such file: " + root;
+      return false;
+    }
+    add_file(root, {});
+  } else if (roots.size() == 1) {
+    if (!walk(root, prefix, 0)) {
+      return false;
+    }
+  } else {
+    for (const std::string& base : roots) {
+      const std::string path = parent + "/" + base;
+      prefix.assign(1, base);
+      if (common::IsDirectory(path)) {
+        if (!walk(path, prefix, 1)) {
+          return false;
+        }
+      } else if (common::FileExists(path)) {
+        add_file(path, prefix);
+      } else {
+        *error = "No such file: " + path;
+        return false;
+      }
+    }
+  }
+  if (offset == 0) {
+    *error = "Nothing to hash: the inputs are empty";
+    return false;
+  }
+  return true;
+}
+
+bool TorrentCreator::HashPieces(const std::vector<SourceFile>& files,
+                                int64_t piece_length, int threads,
+                                std::string* pieces, std::string* error) {
+  const int64_t total = files.back().offset + files.back().length;
+  const int64_t piece_count = (total + piece_length - 1) / piece_length;
+  const int64_t batch_pieces =
+      std::max<int64_t>(1, kTorrentBatchBytes / piece_length);
+  const int64_t batches = (piece_count + batch_pieces - 1) / batch_pieces;
+  pieces->assign(static_cast<size_t>(piece_count) * common::Sha1::kDigestSize,
+                 '\0');
+
+  std::vector<int64_t> offsets;
+  offsets.reserve(files.size());
+  for (const SourceFile& file : files) {
+    offsets.push_back(file.offset);
+  }
+
+  std::atomic<int64_t> next_batch{0};
+  std::atomic<bool> failed{false};
+  std::mutex error_mutex;
+  auto fail = [&](std::string text) {
+    std::lock_guard<std::mutex> lock(error_mutex);
+    if (!failed.exchange(true)) {
+      *error = std::move(text);
+    }
+  };
+
+  auto work = [&]() {
+    PieceReader reader;
+    common::Sha1 hash;
+    for (int64_t batch = next_batch++; batch < batches;
+         batch = next_batch++) {
+      const int64_t first = batch * batch_pieces;
+      const int64_t last = std::min(piece_count, first + batch_pieces);
+      const int64_t batch_end = std::min(total, last * piece_length);
+      // Zero-length files share their offset with the next file; start at
+      // the last file that begins at or before the position.
+      size_t index = static_cast<size_t>(
+          std::upper_bound(offsets.begin(), offsets.end(),
+                           first * piece_length) -
+          offsets.begin() - 1);
+      int prefetched = -1;
+      for (int64_t piece = first; piece < last; ++piece) {
+        if (cancel_.load() || failed.load()) {
+          return;
+        }
+        int64_t position = piece * piece_length;
+        const int64_t piece_end = std::min(total, position + piece_length);
+        hash.Reset();
+        while (position < piece_end) {
+          const SourceFile& file = files[index];
+          const int64_t in_file = position - file.offset;
+          const int64_t take =
+              std::min(file.length - in_file, piece_end - position);
+          if (take <= 0) {
+            ++index;
+            continue;
+          }
+          std::string read_error;
+          if (!reader.Select(file.path, static_cast<int>(index),
+                             &read_error)) {
+            fail(std::move(read_error));
+            return;
+          }
+          if (prefetched != static_cast<int>(index)) {
+            reader.WillNeed(in_file, batch_end - position);
+            prefetched = static_cast<int>(index);
+          }
+          if (!reader.Hash(in_file, take, &hash)) {
+            fail("Cannot read " + file.path +
+                 "; was it changed while hashing?");
+            return;
+          }
+          position += take;
+        }
+        hash.Digest(reinterpret_cast<uint8_t*>(&(*pieces)[static_cast<size_t>(
+            piece * common::Sha1::kDigestSize)]));
+        hashed_bytes_ += piece_end - piece * piece_length;
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int i = 1; i < threads; ++i) {
+    pool.emplace_back(work);
+  }
+  work();
+  for (std::thread& thread : pool) {
+    thread.join();
+  }
+  return !failed.load() && !cancel_.load();
+}
+
+void TorrentCreator::Run(const TorrentConfig& config, const Callback& on_done) {
+  const auto started = std::chrono::steady_clock::now();
+  common::Value out = common::Value::NewMap();
+  std::string error;
+  std::string name;
+  std::string seed_dir;
+  bool single_file = false;
+  std::vector<SourceFile> files;
+  std::string pieces;
+  int64_t total = 0;
+  int64_t piece_length = config.piece_length;
+  int threads = 1;
+  bool ok = CollectFiles(config, &name, &seed_dir, &single_file, &files,
+                         &error);
+  if (ok) {
+    total = files.back().offset + files.back().length;
+    total_bytes_.store(total);
+    if (piece_length == 0) {
+      piece_length = PickPieceLength(total);
+    }
+    const int64_t batches =
+        (total + kTorrentBatchBytes - 1) / kTorrentBatchBytes;
+    threads = config.threads > 0
+                  ? config.threads
+                  : static_cast<int>(std::thread::hardware_concurrency());
+    threads = static_cast<int>(std::max<int64_t>(
+        1, std::min<int64_t>({threads, kTorrentMaxThreads, batches})));
+    ok = HashPieces(files, piece_length, threads, &pieces, &error);
+  }
+
+  std::string info_hash;
+  if (ok) {
+    std::string info = "d";
+    if (single_file) {
+      BencodeString("length", &info);
+      BencodeInt(total, &info);
+    } else {
+      BencodeString("files", &info);
+      info.push_back('l');
+      for (const SourceFile& file : files) {
+        info.push_back('d');
+        BencodeString("length", &info);
+        BencodeInt(file.length, &info);
+        BencodeString("path", &info);
+        info.push_back('l');
+        for (const std::string& component : file.components) {
+          BencodeString(component, &info);
+        }
+        info.append("ee");
+      }
+      info.push_back('e');
+    }
+    BencodeString("name", &info);
+    BencodeString(name, &info);
+    BencodeString("piece length", &info);
+    BencodeInt(piece_length, &info);
+    BencodeString("pieces", &info);
+    BencodeString(pieces, &info);
+    if (config.private_torrent) {
+      BencodeString("private", &info);
+      BencodeInt(1, &info);
+    }
+    info.push_back('e');
+
+    uint8_t digest[common::Sha1::kDigestSize];
+    common::Sha1 hash;
+    hash.Update(info.data(), info.size());
+    hash.Digest(digest);
+    static const char kHex[] = "0123456789abcdef";
+    for (uint8_t byte : digest) {
+      info_hash.push_back(kHex[byte >> 4]);
+      info_hash.push_back(kHex[byte & 0xf]);
+    }
+
+    // Keys of a bencoded dictionary are sorted.
+    std::string torrent = "d";
+    if (!config.trackers.empty()) {
+      BencodeString("announce", &torrent);
+      BencodeString(config.trackers[0], &torrent);
+    }
+    if (config.trackers.size() > 1) {
+      BencodeString("announce-list", &torrent);
+      torrent.push_back('l');
+      for (const std::string& tracker : config.trackers) {
+        torrent.push_back('l');
+        BencodeString(tracker, &torrent);
+        torrent.push_back('e');
+      }
+      torrent.push_back('e');
+    }
+    if (!config.comment.empty()) {
+      BencodeString("comment", &torrent);
+      BencodeString(config.comment, &torrent);
+    }
+    BencodeString("created by", &torrent);
+    BencodeString("flutter_aria2", &torrent);
+    BencodeString("creation date", &torrent);
+    BencodeInt(static_cast<int64_t>(std::time(nullptr)), &torrent);
+    BencodeString("info", &torrent);
+    torrent.append(info);
+    if (!config.webseeds.empty()) {
+      BencodeString("url-list", &torrent);
+      torrent.push_back('l');
+      for (const std::string& webseed : config.webseeds) {
+        BencodeString(webseed, &torrent);
+      }
+      torrent.push_back('e');
+    }
+    torrent.push_back('e');
+    ok = common::WriteFileAtomic(config.output, torrent, &error);
+  }
+
+  if (silent_.load()) {
+    running_.store(false);
+    return;
+  }
+  if (!ok && error.empty()) {
+    error = "Cancelled";
+  }
+  const int64_t elapsed_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - started)
+          .count();
+  out.Set("ok", ok);
+  out.Set("cancelled", cancel_.load());
+  out.Set("error", ok ? std::string() : error);
+  if (ok) {
+    out.Set("path", config.output);
+    out.Set("infoHash", info_hash);
+    out.Set("name", name);
+    out.Set("seedDir", seed_dir);
+    out.Set("pieceLength", piece_length);
+    out.Set("pieces", static_cast<int64_t>(pieces.size() /
+                                           common::Sha1::kDigestSize));
+    out.Set("totalLength", total);
+    out.Set("files", static_cast<int64_t>(files.size()));
+    out.Set("threads", static_cast<int32_t>(threads));
+    out.Set("kernel", common::Sha1::Kernel());
+    out.Set("elapsedMs", elapsed_ms);
+    out.Set("bytesPerSecond",
+            elapsed_ms > 0 ? total * 1000 / elapsed_ms : total * 1000);
+  }
+  running_.store(false);
+  on_done(std::move(out));
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
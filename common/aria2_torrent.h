@@ -0,0 +1,102 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_TORRENT_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_TORRENT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+struct TorrentConfig {
+  // Files or directories to publish, all in the same directory. A single
+  // file makes a single-file torrent named after it, a single directory a
+  // multi-file torrent named after the directory, and several paths a
+  // multi-file torrent named after their common directory.
+  std::vector<std::string> paths;
+  // Where the .torrent file is written.
+  std::string output;
+  // Power of two; 0 picks one with PickPieceLength.
+  int64_t piece_length = 0;
+  // The first tracker is the announce URL; every tracker gets its own tier.
+  std::vector<std::string> trackers;
+  std::vector<std::string> webseeds;
+  std::string comment;
+  bool private_torrent = false;
+  // Hashing threads; 0 uses one per core.
+  int threads = 0;
+};
+
+constexpr int64_t kMinTorrentPieceLength = 16 * 1024;
+constexpr int64_t kMaxTorrentPieceLength = 64 * 1024 * 1024;
+
+// The smallest power of two from 256 KiB up to 16 MiB that keeps the
+// torrent at no more than about 2000 pieces.
+int64_t PickPieceLength(int64_t total_length);
+
+// Creates .torrent files on a worker thread. Pieces are SHA-1 hashed in
+// parallel: each hashing thread takes batches of consecutive pieces and
+// reads them through read-only mappings of the input files, asking the OS
+// to read each batch ahead. Files that cannot be mapped (32-bit builds) are
+// read with positional reads instead.
+class TorrentCreator {
+ public:
+  using Callback = std::function<void(common::Value)>;
+
+  TorrentCreator() = default;
+  ~TorrentCreator();
+
+  TorrentCreator(const TorrentCreator&) = delete;
+  TorrentCreator& operator=(const TorrentCreator&) = delete;
+
+  // Returns false when a torrent is already being created. |on_done| is
+  // called on the worker thread with the result: {ok, error, cancelled} and,
+  // on success, {path, infoHash, name, seedDir, pieceLength, pieces,
+  // totalLength, files, threads, kernel, elapsedMs, bytesPerSecond}.
+  bool Start(TorrentConfig config, Callback on_done);
+
+  bool running() const { return running_.load(); }
+
+  // {running, hashedBytes, totalBytes} of the current or last torrent.
+  common::Value Progress() const;
+
+  // Ends the current torrent; the cancellation is still reported.
+  void Cancel();
+
+  // Aborts the current torrent and joins the worker without reporting.
+  void Stop();
+
+ private:
+  struct SourceFile {
+    std::string path;
+    std::vector<std::string> components;  // Relative to the torrent root.
+    int64_t offset = 0;
+    int64_t length = 0;
+  };
+
+  void Run(const TorrentConfig& config, const Callback& on_done);
+  bool CollectFiles(const TorrentConfig& config, std::string* name,
+                    std::string* seed_dir, bool* single_file,
+                    std::vector<SourceFile>* files, std::string* error);
+  bool HashPieces(const std::vector<SourceFile>& files, int64_t piece_length,
+                  int threads, std::string* pieces, std::string* error);
+
+  std::mutex mutex_;
+  std::thread worker_;
+  std::atomic<bool> running_{false};
+  std::atomic<bool> cancel_{false};
+  std::atomic<bool> silent_{false};
+  std::atomic<int64_t> hashed_bytes_{0};
+  std::atomic<int64_t> total_bytes_{0};
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_TORRENT_H_
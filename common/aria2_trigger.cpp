@@ -0,0 +1,217 @@
+#include "aria2_trigger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <unordered_set>
+#include <utility>
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+std::vector<aria2_gid_t> TriggerActiveGids(aria2_session_t* session) {
+  std::vector<aria2_gid_t> out;
+  aria2_gid_t* gids = nullptr;
+  size_t count = 0;
+  if (aria2_get_active_download(session, &gids, &count) == 0 && gids != nullptr) {
+    out.assign(gids, gids + count);
+  }
+  if (gids != nullptr) {
+    aria2_free(gids);
+  }
+  return out;
+}
+}  // namespace
+
+int64_t ProgressTriggers::Register(ProgressTriggerSpec spec) {
+  std::sort(spec.eta_boundaries.begin(), spec.eta_boundaries.end());
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int64_t id = next_id_++;
+  triggers_[id].spec = std::move(spec);
+  return id;
+}
+
+bool ProgressTriggers::Unregister(int64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return triggers_.erase(id) > 0;
+}
+
+int64_t ProgressTriggers::PercentBucket(const ProgressTriggerSpec& spec,
+                                        const Sample& sample) {
+  if (spec.percent_step <= 0 || sample.total_length <= 0) {
+    return -1;
+  }
+  const double percent = static_cast<double>(sample.completed_length) * 100 /
+                         static_cast<double>(sample.total_length);
+  return static_cast<int64_t>(std::floor(percent / spec.percent_step));
+}
+
+int64_t ProgressTriggers::EtaBucket(const ProgressTriggerSpec& spec,
+                                    const Sample& sample) {
+  if (sample.estimate.eta_seconds < 0) {
+    return -1;
+  }
+  // Boundaries below the ETA; crossing one changes the count.
+  return std::lower_bound(spec.eta_boundaries.begin(),
+                          spec.eta_boundaries.end(),
+                          sample.estimate.eta_seconds) -
+         spec.eta_boundaries.begin();
+}
+
+void ProgressTriggers::EvaluateLocked(
+    int64_t id, Trigger* trigger, aria2_gid_t gid, const Sample& sample,
+    bool last, std::chrono::steady_clock::time_point now,
+    std::vector<ProgressTriggerHit>* out) {
+  const ProgressTriggerSpec& spec = trigger->spec;
+  const int64_t percent = PercentBucket(spec, sample);
+  const int64_t eta = EtaBucket(spec, sample);
+  const int64_t speed = sample.estimate.avg_speed;
+  auto it = trigger->baselines.find(gid);
+  if (it == trigger->baselines.end()) {
+    Baseline& baseline = trigger->baselines[gid];
+    baseline.percent_bucket = percent;
+    baseline.speed = speed;
+    baseline.eta_bucket = eta;
+    return;
+  }
+  Baseline& baseline = it->second;
+  int32_t reasons = 0;
+  if (spec.percent_step > 0 && percent != baseline.percent_bucket) {
+    reasons |= kReasonPercent;
+  }
+  if (spec.speed_delta_pct > 0 &&
+      (baseline.speed == 0
+           ? speed > 0
+           : static_cast<double>(std::llabs(speed - baseline.speed)) * 100 >=
+                 spec.speed_delta_pct * static_cast<double>(baseline.speed))) {
+    reasons |= kReasonSpeed;
+  }
+  if (!spec.eta_boundaries.empty() && eta != baseline.eta_bucket) {
+    reasons |= kReasonEta;
+  }
+  if (reasons == 0 ||
+      (!last && now - baseline.last_hit <
+                    std::chrono::milliseconds(spec.min_interval_ms))) {
+    return;
+  }
+  baseline.percent_bucket = percent;
+  baseline.speed = speed;
+  baseline.eta_bucket = eta;
+  baseline.last_hit = now;
+  ProgressTriggerHit hit;
+  hit.id = id;
+  hit.gid = gid;
+  hit.total_length = sample.total_length;
+  hit.completed_length = sample.completed_length;
+  hit.speed = sample.speed;
+  hit.avg_speed = sample.estimate.avg_speed;
+  hit.eta_seconds = sample.estimate.eta_seconds;
+  hit.reasons = reasons;
+  out->push_back(hit);
+  ++hits_;
+}
+
+std::vector<ProgressTriggerHit> ProgressTriggers::OnTick(
+    aria2_session_t* session, const SpeedHistory& speeds) {
+  std::vector<ProgressTriggerHit> out;
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto now = std::chrono::steady_clock::now();
+  if (triggers_.empty() ||
+      now - last_tick_ < std::chrono::milliseconds(kTriggerTickMs)) {
+    return out;
+  }
+  last_tick_ = now;
+
+  // Sample each download once, whatever the number of triggers on it.
+  bool watch_all = false;
+  std::unordered_set<aria2_gid_t> wanted;
+  for (const auto& item : triggers_) {
+    const Trigger& trigger = item.second;
+    if (trigger.spec.gid != 0) {
+      wanted.insert(trigger.spec.gid);
+      continue;
+    }
+    watch_all = true;
+    for (const auto& baseline : trigger.baselines) {
+      wanted.insert(baseline.first);
+    }
+  }
+  std::unordered_set<aria2_gid_t> active;
+  if (watch_all) {
+    for (aria2_gid_t gid : TriggerActiveGids(session)) {
+      active.insert(gid);
+      wanted.insert(gid);
+    }
+  }
+  std::unordered_map<aria2_gid_t, Sample> samples;
+  for (aria2_gid_t gid : wanted) {
+    aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+    if (handle == nullptr) {
+      continue;
+    }
+    Sample sample;
+    sample.total_length = aria2_download_handle_get_total_length(handle);
+    sample.completed_length =
+        aria2_download_handle_get_completed_length(handle);
+    sample.speed = aria2_download_handle_get_download_speed(handle);
+    aria2_delete_download_handle(handle);
+    sample.estimate = speeds.Estimate(gid, sample.total_length,
+                                      sample.completed_length, sample.speed);
+    samples[gid] = sample;
+  }
+
+  for (auto& item : triggers_) {
+    Trigger& trigger = item.second;
+    if (trigger.spec.gid != 0) {
+      auto sample = samples.find(trigger.spec.gid);
+      if (sample != samples.end()) {
+        EvaluateLocked(item.first, &trigger, trigger.spec.gid, sample->second,
+                       false, now, &out);
+      }
+      continue;
+    }
+    for (aria2_gid_t gid : active) {
+      auto sample = samples.find(gid);
+      if (sample != samples.end()) {
+        EvaluateLocked(item.first, &trigger, gid, sample->second, false, now,
+                       &out);
+      }
+    }
+    for (auto it = trigger.baselines.begin(); it != trigger.baselines.end();) {
+      if (active.count(it->first) > 0) {
+        ++it;
+        continue;
+      }
+      auto sample = samples.find(it->first);
+      if (sample != samples.end()) {
+        EvaluateLocked(item.first, &trigger, it->first, sample->second, true,
+                       now, &out);
+      }
+      it = trigger.baselines.erase(it);
+    }
+  }
+  return out;
+}
+
+common::Value ProgressTriggers::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  int64_t watched = 0;
+  for (const auto& item : triggers_) {
+    watched += static_cast<int64_t>(item.second.baselines.size());
+  }
+  common::Value out = common::Value::NewMap();
+  out.Set("triggers", static_cast<int64_t>(triggers_.size()));
+  out.Set("watched", watched);
+  out.Set("hits", hits_);
+  return out;
+}
+
+void ProgressTriggers::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  triggers_.clear();
+  last_tick_ = std::chrono::steady_clock::time_point();
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
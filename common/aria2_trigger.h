@@ -0,0 +1,121 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_TRIGGER_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_TRIGGER_H_
+
+#include <aria2_c_api.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "aria2_speed.h"
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+struct ProgressTriggerSpec {
+  aria2_gid_t gid = 0;  // 0 watches every active download.
+  double percent_step = 0;     // Fire per step of progress; 0 to ignore.
+  double speed_delta_pct = 0;  // Fire when the speed moves this much.
+  // Fire when the ETA (seconds) crosses one of these. Sorted ascending.
+  std::vector<int64_t> eta_boundaries;
+  int64_t min_interval_ms = 0;  // Between two hits of one download.
+};
+
+struct ProgressTriggerHit {
+  int64_t id = 0;
+  aria2_gid_t gid = 0;
+  int64_t total_length = 0;
+  int64_t completed_length = 0;
+  int64_t speed = 0;
+  int64_t avg_speed = 0;
+  int64_t eta_seconds = -1;
+  int32_t reasons = 0;  // ProgressTriggers::Reason bits.
+};
+
+// Fires when a download's progress changes in a way the caller cares about,
+// instead of the caller polling every download.
+//
+// Every kTriggerTickMs the run-loop thread samples each download a trigger
+// watches once, however many triggers watch it, and compares it against
+// what was last reported for that trigger: the progress step it was in, the
+// smoothed speed (from SpeedHistory) and the ETA interval between two
+// boundaries. A change that comes sooner than |min_interval_ms| after the
+// previous hit is reported once the interval has passed, if it still
+// holds. The first sample of a download only sets the baseline; downloads
+// that leave the active list are sampled once more and then dropped.
+class ProgressTriggers {
+ public:
+  static constexpr int kTriggerTickMs = 250;
+
+  enum Reason : int32_t {
+    kReasonPercent = 1,
+    kReasonSpeed = 2,
+    kReasonEta = 4,
+  };
+
+  ProgressTriggers() = default;
+
+  ProgressTriggers(const ProgressTriggers&) = delete;
+  ProgressTriggers& operator=(const ProgressTriggers&) = delete;
+
+  // Returns the id of the new trigger.
+  int64_t Register(ProgressTriggerSpec spec);
+  // Returns false when |id| is not registered.
+  bool Unregister(int64_t id);
+
+  // Hits of all triggers, at most every kTriggerTickMs.
+  std::vector<ProgressTriggerHit> OnTick(aria2_session_t* session,
+                                         const SpeedHistory& speeds);
+
+  // {triggers, watched, hits}.
+  common::Value Describe() const;
+
+  // Drops every trigger; their gids went away with the session.
+  void Reset();
+
+ private:
+  struct Baseline {
+    int64_t percent_bucket = -1;
+    int64_t speed = 0;
+    int64_t eta_bucket = -1;
+    std::chrono::steady_clock::time_point last_hit;
+  };
+
+  struct Trigger {
+    ProgressTriggerSpec spec;
+    std::unordered_map<aria2_gid_t, Baseline> baselines;
+  };
+
+  struct Sample {
+    int64_t total_length = 0;
+    int64_t completed_length = 0;
+    int64_t speed = 0;
+    SpeedEstimate estimate;
+  };
+
+  // Compares |sample| against the baseline of |gid| and records a hit.
+  // The last sample of a download is not held back by |min_interval_ms|.
+  void EvaluateLocked(int64_t id, Trigger* trigger, aria2_gid_t gid,
+                      const Sample& sample, bool last,
+                      std::chrono::steady_clock::time_point now,
+                      std::vector<ProgressTriggerHit>* out);
+  static int64_t PercentBucket(const ProgressTriggerSpec& spec,
+                               const Sample& sample);
+  static int64_t EtaBucket(const ProgressTriggerSpec& spec,
+                           const Sample& sample);
+
+  mutable std::mutex mutex_;
+  std::map<int64_t, Trigger> triggers_;
+  int64_t next_id_ = 1;
+  int64_t hits_ = 0;
+  std::chrono::steady_clock::time_point last_tick_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_TRIGGER_H_
@@ -0,0 +1,91 @@
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace common {
+
+namespace {
+const Value& NullValue() {
+  static const Value* value = new Value();
+  return *value;
+}
+}  // namespace
+
+bool Value::AsBool(bool def) const {
+  return type_ == Type::kBool ? bool_ : def;
+}
+
+int64_t Value::AsInt(int64_t def) const {
+  if (type_ == Type::kInt) return int_;
+  if (type_ == Type::kDouble) return static_cast<int64_t>(double_);
+  return def;
+}
+
+double Value::AsDouble(double def) const {
+  if (type_ == Type::kDouble) return double_;
+  if (type_ == Type::kInt) return static_cast<double>(int_);
+  return def;
+}
+
+const std::string& Value::AsString() const {
+  static const std::string* empty = new std::string();
+  return type_ == Type::kString ? string_ : *empty;
+}
+
+const Value::Bytes& Value::AsBytes() const {
+  static const Bytes* empty = new Bytes();
+  return type_ == Type::kBytes ? bytes_ : *empty;
+}
+
+const Value::List& Value::AsList() const {
+  static const List* empty = new List();
+  return type_ == Type::kList ? list_ : *empty;
+}
+
+const Value::Map& Value::AsMap() const {
+  static const Map* empty = new Map();
+  return type_ == Type::kMap ? map_ : *empty;
+}
+
+Value::Bytes& Value::bytes() {
+  if (type_ == Type::kNull) type_ = Type::kBytes;
+  return bytes_;
+}
+
+Value::List& Value::list() {
+  if (type_ == Type::kNull) type_ = Type::kList;
+  return list_;
+}
+
+Value::Map& Value::map() {
+  if (type_ == Type::kNull) type_ = Type::kMap;
+  return map_;
+}
+
+const Value& Value::Get(const std::string& key) const {
+  if (type_ != Type::kMap) return NullValue();
+  auto it = map_.find(key);
+  return it == map_.end() ? NullValue() : it->second;
+}
+
+void Value::Set(const std::string& key, Value value) {
+  map()[key] = std::move(value);
+}
+
+void Value::Append(Value value) {
+  list().push_back(std::move(value));
+}
+
+std::vector<std::string> Value::AsStringList() const {
+  std::vector<std::string> out;
+  if (type_ != Type::kList) return out;
+  out.reserve(list_.size());
+  for (const Value& item : list_) {
+    if (item.type_ == Type::kString) {
+      out.push_back(item.string_);
+    }
+  }
+  return out;
+}
+
+}  // namespace common
+}  // namespace flutter_aria2
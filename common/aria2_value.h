@@ -0,0 +1,82 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_VALUE_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_VALUE_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace flutter_aria2 {
+namespace common {
+
+// Codec-neutral value mirroring the StandardMessageCodec types. Shared method
+// handlers in common/ read their arguments from and write their results to a
+// Value; each platform converts it to/from its own channel representation.
+class Value {
+ public:
+  enum class Type { kNull, kBool, kInt, kDouble, kString, kBytes, kList, kMap };
+
+  using Bytes = std::vector<uint8_t>;
+  using List = std::vector<Value>;
+  using Map = std::map<std::string, Value>;
+
+  Value() = default;
+  Value(bool value) : type_(Type::kBool), bool_(value) {}
+  Value(int32_t value) : type_(Type::kInt), int_(value) {}
+  Value(int64_t value) : type_(Type::kInt), int_(value) {}
+  Value(double value) : type_(Type::kDouble), double_(value) {}
+  Value(const char* value)
+      : type_(Type::kString), string_(value == nullptr ? "" : value) {}
+  Value(std::string value) : type_(Type::kString), string_(std::move(value)) {}
+  Value(Bytes value) : type_(Type::kBytes), bytes_(std::move(value)) {}
+  Value(List value) : type_(Type::kList), list_(std::move(value)) {}
+  Value(Map value) : type_(Type::kMap), map_(std::move(value)) {}
+
+  static Value NewList() { return Value(List()); }
+  static Value NewMap() { return Value(Map()); }
+
+  Type type() const { return type_; }
+  bool IsNull() const { return type_ == Type::kNull; }
+  bool IsInt() const { return type_ == Type::kInt; }
+  bool IsString() const { return type_ == Type::kString; }
+  bool IsList() const { return type_ == Type::kList; }
+  bool IsMap() const { return type_ == Type::kMap; }
+
+  // Typed accessors return |def| (or an empty container) on type mismatch.
+  bool AsBool(bool def = false) const;
+  int64_t AsInt(int64_t def = 0) const;
+  double AsDouble(double def = 0) const;
+  const std::string& AsString() const;
+  const Bytes& AsBytes() const;
+  const List& AsList() const;
+  const Map& AsMap() const;
+
+  // Mutable access; converts a null value to an empty container first.
+  Bytes& bytes();
+  List& list();
+  Map& map();
+
+  // Map lookup; returns a null Value when absent or when this is not a map.
+  const Value& Get(const std::string& key) const;
+  bool Has(const std::string& key) const { return !Get(key).IsNull(); }
+  void Set(const std::string& key, Value value);
+  void Append(Value value);
+
+  // Collects the string items of a list, skipping anything else.
+  std::vector<std::string> AsStringList() const;
+
+ private:
+  Type type_ = Type::kNull;
+  bool bool_ = false;
+  int64_t int_ = 0;
+  double double_ = 0;
+  std::string string_;
+  Bytes bytes_;
+  List list_;
+  Map map_;
+};
+
+}  // namespace common
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_VALUE_H_
@@ -0,0 +1,371 @@
+#include "aria2_virtual_queue.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "aria2_helpers.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+constexpr char kIndexMagic[8] = {'F', 'A', 'V', 'Q', 'I', 'D', 'X', '1'};
+constexpr char kHeapMagic[8] = {'F', 'A', 'V', 'Q', 'H', 'E', 'A', 'P'};
+constexpr uint64_t kNoOptions = ~uint64_t{0};
+constexpr auto kVirtualTickInterval = std::chrono::milliseconds(250);
+constexpr int kStateCount = 5;
+
+struct HeapHeader {
+  char magic[8];
+  uint64_t size;  // Logical bytes, header included.
+};
+
+// One entry of the index file.
+struct VirtualRecord {
+  uint64_t uris;     // Heap offset of NUL-terminated URIs.
+  uint64_t options;  // Heap offset of NUL-terminated key/value pairs.
+  uint64_t gid;      // Set once materialized.
+  uint32_t uris_size;
+  uint32_t options_size;
+  uint8_t state;
+  uint8_t reserved[3];
+  int32_t error_code;
+};
+static_assert(sizeof(VirtualRecord) == 40, "record layout is on disk");
+
+struct VirtualHeader {
+  char magic[8];
+  uint64_t count;
+  uint64_t cursor;  // Every record below it has left the pending state.
+  uint64_t states[kStateCount];
+};
+static_assert(sizeof(VirtualHeader) == 64, "header layout is on disk");
+
+VirtualHeader* HeaderOf(const common::MappedFile& index) {
+  return reinterpret_cast<VirtualHeader*>(index.data());
+}
+
+VirtualRecord* RecordOf(const common::MappedFile& index, int64_t id) {
+  return reinterpret_cast<VirtualRecord*>(index.data() +
+                                          sizeof(VirtualHeader)) +
+         id;
+}
+
+void SetRecordState(const common::MappedFile& index, VirtualRecord* entry,
+                    VirtualState state) {
+  VirtualHeader* head = HeaderOf(index);
+  --head->states[entry->state];
+  entry->state = static_cast<uint8_t>(state);
+  ++head->states[entry->state];
+}
+
+std::vector<std::string> SplitStrings(const char* data, uint64_t size) {
+  std::vector<std::string> out;
+  const char* end = data + size;
+  while (data < end) {
+    const size_t length = std::strlen(data);
+    out.emplace_back(data, length);
+    data += length + 1;
+  }
+  return out;
+}
+}  // namespace
+
+VirtualQueue::~VirtualQueue() { Close(); }
+
+bool VirtualQueue::Open(const std::string& dir, int lookahead,
+                        std::string* error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (index_.is_open()) {
+    RequeueInFlight();
+    index_.Close();
+    heap_.Close();
+  }
+  lookahead_ = lookahead;
+  if (!index_.Open(dir + "/virtual_queue.idx", sizeof(VirtualHeader), error) ||
+      !heap_.Open(dir + "/virtual_queue.heap", sizeof(HeapHeader), error)) {
+    index_.Close();
+    heap_.Close();
+    return false;
+  }
+
+  VirtualHeader* head = HeaderOf(index_);
+  auto* heap_head = reinterpret_cast<HeapHeader*>(heap_.data());
+  static const char kZero[8] = {};
+  if (std::memcmp(head->magic, kZero, 8) == 0 &&
+      std::memcmp(heap_head->magic, kZero, 8) == 0) {
+    // New files are zero-filled.
+    std::memcpy(head->magic, kIndexMagic, 8);
+    std::memcpy(heap_head->magic, kHeapMagic, 8);
+    heap_head->size = sizeof(HeapHeader);
+  } else if (std::memcmp(head->magic, kIndexMagic, 8) != 0 ||
+             std::memcmp(heap_head->magic, kHeapMagic, 8) != 0 ||
+             head->cursor > head->count ||
+             sizeof(VirtualHeader) + head->count * sizeof(VirtualRecord) >
+                 index_.size() ||
+             heap_head->size > heap_.size()) {
+    *error = "Not a virtual queue store: " + dir;
+    index_.Close();
+    heap_.Close();
+    return false;
+  }
+
+  const uint8_t materialized = static_cast<uint8_t>(VirtualState::kMaterialized);
+  if (head->states[materialized] > 0) {
+    // The process ended with downloads in aria2; those gids are gone.
+    for (uint64_t id = 0; id < head->count; ++id) {
+      VirtualRecord* entry = RecordOf(index_, static_cast<int64_t>(id));
+      if (entry->state == materialized) {
+        SetRecordState(index_, entry, VirtualState::kPending);
+        entry->gid = 0;
+        head->cursor = std::min(head->cursor, id);
+      }
+    }
+  }
+  in_flight_.clear();
+  slots_freed_ = true;
+  return true;
+}
+
+void VirtualQueue::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!index_.is_open()) {
+    return;
+  }
+  RequeueInFlight();
+  // MAP_SHARED pages survive a process crash on their own; syncing here
+  // covers power loss for a clean shutdown.
+  index_.Sync();
+  heap_.Sync();
+  index_.Close();
+  heap_.Close();
+}
+
+bool VirtualQueue::is_open() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return index_.is_open();
+}
+
+uint64_t VirtualQueue::AppendStrings(const std::vector<std::string>& strings) {
+  auto* heap_head = reinterpret_cast<HeapHeader*>(heap_.data());
+  const uint64_t offset = heap_head->size;
+  char* out = heap_.data() + offset;
+  for (const std::string& value : strings) {
+    std::memcpy(out, value.c_str(), value.size() + 1);
+    out += value.size() + 1;
+  }
+  heap_head->size = static_cast<uint64_t>(out - heap_.data());
+  return offset;
+}
+
+int64_t VirtualQueue::Append(
+    const std::vector<std::vector<std::string>>& entries,
+    const std::vector<std::pair<std::string, std::string>>& options,
+    std::string* error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!index_.is_open()) {
+    *error = "The virtual queue is not open";
+    return -1;
+  }
+  std::vector<std::string> flat_options;
+  size_t heap_bytes = 0;
+  for (const auto& option : options) {
+    flat_options.push_back(option.first);
+    flat_options.push_back(option.second);
+    heap_bytes += option.first.size() + option.second.size() + 2;
+  }
+  const size_t options_size = heap_bytes;
+  for (const std::vector<std::string>& uris : entries) {
+    for (const std::string& uri : uris) {
+      heap_bytes += uri.size() + 1;
+    }
+  }
+  // Reserve everything up front so a batch is added entirely or not at all.
+  const uint64_t first = HeaderOf(index_)->count;
+  const size_t heap_size = reinterpret_cast<HeapHeader*>(heap_.data())->size;
+  if (!index_.Reserve(sizeof(VirtualHeader) +
+                          (first + entries.size()) * sizeof(VirtualRecord),
+                      error) ||
+      !heap_.Reserve(heap_size + heap_bytes, error)) {
+    // A failed remap leaves the store unusable; reopen it to retry.
+    in_flight_.clear();
+    index_.Close();
+    heap_.Close();
+    return -1;
+  }
+
+  const uint64_t options_offset =
+      flat_options.empty() ? kNoOptions : AppendStrings(flat_options);
+  VirtualHeader* head = HeaderOf(index_);
+  for (const std::vector<std::string>& uris : entries) {
+    const uint64_t uris_offset = AppendStrings(uris);
+    VirtualRecord* entry = RecordOf(index_, static_cast<int64_t>(head->count));
+    std::memset(entry, 0, sizeof(VirtualRecord));
+    entry->uris = uris_offset;
+    entry->uris_size = static_cast<uint32_t>(
+        reinterpret_cast<HeapHeader*>(heap_.data())->size - uris_offset);
+    entry->options = options_offset;
+    entry->options_size = static_cast<uint32_t>(options_size);
+    entry->state = static_cast<uint8_t>(VirtualState::kPending);
+    ++head->states[entry->state];
+    // Publish the record only once it is complete.
+    ++head->count;
+  }
+  slots_freed_ = true;
+  return static_cast<int64_t>(first);
+}
+
+void VirtualQueue::OnDownloadEvent(aria2_session_t* session,
+                                   aria2_download_event_t event,
+                                   aria2_gid_t gid) {
+  VirtualState state;
+  switch (event) {
+    case ARIA2_EVENT_ON_DOWNLOAD_COMPLETE:
+      state = VirtualState::kComplete;
+      break;
+    case ARIA2_EVENT_ON_DOWNLOAD_ERROR:
+      state = VirtualState::kError;
+      break;
+    case ARIA2_EVENT_ON_DOWNLOAD_STOP:
+      state = VirtualState::kRemoved;
+      break;
+    default:
+      return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = in_flight_.find(gid);
+  if (it == in_flight_.end() || !index_.is_open()) {
+    return;
+  }
+  VirtualRecord* entry = RecordOf(index_, it->second);
+  in_flight_.erase(it);
+  SetRecordState(index_, entry, state);
+  if (state == VirtualState::kError) {
+    aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+    if (handle != nullptr) {
+      entry->error_code = aria2_download_handle_get_error_code(handle);
+      aria2_delete_download_handle(handle);
+    }
+  }
+  slots_freed_ = true;
+}
+
+std::vector<VirtualQueue::Materialized> VirtualQueue::OnTick(
+    aria2_session_t* session) {
+  std::vector<Materialized> out;
+  const auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!index_.is_open() ||
+      (!slots_freed_ && now - last_tick_ < kVirtualTickInterval)) {
+    return out;
+  }
+  slots_freed_ = false;
+  last_tick_ = now;
+
+  // Re-read every time: the adaptive controller may change it.
+  const size_t target = static_cast<size_t>(
+      std::max(1, common::GetGlobalOptionInt(session,
+                                             "max-concurrent-downloads", 5)) +
+      lookahead_);
+  VirtualHeader* head = HeaderOf(index_);
+  while (in_flight_.size() < target && head->cursor < head->count) {
+    const int64_t id = static_cast<int64_t>(head->cursor++);
+    VirtualRecord* entry = RecordOf(index_, id);
+    if (entry->state != static_cast<uint8_t>(VirtualState::kPending)) {
+      continue;
+    }
+    Materialized item;
+    item.id = id;
+    item.uris = SplitStrings(heap_.data() + entry->uris, entry->uris_size);
+    common::KeyVals options;
+    if (entry->options != kNoOptions) {
+      const std::vector<std::string> flat =
+          SplitStrings(heap_.data() + entry->options, entry->options_size);
+      for (size_t i = 0; i + 1 < flat.size(); i += 2) {
+        options.Add(flat[i], flat[i + 1]);
+        item.options.emplace_back(flat[i], flat[i + 1]);
+      }
+    }
+    std::vector<const char*> uri_ptrs;
+    for (const std::string& uri : item.uris) {
+      uri_ptrs.push_back(uri.c_str());
+    }
+    if (aria2_add_uri(session, &item.gid, uri_ptrs.data(), uri_ptrs.size(),
+                      options.data(), options.count(), -1) != 0) {
+      // Rejected by aria2 (bad URI or option); it will never succeed.
+      entry->error_code = -1;
+      SetRecordState(index_, entry, VirtualState::kError);
+      continue;
+    }
+    entry->gid = item.gid;
+    SetRecordState(index_, entry, VirtualState::kMaterialized);
+    in_flight_[item.gid] = id;
+    out.push_back(std::move(item));
+  }
+  return out;
+}
+
+bool VirtualQueue::Describe(int64_t id, common::Value* out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!index_.is_open() || id < 0 ||
+      static_cast<uint64_t>(id) >= HeaderOf(index_)->count) {
+    return false;
+  }
+  const VirtualRecord* entry = RecordOf(index_, id);
+  *out = common::Value::NewMap();
+  out->Set("id", id);
+  out->Set("state", static_cast<int32_t>(entry->state));
+  if (entry->gid != 0) {
+    out->Set("gid", common::GidToHex(entry->gid));
+  }
+  out->Set("errorCode", static_cast<int32_t>(entry->error_code));
+  common::Value uris = common::Value::NewList();
+  for (std::string& uri :
+       SplitStrings(heap_.data() + entry->uris, entry->uris_size)) {
+    uris.Append(std::move(uri));
+  }
+  out->Set("uris", std::move(uris));
+  return true;
+}
+
+common::Value VirtualQueue::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewMap();
+  out.Set("open", index_.is_open());
+  out.Set("lookahead", static_cast<int32_t>(lookahead_));
+  if (!index_.is_open()) {
+    return out;
+  }
+  const VirtualHeader* head = HeaderOf(index_);
+  out.Set("total", static_cast<int64_t>(head->count));
+  static const char* const kStateNames[kStateCount] = {
+      "pending", "materialized", "complete", "error", "removed"};
+  for (int i = 0; i < kStateCount; ++i) {
+    out.Set(kStateNames[i], static_cast<int64_t>(head->states[i]));
+  }
+  return out;
+}
+
+void VirtualQueue::RequeueInFlight() {
+  if (!index_.is_open()) {
+    in_flight_.clear();
+    return;
+  }
+  VirtualHeader* head = HeaderOf(index_);
+  for (const auto& item : in_flight_) {
+    VirtualRecord* entry = RecordOf(index_, item.second);
+    entry->gid = 0;
+    SetRecordState(index_, entry, VirtualState::kPending);
+    head->cursor = std::min(head->cursor, static_cast<uint64_t>(item.second));
+  }
+  in_flight_.clear();
+  slots_freed_ = true;
+}
+
+void VirtualQueue::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  RequeueInFlight();
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
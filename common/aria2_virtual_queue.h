@@ -0,0 +1,93 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_VIRTUAL_QUEUE_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_VIRTUAL_QUEUE_H_
+
+#include <aria2_c_api.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "aria2_mapped_file.h"
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// Values mirror the Dart `Aria2VirtualState` enum.
+enum class VirtualState : uint8_t {
+  kPending = 0,
+  kMaterialized = 1,
+  kComplete = 2,
+  kError = 3,
+  kRemoved = 4,
+};
+
+// Out-of-core queue for very large batches of URI downloads.
+//
+// Entries live in two append-only memory-mapped files in the queue
+// directory: a fixed-size record index and a string heap holding the URIs
+// and the option set shared by each appended batch. Only
+// max-concurrent-downloads plus |lookahead| entries are handed to aria2 at
+// a time; finished downloads free their slot from the event callback and
+// the next tick materializes more. Virtual ids are record indices and stay
+// valid across restarts. Entries that were in aria2 when the session ended
+// (or the process died) go back to pending.
+class VirtualQueue {
+ public:
+  struct Materialized {
+    int64_t id = 0;
+    aria2_gid_t gid = 0;
+    std::vector<std::string> uris;
+    std::vector<std::pair<std::string, std::string>> options;
+  };
+
+  ~VirtualQueue();
+
+  bool Open(const std::string& dir, int lookahead, std::string* error);
+  void Close();
+  bool is_open() const;
+
+  // Appends one entry per URI list, all sharing |options|. Returns the id
+  // of the first entry (ids are consecutive), or -1 with |error| set.
+  int64_t Append(const std::vector<std::vector<std::string>>& entries,
+                 const std::vector<std::pair<std::string, std::string>>& options,
+                 std::string* error);
+
+  // Runs in the download event callback.
+  void OnDownloadEvent(aria2_session_t* session, aria2_download_event_t event,
+                       aria2_gid_t gid);
+
+  // Hands pending entries to aria2 while there are free slots.
+  std::vector<Materialized> OnTick(aria2_session_t* session);
+
+  // {id, state, gid, errorCode, uris}, or false for an unknown id.
+  bool Describe(int64_t id, common::Value* out) const;
+  // {open, total, pending, materialized, complete, error, removed, lookahead}.
+  common::Value Describe() const;
+
+  // Session ended: entries still in aria2 become pending again.
+  void Reset();
+
+ private:
+  // Copies |strings| NUL-terminated to the end of the heap, which must have
+  // room for them. Returns their offset.
+  uint64_t AppendStrings(const std::vector<std::string>& strings);
+  void RequeueInFlight();
+
+  mutable std::mutex mutex_;
+  common::MappedFile index_;
+  common::MappedFile heap_;
+  int lookahead_ = 2;
+  std::unordered_map<aria2_gid_t, int64_t> in_flight_;
+  bool slots_freed_ = false;
+  std::chrono::steady_clock::time_point last_tick_;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_VIRTUAL_QUEUE_H_
@@ -0,0 +1,341 @@
+#include "aria2_waiter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+#include "aria2_helpers.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+namespace {
+// The fields getDownloadInfo reports, read while the download still has
+// the state it settled with.
+common::Value WaiterInfoSnapshot(aria2_session_t* session, aria2_gid_t gid,
+                                 const SpeedHistory& speeds) {
+  common::Value info = common::Value::NewMap();
+  info.Set("gid", common::GidToHex(gid));
+  aria2_download_handle_t* handle =
+      session == nullptr ? nullptr : aria2_get_download_handle(session, gid);
+  if (handle == nullptr) {
+    return info;
+  }
+  const int64_t total_length = aria2_download_handle_get_total_length(handle);
+  const int64_t completed_length =
+      aria2_download_handle_get_completed_length(handle);
+  const int64_t download_speed =
+      aria2_download_handle_get_download_speed(handle);
+  info.Set("status",
+           static_cast<int32_t>(aria2_download_handle_get_status(handle)));
+  info.Set("totalLength", total_length);
+  info.Set("completedLength", completed_length);
+  info.Set("uploadLength", aria2_download_handle_get_upload_length(handle));
+  info.Set("downloadSpeed", download_speed);
+  info.Set("uploadSpeed",
+           static_cast<int64_t>(aria2_download_handle_get_upload_speed(handle)));
+  const SpeedEstimate estimate =
+      speeds.Estimate(gid, total_length, completed_length, download_speed);
+  info.Set("avgSpeed", estimate.avg_speed);
+  info.Set("eta", estimate.eta_seconds);
+
+  std::string info_hash;
+  aria2_binary_t binary = aria2_download_handle_get_info_hash(handle);
+  if (binary.data != nullptr) {
+    for (size_t i = 0; i < binary.length; ++i) {
+      char buffer[3];
+      std::snprintf(buffer, sizeof(buffer), "%02x", binary.data[i]);
+      info_hash += buffer;
+    }
+    aria2_free_binary(&binary);
+  }
+  info.Set("infoHash", std::move(info_hash));
+  info.Set("pieceLength",
+           static_cast<int64_t>(aria2_download_handle_get_piece_length(handle)));
+  info.Set("numPieces",
+           static_cast<int64_t>(aria2_download_handle_get_num_pieces(handle)));
+  info.Set("connections",
+           static_cast<int64_t>(aria2_download_handle_get_connections(handle)));
+  info.Set("errorCode",
+           static_cast<int64_t>(aria2_download_handle_get_error_code(handle)));
+  common::Value followed_by = common::Value::NewList();
+  aria2_gid_t* followed = nullptr;
+  size_t followed_count = 0;
+  if (aria2_download_handle_get_followed_by(handle, &followed,
+                                            &followed_count) == 0) {
+    for (size_t i = 0; i < followed_count; ++i) {
+      followed_by.Append(common::GidToHex(followed[i]));
+    }
+  }
+  if (followed != nullptr) {
+    aria2_free(followed);
+  }
+  info.Set("followedBy", std::move(followed_by));
+  info.Set("following",
+           common::GidToHex(aria2_download_handle_get_following(handle)));
+  info.Set("belongsTo",
+           common::GidToHex(aria2_download_handle_get_belongs_to(handle)));
+  char* dir = aria2_download_handle_get_dir(handle);
+  info.Set("dir", std::string(dir == nullptr ? "" : dir));
+  if (dir != nullptr) {
+    aria2_free(dir);
+  }
+  info.Set("numFiles",
+           static_cast<int64_t>(aria2_download_handle_get_num_files(handle)));
+  aria2_delete_download_handle(handle);
+  return info;
+}
+
+bool SettlesWaiter(aria2_download_event_t event) {
+  return event == ARIA2_EVENT_ON_DOWNLOAD_COMPLETE ||
+         event == ARIA2_EVENT_ON_DOWNLOAD_ERROR ||
+         event == ARIA2_EVENT_ON_DOWNLOAD_STOP;
+}
+}  // namespace
+
+bool DownloadWaiters::Add(int64_t id, const std::vector<aria2_gid_t>& gids,
+                          int64_t timeout_ms, std::string* error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (waiters_.count(id) > 0) {
+    *error = "Waiter " + std::to_string(id) + " already exists";
+    return false;
+  }
+  Waiter& waiter = waiters_[id];
+  for (aria2_gid_t gid : gids) {
+    Entry entry;
+    entry.gid = gid;
+    waiter.entries.push_back(std::move(entry));
+    by_gid_[gid].push_back(id);
+  }
+  waiter.pending = waiter.entries.size();
+  if (timeout_ms > 0) {
+    waiter.has_deadline = true;
+    waiter.deadline = std::chrono::steady_clock::now() +
+                      std::chrono::milliseconds(timeout_ms);
+  }
+  return true;
+}
+
+void DownloadWaiters::SettleLocked(aria2_session_t* session, aria2_gid_t gid,
+                                   aria2_download_event_t event,
+                                   const SpeedHistory& speeds,
+                                   std::vector<SettledWaiter>* out) {
+  auto it = by_gid_.find(gid);
+  if (it == by_gid_.end()) {
+    return;
+  }
+  const std::vector<int64_t> ids = std::move(it->second);
+  by_gid_.erase(it);
+  const common::Value info = WaiterInfoSnapshot(session, gid, speeds);
+  for (int64_t id : ids) {
+    auto waiter = waiters_.find(id);
+    if (waiter == waiters_.end()) {
+      continue;
+    }
+    for (Entry& entry : waiter->second.entries) {
+      if (entry.gid == gid && entry.event == 0) {
+        entry.event = static_cast<int32_t>(event);
+        entry.retrying = false;
+        entry.info = info;
+        --waiter->second.pending;
+      }
+    }
+    if (waiter->second.pending == 0) {
+      out->push_back(TakeLocked(id, std::string(), false));
+    }
+  }
+}
+
+void DownloadWaiters::MarkRetryingLocked(aria2_gid_t gid) {
+  auto it = by_gid_.find(gid);
+  if (it == by_gid_.end()) {
+    return;
+  }
+  for (int64_t id : it->second) {
+    for (Entry& entry : waiters_[id].entries) {
+      if (entry.gid == gid && entry.event == 0) {
+        entry.retrying = true;
+      }
+    }
+  }
+}
+
+SettledWaiter DownloadWaiters::TakeLocked(int64_t id, std::string error,
+                                          bool timed_out) {
+  auto it = waiters_.find(id);
+  SettledWaiter out;
+  out.id = id;
+  out.error = std::move(error);
+  out.timed_out = timed_out;
+  out.results = common::Value::NewList();
+  for (Entry& entry : it->second.entries) {
+    common::Value result = common::Value::NewMap();
+    result.Set("gid", common::GidToHex(entry.gid));
+    result.Set("event", entry.event);
+    result.Set("info", entry.event == 0 ? common::Value::NewMap()
+                                        : std::move(entry.info));
+    out.results.Append(std::move(result));
+    if (entry.event != 0) {
+      continue;
+    }
+    auto ids = by_gid_.find(entry.gid);
+    if (ids != by_gid_.end()) {
+      ids->second.erase(
+          std::remove(ids->second.begin(), ids->second.end(), id),
+          ids->second.end());
+      if (ids->second.empty()) {
+        by_gid_.erase(ids);
+      }
+    }
+  }
+  waiters_.erase(it);
+  if (timed_out) {
+    ++timed_out_;
+  } else {
+    ++settled_;
+  }
+  return out;
+}
+
+std::vector<SettledWaiter> DownloadWaiters::OnDownloadEvent(
+    aria2_session_t* session, aria2_download_event_t event, aria2_gid_t gid,
+    bool retrying, const SpeedHistory& speeds) {
+  std::vector<SettledWaiter> out;
+  if (!SettlesWaiter(event)) {
+    return out;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = by_gid_.find(gid);
+  if (it == by_gid_.end()) {
+    return out;
+  }
+  if (retrying && event == ARIA2_EVENT_ON_DOWNLOAD_ERROR) {
+    MarkRetryingLocked(gid);
+    return out;
+  }
+  SettleLocked(session, gid, event, speeds, &out);
+  return out;
+}
+
+void DownloadWaiters::OnRetried(aria2_gid_t old_gid, aria2_gid_t new_gid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = by_gid_.find(old_gid);
+  if (it == by_gid_.end()) {
+    return;
+  }
+  std::vector<int64_t> ids = std::move(it->second);
+  by_gid_.erase(it);
+  for (int64_t id : ids) {
+    for (Entry& entry : waiters_[id].entries) {
+      if (entry.gid == old_gid && entry.event == 0) {
+        entry.gid = new_gid;
+        entry.retrying = false;
+      }
+    }
+  }
+  std::vector<int64_t>& moved = by_gid_[new_gid];
+  moved.insert(moved.end(), ids.begin(), ids.end());
+}
+
+std::vector<SettledWaiter> DownloadWaiters::OnGaveUp(
+    aria2_session_t* session, aria2_gid_t gid, const SpeedHistory& speeds) {
+  std::vector<SettledWaiter> out;
+  std::lock_guard<std::mutex> lock(mutex_);
+  SettleLocked(session, gid, ARIA2_EVENT_ON_DOWNLOAD_ERROR, speeds, &out);
+  return out;
+}
+
+std::vector<SettledWaiter> DownloadWaiters::OnTick(
+    aria2_session_t* session, const SpeedHistory& speeds,
+    const ChecksumVerifier& checksums, const RetryEngine& retry) {
+  std::vector<SettledWaiter> out;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (waiters_.empty()) {
+    return out;
+  }
+  std::vector<aria2_gid_t> unchecked;
+  for (auto& item : waiters_) {
+    if (item.second.checked) {
+      continue;
+    }
+    item.second.checked = true;
+    for (const Entry& entry : item.second.entries) {
+      if (entry.event == 0 && !entry.retrying) {
+        unchecked.push_back(entry.gid);
+      }
+    }
+  }
+  for (aria2_gid_t gid : unchecked) {
+    switch (common::GetDownloadStatus(session, gid)) {
+      case common::kStatusComplete:
+        if (checksums.Holds(gid)) {
+          break;
+        }
+        SettleLocked(session, gid, ARIA2_EVENT_ON_DOWNLOAD_COMPLETE, speeds,
+                     &out);
+        break;
+      case common::kStatusError:
+        if (retry.IsPending(gid)) {
+          // Settles when the retry engine re-adds it or gives up.
+          MarkRetryingLocked(gid);
+          break;
+        }
+        SettleLocked(session, gid, ARIA2_EVENT_ON_DOWNLOAD_ERROR, speeds,
+                     &out);
+        break;
+      case common::kStatusRemoved:
+        SettleLocked(session, gid, ARIA2_EVENT_ON_DOWNLOAD_STOP, speeds, &out);
+        break;
+      case -1: {
+        // Finished and already evicted; its outcome is gone.
+        auto it = by_gid_.find(gid);
+        if (it == by_gid_.end()) {
+          break;
+        }
+        const std::vector<int64_t> ids = it->second;
+        for (int64_t id : ids) {
+          if (waiters_.count(id) > 0) {
+            out.push_back(
+                TakeLocked(id, "Unknown gid " + common::GidToHex(gid), false));
+          }
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  const auto now = std::chrono::steady_clock::now();
+  std::vector<int64_t> expired;
+  for (const auto& item : waiters_) {
+    if (item.second.has_deadline && now >= item.second.deadline) {
+      expired.push_back(item.first);
+    }
+  }
+  for (int64_t id : expired) {
+    out.push_back(TakeLocked(id, "Timed out", true));
+  }
+  return out;
+}
+
+common::Value DownloadWaiters::Describe() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  common::Value out = common::Value::NewMap();
+  out.Set("waiters", static_cast<int64_t>(waiters_.size()));
+  out.Set("gids", static_cast<int64_t>(by_gid_.size()));
+  out.Set("settled", settled_);
+  out.Set("timedOut", timed_out_);
+  return out;
+}
+
+std::vector<SettledWaiter> DownloadWaiters::Reset(const std::string& reason) {
+  std::vector<SettledWaiter> out;
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (!waiters_.empty()) {
+    out.push_back(TakeLocked(waiters_.begin()->first, reason, false));
+  }
+  return out;
+}
+
+}  // namespace core
+}  // namespace flutter_aria2
@@ -0,0 +1,112 @@
+#ifndef FLUTTER_ARIA2_COMMON_ARIA2_WAITER_H_
+#define FLUTTER_ARIA2_COMMON_ARIA2_WAITER_H_
+
+#include <aria2_c_api.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "aria2_checksum.h"
+#include "aria2_retry.h"
+#include "aria2_speed.h"
+#include "aria2_value.h"
+
+namespace flutter_aria2 {
+namespace core {
+
+// A waiter whose downloads all finished, or that ran out of time.
+struct SettledWaiter {
+  int64_t id = 0;
+  // [{gid, event, info}] in the order the gids were given; event is 0 and
+  // info empty for downloads still running when |error| is set.
+  common::Value results;
+  std::string error;  // Empty on success.
+  bool timed_out = false;
+};
+
+// Waiters registered by Dart for one or more downloads, keyed by gid, so
+// the event callback resolves them directly instead of Dart filtering the
+// whole event stream for each waiter.
+//
+// A download settles on its complete, error or stop event, with a snapshot
+// of its info (the getDownloadInfo fields) taken right then, so no second
+// query is needed. An error the retry engine is about to retry does not
+// settle: the waiter follows the download to its new gid. Downloads that
+// had already finished when the waiter was added are settled on the next
+// tick from their status.
+class DownloadWaiters {
+ public:
+  DownloadWaiters() = default;
+
+  DownloadWaiters(const DownloadWaiters&) = delete;
+  DownloadWaiters& operator=(const DownloadWaiters&) = delete;
+
+  // |id| is chosen by the caller; |timeout_ms| 0 waits forever. Fails when
+  // |id| is already waiting.
+  bool Add(int64_t id, const std::vector<aria2_gid_t>& gids,
+           int64_t timeout_ms, std::string* error);
+
+  // Runs in the download event callback and for events released by the
+  // checksum verifier. |retrying| marks an error the retry engine took.
+  std::vector<SettledWaiter> OnDownloadEvent(aria2_session_t* session,
+                                             aria2_download_event_t event,
+                                             aria2_gid_t gid, bool retrying,
+                                             const SpeedHistory& speeds);
+  void OnRetried(aria2_gid_t old_gid, aria2_gid_t new_gid);
+  // The retry engine gave up on |gid| after its error event.
+  std::vector<SettledWaiter> OnGaveUp(aria2_session_t* session,
+                                      aria2_gid_t gid,
+                                      const SpeedHistory& speeds);
+
+  // Settles downloads that finished before their waiter was added, unless
+  // |checksums| still holds their completion or |retry| has a retry of
+  // their error scheduled, and waiters past their deadline.
+  std::vector<SettledWaiter> OnTick(aria2_session_t* session,
+                                    const SpeedHistory& speeds,
+                                    const ChecksumVerifier& checksums,
+                                    const RetryEngine& retry);
+
+  // {waiters, gids, settled, timedOut}.
+  common::Value Describe() const;
+
+  // Fails every open waiter with |reason|.
+  std::vector<SettledWaiter> Reset(const std::string& reason);
+
+ private:
+  struct Entry {
+    aria2_gid_t gid = 0;
+    int32_t event = 0;  // aria2_download_event_t once settled.
+    bool retrying = false;
+    common::Value info;
+  };
+
+  struct Waiter {
+    std::vector<Entry> entries;
+    size_t pending = 0;
+    bool checked = false;  // Statuses read once after Add.
+    bool has_deadline = false;
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  void SettleLocked(aria2_session_t* session, aria2_gid_t gid,
+                    aria2_download_event_t event, const SpeedHistory& speeds,
+                    std::vector<SettledWaiter>* out);
+  void MarkRetryingLocked(aria2_gid_t gid);
+  SettledWaiter TakeLocked(int64_t id, std::string error, bool timed_out);
+
+  mutable std::mutex mutex_;
+  std::map<int64_t, Waiter> waiters_;
+  std::unordered_map<aria2_gid_t, std::vector<int64_t>> by_gid_;
+  int64_t settled_ = 0;
+  int64_t timed_out_ = 0;
+};
+
+}  // namespace core
+}  // namespace flutter_aria2
+
+#endif  // FLUTTER_ARIA2_COMMON_ARIA2_WAITER_H_
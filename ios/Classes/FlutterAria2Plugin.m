@@ -23,12 +23,8 @@
     _channel = channel;
     _native = [[FlutterAria2Native alloc] init];
     __weak typeof(self) weakSelf = self;
-    _native.onDownloadEvent = ^(NSInteger event, NSString* gid) {
-      [weakSelf.channel invokeMethod:@"onDownloadEvent"
-                           arguments:@{
-                             @"event" : @(event),
-                             @"gid" : gid ?: @"",
-                           }];
+    _native.onNativeEvent = ^(NSString* method, id _Nullable payload) {
+      [weakSelf.channel invokeMethod:method arguments:payload];
     };
   }
   return self;
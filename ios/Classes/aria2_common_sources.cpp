@@ -1,3 +1,34 @@
 // Thin wrapper so CocoaPods compiles common C++ (pod only allows sources under its root).
+#include "../../common/aria2_autotune.cpp"
+#include "../../common/aria2_bitfield.cpp"
+#include "../../common/aria2_checksum.cpp"
+#include "../../common/aria2_concurrency.cpp"
 #include "../../common/aria2_core.cpp"
+#include "../../common/aria2_fetch.cpp"
+#include "../../common/aria2_group.cpp"
 #include "../../common/aria2_helpers.cpp"
+#include "../../common/aria2_history.cpp"
+#include "../../common/aria2_hoststats.cpp"
+#include "../../common/aria2_import.cpp"
+#include "../../common/aria2_journal.cpp"
+#include "../../common/aria2_loopback.cpp"
+#include "../../common/aria2_mapped_file.cpp"
+#include "../../common/aria2_methods.cpp"
+#include "../../common/aria2_metrics.cpp"
+#include "../../common/aria2_net.cpp"
+#include "../../common/aria2_probe.cpp"
+#include "../../common/aria2_registry.cpp"
+#include "../../common/aria2_resume.cpp"
+#include "../../common/aria2_retention.cpp"
+#include "../../common/aria2_retry.cpp"
+#include "../../common/aria2_scheduler.cpp"
+#include "../../common/aria2_sha.cpp"
+#include "../../common/aria2_speed.cpp"
+#include "../../common/aria2_stream.cpp"
+#include "../../common/aria2_subscription.cpp"
+#include "../../common/aria2_timing.cpp"
+#include "../../common/aria2_torrent.cpp"
+#include "../../common/aria2_trigger.cpp"
+#include "../../common/aria2_value.cpp"
+#include "../../common/aria2_virtual_queue.cpp"
+#include "../../common/aria2_waiter.cpp"
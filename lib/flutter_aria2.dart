@@ -1,3 +1,5 @@
+import 'dart:typed_data';
+
 import 'package:flutter/services.dart';
 
 import 'flutter_aria2_platform_interface.dart';
@@ -67,6 +69,66 @@ enum Aria2UriStatus {
   waiting,
 }
 
+/// 下载优先级，由原生层 common/ 中的队列调度器维护。
+///
+/// critical 下载在没有空闲槽位（max-concurrent-downloads）时会抢占 background
+/// 下载：将其暂停，待没有 critical 下载排队时再自动恢复。
+enum Aria2Priority {
+  /// 关键：排到等待队列头部，必要时抢占 background 下载
+  critical,
+
+  /// 高：重排时位于 normal 之前
+  high,
+
+  /// 普通：保持 aria2 默认的 FIFO 顺序
+  normal,
+
+  /// 后台：重排时移到队尾，可被 critical 下载抢占
+  background,
+}
+
+/// 同一优先级内等待队列的排序策略，由原生层重排（aria2_change_position）。
+enum Aria2QueuePolicy {
+  /// 先进先出：aria2 默认顺序
+  fifo,
+
+  /// 最短作业优先：按文件大小升序，未知大小的 HTTP 链接会由原生层探测
+  shortestJobFirst,
+
+  /// 最早截止优先：按截止时间升序，无截止时间的排在最后
+  earliestDeadlineFirst,
+}
+
+/// 原生重试引擎对一次下载失败采取的动作
+enum Aria2RetryAction {
+  /// 已按退避时间安排重试
+  scheduled,
+
+  /// 已重新添加为新的下载（见 [Aria2RetryEvent.newGid]）
+  retried,
+
+  /// 放弃重试：永久性错误、次数用尽或重新添加失败
+  gaveUp,
+}
+
+/// 虚拟队列条目的状态
+enum Aria2VirtualState {
+  /// 仍在磁盘队列中等待
+  pending,
+
+  /// 已交给 aria2（见 [Aria2VirtualEntry.gid]）
+  materialized,
+
+  /// 下载完成
+  complete,
+
+  /// 下载出错，或被 aria2 拒绝添加
+  error,
+
+  /// 下载被移除
+  removed,
+}
+
 /// BT 文件模式，对应 C API 的 aria2_bt_file_mode_t
 enum Aria2BtFileMode {
   /// 无
@@ -114,6 +176,46 @@ class Aria2Exception implements Exception {
   String toString() => 'Aria2Exception($code: $message)';
 }
 
+/// 下载完成时单个文件的 SHA-256 校验结果
+class Aria2FileChecksum {
+  /// 文件序号（从 1 开始）
+  final int index;
+
+  /// 文件路径
+  final String path;
+
+  /// 计算得到的摘要（十六进制），文件无法读取时为空字符串
+  final String sha256;
+
+  /// 预期摘要，未指定时为 null
+  final String? expected;
+
+  /// 与预期摘要是否一致，未指定预期摘要时为 null
+  final bool? match;
+
+  const Aria2FileChecksum({
+    required this.index,
+    required this.path,
+    required this.sha256,
+    this.expected,
+    this.match,
+  });
+
+  factory Aria2FileChecksum.fromMap(Map<String, dynamic> map) {
+    return Aria2FileChecksum(
+      index: map['index'] as int,
+      path: map['path'] as String? ?? '',
+      sha256: map['sha256'] as String? ?? '',
+      expected: map['expected'] as String?,
+      match: map['match'] as bool?,
+    );
+  }
+
+  @override
+  String toString() =>
+      'Aria2FileChecksum(index: $index, sha256: $sha256, match: $match)';
+}
+
 /// 下载事件数据
 class Aria2DownloadEventData {
   /// 事件类型
@@ -122,14 +224,36 @@ class Aria2DownloadEventData {
   /// 下载 GID（十六进制字符串）
   final String gid;
 
-  const Aria2DownloadEventData({required this.event, required this.gid});
+  /// 错误码，仅在原生层判定的错误（如摘要不符时为 32）中携带
+  final int? errorCode;
+
+  /// 启用 SHA-256 校验的下载完成时各文件的摘要
+  final List<Aria2FileChecksum> checksums;
+
+  /// 命中的事件订阅名称，未设置任何订阅时为空，见 [FlutterAria2.setEventFilter]
+  final List<String> subscriptions;
+
+  const Aria2DownloadEventData({
+    required this.event,
+    required this.gid,
+    this.errorCode,
+    this.checksums = const [],
+    this.subscriptions = const [],
+  });
 
   factory Aria2DownloadEventData.fromMap(Map<String, dynamic> map) {
     // C API 中事件值从 1 开始
     final eventIndex = (map['event'] as int) - 1;
+    final checksums = map['checksums'] as List<dynamic>? ?? const [];
     return Aria2DownloadEventData(
       event: Aria2DownloadEvent.values[eventIndex],
       gid: map['gid'] as String,
+      errorCode: map['errorCode'] as int?,
+      checksums: checksums
+          .map((e) => Aria2FileChecksum.fromMap(Map<String, dynamic>.from(e)))
+          .toList(),
+      subscriptions:
+          (map['subscriptions'] as List<dynamic>?)?.cast<String>() ?? const [],
     );
   }
 
@@ -137,6 +261,308 @@ class Aria2DownloadEventData {
   String toString() => 'Aria2DownloadEventData(event: $event, gid: $gid)';
 }
 
+/// 原生重试引擎事件
+class Aria2RetryEvent {
+  /// 动作
+  final Aria2RetryAction action;
+
+  /// 失败的下载 GID
+  final String gid;
+
+  /// 重新添加后的下载 GID（仅 [Aria2RetryAction.retried]）
+  final String? newGid;
+
+  /// 第几次重试（从 1 开始）
+  final int attempt;
+
+  /// aria2 错误码
+  final int errorCode;
+
+  /// 退避时间（仅 [Aria2RetryAction.scheduled]）
+  final Duration delay;
+
+  /// 原因（transient、permanent、attempts、add failed 等）
+  final String reason;
+
+  const Aria2RetryEvent({
+    required this.action,
+    required this.gid,
+    required this.newGid,
+    required this.attempt,
+    required this.errorCode,
+    required this.delay,
+    required this.reason,
+  });
+
+  factory Aria2RetryEvent.fromMap(Map<String, dynamic> map) {
+    return Aria2RetryEvent(
+      action: Aria2RetryAction.values[map['action'] as int? ?? 0],
+      gid: map['gid'] as String? ?? '',
+      newGid: map['newGid'] as String?,
+      attempt: map['attempt'] as int? ?? 0,
+      errorCode: map['errorCode'] as int? ?? 0,
+      delay: Duration(milliseconds: map['delayMs'] as int? ?? 0),
+      reason: map['reason'] as String? ?? '',
+    );
+  }
+
+  @override
+  String toString() =>
+      'Aria2RetryEvent($action, gid: $gid, attempt: $attempt, '
+      'errorCode: $errorCode)';
+}
+
+/// 虚拟队列条目被交给 aria2 时的事件
+class Aria2VirtualMaterialized {
+  /// 虚拟 ID
+  final int id;
+
+  /// aria2 分配的 GID（十六进制字符串）
+  final String gid;
+
+  const Aria2VirtualMaterialized({required this.id, required this.gid});
+
+  factory Aria2VirtualMaterialized.fromMap(Map<String, dynamic> map) {
+    return Aria2VirtualMaterialized(
+      id: map['id'] as int? ?? -1,
+      gid: map['gid'] as String? ?? '',
+    );
+  }
+
+  @override
+  String toString() => 'Aria2VirtualMaterialized(id: $id, gid: $gid)';
+}
+
+/// 虚拟队列中的一个条目
+class Aria2VirtualEntry {
+  /// 虚拟 ID，跨会话与重启保持不变
+  final int id;
+
+  /// 状态
+  final Aria2VirtualState state;
+
+  /// 最近一次交给 aria2 时的 GID，从未交给 aria2 时为 null
+  final String? gid;
+
+  /// aria2 错误码；被 aria2 拒绝添加时为 -1
+  final int errorCode;
+
+  /// 下载链接列表
+  final List<String> uris;
+
+  const Aria2VirtualEntry({
+    required this.id,
+    required this.state,
+    required this.gid,
+    required this.errorCode,
+    required this.uris,
+  });
+
+  factory Aria2VirtualEntry.fromMap(Map<String, dynamic> map) {
+    return Aria2VirtualEntry(
+      id: map['id'] as int? ?? -1,
+      state: Aria2VirtualState.values[map['state'] as int? ?? 0],
+      gid: map['gid'] as String?,
+      errorCode: map['errorCode'] as int? ?? 0,
+      uris: List<String>.from(map['uris'] as List? ?? const []),
+    );
+  }
+
+  @override
+  String toString() => 'Aria2VirtualEntry($id, $state, gid: $gid)';
+}
+
+/// 下载历史查询条件，见 [FlutterAria2.queryHistory]。
+class Aria2HistoryFilter {
+  /// 只返回该主机（小写）的记录
+  final String? host;
+
+  /// 只返回此时刻及之后结束的记录
+  final DateTime? since;
+
+  /// 只返回此时刻之前结束的记录
+  final DateTime? until;
+
+  /// 只返回该状态（complete、error、removed）的记录
+  final Aria2DownloadStatus? status;
+
+  const Aria2HistoryFilter({this.host, this.since, this.until, this.status});
+
+  Map<String, dynamic> toMap() {
+    return {
+      'host': host ?? '',
+      'since': since?.millisecondsSinceEpoch ?? -1,
+      'until': until?.millisecondsSinceEpoch ?? -1,
+      'status': status?.index ?? -1,
+    };
+  }
+}
+
+/// 一条下载历史记录
+class Aria2HistoryRecord {
+  /// 下载 GID
+  final String gid;
+
+  /// 结束状态（complete、error 或 removed）
+  final Aria2DownloadStatus status;
+
+  /// aria2 错误码
+  final int errorCode;
+
+  /// 结束时间
+  final DateTime finishedAt;
+
+  /// 从首次开始到结束的时长（含暂停时间）
+  final Duration duration;
+
+  /// 总长度（字节）
+  final int totalLength;
+
+  /// 已完成长度（字节）
+  final int completedLength;
+
+  /// 平均速度（字节/秒）
+  final int averageSpeed;
+
+  /// 首个已使用 URI 的主机
+  final String host;
+
+  /// 第一个文件的路径
+  final String path;
+
+  /// 下载链接列表
+  final List<String> uris;
+
+  const Aria2HistoryRecord({
+    required this.gid,
+    required this.status,
+    required this.errorCode,
+    required this.finishedAt,
+    required this.duration,
+    required this.totalLength,
+    required this.completedLength,
+    required this.averageSpeed,
+    required this.host,
+    required this.path,
+    required this.uris,
+  });
+
+  factory Aria2HistoryRecord.fromMap(Map<String, dynamic> map) {
+    return Aria2HistoryRecord(
+      gid: map['gid'] as String? ?? '',
+      status: Aria2DownloadStatus.values[map['status'] as int? ?? 3],
+      errorCode: map['errorCode'] as int? ?? 0,
+      finishedAt:
+          DateTime.fromMillisecondsSinceEpoch(map['finishedAt'] as int? ?? 0),
+      duration: Duration(milliseconds: map['durationMs'] as int? ?? 0),
+      totalLength: map['totalLength'] as int? ?? 0,
+      completedLength: map['completedLength'] as int? ?? 0,
+      averageSpeed: map['averageSpeed'] as int? ?? 0,
+      host: map['host'] as String? ?? '',
+      path: map['path'] as String? ?? '',
+      uris: List<String>.from(map['uris'] as List? ?? const []),
+    );
+  }
+
+  @override
+  String toString() =>
+      'Aria2HistoryRecord($gid, $status, host: $host, finishedAt: $finishedAt)';
+}
+
+/// 导入输入文件时某一行的错误
+class Aria2ImportError {
+  /// 行号（从 1 开始）
+  final int line;
+
+  /// 错误信息
+  final String message;
+
+  const Aria2ImportError({required this.line, required this.message});
+
+  factory Aria2ImportError.fromMap(Map<String, dynamic> map) {
+    return Aria2ImportError(
+      line: map['line'] as int? ?? 0,
+      message: map['message'] as String? ?? '',
+    );
+  }
+
+  @override
+  String toString() => 'Aria2ImportError(line $line: $message)';
+}
+
+/// 输入文件导入进度，见 [FlutterAria2.importInputFile]
+class Aria2ImportProgress {
+  /// 输入文件路径
+  final String path;
+
+  /// 已读取的行数
+  final int lines;
+
+  /// 已处理的下载条目数
+  final int entries;
+
+  /// 成功添加的条目数
+  final int added;
+
+  /// 失败的条目数
+  final int failed;
+
+  /// 已读取的字节数
+  final int bytes;
+
+  /// 文件总字节数
+  final int totalBytes;
+
+  /// 自上次报告以来新发现的错误（每次报告最多 200 条，[failed] 为准确总数）
+  final List<Aria2ImportError> errors;
+
+  /// 导入是否已结束
+  final bool done;
+
+  /// 是否被 [FlutterAria2.cancelImport] 取消
+  final bool cancelled;
+
+  /// 导致导入提前结束的错误（如会话结束、虚拟队列写入失败），正常时为 null
+  final String? error;
+
+  const Aria2ImportProgress({
+    required this.path,
+    required this.lines,
+    required this.entries,
+    required this.added,
+    required this.failed,
+    required this.bytes,
+    required this.totalBytes,
+    required this.errors,
+    required this.done,
+    required this.cancelled,
+    required this.error,
+  });
+
+  factory Aria2ImportProgress.fromMap(Map<String, dynamic> map) {
+    return Aria2ImportProgress(
+      path: map['path'] as String? ?? '',
+      lines: map['lines'] as int? ?? 0,
+      entries: map['entries'] as int? ?? 0,
+      added: map['added'] as int? ?? 0,
+      failed: map['failed'] as int? ?? 0,
+      bytes: map['bytes'] as int? ?? 0,
+      totalBytes: map['totalBytes'] as int? ?? 0,
+      errors: ((map['errors'] as List?) ?? [])
+          .map((e) => Aria2ImportError.fromMap(Map<String, dynamic>.from(e)))
+          .toList(),
+      done: map['done'] as bool? ?? false,
+      cancelled: map['cancelled'] as bool? ?? false,
+      error: map['error'] as String?,
+    );
+  }
+
+  @override
+  String toString() =>
+      'Aria2ImportProgress($path, added: $added, failed: $failed, '
+      '$bytes/$totalBytes bytes, done: $done)';
+}
+
 /// 全局统计信息
 class Aria2GlobalStat {
   /// 总下载速度（字节/秒）
@@ -178,6 +604,57 @@ class Aria2GlobalStat {
       'active: $numActive, waiting: $numWaiting, stopped: $numStopped)';
 }
 
+/// 原生下载登记表中各状态的下载数量
+class Aria2DownloadSummary {
+  /// 活跃下载数
+  final int active;
+
+  /// 等待中（含已暂停）下载数
+  final int waiting;
+
+  /// 已完成下载数
+  final int complete;
+
+  /// 出错下载数
+  final int error;
+
+  /// 已移除下载数
+  final int removed;
+
+  /// 已停止下载数（完成 + 出错 + 已移除）
+  final int stopped;
+
+  /// 登记的下载总数
+  final int total;
+
+  const Aria2DownloadSummary({
+    required this.active,
+    required this.waiting,
+    required this.complete,
+    required this.error,
+    required this.removed,
+    required this.stopped,
+    required this.total,
+  });
+
+  factory Aria2DownloadSummary.fromMap(Map<String, dynamic> map) {
+    return Aria2DownloadSummary(
+      active: map['active'] as int? ?? 0,
+      waiting: map['waiting'] as int? ?? 0,
+      complete: map['complete'] as int? ?? 0,
+      error: map['error'] as int? ?? 0,
+      removed: map['removed'] as int? ?? 0,
+      stopped: map['stopped'] as int? ?? 0,
+      total: map['total'] as int? ?? 0,
+    );
+  }
+
+  @override
+  String toString() =>
+      'Aria2DownloadSummary(active: $active, waiting: $waiting, '
+      'stopped: $stopped, total: $total)';
+}
+
 /// URI 数据
 class Aria2UriData {
   final String uri;
@@ -342,6 +819,13 @@ class Aria2DownloadInfo {
   /// 文件数量
   final int numFiles;
 
+  /// 原生层对下载速度的指数加权平均（字节/秒），见 [FlutterAria2.getSpeedHistory]；
+  /// 下载未在进行时为 0，尚未采样时为当前速度
+  final int avgSpeed;
+
+  /// 按 [avgSpeed] 估算的剩余时间，无法估算时为 null
+  final Duration? eta;
+
   const Aria2DownloadInfo({
     required this.gid,
     required this.status,
@@ -360,9 +844,12 @@ class Aria2DownloadInfo {
     required this.belongsTo,
     required this.dir,
     required this.numFiles,
+    this.avgSpeed = 0,
+    this.eta,
   });
 
   factory Aria2DownloadInfo.fromMap(Map<String, dynamic> map) {
+    final eta = map['eta'] as int? ?? -1;
     return Aria2DownloadInfo(
       gid: map['gid'] as String? ?? '',
       status: Aria2DownloadStatus.values[map['status'] as int? ?? 0],
@@ -383,6 +870,8 @@ class Aria2DownloadInfo {
       belongsTo: map['belongsTo'] as String? ?? '',
       dir: map['dir'] as String? ?? '',
       numFiles: map['numFiles'] as int? ?? 0,
+      avgSpeed: map['avgSpeed'] as int? ?? 0,
+      eta: eta < 0 ? null : Duration(seconds: eta),
     );
   }
 
@@ -397,55 +886,1013 @@ class Aria2DownloadInfo {
       'dl: $downloadSpeed, ul: $uploadSpeed)';
 }
 
-// ──────────────────────────── Main API ────────────────────────────
+/// 自适应并发控制器的配置。
+///
+/// 原生层在每个采样窗口比较平均下载速度：增加当前参数带来明显提升时继续加 1，
+/// 速度明显下降时减半回退，无明显变化时回退一步并改为调整下一个参数。
+/// 所有参数都限制在 [min, max] 范围内。
+class Aria2ConcurrencyConfig {
+  /// split 下限
+  final int minSplit;
+
+  /// split 上限
+  final int maxSplit;
+
+  /// max-connection-per-server 下限
+  final int minConnectionPerServer;
+
+  /// max-connection-per-server 上限
+  final int maxConnectionPerServer;
+
+  /// max-concurrent-downloads 下限
+  final int minConcurrentDownloads;
+
+  /// max-concurrent-downloads 上限
+  final int maxConcurrentDownloads;
+
+  /// 采样窗口长度，不小于 500 毫秒
+  final Duration sampleInterval;
+
+  const Aria2ConcurrencyConfig({
+    this.minSplit = 1,
+    this.maxSplit = 16,
+    this.minConnectionPerServer = 1,
+    this.maxConnectionPerServer = 16,
+    this.minConcurrentDownloads = 1,
+    this.maxConcurrentDownloads = 10,
+    this.sampleInterval = const Duration(seconds: 3),
+  });
 
-/// Flutter aria2 插件主类。
+  Map<String, dynamic> toMap() {
+    return {
+      'minSplit': minSplit,
+      'maxSplit': maxSplit,
+      'minConnectionPerServer': minConnectionPerServer,
+      'maxConnectionPerServer': maxConnectionPerServer,
+      'minConcurrentDownloads': minConcurrentDownloads,
+      'maxConcurrentDownloads': maxConcurrentDownloads,
+      'sampleIntervalMs': sampleInterval.inMilliseconds,
+    };
+  }
+}
+
+/// 原生重试引擎的策略。
 ///
-/// 通过 MethodChannel 调用原生 aria2 C API，提供完整的下载管理能力。
+/// 下载出错时，原生层在事件回调中按错误码分类：超时、网络错误、域名解析失败、
+/// 服务器过载等视为暂时性错误，按指数退避加随机抖动后重新添加同一组 URI 与选项；
+/// 其余错误直接放弃。同一主机连续失败 [breakerThreshold] 次后熔断，
+/// [breakerCooldown] 内不再向其发起重试，之后放行一次试探。
 ///
-/// 基本使用流程：
-/// ```dart
-/// final aria2 = FlutterAria2();
-/// await aria2.libraryInit();
-/// await aria2.sessionNew();
-/// aria2.startRunLoop(); // 启动事件循环
-/// final gid = await aria2.addUri(['https://example.com/file.zip']);
-/// // ... 监听事件、查询状态 ...
-/// aria2.stopRunLoop();
-/// await aria2.sessionFinal();
-/// await aria2.libraryDeinit();
-/// ```
-class FlutterAria2 {
-  // ──────── 事件流 ────────
+/// 仅对单文件且带 URI 的下载生效（如 [FlutterAria2.addUri] 添加的下载）。
+class Aria2RetryPolicy {
+  /// 是否启用
+  final bool enabled;
 
-  /// 下载事件流。
-  ///
-  /// 当下载状态发生变化（开始、暂停、停止、完成、出错等）时触发。
-  Stream<Aria2DownloadEventData> get onDownloadEvent =>
-      FlutterAria2Platform.instance.onDownloadEvent;
+  /// 每个下载最多重试次数
+  final int maxAttempts;
 
-  // ──────── 库初始化 ────────
+  /// 首次重试的基础延迟
+  final Duration baseDelay;
 
-  /// 初始化 aria2 库。必须在任何其他操作前调用。
-  ///
-  /// 返回 0 表示成功。
-  Future<int> libraryInit() {
-    return FlutterAria2Platform.instance.libraryInit();
+  /// 延迟上限
+  final Duration maxDelay;
+
+  /// 每次重试的延迟倍数
+  final double multiplier;
+
+  /// 抖动比例（0 ~ 1），实际延迟在 (1 ± jitter) 倍之间随机
+  final double jitter;
+
+  /// 触发主机熔断的连续失败次数
+  final int breakerThreshold;
+
+  /// 熔断持续时间
+  final Duration breakerCooldown;
+
+  const Aria2RetryPolicy({
+    this.enabled = true,
+    this.maxAttempts = 5,
+    this.baseDelay = const Duration(seconds: 1),
+    this.maxDelay = const Duration(minutes: 1),
+    this.multiplier = 2.0,
+    this.jitter = 0.2,
+    this.breakerThreshold = 5,
+    this.breakerCooldown = const Duration(minutes: 1),
+  });
+
+  Map<String, dynamic> toMap() {
+    return {
+      'enabled': enabled,
+      'maxAttempts': maxAttempts,
+      'baseDelayMs': baseDelay.inMilliseconds,
+      'maxDelayMs': maxDelay.inMilliseconds,
+      'multiplier': multiplier,
+      'jitter': jitter,
+      'breakerThreshold': breakerThreshold,
+      'breakerCooldownMs': breakerCooldown.inMilliseconds,
+    };
   }
+}
 
-  /// 反初始化 aria2 库。所有 session 关闭后调用。
+/// 已结束下载结果的保留策略，见 [FlutterAria2.setRetentionPolicy]。
+///
+/// 三项上限均为 null 时表示不限制（停用）。
+class Aria2RetentionPolicy {
+  /// 最多保留的已结束结果数
+  final int? maxCount;
+
+  /// 结果在结束后最多保留的时长
+  final Duration? maxAge;
+
+  /// 保留结果的元数据估算字节数上限（固定开销加文件路径与 URI）
+  final int? maxBytes;
+
+  /// 淘汰前追加摘要记录的归档文件路径；为 null 时不归档。
   ///
-  /// 返回 0 表示成功。
-  Future<int> libraryDeinit() {
-    return FlutterAria2Platform.instance.libraryDeinit();
+  /// 每条记录一行，以制表符分隔：gid、状态（complete/error/removed）、
+  /// 错误码、总长度、已完成长度、结束时间（Unix 毫秒）。
+  final String? archivePath;
+
+  const Aria2RetentionPolicy({
+    this.maxCount,
+    this.maxAge,
+    this.maxBytes,
+    this.archivePath,
+  });
+
+  Map<String, dynamic> toMap() {
+    return {
+      'maxCount': maxCount ?? -1,
+      'maxAgeMs': maxAge?.inMilliseconds ?? -1,
+      'maxBytes': maxBytes ?? -1,
+      'archivePath': archivePath ?? '',
+    };
   }
+}
 
-  // ──────── 会话管理 ────────
+/// 速度历史的采样策略，见 [FlutterAria2.setSpeedHistoryPolicy]。
+class Aria2SpeedHistoryPolicy {
+  /// 采样间隔，不小于 100 毫秒
+  final Duration interval;
 
-  /// 创建新的 aria2 会话。
-  ///
-  /// [options] 会话选项，如 `{'dir': '/downloads', 'max-concurrent-downloads': '5'}`。
-  /// [keepRunning] 是否在所有下载完成后保持运行。
+  /// 每个下载保留的样本数（2 ~ 3600）
+  final int samples;
+
+  /// 平均速度的时间常数，越大越平滑
+  final Duration smoothing;
+
+  /// 同时保留历史的下载数上限（1 ~ 4096）；占满时复用最久未采样的非活动下载
+  final int maxDownloads;
+
+  const Aria2SpeedHistoryPolicy({
+    this.interval = const Duration(seconds: 1),
+    this.samples = 120,
+    this.smoothing = const Duration(seconds: 10),
+    this.maxDownloads = 256,
+  });
+
+  Map<String, dynamic> toMap() {
+    return {
+      'intervalMs': interval.inMilliseconds,
+      'samples': samples,
+      'smoothingMs': smoothing.inMilliseconds,
+      'maxDownloads': maxDownloads,
+    };
+  }
+}
+
+/// 速度历史中的一个样本
+class Aria2SpeedSample {
+  /// 采样时间
+  final DateTime time;
+
+  /// 已完成大小（字节）
+  final int completedLength;
+
+  /// 下载速度（字节/秒）
+  final int speed;
+
+  const Aria2SpeedSample({
+    required this.time,
+    required this.completedLength,
+    required this.speed,
+  });
+}
+
+/// 下载的速度历史
+class Aria2SpeedHistory {
+  /// 采样间隔
+  final Duration interval;
+
+  /// 平均速度（字节/秒），下载未在进行时为 0
+  final int avgSpeed;
+
+  /// 估算的剩余时间，无法估算时为 null
+  final Duration? eta;
+
+  /// 样本，从旧到新
+  final List<Aria2SpeedSample> samples;
+
+  const Aria2SpeedHistory({
+    required this.interval,
+    required this.avgSpeed,
+    required this.eta,
+    required this.samples,
+  });
+
+  factory Aria2SpeedHistory.fromMap(Map<String, dynamic> map) {
+    final timestamps = (map['timestamps'] as List?) ?? const [];
+    final completed = (map['completed'] as List?) ?? const [];
+    final speeds = (map['speeds'] as List?) ?? const [];
+    final eta = map['eta'] as int? ?? -1;
+    return Aria2SpeedHistory(
+      interval: Duration(milliseconds: map['intervalMs'] as int? ?? 0),
+      avgSpeed: map['avgSpeed'] as int? ?? 0,
+      eta: eta < 0 ? null : Duration(seconds: eta),
+      samples: [
+        for (var i = 0; i < timestamps.length; i++)
+          Aria2SpeedSample(
+            time: DateTime.fromMillisecondsSinceEpoch(timestamps[i] as int),
+            completedLength: completed[i] as int,
+            speed: speeds[i] as int,
+          ),
+      ],
+    );
+  }
+}
+
+/// 已结束下载的结果，见 [FlutterAria2.awaitDownload]。
+class Aria2DownloadResult {
+  /// 下载 GID；重试后为最终一次尝试的 GID
+  final String gid;
+
+  /// 结束事件：完成、出错或停止
+  final Aria2DownloadEvent event;
+
+  /// 结束时的下载信息
+  final Aria2DownloadInfo info;
+
+  const Aria2DownloadResult({
+    required this.gid,
+    required this.event,
+    required this.info,
+  });
+
+  factory Aria2DownloadResult.fromMap(Map<String, dynamic> map) {
+    // C API 中事件值从 1 开始
+    return Aria2DownloadResult(
+      gid: map['gid'] as String,
+      event: Aria2DownloadEvent.values[(map['event'] as int) - 1],
+      info: Aria2DownloadInfo.fromMap(
+          Map<String, dynamic>.from(map['info'] as Map? ?? const {})),
+    );
+  }
+
+  /// 是否成功完成
+  bool get isComplete => event == Aria2DownloadEvent.onDownloadComplete;
+
+  @override
+  String toString() => 'Aria2DownloadResult(gid: $gid, event: $event)';
+}
+
+/// 一个通道方法的调用耗时统计，见 [FlutterAria2.getMethodTimings]。
+class Aria2MethodTiming {
+  /// 调用次数
+  final int calls;
+
+  /// UI 线程上的累计耗时（接收调用与发送响应；事件为发送本身）
+  final Duration mainTime;
+
+  /// 单次调用在 UI 线程上的最长耗时
+  final Duration mainMax;
+
+  /// UI 线程耗时超过 1 毫秒的调用次数
+  final int slowOnMain;
+
+  /// 工作线程上的累计耗时（解码参数并执行方法；事件为发送前的数据转换）
+  final Duration workerTime;
+
+  /// 单次调用在工作线程上的最长耗时
+  final Duration workerMax;
+
+  const Aria2MethodTiming({
+    required this.calls,
+    required this.mainTime,
+    required this.mainMax,
+    required this.slowOnMain,
+    required this.workerTime,
+    required this.workerMax,
+  });
+
+  factory Aria2MethodTiming.fromMap(Map<String, dynamic> map) {
+    return Aria2MethodTiming(
+      calls: map['calls'] as int? ?? 0,
+      mainTime: Duration(microseconds: map['mainUs'] as int? ?? 0),
+      mainMax: Duration(microseconds: map['mainMaxUs'] as int? ?? 0),
+      slowOnMain: map['slowOnMain'] as int? ?? 0,
+      workerTime: Duration(microseconds: map['workerUs'] as int? ?? 0),
+      workerMax: Duration(microseconds: map['workerMaxUs'] as int? ?? 0),
+    );
+  }
+
+  @override
+  String toString() => 'Aria2MethodTiming(calls: $calls, '
+      'mainTime: $mainTime, workerTime: $workerTime, slowOnMain: $slowOnMain)';
+}
+
+/// 进度触发器的一次命中，见 [FlutterAria2.registerProgressTrigger]。
+class Aria2ProgressTriggerHit {
+  /// 触发器 id
+  final int id;
+
+  /// 下载 GID
+  final String gid;
+
+  /// 总大小（字节）
+  final int totalLength;
+
+  /// 已完成大小（字节）
+  final int completedLength;
+
+  /// 当前下载速度（字节/秒）
+  final int downloadSpeed;
+
+  /// 平滑后的下载速度（字节/秒）
+  final int avgSpeed;
+
+  /// 估算的剩余时间，无法估算时为 null
+  final Duration? eta;
+
+  /// 进度跨过了 percentStep 的整数倍
+  final bool percentChanged;
+
+  /// 平滑速度的变化超过了 speedDeltaPct
+  final bool speedChanged;
+
+  /// 剩余时间跨过了某个 etaBoundaries 边界
+  final bool etaCrossed;
+
+  const Aria2ProgressTriggerHit({
+    required this.id,
+    required this.gid,
+    required this.totalLength,
+    required this.completedLength,
+    required this.downloadSpeed,
+    required this.avgSpeed,
+    required this.eta,
+    required this.percentChanged,
+    required this.speedChanged,
+    required this.etaCrossed,
+  });
+
+  factory Aria2ProgressTriggerHit.fromMap(Map<String, dynamic> map) {
+    final eta = map['eta'] as int? ?? -1;
+    final reasons = map['reasons'] as int? ?? 0;
+    return Aria2ProgressTriggerHit(
+      id: map['id'] as int,
+      gid: map['gid'] as String,
+      totalLength: map['totalLength'] as int? ?? 0,
+      completedLength: map['completedLength'] as int? ?? 0,
+      downloadSpeed: map['downloadSpeed'] as int? ?? 0,
+      avgSpeed: map['avgSpeed'] as int? ?? 0,
+      eta: eta < 0 ? null : Duration(seconds: eta),
+      percentChanged: reasons & 1 != 0,
+      speedChanged: reasons & 2 != 0,
+      etaCrossed: reasons & 4 != 0,
+    );
+  }
+
+  /// 下载进度 (0.0 ~ 1.0)
+  double get progress =>
+      totalLength > 0 ? completedLength / totalLength : 0.0;
+
+  @override
+  String toString() => 'Aria2ProgressTriggerHit(id: $id, gid: $gid, '
+      '$completedLength/$totalLength)';
+}
+
+/// 单个主机的吞吐与健康统计。
+///
+/// 原生层每秒采样一次活动下载，把进度与速度平均分摊给其已使用 URI 的主机；
+/// 下载出错或完成时计入对应主机。统计跨会话保留。
+class Aria2HostStats {
+  /// 主机名（小写）
+  final String host;
+
+  /// 累计下载字节数
+  final int bytes;
+
+  /// 速度的指数加权移动平均（字节/秒）
+  final double speed;
+
+  /// 首字节延迟的指数加权移动平均（毫秒），未测得时为 null
+  final double? latencyMs;
+
+  /// 使用该主机时出错的下载数
+  final int errors;
+
+  /// 使用该主机时完成的下载数
+  final int completions;
+
+  /// 采样次数
+  final int samples;
+
+  /// 综合评分：速度按失败比例与延迟折算，越大越好
+  final double score;
+
+  const Aria2HostStats({
+    required this.host,
+    required this.bytes,
+    required this.speed,
+    required this.latencyMs,
+    required this.errors,
+    required this.completions,
+    required this.samples,
+    required this.score,
+  });
+
+  factory Aria2HostStats.fromMap(Map<String, dynamic> map) {
+    final latency = (map['latencyMs'] as num?)?.toDouble() ?? -1;
+    return Aria2HostStats(
+      host: map['host'] as String? ?? '',
+      bytes: map['bytes'] as int? ?? 0,
+      speed: (map['speed'] as num?)?.toDouble() ?? 0,
+      latencyMs: latency < 0 ? null : latency,
+      errors: map['errors'] as int? ?? 0,
+      completions: map['completions'] as int? ?? 0,
+      samples: map['samples'] as int? ?? 0,
+      score: (map['score'] as num?)?.toDouble() ?? 0,
+    );
+  }
+
+  @override
+  String toString() => 'Aria2HostStats($host, speed: $speed, score: $score)';
+}
+
+/// 原生组件记录的一条决策事件
+class Aria2MetricEvent {
+  /// 记录时间
+  final DateTime timestamp;
+
+  /// 组件名（如 concurrency）
+  final String component;
+
+  /// 事件数据
+  final Map<String, dynamic> data;
+
+  const Aria2MetricEvent({
+    required this.timestamp,
+    required this.component,
+    required this.data,
+  });
+
+  factory Aria2MetricEvent.fromMap(Map<String, dynamic> map) {
+    return Aria2MetricEvent(
+      timestamp:
+          DateTime.fromMillisecondsSinceEpoch(map['timestamp'] as int? ?? 0),
+      component: map['component'] as String? ?? '',
+      data: Map<String, dynamic>.from(map['data'] as Map? ?? const {}),
+    );
+  }
+
+  @override
+  String toString() => 'Aria2MetricEvent($component, $data)';
+}
+
+/// 原生层调度与自适应组件的运行指标
+class Aria2NativeMetrics {
+  /// 队列调度器状态
+  final Map<String, dynamic> scheduler;
+
+  /// 自适应并发控制器状态（enabled、当前参数与最近吞吐量）
+  final Map<String, dynamic> concurrency;
+
+  /// 重试引擎状态，格式同 [FlutterAria2.getRetryStats]
+  final Map<String, dynamic> retry;
+
+  /// 主机统计，格式同 [FlutterAria2.getHostStats]
+  final List<Aria2HostStats> hosts;
+
+  /// 最近的决策事件，按时间先后排列
+  final List<Aria2MetricEvent> events;
+
+  const Aria2NativeMetrics({
+    required this.scheduler,
+    required this.concurrency,
+    required this.retry,
+    required this.hosts,
+    required this.events,
+  });
+
+  factory Aria2NativeMetrics.fromMap(Map<String, dynamic> map) {
+    return Aria2NativeMetrics(
+      scheduler: Map<String, dynamic>.from(map['scheduler'] as Map? ?? const {}),
+      concurrency:
+          Map<String, dynamic>.from(map['concurrency'] as Map? ?? const {}),
+      retry: Map<String, dynamic>.from(map['retry'] as Map? ?? const {}),
+      hosts: ((map['hosts'] as List?) ?? [])
+          .map((e) => Aria2HostStats.fromMap(Map<String, dynamic>.from(e)))
+          .toList(),
+      events: ((map['events'] as List?) ?? [])
+          .map((e) => Aria2MetricEvent.fromMap(Map<String, dynamic>.from(e)))
+          .toList(),
+    );
+  }
+}
+
+/// 自动调优中单个选项组合的测量结果
+class Aria2AutotuneRun {
+  /// disk-cache 取值
+  final String diskCache;
+
+  /// file-allocation 取值
+  final String fileAllocation;
+
+  /// piece-length 取值
+  final String pieceLength;
+
+  /// 是否全部下载成功
+  final bool ok;
+
+  /// 失败原因（成功时为空）
+  final String error;
+
+  /// 整轮耗时
+  final Duration elapsed;
+
+  /// 平均吞吐量（字节/秒）
+  final int throughput;
+
+  /// 写入延迟（毫秒）：服务端发出最后一个字节到下载完成的平均间隔，
+  /// 即缓存落盘与关闭文件的耗时
+  final double writeLatencyMs;
+
+  const Aria2AutotuneRun({
+    required this.diskCache,
+    required this.fileAllocation,
+    required this.pieceLength,
+    required this.ok,
+    required this.error,
+    required this.elapsed,
+    required this.throughput,
+    required this.writeLatencyMs,
+  });
+
+  factory Aria2AutotuneRun.fromMap(Map<String, dynamic> map) {
+    return Aria2AutotuneRun(
+      diskCache: map['diskCache'] as String? ?? '',
+      fileAllocation: map['fileAllocation'] as String? ?? '',
+      pieceLength: map['pieceLength'] as String? ?? '',
+      ok: map['ok'] as bool? ?? false,
+      error: map['error'] as String? ?? '',
+      elapsed: Duration(milliseconds: map['elapsedMs'] as int? ?? 0),
+      throughput: map['throughput'] as int? ?? 0,
+      writeLatencyMs: (map['writeLatencyMs'] as num? ?? 0).toDouble(),
+    );
+  }
+
+  @override
+  String toString() =>
+      'Aria2AutotuneRun(disk-cache: $diskCache, file-allocation: '
+      '$fileAllocation, piece-length: $pieceLength, '
+      '${ok ? 'dl: $throughput, latency: ${writeLatencyMs}ms' : error})';
+}
+
+/// 自动调优结果
+class Aria2AutotuneResult {
+  /// 各选项组合的测量结果，按执行顺序排列
+  final List<Aria2AutotuneRun> runs;
+
+  /// 最优的全局选项（disk-cache、file-allocation、piece-length）；
+  /// 没有成功的组合时为 null。可直接传给 [FlutterAria2.sessionNew] 的 options。
+  final Map<String, String>? bestOptions;
+
+  /// 是否被 [FlutterAria2.cancelAutotune] 提前结束
+  final bool cancelled;
+
+  const Aria2AutotuneResult({
+    required this.runs,
+    required this.bestOptions,
+    required this.cancelled,
+  });
+
+  factory Aria2AutotuneResult.fromMap(Map<String, dynamic> map) {
+    final best = map['best'] as Map?;
+    return Aria2AutotuneResult(
+      runs: ((map['runs'] as List?) ?? [])
+          .map((e) => Aria2AutotuneRun.fromMap(Map<String, dynamic>.from(e)))
+          .toList(),
+      bestOptions: best == null ? null : Map<String, String>.from(best),
+      cancelled: map['cancelled'] as bool? ?? false,
+    );
+  }
+}
+
+/// [FlutterAria2.createTorrent] 生成的种子
+class Aria2CreatedTorrent {
+  /// 种子文件路径
+  final String path;
+
+  /// info hash（十六进制）
+  final String infoHash;
+
+  /// 种子名称（单文件为文件名，多文件为目录名）
+  final String name;
+
+  /// 做种时应作为 dir 选项传给 [FlutterAria2.addTorrent] 的目录
+  final String seedDir;
+
+  /// 分片大小（字节）
+  final int pieceLength;
+
+  /// 分片数量
+  final int pieceCount;
+
+  /// 内容总大小（字节）
+  final int totalLength;
+
+  /// 文件数量
+  final int fileCount;
+
+  /// 计算哈希的线程数
+  final int threads;
+
+  /// SHA-1 实现（sha-ni 或 portable）
+  final String kernel;
+
+  /// 总耗时
+  final Duration elapsed;
+
+  /// 平均哈希速度（字节/秒）
+  final int bytesPerSecond;
+
+  const Aria2CreatedTorrent({
+    required this.path,
+    required this.infoHash,
+    required this.name,
+    required this.seedDir,
+    required this.pieceLength,
+    required this.pieceCount,
+    required this.totalLength,
+    required this.fileCount,
+    required this.threads,
+    required this.kernel,
+    required this.elapsed,
+    required this.bytesPerSecond,
+  });
+
+  factory Aria2CreatedTorrent.fromMap(Map<String, dynamic> map) {
+    return Aria2CreatedTorrent(
+      path: map['path'] as String? ?? '',
+      infoHash: map['infoHash'] as String? ?? '',
+      name: map['name'] as String? ?? '',
+      seedDir: map['seedDir'] as String? ?? '',
+      pieceLength: map['pieceLength'] as int? ?? 0,
+      pieceCount: map['pieces'] as int? ?? 0,
+      totalLength: map['totalLength'] as int? ?? 0,
+      fileCount: map['files'] as int? ?? 0,
+      threads: map['threads'] as int? ?? 0,
+      kernel: map['kernel'] as String? ?? '',
+      elapsed: Duration(milliseconds: map['elapsedMs'] as int? ?? 0),
+      bytesPerSecond: map['bytesPerSecond'] as int? ?? 0,
+    );
+  }
+
+  @override
+  String toString() =>
+      'Aria2CreatedTorrent(path: $path, infoHash: $infoHash, '
+      'pieces: $pieceCount x $pieceLength)';
+}
+
+/// 种子制作进度
+class Aria2CreateTorrentProgress {
+  /// 是否正在制作
+  final bool running;
+
+  /// 已计算哈希的字节数
+  final int hashedBytes;
+
+  /// 需要计算哈希的总字节数（收集文件完成前为 0）
+  final int totalBytes;
+
+  const Aria2CreateTorrentProgress({
+    required this.running,
+    required this.hashedBytes,
+    required this.totalBytes,
+  });
+
+  factory Aria2CreateTorrentProgress.fromMap(Map<String, dynamic> map) {
+    return Aria2CreateTorrentProgress(
+      running: map['running'] as bool? ?? false,
+      hashedBytes: map['hashedBytes'] as int? ?? 0,
+      totalBytes: map['totalBytes'] as int? ?? 0,
+    );
+  }
+}
+
+/// 一段连续的已完成分片
+class Aria2PieceRun {
+  /// 起始分片序号
+  final int start;
+
+  /// 分片数
+  final int count;
+
+  const Aria2PieceRun(this.start, this.count);
+
+  @override
+  String toString() => 'Aria2PieceRun($start, $count)';
+}
+
+/// 下载的分片完成位图
+class Aria2PieceBitfield {
+  /// 位图序号，位图每次变化时递增；作为 sinceSeq 传回即可只取增量
+  final int seq;
+
+  /// 分片总数
+  final int numPieces;
+
+  /// 分片大小（字节）
+  final int pieceLength;
+
+  /// 已完成的分片数
+  final int completedPieces;
+
+  /// 连续已完成分片段的数量
+  final int runs;
+
+  /// 第一个未完成分片的序号，全部完成时等于 [numPieces]
+  final int firstMissing;
+
+  /// 完整位图，分片 0 为首字节最高位；增量结果时为 null
+  final Uint8List? bitfield;
+
+  /// 增量结果中自 sinceSeq 以来状态变化的分片序号；完整结果时为 null
+  final List<int>? changedPieces;
+
+  /// 各段连续已完成分片，段数超过 256 时为 null
+  final List<Aria2PieceRun>? segments;
+
+  const Aria2PieceBitfield({
+    required this.seq,
+    required this.numPieces,
+    required this.pieceLength,
+    required this.completedPieces,
+    required this.runs,
+    required this.firstMissing,
+    this.bitfield,
+    this.changedPieces,
+    this.segments,
+  });
+
+  factory Aria2PieceBitfield.fromMap(Map<String, dynamic> map) {
+    final segments = map['segments'] as List?;
+    return Aria2PieceBitfield(
+      seq: map['seq'] as int? ?? 0,
+      numPieces: map['numPieces'] as int? ?? 0,
+      pieceLength: map['pieceLength'] as int? ?? 0,
+      completedPieces: map['completed'] as int? ?? 0,
+      runs: map['runs'] as int? ?? 0,
+      firstMissing: map['firstMissing'] as int? ?? 0,
+      bitfield: map['bitfield'] as Uint8List?,
+      changedPieces: (map['changed'] as List?)?.cast<int>(),
+      segments: segments == null
+          ? null
+          : [
+              for (var i = 0; i + 1 < segments.length; i += 2)
+                Aria2PieceRun(segments[i] as int, segments[i + 1] as int),
+            ],
+    );
+  }
+
+  /// 是否为增量结果
+  bool get isDelta => changedPieces != null;
+
+  /// 得到当前的完整位图：完整结果直接返回副本，增量结果则在上一次的位图
+  /// [previous] 上翻转变化的分片。
+  Uint8List applyTo(Uint8List previous) {
+    final full = bitfield;
+    if (full != null) {
+      return Uint8List.fromList(full);
+    }
+    final out = Uint8List.fromList(previous);
+    for (final piece in changedPieces ?? const <int>[]) {
+      out[piece >> 3] ^= 0x80 >> (piece & 7);
+    }
+    return out;
+  }
+
+  /// 位图 [bits] 中分片 [piece] 是否已完成。
+  static bool isPieceComplete(Uint8List bits, int piece) =>
+      (bits[piece >> 3] & (0x80 >> (piece & 7))) != 0;
+}
+
+/// 下载组（followedBy / belongsTo 形成的下载树）的汇总进度
+class Aria2GroupProgress {
+  /// 根下载 GID
+  final String rootGid;
+
+  /// 组内全部 GID，根在前，按层次排列
+  final List<String> gids;
+
+  /// 成员数
+  final int members;
+
+  /// 各状态的成员数；做种中的 BT 下载计为完成，尚未启动的后续下载计为等待
+  final int active;
+  final int waiting;
+  final int paused;
+  final int complete;
+  final int error;
+  final int removed;
+
+  /// 总大小（字节）
+  final int totalLength;
+
+  /// 已完成大小（字节）
+  final int completedLength;
+
+  /// 下载速度（字节/秒）
+  final int downloadSpeed;
+
+  /// 上传速度（字节/秒）
+  final int uploadSpeed;
+
+  /// 是否全部成员都已结束（完成、出错或被移除）
+  final bool finished;
+
+  const Aria2GroupProgress({
+    required this.rootGid,
+    required this.gids,
+    required this.members,
+    required this.active,
+    required this.waiting,
+    required this.paused,
+    required this.complete,
+    required this.error,
+    required this.removed,
+    required this.totalLength,
+    required this.completedLength,
+    required this.downloadSpeed,
+    required this.uploadSpeed,
+    required this.finished,
+  });
+
+  factory Aria2GroupProgress.fromMap(Map<String, dynamic> map) {
+    return Aria2GroupProgress(
+      rootGid: map['rootGid'] as String? ?? '',
+      gids: ((map['gids'] as List?) ?? []).cast<String>(),
+      members: map['members'] as int? ?? 0,
+      active: map['active'] as int? ?? 0,
+      waiting: map['waiting'] as int? ?? 0,
+      paused: map['paused'] as int? ?? 0,
+      complete: map['complete'] as int? ?? 0,
+      error: map['error'] as int? ?? 0,
+      removed: map['removed'] as int? ?? 0,
+      totalLength: map['totalLength'] as int? ?? 0,
+      completedLength: map['completedLength'] as int? ?? 0,
+      downloadSpeed: map['downloadSpeed'] as int? ?? 0,
+      uploadSpeed: map['uploadSpeed'] as int? ?? 0,
+      finished: map['finished'] as bool? ?? false,
+    );
+  }
+
+  /// 完成比例（0.0 ~ 1.0），总大小未知时为 0
+  double get progress =>
+      totalLength > 0 ? completedLength / totalLength : 0.0;
+
+  @override
+  String toString() =>
+      'Aria2GroupProgress(root: $rootGid, members: $members, '
+      '$completedLength/$totalLength)';
+}
+
+/// 下载组成员的事件
+class Aria2GroupEvent {
+  /// 根下载 GID
+  final String rootGid;
+
+  /// 发生事件的成员 GID
+  final String gid;
+
+  /// 成员的事件
+  final Aria2DownloadEvent event;
+
+  /// 当前已知的成员数
+  final int members;
+
+  /// 已完成、出错、被移除的成员数
+  final int complete;
+  final int error;
+  final int removed;
+
+  /// 是否全部成员都已结束
+  final bool finished;
+
+  const Aria2GroupEvent({
+    required this.rootGid,
+    required this.gid,
+    required this.event,
+    required this.members,
+    required this.complete,
+    required this.error,
+    required this.removed,
+    required this.finished,
+  });
+
+  factory Aria2GroupEvent.fromMap(Map<String, dynamic> map) {
+    return Aria2GroupEvent(
+      rootGid: map['rootGid'] as String,
+      gid: map['gid'] as String,
+      // C API 中事件值从 1 开始
+      event: Aria2DownloadEvent.values[(map['event'] as int) - 1],
+      members: map['members'] as int? ?? 0,
+      complete: map['complete'] as int? ?? 0,
+      error: map['error'] as int? ?? 0,
+      removed: map['removed'] as int? ?? 0,
+      finished: map['finished'] as bool? ?? false,
+    );
+  }
+
+  @override
+  String toString() =>
+      'Aria2GroupEvent(root: $rootGid, gid: $gid, event: $event)';
+}
+
+// ──────────────────────────── Main API ────────────────────────────
+
+/// Flutter aria2 插件主类。
+///
+/// 通过 MethodChannel 调用原生 aria2 C API，提供完整的下载管理能力。
+///
+/// 基本使用流程：
+/// ```dart
+/// final aria2 = FlutterAria2();
+/// await aria2.libraryInit();
+/// await aria2.sessionNew();
+/// aria2.startRunLoop(); // 启动事件循环
+/// final gid = await aria2.addUri(['https://example.com/file.zip']);
+/// // ... 监听事件、查询状态 ...
+/// aria2.stopRunLoop();
+/// await aria2.sessionFinal();
+/// await aria2.libraryDeinit();
+/// ```
+class FlutterAria2 {
+  // ──────── 事件流 ────────
+
+  /// 下载事件流。
+  ///
+  /// 当下载状态发生变化（开始、暂停、停止、完成、出错等）时触发。设置了
+  /// [setEventFilter] 后仅包含至少一个订阅需要的事件。
+  Stream<Aria2DownloadEventData> get onDownloadEvent =>
+      FlutterAria2Platform.instance.onDownloadEvent;
+
+  /// 订阅 [name] 命中的下载事件，见 [setEventFilter]。
+  Stream<Aria2DownloadEventData> eventsFor(String name) =>
+      onDownloadEvent.where((e) => e.subscriptions.contains(name));
+
+  /// 原生重试引擎事件流，见 [setRetryPolicy]。
+  Stream<Aria2RetryEvent> get onRetryEvent =>
+      FlutterAria2Platform.instance.onRetryEvent;
+
+  /// 虚拟队列条目交给 aria2 的事件流，见 [addVirtualUris]。
+  Stream<Aria2VirtualMaterialized> get onVirtualMaterialized =>
+      FlutterAria2Platform.instance.onVirtualMaterialized;
+
+  /// 输入文件导入进度流，见 [importInputFile]。
+  Stream<Aria2ImportProgress> get onImportProgress =>
+      FlutterAria2Platform.instance.onImportProgress;
+
+  /// 下载组成员事件流，在对应的 [onDownloadEvent] 之后触发，见 [getGroupProgress]。
+  Stream<Aria2GroupEvent> get onGroupEvent =>
+      FlutterAria2Platform.instance.onGroupEvent;
+
+  /// 进度触发器命中流，每次携带同一轮评估的全部命中，见 [registerProgressTrigger]。
+  Stream<List<Aria2ProgressTriggerHit>> get onProgressTrigger =>
+      FlutterAria2Platform.instance.onProgressTrigger;
+
+  // ──────── 库初始化 ────────
+
+  /// 初始化 aria2 库。必须在任何其他操作前调用。
+  ///
+  /// 返回 0 表示成功。
+  Future<int> libraryInit() {
+    return FlutterAria2Platform.instance.libraryInit();
+  }
+
+  /// 反初始化 aria2 库。所有 session 关闭后调用。
+  ///
+  /// 返回 0 表示成功。
+  Future<int> libraryDeinit() {
+    return FlutterAria2Platform.instance.libraryDeinit();
+  }
+
+  // ──────── 会话管理 ────────
+
+  /// 创建新的 aria2 会话。
+  ///
+  /// [options] 会话选项，如 `{'dir': '/downloads', 'max-concurrent-downloads': '5'}`。
+  /// [keepRunning] 是否在所有下载完成后保持运行。
   Future<void> sessionNew({
     Map<String, String>? options,
     bool keepRunning = true,
@@ -494,26 +1941,79 @@ class FlutterAria2 {
   /// [uris] 下载链接列表（多个链接指向同一资源时用于多源下载）。
   /// [options] 下载选项。
   /// [position] 在队列中的位置，-1 表示末尾。
+  /// [priority] 优先级，为 null 时等同于 [Aria2Priority.normal]。
+  /// [sizeHint] 已知的文件大小（字节），供 [Aria2QueuePolicy.shortestJobFirst] 使用。
+  /// [deadline] 截止时间，供 [Aria2QueuePolicy.earliestDeadlineFirst] 使用。
+  /// [rankMirrors] 为 true 时按 [getHostStats] 的评分重排 [uris]，
+  /// 使首批连接落在表现最好的镜像上；未测量过的主机按平均评分参与排序。
+  /// [expectedSha256] 文件的预期 SHA-256（十六进制）。给出或 [computeSha256]
+  /// 为 true 时，原生层在下载过程中增量计算摘要，完成事件会推迟到摘要就绪后
+  /// 发出，并在 [Aria2DownloadEventData.checksums] 中携带结果；摘要不符时
+  /// 改为发出错误事件，[Aria2DownloadEventData.errorCode] 为 32，原生下载列表
+  /// 与下载历史也将其记为失败。
   ///
   /// 返回下载 GID（十六进制字符串）。
   Future<String> addUri(
     List<String> uris, {
     Map<String, String>? options,
     int position = -1,
+    Aria2Priority? priority,
+    int? sizeHint,
+    DateTime? deadline,
+    bool rankMirrors = false,
+    String? expectedSha256,
+    bool computeSha256 = false,
   }) {
     return FlutterAria2Platform.instance.addUri(
       uris,
       options: options,
       position: position,
+      priority: priority,
+      sizeHint: sizeHint,
+      deadline: deadline,
+      rankMirrors: rankMirrors,
+      expectedSha256: expectedSha256,
+      computeSha256: computeSha256,
+    );
+  }
+
+  /// 以流式方式导入 aria2 输入文件（--input-file 格式）。
+  ///
+  /// 每行为一个下载的链接（多个镜像以 TAB 分隔），其后以空白开头的
+  /// `key=value` 行为该下载的选项，`#` 开头的行为注释。文件由原生层在事件循环
+  /// 中分批读取并添加，不经过 Dart，也不会整体载入内存；相同的选项组合只解析
+  /// 与校验一次。[options] 作为所有条目的默认选项，可被条目自身的选项覆盖。
+  /// [toVirtualQueue] 为 true 时条目写入虚拟队列（需先调用 [openVirtualQueue]），
+  /// 适合数十万行的清单。
+  ///
+  /// 需要事件循环在运行（[startRunLoop] 或反复调用 [run]）。进度与逐行错误通过
+  /// [onImportProgress] 增量报告；返回的 Future 在导入结束时以最后一次报告完成。
+  /// 同一时间只能进行一个导入。
+  Future<Aria2ImportProgress> importInputFile(
+    String path, {
+    Map<String, String>? options,
+    bool toVirtualQueue = false,
+  }) {
+    return FlutterAria2Platform.instance.importInputFile(
+      path,
+      options: options,
+      toVirtualQueue: toVirtualQueue,
     );
   }
 
+  /// 取消进行中的导入，已添加的条目保留。
+  Future<void> cancelImport() {
+    return FlutterAria2Platform.instance.cancelImport();
+  }
+
   /// 添加种子下载。
   ///
   /// [torrentFile] 种子文件路径。
   /// [webseedUris] Web seed URI 列表。
   /// [options] 下载选项。
   /// [position] 在队列中的位置，-1 表示末尾。
+  /// [expectedSha256] 按文件序号（从 1 开始）给出的预期 SHA-256，
+  /// 与 [computeSha256] 的含义同 [addUri]。
   ///
   /// 返回下载 GID（十六进制字符串）。
   Future<String> addTorrent(
@@ -521,12 +2021,16 @@ class FlutterAria2 {
     List<String>? webseedUris,
     Map<String, String>? options,
     int position = -1,
+    Map<int, String>? expectedSha256,
+    bool computeSha256 = false,
   }) {
     return FlutterAria2Platform.instance.addTorrent(
       torrentFile,
       webseedUris: webseedUris,
       options: options,
       position: position,
+      expectedSha256: expectedSha256,
+      computeSha256: computeSha256,
     );
   }
 
@@ -549,6 +2053,78 @@ class FlutterAria2 {
     );
   }
 
+  /// 以内存中的种子内容添加下载，无需先写入文件。
+  ///
+  /// [torrent] .torrent 文件内容，其余参数同 [addTorrent]。
+  /// Linux 与 Android 上内容经匿名内存文件交给 aria2，不落盘；其他平台
+  /// 写入临时目录并在添加后立即删除。
+  ///
+  /// 返回下载 GID（十六进制字符串）。
+  Future<String> addTorrentBytes(
+    Uint8List torrent, {
+    List<String>? webseedUris,
+    Map<String, String>? options,
+    int position = -1,
+    Map<int, String>? expectedSha256,
+    bool computeSha256 = false,
+  }) {
+    return FlutterAria2Platform.instance.addTorrentBytes(
+      torrent,
+      webseedUris: webseedUris,
+      options: options,
+      position: position,
+      expectedSha256: expectedSha256,
+      computeSha256: computeSha256,
+    );
+  }
+
+  /// 以内存中的 Metalink 内容添加下载，无需先写入文件。
+  ///
+  /// [metalink] Metalink 文件内容，其余参数同 [addMetalink]，
+  /// 传递方式同 [addTorrentBytes]。
+  ///
+  /// 返回下载 GID 列表（十六进制字符串）。
+  Future<List<String>> addMetalinkBytes(
+    Uint8List metalink, {
+    Map<String, String>? options,
+    int position = -1,
+  }) {
+    return FlutterAria2Platform.instance.addMetalinkBytes(
+      metalink,
+      options: options,
+      position: position,
+    );
+  }
+
+  /// 将小型资源（JSON、清单、缩略图等）下载到内存。
+  ///
+  /// 下载仍经由 aria2，享有其重试与多源能力，但写入原生层管理的临时文件
+  /// （Linux 上位于内存文件系统 /dev/shm），完成后整体读出并立即删除，
+  /// 不在下载目录留下文件。此类下载不会出现在 [onDownloadEvent] 中，也不记入
+  /// 会话日志与快速续传缓存。
+  ///
+  /// [uris] 下载链接列表。
+  /// [options] 下载选项，其中 dir 与 out 由原生层决定。
+  /// [maxBytes] 允许的最大字节数，超出时下载被移除并以 TOO_LARGE 失败。
+  /// [priority] 与 [rankMirrors] 的含义同 [addUri]。
+  ///
+  /// 失败时抛出 [Aria2Exception]，错误码为 FETCH_FAILED 或 TOO_LARGE。
+  Future<Uint8List> fetchToMemory(
+    List<String> uris, {
+    Map<String, String>? options,
+    int maxBytes = 16 * 1024 * 1024,
+    Aria2Priority? priority,
+    bool rankMirrors = false,
+  }) {
+    return FlutterAria2Platform.instance.fetchToMemory(
+      uris,
+      options: options,
+      maxBytes: maxBytes,
+      priority: priority,
+      rankMirrors: rankMirrors,
+    );
+  }
+
   // ──────── 下载控制 ────────
 
   /// 获取所有活跃下载的 GID 列表。
@@ -556,6 +2132,26 @@ class FlutterAria2 {
     return FlutterAria2Platform.instance.getActiveDownload();
   }
 
+  /// 分页获取等待中（含已暂停）下载的 GID 列表。
+  ///
+  /// 列表由原生下载登记表维护，按进入等待状态的先后排序，
+  /// 而非 aria2 队列位置。连续翻页时每页开销只与 [limit] 有关。
+  Future<List<String>> getWaitingDownloads({int offset = 0, int limit = 100}) {
+    return FlutterAria2Platform.instance
+        .getWaitingDownloads(offset: offset, limit: limit);
+  }
+
+  /// 分页获取已停止（完成、出错、已移除）下载的 GID 列表，按停止先后排序。
+  Future<List<String>> getStoppedDownloads({int offset = 0, int limit = 100}) {
+    return FlutterAria2Platform.instance
+        .getStoppedDownloads(offset: offset, limit: limit);
+  }
+
+  /// 获取原生下载登记表中各状态的下载数量。
+  Future<Aria2DownloadSummary> getDownloadSummary() {
+    return FlutterAria2Platform.instance.getDownloadSummary();
+  }
+
   /// 移除下载。
   ///
   /// [gid] 下载 GID。
@@ -596,6 +2192,278 @@ class FlutterAria2 {
     return FlutterAria2Platform.instance.changePosition(gid, pos, how);
   }
 
+  // ──────── 优先级 ────────
+
+  /// 设置下载的优先级。
+  ///
+  /// 设为 [Aria2Priority.critical] 时在原生事件循环的下一次迭代中移到等待队列头部，
+  /// 并在槽位不足时暂停 background 下载。
+  ///
+  /// 返回 0 表示成功。
+  Future<int> setDownloadPriority(String gid, Aria2Priority priority) {
+    return FlutterAria2Platform.instance.setDownloadPriority(gid, priority);
+  }
+
+  /// 获取下载的优先级；未设置过的下载返回 [Aria2Priority.normal]。
+  Future<Aria2Priority> getDownloadPriority(String gid) {
+    return FlutterAria2Platform.instance.getDownloadPriority(gid);
+  }
+
+  /// 按优先级一次性重排等待队列（原生层批量调用 aria2_change_position）。
+  ///
+  /// critical/high 下载移到队首，background 下载移到队尾，normal 下载相对顺序不变。
+  /// 重排在原生事件循环的下一次迭代中执行。
+  ///
+  /// 返回参与重排的已跟踪下载数量。
+  Future<int> reorderByPriority() {
+    return FlutterAria2Platform.instance.reorderByPriority();
+  }
+
+  /// 设置同一优先级内的排队策略，并在原生事件循环的下一次迭代中按新策略重排等待队列。
+  ///
+  /// 之后每当有下载完成或新增时，原生层只调整即将启动的队首几项。
+  /// 策略仅作用于通过 [addUri] 添加的下载。
+  ///
+  /// 返回参与重排的已跟踪下载数量。
+  Future<int> setQueuePolicy(Aria2QueuePolicy policy) {
+    return FlutterAria2Platform.instance.setQueuePolicy(policy);
+  }
+
+  /// 获取当前的排队策略。
+  Future<Aria2QueuePolicy> getQueuePolicy() {
+    return FlutterAria2Platform.instance.getQueuePolicy();
+  }
+
+  // ──────── 重试 ────────
+
+  /// 设置原生重试引擎的策略，可在 [sessionNew] 之前调用，跨会话保留。
+  ///
+  /// 传入 `Aria2RetryPolicy(enabled: false)` 可停用并丢弃尚未执行的重试。
+  ///
+  /// 返回重试引擎当前状态，格式同 [getRetryStats]。
+  Future<Map<String, dynamic>> setRetryPolicy(Aria2RetryPolicy policy) {
+    return FlutterAria2Platform.instance.setRetryPolicy(policy);
+  }
+
+  /// 获取重试引擎的计数（pending、scheduled、retried、gaveUp、breakerOpens）
+  /// 与处于熔断状态的主机列表（openHosts）。
+  Future<Map<String, dynamic>> getRetryStats() {
+    return FlutterAria2Platform.instance.getRetryStats();
+  }
+
+  // ──────── 结果保留 ────────
+
+  /// 设置已结束（完成、出错、已移除）下载结果的保留策略，可在 [sessionNew]
+  /// 之前调用，跨会话保留。
+  ///
+  /// 原生层按结束先后记录结果，每秒淘汰超出数量、时长或字节上限的最旧结果：
+  /// 从下载登记表等原生缓存中移除，并把 aria2 的 max-download-result 调整为
+  /// 保留数量，使 aria2 同步丢弃其结果。每次淘汰为 O(1)，长时间运行时内存保持平稳。
+  /// 设置了 [Aria2RetentionPolicy.archivePath] 时，淘汰前先追加一行摘要记录。
+  ///
+  /// 返回当前状态，格式同 [getRetentionStats]。
+  Future<Map<String, dynamic>> setRetentionPolicy(
+      Aria2RetentionPolicy policy) {
+    return FlutterAria2Platform.instance.setRetentionPolicy(policy);
+  }
+
+  /// 获取保留策略与计数（retained、bytes、evicted、archived、archiveErrors）。
+  Future<Map<String, dynamic>> getRetentionStats() {
+    return FlutterAria2Platform.instance.getRetentionStats();
+  }
+
+  // ──────── 主机统计 ────────
+
+  /// 获取各主机的吞吐与健康统计，按评分从高到低排列。
+  ///
+  /// [clear] 为 true 时在返回后清空统计。
+  Future<List<Aria2HostStats>> getHostStats({bool clear = false}) {
+    return FlutterAria2Platform.instance.getHostStats(clear: clear);
+  }
+
+  /// 设置或清除（传入 null）下载的截止时间。
+  ///
+  /// 返回 0 表示成功。
+  Future<int> setDownloadDeadline(String gid, DateTime? deadline) {
+    return FlutterAria2Platform.instance.setDownloadDeadline(gid, deadline);
+  }
+
+  // ──────── 虚拟队列 ────────
+
+  /// 打开（不存在时创建）[dir] 目录下的虚拟队列，可在 [sessionNew] 之前调用。
+  ///
+  /// 虚拟队列把大量待下载条目保存在磁盘上的追加式存储中（记录索引与字符串堆，
+  /// 均通过内存映射访问），只把 max-concurrent-downloads 加 [lookahead] 个条目
+  /// 交给 aria2，下载完成、出错或被移除后再从队列中补充。条目状态持久化在磁盘上，
+  /// 会话结束或进程退出时仍在 aria2 中的条目会恢复为等待状态。
+  ///
+  /// 返回队列统计，格式同 [getVirtualQueueStats]。
+  Future<Map<String, dynamic>> openVirtualQueue(String dir,
+      {int lookahead = 2}) {
+    return FlutterAria2Platform.instance
+        .openVirtualQueue(dir, lookahead: lookahead);
+  }
+
+  /// 关闭虚拟队列。已交给 aria2 的下载不受影响，但其条目恢复为等待状态。
+  Future<void> closeVirtualQueue() {
+    return FlutterAria2Platform.instance.closeVirtualQueue();
+  }
+
+  /// 向虚拟队列追加条目，每个元素为一个下载的链接列表，共享同一组 [options]。
+  ///
+  /// 返回第一个条目的虚拟 ID，其余条目的 ID 依次递增。条目交给 aria2 时
+  /// 通过 [onVirtualMaterialized] 报告其 GID。
+  Future<int> addVirtualUris(
+    List<List<String>> entries, {
+    Map<String, String>? options,
+  }) {
+    return FlutterAria2Platform.instance
+        .addVirtualUris(entries, options: options);
+  }
+
+  /// 按虚拟 ID 查询条目。
+  Future<Aria2VirtualEntry> getVirtualEntry(int id) {
+    return FlutterAria2Platform.instance.getVirtualEntry(id);
+  }
+
+  /// 获取虚拟队列统计：open、lookahead、total 以及各状态的条目数
+  /// （pending、materialized、complete、error、removed）。
+  Future<Map<String, dynamic>> getVirtualQueueStats() {
+    return FlutterAria2Platform.instance.getVirtualQueueStats();
+  }
+
+  // ──────── 下载历史 ────────
+
+  /// 打开（不存在时创建）[dir] 目录下的下载历史，可在 [sessionNew] 之前调用。
+  ///
+  /// 打开后，每个完成、出错或被移除的下载都会由原生层追加一条记录到磁盘上的
+  /// 追加式存储（定长记录索引与字符串堆，均通过内存映射访问），不占用 aria2
+  /// 或 Dart 内存。记录按结束时间排序并按主机建立索引，适合百万级记录。
+  ///
+  /// 返回统计，格式同 [getHistoryStats]。
+  Future<Map<String, dynamic>> openHistory(String dir) {
+    return FlutterAria2Platform.instance.openHistory(dir);
+  }
+
+  /// 关闭下载历史，之后结束的下载不再记录。
+  Future<void> closeHistory() {
+    return FlutterAria2Platform.instance.closeHistory();
+  }
+
+  /// 按条件分页查询下载历史，最新的记录在前。
+  ///
+  /// 按时间范围查询为二分查找；按主机查询只访问该主机的记录。
+  Future<List<Aria2HistoryRecord>> queryHistory({
+    Aria2HistoryFilter filter = const Aria2HistoryFilter(),
+    int offset = 0,
+    int limit = 100,
+  }) {
+    return FlutterAria2Platform.instance
+        .queryHistory(filter: filter, offset: offset, limit: limit);
+  }
+
+  /// 逐页读取符合条件的全部历史记录，最新的在前。
+  ///
+  /// 未指定 [Aria2HistoryFilter.until] 时以开始读取的时刻为上限，
+  /// 读取期间新增的记录不会导致分页错位。
+  Stream<List<Aria2HistoryRecord>> streamHistory({
+    Aria2HistoryFilter filter = const Aria2HistoryFilter(),
+    int pageSize = 500,
+  }) async* {
+    final pinned = Aria2HistoryFilter(
+      host: filter.host,
+      since: filter.since,
+      until: filter.until ?? DateTime.now(),
+      status: filter.status,
+    );
+    var offset = 0;
+    while (true) {
+      final page =
+          await queryHistory(filter: pinned, offset: offset, limit: pageSize);
+      if (page.isEmpty) {
+        return;
+      }
+      yield page;
+      if (page.length < pageSize) {
+        return;
+      }
+      offset += page.length;
+    }
+  }
+
+  /// 获取下载历史统计：open、rows（记录数）、hosts（主机数）、bytes（文件占用）。
+  Future<Map<String, dynamic>> getHistoryStats() {
+    return FlutterAria2Platform.instance.getHistoryStats();
+  }
+
+  // ──────── 会话日志 ────────
+
+  /// 在 [dir] 目录下打开会话日志，需在 [sessionNew] 之后调用。
+  ///
+  /// 打开后，通过插件添加的 URI 下载及其选项修改、暂停、恢复和结束都会追加到
+  /// 内存映射的日志文件中，进程崩溃也不会丢失；原生层每 100 毫秒批量落盘一次，
+  /// 日志写满四分之三时在后台线程生成快照并切换到新日志。
+  ///
+  /// [restore] 为 true 时，按原顺序以原 GID、选项和暂停状态重新添加上次记录中
+  /// 尚未结束的下载；为 false 时丢弃目录中已有的记录。种子和 Metalink 下载
+  /// 不会被记录。
+  ///
+  /// 返回统计，格式同 [getJournalStats]，另含 restoredGids（恢复的 GID 列表）。
+  Future<Map<String, dynamic>> openJournal(String dir, {bool restore = true}) {
+    return FlutterAria2Platform.instance.openJournal(dir, restore: restore);
+  }
+
+  /// 落盘未提交的记录并关闭会话日志。会话结束时也会自动关闭。
+  Future<void> closeJournal() {
+    return FlutterAria2Platform.instance.closeJournal();
+  }
+
+  /// 立即生成快照并切换到新日志，返回统计。
+  Future<Map<String, dynamic>> checkpointJournal() {
+    return FlutterAria2Platform.instance.checkpointJournal();
+  }
+
+  /// 获取会话日志统计：open、dir、generation、logBytes、compacting、
+  /// live（记录中未结束的下载数）、records、commits、checkpoints、restored、
+  /// restoreFailed。
+  Future<Map<String, dynamic>> getJournalStats() {
+    return FlutterAria2Platform.instance.getJournalStats();
+  }
+
+  // ──────── 快速续传 ────────
+
+  /// 使用已存在的 [dir] 目录作为快速续传缓存，可在 [sessionNew] 之前调用。
+  ///
+  /// 打开后，通过 [addUri] 或 [addTorrent] 添加的下载在暂停或随会话关闭而
+  /// 停止时，原生层会把分片完成状态和各文件的大小、修改时间保存到缓存中。
+  /// 之后（包括重启后）再次添加同一下载（相同的 URI 或种子文件及保存目录）
+  /// 时，若文件均未改变，则据缓存重写 aria2 控制文件并关闭 check-integrity，
+  /// 无需重新校验整个文件；若有改变则开启 check-integrity 完整校验。
+  ///
+  /// 返回统计，格式同 [getResumeCacheStats]。
+  Future<Map<String, dynamic>> openResumeCache(String dir) {
+    return FlutterAria2Platform.instance.openResumeCache(dir);
+  }
+
+  /// 关闭快速续传缓存，已保存的条目保留在目录中。
+  Future<void> closeResumeCache() {
+    return FlutterAria2Platform.instance.closeResumeCache();
+  }
+
+  /// 立即保存所有未结束下载的续传状态，返回保存的数量。
+  ///
+  /// 活动中的下载在保存后仍会写入文件，下次添加时会因文件已改变而完整校验；
+  /// 建议在暂停下载后调用。
+  Future<int> saveResumeState() {
+    return FlutterAria2Platform.instance.saveResumeState();
+  }
+
+  /// 获取快速续传统计：open、dir、tracked（跟踪中的下载数）、saved、
+  /// saveErrors、hits（免校验续传次数）、stale（文件已改变次数）、misses。
+  Future<Map<String, dynamic>> getResumeCacheStats() {
+    return FlutterAria2Platform.instance.getResumeCacheStats();
+  }
+
   // ──────── 选项管理 ────────
 
   /// 修改指定下载的选项。
@@ -636,6 +2504,130 @@ class FlutterAria2 {
     return FlutterAria2Platform.instance.getGlobalStat();
   }
 
+  /// 获取原生组件的运行指标与最近的决策事件。
+  ///
+  /// [clear] 读取后是否清空事件记录。
+  Future<Aria2NativeMetrics> getNativeMetrics({bool clear = false}) {
+    return FlutterAria2Platform.instance.getNativeMetrics(clear: clear);
+  }
+
+  // ──────── 自适应并发 ────────
+
+  /// 启用自适应并发控制，由原生层在运行期间调整 split、
+  /// max-connection-per-server 与 max-concurrent-downloads。
+  ///
+  /// split 与 max-connection-per-server 在下载开始时生效，因此调整只影响之后启动的下载。
+  ///
+  /// 返回控制器当前状态（enabled、split、maxConnectionPerServer、maxConcurrentDownloads、throughput）。
+  Future<Map<String, dynamic>> enableAdaptiveConcurrency([
+    Aria2ConcurrencyConfig config = const Aria2ConcurrencyConfig(),
+  ]) {
+    return FlutterAria2Platform.instance.enableAdaptiveConcurrency(config);
+  }
+
+  /// 停用自适应并发控制；已调整的选项保持当前值。
+  Future<void> disableAdaptiveConcurrency() {
+    return FlutterAria2Platform.instance.disableAdaptiveConcurrency();
+  }
+
+  /// 在本机上一次性测量 disk-cache、file-allocation 与 piece-length 的最佳组合。
+  ///
+  /// 原生层对每个选项组合启动一个临时会话，从本地回环 HTTP 服务器并行下载
+  /// [fileCount] 个合成文件（合计 [workloadBytes] 字节）到 [dir]，测量吞吐量与
+  /// 写入延迟，结束后删除测试文件。吞吐量最高者胜出；与其相差 5% 以内时取写入延迟更低者。
+  ///
+  /// 需在 [libraryInit] 之后、[sessionNew] 之前调用，运行期间无法创建会话。
+  /// 结果不会自动保存，可将 [Aria2AutotuneResult.bestOptions] 持久化并在之后传给 [sessionNew]。
+  Future<Aria2AutotuneResult> autotune({
+    required String dir,
+    List<String> diskCache = const ['0', '16M', '64M'],
+    List<String> fileAllocation = const ['none', 'prealloc', 'falloc'],
+    List<String> pieceLength = const ['1M', '4M'],
+    int workloadBytes = 32 * 1024 * 1024,
+    int fileCount = 4,
+    Duration runTimeout = const Duration(seconds: 30),
+  }) {
+    return FlutterAria2Platform.instance.autotune(
+      dir: dir,
+      diskCache: diskCache,
+      fileAllocation: fileAllocation,
+      pieceLength: pieceLength,
+      workloadBytes: workloadBytes,
+      fileCount: fileCount,
+      runTimeout: runTimeout,
+    );
+  }
+
+  /// 在当前组合测量完成后提前结束 [autotune]，已完成的结果照常返回。
+  Future<void> cancelAutotune() {
+    return FlutterAria2Platform.instance.cancelAutotune();
+  }
+
+  // ──────── 制作种子 ────────
+
+  /// 为本地文件制作 .torrent 文件并写入 [output]。
+  ///
+  /// [paths] 为同一目录下的文件或目录：单个文件生成单文件种子，单个目录生成
+  /// 以该目录命名的多文件种子，多个路径生成以其所在目录命名的多文件种子。
+  /// [pieceLength] 为 2 的幂（16 KiB ~ 64 MiB），为 null 时按总大小自动选择。
+  /// [trackers] 中第一个作为 announce，每个 tracker 各占一层 announce-list；
+  /// [webseeds] 写入 url-list。
+  ///
+  /// 分片哈希在原生层多线程并行计算（[threads] 为 0 时每核一个线程），
+  /// 通过内存映射读取文件并预读，支持 SHA 指令的 x86 CPU 使用硬件加速。
+  /// 无需会话。做种时将结果路径传给 [addTorrent]，并以
+  /// [Aria2CreatedTorrent.seedDir] 作为 dir 选项。
+  ///
+  /// 同一时间只能制作一个种子；被 [cancelCreateTorrent] 取消时抛出
+  /// code 为 CANCELLED 的 [Aria2Exception]。
+  Future<Aria2CreatedTorrent> createTorrent({
+    required List<String> paths,
+    required String output,
+    int? pieceLength,
+    List<String> trackers = const [],
+    List<String> webseeds = const [],
+    String? comment,
+    bool isPrivate = false,
+    int threads = 0,
+  }) {
+    return FlutterAria2Platform.instance.createTorrent(
+      paths: paths,
+      output: output,
+      pieceLength: pieceLength,
+      trackers: trackers,
+      webseeds: webseeds,
+      comment: comment,
+      isPrivate: isPrivate,
+      threads: threads,
+    );
+  }
+
+  /// 取消进行中的 [createTorrent]。
+  Future<void> cancelCreateTorrent() {
+    return FlutterAria2Platform.instance.cancelCreateTorrent();
+  }
+
+  /// 获取当前（或最近一次）[createTorrent] 的进度。
+  Future<Aria2CreateTorrentProgress> getCreateTorrentProgress() {
+    return FlutterAria2Platform.instance.getCreateTorrentProgress();
+  }
+
+  // ──────── 渐进读取 ────────
+
+  /// 在下载进行中按顺序读取文件 [fileIndex]（从 1 开始）。
+  ///
+  /// 订阅后下载切换为按顺序获取分片（种子下载则优先获取各文件的开头），
+  /// 原生层根据已完成分片计算文件开头连续可用的部分，一有新数据即读出推送，
+  /// 无需轮询，也不会重复下载。下载完成且数据全部送达后流关闭；下载失败或被
+  /// 移除时流以 [Aria2Exception]（错误码 STREAM_FAILED）结束。取消订阅即关闭
+  /// 原生端的读取。适合边下边播等场景。
+  Stream<Uint8List> openProgressiveStream(String gid, {int fileIndex = 1}) {
+    return FlutterAria2Platform.instance.openProgressiveStream(
+      gid,
+      fileIndex: fileIndex,
+    );
+  }
+
   // ──────── 关闭 ────────
 
   /// 关闭 aria2。
@@ -685,6 +2677,163 @@ class FlutterAria2 {
     return FlutterAria2Platform.instance.getDownloadBtMetaInfo(gid);
   }
 
+  /// 获取下载的分片完成位图，可用于绘制分段进度条。
+  ///
+  /// [sinceSeq] 为上一次结果的 [Aria2PieceBitfield.seq] 时，若原生层仍保留
+  /// 该版本（最近 8 个，下载结束后不再保留）则只返回变化的分片，用 [Aria2PieceBitfield.applyTo]
+  /// 合并；否则返回完整位图。已完成数与连续段统计由原生层以向量化指令计算。
+  Future<Aria2PieceBitfield> getPieceBitfield(String gid, {int? sinceSeq}) {
+    return FlutterAria2Platform.instance.getPieceBitfield(
+      gid,
+      sinceSeq: sinceSeq,
+    );
+  }
+
+  // ──────── 下载组 ────────
+
+  /// 获取下载组的汇总进度。
+  ///
+  /// 磁力链接、HTTP 获取的 .torrent 与 Metalink 会在 aria2 内展开成一棵下载树
+  /// （followedBy / following / belongsTo），原生层维护这棵树并在一次遍历中汇总
+  /// 大小与速度。[gid] 可以是树中任一成员。已被保留策略清理的成员按最后已知的
+  /// 状态计入。
+  Future<Aria2GroupProgress> getGroupProgress(String gid) {
+    return FlutterAria2Platform.instance.getGroupProgress(gid);
+  }
+
+  /// 暂停下载组内所有进行中与等待中的成员，返回实际暂停的成员数。
+  Future<int> pauseGroup(String gid, {bool force = false}) {
+    return FlutterAria2Platform.instance.pauseGroup(gid, force: force);
+  }
+
+  /// 恢复下载组内所有已暂停的成员，返回实际恢复的成员数。
+  Future<int> unpauseGroup(String gid) {
+    return FlutterAria2Platform.instance.unpauseGroup(gid);
+  }
+
+  /// 移除下载组内所有尚未结束的成员（根在前），返回实际移除的成员数。
+  Future<int> removeGroup(String gid, {bool force = false}) {
+    return FlutterAria2Platform.instance.removeGroup(gid, force: force);
+  }
+
+  // ──────── 速度历史 ────────
+
+  /// 设置速度历史的采样策略。
+  ///
+  /// 原生事件循环线程按 [Aria2SpeedHistoryPolicy.interval] 采样所有活动下载，
+  /// 为每个下载保留定长的环形样本，并维护按时间衰减的速度加权平均，
+  /// [getDownloadInfo] 的 avgSpeed 与 eta 即来自该平均。修改样本数或下载数上限
+  /// 会清空已有历史。返回当前状态（intervalMs、samples、smoothingMs、
+  /// maxDownloads、tracked、slabBytes）。
+  Future<Map<String, dynamic>> setSpeedHistoryPolicy(
+      Aria2SpeedHistoryPolicy policy) {
+    return FlutterAria2Platform.instance.setSpeedHistoryPolicy(policy);
+  }
+
+  /// 获取下载的速度历史，可直接用于绘制速度曲线。
+  ///
+  /// 下载尚未被采样或历史已被回收时抛出 [Aria2Exception]（HANDLE_FAILED）。
+  Future<Aria2SpeedHistory> getSpeedHistory(String gid) {
+    return FlutterAria2Platform.instance.getSpeedHistory(gid);
+  }
+
+  // ──────── 进度触发器 ────────
+
+  /// 注册进度触发器，返回其 id。
+  ///
+  /// 原生事件循环线程每 250 毫秒采样一次被关注的下载，仅当变化有意义时才通过
+  /// [onProgressTrigger] 批量通知，避免对大量下载轮询：
+  /// - [percentStep]：进度每跨过该百分比的整数倍时命中；
+  /// - [speedDeltaPct]：平滑速度相对上次命中时变化超过该百分比时命中；
+  /// - [etaBoundaries]：剩余时间跨过任一边界时命中。
+  ///
+  /// [gid] 为 null 时关注所有进行中的下载。同一下载两次命中至少间隔
+  /// [minInterval]，期间的变化在间隔结束后若仍成立再通知；下载离开活动列表时
+  /// 的最后一次变化不受该限制。首次采样只记录基准，不命中。会话结束时触发器
+  /// 全部失效。
+  Future<int> registerProgressTrigger(
+    String? gid, {
+    double? percentStep,
+    double? speedDeltaPct,
+    List<Duration>? etaBoundaries,
+    Duration minInterval = Duration.zero,
+  }) {
+    return FlutterAria2Platform.instance.registerProgressTrigger(
+      gid,
+      percentStep: percentStep,
+      speedDeltaPct: speedDeltaPct,
+      etaBoundaries: etaBoundaries,
+      minInterval: minInterval,
+    );
+  }
+
+  /// 注销进度触发器，id 不存在时返回 false。
+  Future<bool> unregisterProgressTrigger(int id) {
+    return FlutterAria2Platform.instance.unregisterProgressTrigger(id);
+  }
+
+  // ──────── 等待下载 ────────
+
+  /// 等待 [gid] 结束（完成、出错或停止），返回结束事件与当时的下载信息。
+  ///
+  /// 由原生层按 GID 登记并在下载事件回调中直接完成，无需监听并过滤
+  /// [onDownloadEvent]，也无需结束后再调用 [getDownloadInfo]。已结束的下载在
+  /// 下一轮事件循环中返回；原生重试引擎接手的失败不算结束，等待会跟随重试后
+  /// 的新 GID；启用 SHA-256 校验的下载在摘要校验后才返回。[timeout] 内未结束
+  /// 时抛出 code 为 TIMEOUT 的 [Aria2Exception]，会话结束时抛出 code 为
+  /// WAIT_FAILED 的 [Aria2Exception]。需要原生事件循环运行。
+  Future<Aria2DownloadResult> awaitDownload(String gid, {Duration? timeout}) {
+    return FlutterAria2Platform.instance.awaitDownload(gid, timeout: timeout);
+  }
+
+  /// 等待 [gids] 全部结束，结果与 [gids] 顺序一致，见 [awaitDownload]。
+  Future<List<Aria2DownloadResult>> awaitAll(
+    List<String> gids, {
+    Duration? timeout,
+  }) {
+    return FlutterAria2Platform.instance.awaitAll(gids, timeout: timeout);
+  }
+
+  // ──────── 事件订阅 ────────
+
+  /// 设置（或替换）名为 [name] 的事件订阅，在原生层过滤 [onDownloadEvent]。
+  ///
+  /// 订阅只接收 [events] 中的事件；[gids] 不为 null 时只接收这些下载的事件
+  /// （重试后的新 GID 自动沿用）。只要存在订阅，原生层即在回调中先行丢弃
+  /// 没有任何订阅需要的事件，其余事件按事件循环的每一轮合并为一次批量投递，
+  /// 每个事件的 [Aria2DownloadEventData.subscriptions] 标明命中的订阅，可用
+  /// [eventsFor] 按名称取出。最多 32 个订阅。会话结束时各订阅的 [gids] 清空，
+  /// 订阅本身保留。
+  Future<void> setEventFilter(
+    Set<Aria2DownloadEvent> events, {
+    Set<String>? gids,
+    String name = 'default',
+  }) {
+    return FlutterAria2Platform.instance
+        .setEventFilter(events, gids: gids, name: name);
+  }
+
+  /// 移除名为 [name] 的事件订阅，不存在时返回 false。移除最后一个订阅后恢复
+  /// 逐个转发全部事件。
+  Future<bool> clearEventFilter({String name = 'default'}) {
+    return FlutterAria2Platform.instance.clearEventFilter(name: name);
+  }
+
+  // ──────── 方法耗时 ────────
+
+  /// 获取各通道方法的调用耗时，按方法名索引。
+  ///
+  /// Linux 上所有方法在单个工作线程中按调用顺序执行（含参数解码），UI 线程只负责
+  /// 接收调用与发送响应，二者分别计时；UI 线程耗时超过 1 毫秒的调用计入
+  /// [Aria2MethodTiming.slowOnMain]。原生层发往 Dart 的事件（如 onFetchComplete、
+  /// onDownloadEvents）以事件名记录：UI 线程上的发送计入 mainUs，发送前在原生线程上
+  /// 的数据转换计入 workerUs。其他平台暂不记录，返回空表。[clear] 为 true 时读取后清零。
+  Future<Map<String, Aria2MethodTiming>> getMethodTimings({
+    bool clear = false,
+  }) {
+    return FlutterAria2Platform.instance.getMethodTimings(clear: clear);
+  }
+
   // ──────── 工具方法 ────────
 
   /// 获取平台版本信息。
@@ -18,8 +18,46 @@ class MethodChannelFlutterAria2 extends FlutterAria2Platform {
   final StreamController<Aria2DownloadEventData> _eventController =
       StreamController<Aria2DownloadEventData>.broadcast();
 
+  final StreamController<Aria2RetryEvent> _retryController =
+      StreamController<Aria2RetryEvent>.broadcast();
+
+  final StreamController<Aria2VirtualMaterialized> _virtualController =
+      StreamController<Aria2VirtualMaterialized>.broadcast();
+
+  final StreamController<Aria2ImportProgress> _importController =
+      StreamController<Aria2ImportProgress>.broadcast();
+
+  final StreamController<Aria2GroupEvent> _groupController =
+      StreamController<Aria2GroupEvent>.broadcast();
+
+  final StreamController<List<Aria2ProgressTriggerHit>> _triggerController =
+      StreamController<List<Aria2ProgressTriggerHit>>.broadcast();
+
   bool _handlerRegistered = false;
 
+  /// 进行中的 [autotune]，由 onAutotuneComplete 事件完成。
+  Completer<Aria2AutotuneResult>? _autotuneCompleter;
+
+  /// 进行中的 [importInputFile]，由 done 为 true 的 onImportProgress 事件完成。
+  Completer<Aria2ImportProgress>? _importCompleter;
+
+  /// 进行中的 [createTorrent]，由 onTorrentCreated 事件完成。
+  Completer<Aria2CreatedTorrent>? _torrentCompleter;
+
+  /// 进行中的 [fetchToMemory]，按 GID 由 onFetchComplete 事件完成。
+  final Map<String, Completer<Uint8List>> _fetchCompleters = {};
+
+  /// 先于 fetchToMemory 调用返回到达的 onFetchComplete 事件，按 GID 暂存。
+  final Map<String, Map<String, dynamic>> _earlyFetchResults = {};
+
+  /// 已订阅的 [openProgressiveStream]，按 Dart 端分配的 id 接收 onStreamData。
+  final Map<int, StreamController<Uint8List>> _progressiveStreams = {};
+  int _nextStreamId = 0;
+
+  /// 进行中的 [awaitAll]，按 Dart 端分配的 id 由 onDownloadSettled 事件完成。
+  final Map<int, Completer<List<Aria2DownloadResult>>> _waiters = {};
+  int _nextWaiterId = 0;
+
   void _ensureHandler() {
     if (!_handlerRegistered) {
       _handlerRegistered = true;
@@ -33,10 +71,133 @@ class MethodChannelFlutterAria2 extends FlutterAria2Platform {
         final args = Map<String, dynamic>.from(call.arguments as Map);
         _eventController.add(Aria2DownloadEventData.fromMap(args));
         break;
+      case 'onDownloadEvents':
+        final args = Map<String, dynamic>.from(call.arguments as Map);
+        for (final e in (args['events'] as List?) ?? const []) {
+          _eventController.add(
+              Aria2DownloadEventData.fromMap(Map<String, dynamic>.from(e)));
+        }
+        break;
+      case 'onDownloadSettled':
+        final args = Map<String, dynamic>.from(call.arguments as Map);
+        final completer = _waiters.remove(args['id'] as int);
+        if (completer == null) {
+          break;
+        }
+        if (args['timedOut'] == true) {
+          completer.completeError(Aria2Exception(
+            code: 'TIMEOUT',
+            message: 'Downloads did not finish in time',
+          ));
+        } else if (args['error'] != null) {
+          completer.completeError(Aria2Exception(
+            code: 'WAIT_FAILED',
+            message: args['error'] as String,
+          ));
+        } else {
+          completer.complete(((args['results'] as List?) ?? [])
+              .map((e) =>
+                  Aria2DownloadResult.fromMap(Map<String, dynamic>.from(e)))
+              .toList());
+        }
+        break;
+      case 'onGroupEvent':
+        final args = Map<String, dynamic>.from(call.arguments as Map);
+        _groupController.add(Aria2GroupEvent.fromMap(args));
+        break;
+      case 'onProgressTrigger':
+        final args = Map<String, dynamic>.from(call.arguments as Map);
+        _triggerController.add(((args['hits'] as List?) ?? [])
+            .map((e) =>
+                Aria2ProgressTriggerHit.fromMap(Map<String, dynamic>.from(e)))
+            .toList());
+        break;
+      case 'onRetryEvent':
+        final args = Map<String, dynamic>.from(call.arguments as Map);
+        _retryController.add(Aria2RetryEvent.fromMap(args));
+        break;
+      case 'onVirtualMaterialized':
+        final args = Map<String, dynamic>.from(call.arguments as Map);
+        _virtualController.add(Aria2VirtualMaterialized.fromMap(args));
+        break;
+      case 'onImportProgress':
+        final args = Map<String, dynamic>.from(call.arguments as Map);
+        final progress = Aria2ImportProgress.fromMap(args);
+        _importController.add(progress);
+        if (progress.done) {
+          final completer = _importCompleter;
+          _importCompleter = null;
+          completer?.complete(progress);
+        }
+        break;
+      case 'onAutotuneComplete':
+        final args = Map<String, dynamic>.from(call.arguments as Map);
+        final completer = _autotuneCompleter;
+        _autotuneCompleter = null;
+        completer?.complete(Aria2AutotuneResult.fromMap(args));
+        break;
+      case 'onTorrentCreated':
+        final args = Map<String, dynamic>.from(call.arguments as Map);
+        final completer = _torrentCompleter;
+        _torrentCompleter = null;
+        if (args['ok'] == true) {
+          completer?.complete(Aria2CreatedTorrent.fromMap(args));
+        } else {
+          completer?.completeError(Aria2Exception(
+            code: args['cancelled'] == true ? 'CANCELLED' : 'TORRENT_FAILED',
+            message: args['error'] as String? ?? '',
+          ));
+        }
+        break;
+      case 'onFetchComplete':
+        final args = Map<String, dynamic>.from(call.arguments as Map);
+        final gid = args['gid'] as String;
+        final completer = _fetchCompleters.remove(gid);
+        if (completer == null) {
+          _earlyFetchResults[gid] = args;
+        } else {
+          _completeFetch(completer, args);
+        }
+        break;
+      case 'onStreamData':
+        final args = Map<String, dynamic>.from(call.arguments as Map);
+        final id = args['id'] as int;
+        final controller = _progressiveStreams[id];
+        if (controller == null) {
+          break;
+        }
+        final data = args['data'];
+        if (data is Uint8List) {
+          controller.add(data);
+        }
+        if (args['done'] == true) {
+          _progressiveStreams.remove(id);
+          final error = args['error'] as String?;
+          if (error != null) {
+            controller.addError(
+                Aria2Exception(code: 'STREAM_FAILED', message: error));
+          }
+          controller.close();
+        }
+        break;
     }
     return null;
   }
 
+  void _completeFetch(
+    Completer<Uint8List> completer,
+    Map<String, dynamic> args,
+  ) {
+    if (args['ok'] == true) {
+      completer.complete(args['data'] as Uint8List);
+    } else {
+      completer.completeError(Aria2Exception(
+        code: args['tooLarge'] == true ? 'TOO_LARGE' : 'FETCH_FAILED',
+        message: args['error'] as String? ?? '',
+      ));
+    }
+  }
+
   /// 调用原生方法，将 [PlatformException] 包装为 [Aria2Exception] 抛出。
   Future<T?> _invoke<T>(String method, [Map<String, dynamic>? arguments]) async {
     try {
@@ -66,6 +227,36 @@ class MethodChannelFlutterAria2 extends FlutterAria2Platform {
     return _eventController.stream;
   }
 
+  @override
+  Stream<Aria2RetryEvent> get onRetryEvent {
+    _ensureHandler();
+    return _retryController.stream;
+  }
+
+  @override
+  Stream<Aria2VirtualMaterialized> get onVirtualMaterialized {
+    _ensureHandler();
+    return _virtualController.stream;
+  }
+
+  @override
+  Stream<Aria2ImportProgress> get onImportProgress {
+    _ensureHandler();
+    return _importController.stream;
+  }
+
+  @override
+  Stream<Aria2GroupEvent> get onGroupEvent {
+    _ensureHandler();
+    return _groupController.stream;
+  }
+
+  @override
+  Stream<List<Aria2ProgressTriggerHit>> get onProgressTrigger {
+    _ensureHandler();
+    return _triggerController.stream;
+  }
+
   // ──────── 库初始化 ────────
 
   @override
@@ -78,6 +269,13 @@ class MethodChannelFlutterAria2 extends FlutterAria2Platform {
   @override
   Future<int> libraryDeinit() async {
     final result = await _invokeRequired<int>('libraryDeinit');
+    // 原生层会中止进行中的 autotune 且不再回报结果。
+    final completer = _autotuneCompleter;
+    _autotuneCompleter = null;
+    completer?.completeError(const Aria2Exception(
+      code: 'CANCELLED',
+      message: 'autotune aborted by libraryDeinit()',
+    ));
     return result;
   }
 
@@ -125,27 +323,80 @@ class MethodChannelFlutterAria2 extends FlutterAria2Platform {
     List<String> uris, {
     Map<String, String>? options,
     int position = -1,
+    Aria2Priority? priority,
+    int? sizeHint,
+    DateTime? deadline,
+    bool rankMirrors = false,
+    String? expectedSha256,
+    bool computeSha256 = false,
   }) async {
     final result = await _invokeRequired<String>('addUri', {
       'uris': uris,
       'options': options,
       'position': position,
+      if (priority != null) 'priority': priority.index,
+      if (sizeHint != null) 'sizeHint': sizeHint,
+      if (deadline != null) 'deadline': deadline.millisecondsSinceEpoch,
+      if (rankMirrors) 'rankMirrors': true,
+      if (expectedSha256 != null) 'expectedSha256': {'1': expectedSha256},
+      if (computeSha256) 'computeSha256': true,
     });
     return result;
   }
 
+  @override
+  Future<Aria2ImportProgress> importInputFile(
+    String path, {
+    Map<String, String>? options,
+    bool toVirtualQueue = false,
+  }) async {
+    _ensureHandler();
+    if (_importCompleter != null) {
+      throw const Aria2Exception(
+        code: 'IMPORT_RUNNING',
+        message: 'An import is already running',
+      );
+    }
+    final completer = Completer<Aria2ImportProgress>();
+    _importCompleter = completer;
+    try {
+      await _invoke<void>('importInputFile', {
+        'path': path,
+        'options': options,
+        'virtualQueue': toVirtualQueue,
+      });
+    } catch (_) {
+      _importCompleter = null;
+      rethrow;
+    }
+    return completer.future;
+  }
+
+  @override
+  Future<void> cancelImport() async {
+    await _invoke<void>('cancelImport');
+  }
+
   @override
   Future<String> addTorrent(
     String torrentFile, {
     List<String>? webseedUris,
     Map<String, String>? options,
     int position = -1,
+    Map<int, String>? expectedSha256,
+    bool computeSha256 = false,
   }) async {
     final result = await _invokeRequired<String>('addTorrent', {
       'torrentFile': torrentFile,
       'webseedUris': webseedUris,
       'options': options,
       'position': position,
+      if (expectedSha256 != null)
+        'expectedSha256': {
+          for (final entry in expectedSha256.entries)
+            '${entry.key}': entry.value,
+        },
+      if (computeSha256) 'computeSha256': true,
     });
     return result;
   }
@@ -164,6 +415,70 @@ class MethodChannelFlutterAria2 extends FlutterAria2Platform {
     return result.cast<String>();
   }
 
+  @override
+  Future<String> addTorrentBytes(
+    Uint8List torrent, {
+    List<String>? webseedUris,
+    Map<String, String>? options,
+    int position = -1,
+    Map<int, String>? expectedSha256,
+    bool computeSha256 = false,
+  }) async {
+    final result = await _invokeRequired<String>('addTorrentBytes', {
+      'torrent': torrent,
+      'webseedUris': webseedUris,
+      'options': options,
+      'position': position,
+      if (expectedSha256 != null)
+        'expectedSha256': {
+          for (final entry in expectedSha256.entries)
+            '${entry.key}': entry.value,
+        },
+      if (computeSha256) 'computeSha256': true,
+    });
+    return result;
+  }
+
+  @override
+  Future<List<String>> addMetalinkBytes(
+    Uint8List metalink, {
+    Map<String, String>? options,
+    int position = -1,
+  }) async {
+    final result = await _invokeRequired<List>('addMetalinkBytes', {
+      'metalink': metalink,
+      'options': options,
+      'position': position,
+    });
+    return result.cast<String>();
+  }
+
+  @override
+  Future<Uint8List> fetchToMemory(
+    List<String> uris, {
+    Map<String, String>? options,
+    int maxBytes = 16 * 1024 * 1024,
+    Aria2Priority? priority,
+    bool rankMirrors = false,
+  }) async {
+    _ensureHandler();
+    final gid = await _invokeRequired<String>('fetchToMemory', {
+      'uris': uris,
+      'options': options,
+      'maxBytes': maxBytes,
+      if (priority != null) 'priority': priority.index,
+      if (rankMirrors) 'rankMirrors': true,
+    });
+    final completer = Completer<Uint8List>();
+    final early = _earlyFetchResults.remove(gid);
+    if (early != null) {
+      _completeFetch(completer, early);
+    } else {
+      _fetchCompleters[gid] = completer;
+    }
+    return completer.future;
+  }
+
   // ──────── 下载控制 ────────
 
   @override
@@ -172,6 +487,32 @@ class MethodChannelFlutterAria2 extends FlutterAria2Platform {
     return result.cast<String>();
   }
 
+  @override
+  Future<List<String>> getWaitingDownloads(
+      {int offset = 0, int limit = 100}) async {
+    final result = await _invokeRequired<List>('getWaitingDownloads', {
+      'offset': offset,
+      'limit': limit,
+    });
+    return result.cast<String>();
+  }
+
+  @override
+  Future<List<String>> getStoppedDownloads(
+      {int offset = 0, int limit = 100}) async {
+    final result = await _invokeRequired<List>('getStoppedDownloads', {
+      'offset': offset,
+      'limit': limit,
+    });
+    return result.cast<String>();
+  }
+
+  @override
+  Future<Aria2DownloadSummary> getDownloadSummary() async {
+    final result = await _invokeRequired<Map>('getDownloadSummary');
+    return Aria2DownloadSummary.fromMap(Map<String, dynamic>.from(result));
+  }
+
   @override
   Future<int> removeDownload(String gid, {bool force = false}) async {
     final result = await _invokeRequired<int>('removeDownload', {
@@ -206,6 +547,225 @@ class MethodChannelFlutterAria2 extends FlutterAria2Platform {
     return result;
   }
 
+  // ──────── 优先级 ────────
+
+  @override
+  Future<int> setDownloadPriority(String gid, Aria2Priority priority) async {
+    final result = await _invokeRequired<int>('setDownloadPriority', {
+      'gid': gid,
+      'priority': priority.index,
+    });
+    return result;
+  }
+
+  @override
+  Future<Aria2Priority> getDownloadPriority(String gid) async {
+    final result =
+        await _invokeRequired<int>('getDownloadPriority', {'gid': gid});
+    return Aria2Priority.values[result];
+  }
+
+  @override
+  Future<int> reorderByPriority() async {
+    final result = await _invokeRequired<int>('reorderByPriority');
+    return result;
+  }
+
+  @override
+  Future<int> setQueuePolicy(Aria2QueuePolicy policy) async {
+    final result = await _invokeRequired<int>(
+      'setQueuePolicy',
+      {'policy': policy.index},
+    );
+    return result;
+  }
+
+  @override
+  Future<Aria2QueuePolicy> getQueuePolicy() async {
+    final result = await _invokeRequired<int>('getQueuePolicy');
+    return Aria2QueuePolicy.values[result];
+  }
+
+  @override
+  Future<int> setDownloadDeadline(String gid, DateTime? deadline) async {
+    final result = await _invokeRequired<int>('setDownloadDeadline', {
+      'gid': gid,
+      'deadline': deadline?.millisecondsSinceEpoch ?? -1,
+    });
+    return result;
+  }
+
+  // ──────── 重试 ────────
+
+  @override
+  Future<Map<String, dynamic>> setRetryPolicy(Aria2RetryPolicy policy) async {
+    final result = await _invokeRequired<Map>('setRetryPolicy', policy.toMap());
+    return Map<String, dynamic>.from(result);
+  }
+
+  @override
+  Future<Map<String, dynamic>> getRetryStats() async {
+    final result = await _invokeRequired<Map>('getRetryStats');
+    return Map<String, dynamic>.from(result);
+  }
+
+  // ──────── 结果保留 ────────
+
+  @override
+  Future<Map<String, dynamic>> setRetentionPolicy(
+      Aria2RetentionPolicy policy) async {
+    final result =
+        await _invokeRequired<Map>('setRetentionPolicy', policy.toMap());
+    return Map<String, dynamic>.from(result);
+  }
+
+  @override
+  Future<Map<String, dynamic>> getRetentionStats() async {
+    final result = await _invokeRequired<Map>('getRetentionStats');
+    return Map<String, dynamic>.from(result);
+  }
+
+  // ──────── 主机统计 ────────
+
+  @override
+  Future<List<Aria2HostStats>> getHostStats({bool clear = false}) async {
+    final result = await _invokeRequired<List>('getHostStats', {'clear': clear});
+    return result
+        .map((e) => Aria2HostStats.fromMap(Map<String, dynamic>.from(e)))
+        .toList();
+  }
+
+  // ──────── 虚拟队列 ────────
+
+  @override
+  Future<Map<String, dynamic>> openVirtualQueue(String dir,
+      {int lookahead = 2}) async {
+    _ensureHandler();
+    final result = await _invokeRequired<Map>('openVirtualQueue', {
+      'dir': dir,
+      'lookahead': lookahead,
+    });
+    return Map<String, dynamic>.from(result);
+  }
+
+  @override
+  Future<void> closeVirtualQueue() async {
+    await _invoke<void>('closeVirtualQueue');
+  }
+
+  @override
+  Future<int> addVirtualUris(
+    List<List<String>> entries, {
+    Map<String, String>? options,
+  }) async {
+    final result = await _invokeRequired<int>('addVirtualUris', {
+      'entries': entries,
+      'options': options,
+    });
+    return result;
+  }
+
+  @override
+  Future<Aria2VirtualEntry> getVirtualEntry(int id) async {
+    final result = await _invokeRequired<Map>('getVirtualEntry', {'id': id});
+    return Aria2VirtualEntry.fromMap(Map<String, dynamic>.from(result));
+  }
+
+  @override
+  Future<Map<String, dynamic>> getVirtualQueueStats() async {
+    final result = await _invokeRequired<Map>('getVirtualQueueStats');
+    return Map<String, dynamic>.from(result);
+  }
+
+  // ──────── 下载历史 ────────
+
+  @override
+  Future<Map<String, dynamic>> openHistory(String dir) async {
+    final result = await _invokeRequired<Map>('openHistory', {'dir': dir});
+    return Map<String, dynamic>.from(result);
+  }
+
+  @override
+  Future<void> closeHistory() async {
+    await _invoke<void>('closeHistory');
+  }
+
+  @override
+  Future<List<Aria2HistoryRecord>> queryHistory({
+    Aria2HistoryFilter filter = const Aria2HistoryFilter(),
+    int offset = 0,
+    int limit = 100,
+  }) async {
+    final result = await _invokeRequired<List>('queryHistory', {
+      ...filter.toMap(),
+      'offset': offset,
+      'limit': limit,
+    });
+    return result
+        .map((e) => Aria2HistoryRecord.fromMap(Map<String, dynamic>.from(e)))
+        .toList();
+  }
+
+  @override
+  Future<Map<String, dynamic>> getHistoryStats() async {
+    final result = await _invokeRequired<Map>('getHistoryStats');
+    return Map<String, dynamic>.from(result);
+  }
+
+  // ──────── 会话日志 ────────
+
+  @override
+  Future<Map<String, dynamic>> openJournal(String dir,
+      {bool restore = true}) async {
+    final result = await _invokeRequired<Map>('openJournal', {
+      'dir': dir,
+      'restore': restore,
+    });
+    return Map<String, dynamic>.from(result);
+  }
+
+  @override
+  Future<void> closeJournal() async {
+    await _invoke<void>('closeJournal');
+  }
+
+  @override
+  Future<Map<String, dynamic>> checkpointJournal() async {
+    final result = await _invokeRequired<Map>('checkpointJournal');
+    return Map<String, dynamic>.from(result);
+  }
+
+  @override
+  Future<Map<String, dynamic>> getJournalStats() async {
+    final result = await _invokeRequired<Map>('getJournalStats');
+    return Map<String, dynamic>.from(result);
+  }
+
+  // ──────── 快速续传 ────────
+
+  @override
+  Future<Map<String, dynamic>> openResumeCache(String dir) async {
+    final result = await _invokeRequired<Map>('openResumeCache', {'dir': dir});
+    return Map<String, dynamic>.from(result);
+  }
+
+  @override
+  Future<void> closeResumeCache() async {
+    await _invoke<void>('closeResumeCache');
+  }
+
+  @override
+  Future<int> saveResumeState() async {
+    final result = await _invokeRequired<int>('saveResumeState');
+    return result;
+  }
+
+  @override
+  Future<Map<String, dynamic>> getResumeCacheStats() async {
+    final result = await _invokeRequired<Map>('getResumeCacheStats');
+    return Map<String, dynamic>.from(result);
+  }
+
   // ──────── 选项管理 ────────
 
   @override
@@ -246,6 +806,153 @@ class MethodChannelFlutterAria2 extends FlutterAria2Platform {
     return Aria2GlobalStat.fromMap(Map<String, dynamic>.from(result));
   }
 
+  @override
+  Future<Aria2NativeMetrics> getNativeMetrics({bool clear = false}) async {
+    final result =
+        await _invokeRequired<Map>('getNativeMetrics', {'clear': clear});
+    return Aria2NativeMetrics.fromMap(Map<String, dynamic>.from(result));
+  }
+
+  // ──────── 自适应并发 ────────
+
+  @override
+  Future<Map<String, dynamic>> enableAdaptiveConcurrency(
+      Aria2ConcurrencyConfig config) async {
+    final result = await _invokeRequired<Map>(
+      'enableAdaptiveConcurrency',
+      config.toMap(),
+    );
+    return Map<String, dynamic>.from(result);
+  }
+
+  @override
+  Future<void> disableAdaptiveConcurrency() async {
+    await _invoke<void>('disableAdaptiveConcurrency');
+  }
+
+  @override
+  Future<Aria2AutotuneResult> autotune({
+    required String dir,
+    required List<String> diskCache,
+    required List<String> fileAllocation,
+    required List<String> pieceLength,
+    required int workloadBytes,
+    required int fileCount,
+    required Duration runTimeout,
+  }) async {
+    _ensureHandler();
+    if (_autotuneCompleter != null) {
+      throw const Aria2Exception(
+        code: 'AUTOTUNE_RUNNING',
+        message: 'An autotune benchmark is already running',
+      );
+    }
+    final completer = Completer<Aria2AutotuneResult>();
+    _autotuneCompleter = completer;
+    try {
+      await _invoke<void>('autotune', {
+        'dir': dir,
+        'diskCache': diskCache,
+        'fileAllocation': fileAllocation,
+        'pieceLength': pieceLength,
+        'workloadBytes': workloadBytes,
+        'fileCount': fileCount,
+        'runTimeoutMs': runTimeout.inMilliseconds,
+      });
+    } catch (_) {
+      _autotuneCompleter = null;
+      rethrow;
+    }
+    return completer.future;
+  }
+
+  @override
+  Future<void> cancelAutotune() async {
+    await _invoke<void>('cancelAutotune');
+  }
+
+  // ──────── 制作种子 ────────
+
+  @override
+  Future<Aria2CreatedTorrent> createTorrent({
+    required List<String> paths,
+    required String output,
+    int? pieceLength,
+    List<String> trackers = const [],
+    List<String> webseeds = const [],
+    String? comment,
+    bool isPrivate = false,
+    int threads = 0,
+  }) async {
+    _ensureHandler();
+    if (_torrentCompleter != null) {
+      throw const Aria2Exception(
+        code: 'TORRENT_RUNNING',
+        message: 'A torrent is already being created',
+      );
+    }
+    final completer = Completer<Aria2CreatedTorrent>();
+    _torrentCompleter = completer;
+    try {
+      await _invoke<void>('createTorrent', {
+        'paths': paths,
+        'output': output,
+        if (pieceLength != null) 'pieceLength': pieceLength,
+        'trackers': trackers,
+        'webseeds': webseeds,
+        if (comment != null) 'comment': comment,
+        'private': isPrivate,
+        'threads': threads,
+      });
+    } catch (_) {
+      _torrentCompleter = null;
+      rethrow;
+    }
+    return completer.future;
+  }
+
+  @override
+  Future<void> cancelCreateTorrent() async {
+    await _invoke<void>('cancelCreateTorrent');
+  }
+
+  @override
+  Future<Aria2CreateTorrentProgress> getCreateTorrentProgress() async {
+    final result = await _invokeRequired<Map>('getCreateTorrentProgress');
+    return Aria2CreateTorrentProgress.fromMap(Map<String, dynamic>.from(result));
+  }
+
+  // ──────── 渐进读取 ────────
+
+  @override
+  Stream<Uint8List> openProgressiveStream(String gid, {int fileIndex = 1}) {
+    _ensureHandler();
+    final id = ++_nextStreamId;
+    late final StreamController<Uint8List> controller;
+    controller = StreamController<Uint8List>(
+      onListen: () async {
+        _progressiveStreams[id] = controller;
+        try {
+          await _invoke<void>('openProgressiveStream', {
+            'id': id,
+            'gid': gid,
+            'fileIndex': fileIndex,
+          });
+        } on Aria2Exception catch (e) {
+          _progressiveStreams.remove(id);
+          controller.addError(e);
+          await controller.close();
+        }
+      },
+      onCancel: () async {
+        if (_progressiveStreams.remove(id) != null) {
+          await _invoke<void>('closeProgressiveStream', {'id': id});
+        }
+      },
+    );
+    return controller.stream;
+  }
+
   // ──────── 关闭 ────────
 
   @override
@@ -292,6 +999,158 @@ class MethodChannelFlutterAria2 extends FlutterAria2Platform {
     return Aria2BtMetaInfoData.fromMap(Map<String, dynamic>.from(result));
   }
 
+  @override
+  Future<Aria2PieceBitfield> getPieceBitfield(
+    String gid, {
+    int? sinceSeq,
+  }) async {
+    final result = await _invokeRequired<Map>('getPieceBitfield', {
+      'gid': gid,
+      if (sinceSeq != null) 'sinceSeq': sinceSeq,
+    });
+    return Aria2PieceBitfield.fromMap(Map<String, dynamic>.from(result));
+  }
+
+  // ──────── 下载组 ────────
+
+  @override
+  Future<Aria2GroupProgress> getGroupProgress(String gid) async {
+    final result = await _invokeRequired<Map>('getGroupProgress', {
+      'gid': gid,
+    });
+    return Aria2GroupProgress.fromMap(Map<String, dynamic>.from(result));
+  }
+
+  @override
+  Future<int> pauseGroup(String gid, {bool force = false}) async {
+    return _invokeRequired<int>('pauseGroup', {'gid': gid, 'force': force});
+  }
+
+  @override
+  Future<int> unpauseGroup(String gid) async {
+    return _invokeRequired<int>('unpauseGroup', {'gid': gid});
+  }
+
+  @override
+  Future<int> removeGroup(String gid, {bool force = false}) async {
+    return _invokeRequired<int>('removeGroup', {'gid': gid, 'force': force});
+  }
+
+  // ──────── 速度历史 ────────
+
+  @override
+  Future<Map<String, dynamic>> setSpeedHistoryPolicy(
+      Aria2SpeedHistoryPolicy policy) async {
+    final result =
+        await _invokeRequired<Map>('setSpeedHistoryPolicy', policy.toMap());
+    return Map<String, dynamic>.from(result);
+  }
+
+  @override
+  Future<Aria2SpeedHistory> getSpeedHistory(String gid) async {
+    final result = await _invokeRequired<Map>('getSpeedHistory', {'gid': gid});
+    return Aria2SpeedHistory.fromMap(Map<String, dynamic>.from(result));
+  }
+
+  // ──────── 进度触发器 ────────
+
+  @override
+  Future<int> registerProgressTrigger(
+    String? gid, {
+    double? percentStep,
+    double? speedDeltaPct,
+    List<Duration>? etaBoundaries,
+    Duration minInterval = Duration.zero,
+  }) async {
+    return _invokeRequired<int>('registerProgressTrigger', {
+      if (gid != null) 'gid': gid,
+      if (percentStep != null) 'percentStep': percentStep,
+      if (speedDeltaPct != null) 'speedDeltaPct': speedDeltaPct,
+      if (etaBoundaries != null)
+        'etaBoundaries': etaBoundaries.map((e) => e.inSeconds).toList(),
+      'minIntervalMs': minInterval.inMilliseconds,
+    });
+  }
+
+  @override
+  Future<bool> unregisterProgressTrigger(int id) async {
+    return _invokeRequired<bool>('unregisterProgressTrigger', {'id': id});
+  }
+
+  // ──────── 等待下载 ────────
+
+  @override
+  Future<Aria2DownloadResult> awaitDownload(
+    String gid, {
+    Duration? timeout,
+  }) async {
+    final results = await awaitAll([gid], timeout: timeout);
+    return results.first;
+  }
+
+  @override
+  Future<List<Aria2DownloadResult>> awaitAll(
+    List<String> gids, {
+    Duration? timeout,
+  }) async {
+    _ensureHandler();
+    // 先登记再调用：完成事件可能紧随调用返回到达
+    final id = ++_nextWaiterId;
+    final completer = Completer<List<Aria2DownloadResult>>();
+    _waiters[id] = completer;
+    try {
+      await _invoke<bool>('awaitDownloads', {
+        'id': id,
+        'gids': gids,
+        if (timeout != null) 'timeoutMs': timeout.inMilliseconds,
+      });
+    } catch (_) {
+      _waiters.remove(id);
+      rethrow;
+    }
+    return completer.future;
+  }
+
+  // ──────── 事件订阅 ────────
+
+  @override
+  Future<void> setEventFilter(
+    Set<Aria2DownloadEvent> events, {
+    Set<String>? gids,
+    String name = 'default',
+  }) async {
+    // C API 中事件值从 1 开始，掩码第 n 位对应事件值 n
+    var mask = 0;
+    for (final event in events) {
+      mask |= 1 << (event.index + 1);
+    }
+    await _invoke<bool>('setEventFilter', {
+      'name': name,
+      'eventMask': mask,
+      if (gids != null) 'gids': gids.toList(),
+    });
+  }
+
+  @override
+  Future<bool> clearEventFilter({String name = 'default'}) async {
+    return _invokeRequired<bool>('clearEventFilter', {'name': name});
+  }
+
+  // ──────── 方法耗时 ────────
+
+  @override
+  Future<Map<String, Aria2MethodTiming>> getMethodTimings({
+    bool clear = false,
+  }) async {
+    final map =
+        await _invokeRequired<Map>('getMethodTimings', {'clear': clear});
+    return {
+      for (final entry in map.entries)
+        entry.key as String: Aria2MethodTiming.fromMap(
+            Map<String, dynamic>.from(entry.value as Map)),
+    };
+  }
+
   // ──────── 旧接口 ────────
 
   @override
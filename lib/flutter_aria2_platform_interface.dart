@@ -1,3 +1,5 @@
+import 'dart:typed_data';
+
 import 'package:plugin_platform_interface/plugin_platform_interface.dart';
 
 import 'flutter_aria2.dart';
@@ -23,6 +25,27 @@ abstract class FlutterAria2Platform extends PlatformInterface {
     throw UnimplementedError('onDownloadEvent has not been implemented.');
   }
 
+  Stream<Aria2RetryEvent> get onRetryEvent {
+    throw UnimplementedError('onRetryEvent has not been implemented.');
+  }
+
+  Stream<Aria2VirtualMaterialized> get onVirtualMaterialized {
+    throw UnimplementedError(
+        'onVirtualMaterialized has not been implemented.');
+  }
+
+  Stream<Aria2ImportProgress> get onImportProgress {
+    throw UnimplementedError('onImportProgress has not been implemented.');
+  }
+
+  Stream<Aria2GroupEvent> get onGroupEvent {
+    throw UnimplementedError('onGroupEvent has not been implemented.');
+  }
+
+  Stream<List<Aria2ProgressTriggerHit>> get onProgressTrigger {
+    throw UnimplementedError('onProgressTrigger has not been implemented.');
+  }
+
   // ──────── 库初始化 ────────
 
   Future<int> libraryInit() {
@@ -68,15 +91,35 @@ abstract class FlutterAria2Platform extends PlatformInterface {
     List<String> uris, {
     Map<String, String>? options,
     int position = -1,
+    Aria2Priority? priority,
+    int? sizeHint,
+    DateTime? deadline,
+    bool rankMirrors = false,
+    String? expectedSha256,
+    bool computeSha256 = false,
   }) {
     throw UnimplementedError('addUri() has not been implemented.');
   }
 
+  Future<Aria2ImportProgress> importInputFile(
+    String path, {
+    Map<String, String>? options,
+    bool toVirtualQueue = false,
+  }) {
+    throw UnimplementedError('importInputFile() has not been implemented.');
+  }
+
+  Future<void> cancelImport() {
+    throw UnimplementedError('cancelImport() has not been implemented.');
+  }
+
   Future<String> addTorrent(
     String torrentFile, {
     List<String>? webseedUris,
     Map<String, String>? options,
     int position = -1,
+    Map<int, String>? expectedSha256,
+    bool computeSha256 = false,
   }) {
     throw UnimplementedError('addTorrent() has not been implemented.');
   }
@@ -89,12 +132,55 @@ abstract class FlutterAria2Platform extends PlatformInterface {
     throw UnimplementedError('addMetalink() has not been implemented.');
   }
 
+  Future<String> addTorrentBytes(
+    Uint8List torrent, {
+    List<String>? webseedUris,
+    Map<String, String>? options,
+    int position = -1,
+    Map<int, String>? expectedSha256,
+    bool computeSha256 = false,
+  }) {
+    throw UnimplementedError('addTorrentBytes() has not been implemented.');
+  }
+
+  Future<List<String>> addMetalinkBytes(
+    Uint8List metalink, {
+    Map<String, String>? options,
+    int position = -1,
+  }) {
+    throw UnimplementedError('addMetalinkBytes() has not been implemented.');
+  }
+
+  Future<Uint8List> fetchToMemory(
+    List<String> uris, {
+    Map<String, String>? options,
+    int maxBytes = 16 * 1024 * 1024,
+    Aria2Priority? priority,
+    bool rankMirrors = false,
+  }) {
+    throw UnimplementedError('fetchToMemory() has not been implemented.');
+  }
+
   // ──────── 下载控制 ────────
 
   Future<List<String>> getActiveDownload() {
     throw UnimplementedError('getActiveDownload() has not been implemented.');
   }
 
+  Future<List<String>> getWaitingDownloads({int offset = 0, int limit = 100}) {
+    throw UnimplementedError(
+        'getWaitingDownloads() has not been implemented.');
+  }
+
+  Future<List<String>> getStoppedDownloads({int offset = 0, int limit = 100}) {
+    throw UnimplementedError(
+        'getStoppedDownloads() has not been implemented.');
+  }
+
+  Future<Aria2DownloadSummary> getDownloadSummary() {
+    throw UnimplementedError('getDownloadSummary() has not been implemented.');
+  }
+
   Future<int> removeDownload(String gid, {bool force = false}) {
     throw UnimplementedError('removeDownload() has not been implemented.');
   }
@@ -111,6 +197,145 @@ abstract class FlutterAria2Platform extends PlatformInterface {
     throw UnimplementedError('changePosition() has not been implemented.');
   }
 
+  // ──────── 优先级 ────────
+
+  Future<int> setDownloadPriority(String gid, Aria2Priority priority) {
+    throw UnimplementedError('setDownloadPriority() has not been implemented.');
+  }
+
+  Future<Aria2Priority> getDownloadPriority(String gid) {
+    throw UnimplementedError('getDownloadPriority() has not been implemented.');
+  }
+
+  Future<int> reorderByPriority() {
+    throw UnimplementedError('reorderByPriority() has not been implemented.');
+  }
+
+  Future<int> setQueuePolicy(Aria2QueuePolicy policy) {
+    throw UnimplementedError('setQueuePolicy() has not been implemented.');
+  }
+
+  Future<Aria2QueuePolicy> getQueuePolicy() {
+    throw UnimplementedError('getQueuePolicy() has not been implemented.');
+  }
+
+  Future<int> setDownloadDeadline(String gid, DateTime? deadline) {
+    throw UnimplementedError('setDownloadDeadline() has not been implemented.');
+  }
+
+  // ──────── 重试 ────────
+
+  Future<Map<String, dynamic>> setRetryPolicy(Aria2RetryPolicy policy) {
+    throw UnimplementedError('setRetryPolicy() has not been implemented.');
+  }
+
+  Future<Map<String, dynamic>> getRetryStats() {
+    throw UnimplementedError('getRetryStats() has not been implemented.');
+  }
+
+  // ──────── 结果保留 ────────
+
+  Future<Map<String, dynamic>> setRetentionPolicy(
+      Aria2RetentionPolicy policy) {
+    throw UnimplementedError('setRetentionPolicy() has not been implemented.');
+  }
+
+  Future<Map<String, dynamic>> getRetentionStats() {
+    throw UnimplementedError('getRetentionStats() has not been implemented.');
+  }
+
+  // ──────── 主机统计 ────────
+
+  Future<List<Aria2HostStats>> getHostStats({bool clear = false}) {
+    throw UnimplementedError('getHostStats() has not been implemented.');
+  }
+
+  // ──────── 虚拟队列 ────────
+
+  Future<Map<String, dynamic>> openVirtualQueue(String dir,
+      {int lookahead = 2}) {
+    throw UnimplementedError('openVirtualQueue() has not been implemented.');
+  }
+
+  Future<void> closeVirtualQueue() {
+    throw UnimplementedError('closeVirtualQueue() has not been implemented.');
+  }
+
+  Future<int> addVirtualUris(
+    List<List<String>> entries, {
+    Map<String, String>? options,
+  }) {
+    throw UnimplementedError('addVirtualUris() has not been implemented.');
+  }
+
+  Future<Aria2VirtualEntry> getVirtualEntry(int id) {
+    throw UnimplementedError('getVirtualEntry() has not been implemented.');
+  }
+
+  Future<Map<String, dynamic>> getVirtualQueueStats() {
+    throw UnimplementedError(
+        'getVirtualQueueStats() has not been implemented.');
+  }
+
+  // ──────── 下载历史 ────────
+
+  Future<Map<String, dynamic>> openHistory(String dir) {
+    throw UnimplementedError('openHistory() has not been implemented.');
+  }
+
+  Future<void> closeHistory() {
+    throw UnimplementedError('closeHistory() has not been implemented.');
+  }
+
+  Future<List<Aria2HistoryRecord>> queryHistory({
+    Aria2HistoryFilter filter = const Aria2HistoryFilter(),
+    int offset = 0,
+    int limit = 100,
+  }) {
+    throw UnimplementedError('queryHistory() has not been implemented.');
+  }
+
+  Future<Map<String, dynamic>> getHistoryStats() {
+    throw UnimplementedError('getHistoryStats() has not been implemented.');
+  }
+
+  // ──────── 会话日志 ────────
+
+  Future<Map<String, dynamic>> openJournal(String dir, {bool restore = true}) {
+    throw UnimplementedError('openJournal() has not been implemented.');
+  }
+
+  Future<void> closeJournal() {
+    throw UnimplementedError('closeJournal() has not been implemented.');
+  }
+
+  Future<Map<String, dynamic>> checkpointJournal() {
+    throw UnimplementedError('checkpointJournal() has not been implemented.');
+  }
+
+  Future<Map<String, dynamic>> getJournalStats() {
+    throw UnimplementedError('getJournalStats() has not been implemented.');
+  }
+
+  // ──────── 快速续传 ────────
+
+  Future<Map<String, dynamic>> openResumeCache(String dir) {
+    throw UnimplementedError('openResumeCache() has not been implemented.');
+  }
+
+  Future<void> closeResumeCache() {
+    throw UnimplementedError('closeResumeCache() has not been implemented.');
+  }
+
+  Future<int> saveResumeState() {
+    throw UnimplementedError('saveResumeState() has not been implemented.');
+  }
+
+  Future<Map<String, dynamic>> getResumeCacheStats() {
+    throw UnimplementedError(
+        'getResumeCacheStats() has not been implemented.');
+  }
+
   // ──────── 选项管理 ────────
 
   Future<int> changeOption(String gid, Map<String, String> options) {
@@ -135,6 +360,71 @@ abstract class FlutterAria2Platform extends PlatformInterface {
     throw UnimplementedError('getGlobalStat() has not been implemented.');
   }
 
+  Future<Aria2NativeMetrics> getNativeMetrics({bool clear = false}) {
+    throw UnimplementedError('getNativeMetrics() has not been implemented.');
+  }
+
+  // ──────── 自适应并发 ────────
+
+  Future<Map<String, dynamic>> enableAdaptiveConcurrency(
+      Aria2ConcurrencyConfig config) {
+    throw UnimplementedError(
+        'enableAdaptiveConcurrency() has not been implemented.');
+  }
+
+  Future<void> disableAdaptiveConcurrency() {
+    throw UnimplementedError(
+        'disableAdaptiveConcurrency() has not been implemented.');
+  }
+
+  Future<Aria2AutotuneResult> autotune({
+    required String dir,
+    required List<String> diskCache,
+    required List<String> fileAllocation,
+    required List<String> pieceLength,
+    required int workloadBytes,
+    required int fileCount,
+    required Duration runTimeout,
+  }) {
+    throw UnimplementedError('autotune() has not been implemented.');
+  }
+
+  Future<void> cancelAutotune() {
+    throw UnimplementedError('cancelAutotune() has not been implemented.');
+  }
+
+  // ──────── 制作种子 ────────
+
+  Future<Aria2CreatedTorrent> createTorrent({
+    required List<String> paths,
+    required String output,
+    int? pieceLength,
+    List<String> trackers = const [],
+    List<String> webseeds = const [],
+    String? comment,
+    bool isPrivate = false,
+    int threads = 0,
+  }) {
+    throw UnimplementedError('createTorrent() has not been implemented.');
+  }
+
+  Future<void> cancelCreateTorrent() {
+    throw UnimplementedError(
+        'cancelCreateTorrent() has not been implemented.');
+  }
+
+  Future<Aria2CreateTorrentProgress> getCreateTorrentProgress() {
+    throw UnimplementedError(
+        'getCreateTorrentProgress() has not been implemented.');
+  }
+
+  // ──────── 渐进读取 ────────
+
+  Stream<Uint8List> openProgressiveStream(String gid, {int fileIndex = 1}) {
+    throw UnimplementedError(
+        'openProgressiveStream() has not been implemented.');
+  }
+
   // ──────── 关闭 ────────
 
   Future<int> shutdown({bool force = false}) {
@@ -165,6 +455,81 @@ abstract class FlutterAria2Platform extends PlatformInterface {
     );
   }
 
+  Future<Aria2PieceBitfield> getPieceBitfield(String gid, {int? sinceSeq}) {
+    throw UnimplementedError('getPieceBitfield() has not been implemented.');
+  }
+
+  Future<Aria2GroupProgress> getGroupProgress(String gid) {
+    throw UnimplementedError('getGroupProgress() has not been implemented.');
+  }
+
+  Future<int> pauseGroup(String gid, {bool force = false}) {
+    throw UnimplementedError('pauseGroup() has not been implemented.');
+  }
+
+  Future<int> unpauseGroup(String gid) {
+    throw UnimplementedError('unpauseGroup() has not been implemented.');
+  }
+
+  Future<int> removeGroup(String gid, {bool force = false}) {
+    throw UnimplementedError('removeGroup() has not been implemented.');
+  }
+
+  Future<Map<String, dynamic>> setSpeedHistoryPolicy(
+      Aria2SpeedHistoryPolicy policy) {
+    throw UnimplementedError(
+        'setSpeedHistoryPolicy() has not been implemented.');
+  }
+
+  Future<Aria2SpeedHistory> getSpeedHistory(String gid) {
+    throw UnimplementedError('getSpeedHistory() has not been implemented.');
+  }
+
+  Future<int> registerProgressTrigger(
+    String? gid, {
+    double? percentStep,
+    double? speedDeltaPct,
+    List<Duration>? etaBoundaries,
+    Duration minInterval = Duration.zero,
+  }) {
+    throw UnimplementedError(
+        'registerProgressTrigger() has not been implemented.');
+  }
+
+  Future<bool> unregisterProgressTrigger(int id) {
+    throw UnimplementedError(
+        'unregisterProgressTrigger() has not been implemented.');
+  }
+
+  Future<Aria2DownloadResult> awaitDownload(String gid, {Duration? timeout}) {
+    throw UnimplementedError('awaitDownload() has not been implemented.');
+  }
+
+  Future<List<Aria2DownloadResult>> awaitAll(
+    List<String> gids, {
+    Duration? timeout,
+  }) {
+    throw UnimplementedError('awaitAll() has not been implemented.');
+  }
+
+  Future<void> setEventFilter(
+    Set<Aria2DownloadEvent> events, {
+    Set<String>? gids,
+    String name = 'default',
+  }) {
+    throw UnimplementedError('setEventFilter() has not been implemented.');
+  }
+
+  Future<bool> clearEventFilter({String name = 'default'}) {
+    throw UnimplementedError('clearEventFilter() has not been implemented.');
+  }
+
+  Future<Map<String, Aria2MethodTiming>> getMethodTimings({
+    bool clear = false,
+  }) {
+    throw UnimplementedError('getMethodTimings() has not been implemented.');
+  }
+
   // ──────── 旧接口 ────────
 
   Future<String?> getPlatformVersion() {
@@ -5,10 +5,14 @@
 #include <gtk/gtk.h>
 #include <sys/utsname.h>
 
-#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <thread>
@@ -16,19 +20,77 @@
 
 #include "../common/aria2_core.h"
 #include "../common/aria2_helpers.h"
+#include "../common/aria2_methods.h"
+#include "../common/aria2_value.h"
 #include "flutter_aria2_plugin_private.h"
 
 #define FLUTTER_ARIA2_PLUGIN(obj) \
   (G_TYPE_CHECK_INSTANCE_CAST((obj), flutter_aria2_plugin_get_type(), \
                               FlutterAria2Plugin))
 
+namespace {
+
+// Runs channel methods off the GTK main thread, one at a time and in the
+// order they arrived, so parsing a torrent or listing the files of a huge
+// one does not stall rendering. Keeping a single queue preserves the
+// ordering Dart saw when every method ran on the main thread.
+class MethodWorker {
+ public:
+  ~MethodWorker() { Stop(); }
+
+  void Post(std::function<void()> job) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!thread_.joinable()) {
+      stopping_ = false;
+      thread_ = std::thread([this]() { Loop(); });
+    }
+    jobs_.push_back(std::move(job));
+    wake_.notify_one();
+  }
+
+  // Runs the jobs still queued, then joins the thread.
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+      wake_.notify_one();
+    }
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+ private:
+  void Loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      wake_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+      if (jobs_.empty()) {
+        return;
+      }
+      std::function<void()> job = std::move(jobs_.front());
+      jobs_.pop_front();
+      lock.unlock();
+      job();
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::function<void()>> jobs_;
+  std::thread thread_;
+  bool stopping_ = false;
+};
+
+}  // namespace
+
 struct _FlutterAria2Plugin {
   GObject parent_instance;
-  aria2_session_t* session = nullptr;
-  gboolean library_initialized = FALSE;
-  std::thread run_thread;
-  std::atomic<bool> run_loop_active{false};
-  std::atomic<bool> run_in_progress{false};
+  // Heap-allocated so the run-loop thread and event callbacks can keep a
+  // stable pointer to it for the plugin's whole lifetime.
+  flutter_aria2::core::RuntimeState* core = nullptr;
+  MethodWorker* worker = nullptr;
   FlMethodChannel* channel = nullptr;
 };
 
@@ -144,91 +206,140 @@ FlMethodResponse* error_response(const gchar* code, const gchar* message) {
   return FL_METHOD_RESPONSE(fl_method_error_response_new(code, message, nullptr));
 }
 
-static const char* require_session(FlutterAria2Plugin* self) {
-  flutter_aria2::core::RuntimeState s;
-  s.session = self->session;
-  s.library_initialized = self->library_initialized;
-  return flutter_aria2::core::RequireSession(&s);
-}
-
-static const char* require_initialized(FlutterAria2Plugin* self) {
-  flutter_aria2::core::RuntimeState s;
-  s.session = self->session;
-  s.library_initialized = self->library_initialized;
-  return flutter_aria2::core::RequireInitialized(&s);
-}
-
-static const char* require_no_session(FlutterAria2Plugin* self) {
-  flutter_aria2::core::RuntimeState s;
-  s.session = self->session;
-  s.library_initialized = self->library_initialized;
-  return flutter_aria2::core::RequireNoSession(&s);
-}
-
-flutter_aria2::core::RuntimeState take_core_state(FlutterAria2Plugin* self) {
-  flutter_aria2::core::RuntimeState core;
-  core.session = self->session;
-  core.library_initialized = self->library_initialized;
-  core.run_thread = std::move(self->run_thread);
-  core.run_loop_active.store(self->run_loop_active.load());
-  core.run_in_progress.store(self->run_in_progress.load());
-  return core;
+using flutter_aria2::common::Value;
+
+FlValue* value_to_fl_value(const Value& value) {
+  switch (value.type()) {
+    case Value::Type::kNull:
+      return fl_value_new_null();
+    case Value::Type::kBool:
+      return fl_value_new_bool(value.AsBool());
+    case Value::Type::kInt:
+      return fl_value_new_int(value.AsInt());
+    case Value::Type::kDouble:
+      return fl_value_new_float(value.AsDouble());
+    case Value::Type::kString:
+      return fl_value_new_string(value.AsString().c_str());
+    case Value::Type::kBytes:
+      return fl_value_new_uint8_list(value.AsBytes().data(),
+                                     value.AsBytes().size());
+    case Value::Type::kList: {
+      FlValue* list = fl_value_new_list();
+      for (const Value& item : value.AsList()) {
+        fl_value_append_take(list, value_to_fl_value(item));
+      }
+      return list;
+    }
+    case Value::Type::kMap: {
+      FlValue* map = fl_value_new_map();
+      for (const auto& entry : value.AsMap()) {
+        fl_value_set_string_take(map, entry.first.c_str(),
+                                 value_to_fl_value(entry.second));
+      }
+      return map;
+    }
+  }
+  return fl_value_new_null();
 }
 
-void put_core_state(FlutterAria2Plugin* self,
-                    flutter_aria2::core::RuntimeState&& core) {
-  self->session = core.session;
-  self->library_initialized = core.library_initialized;
-  self->run_thread = std::move(core.run_thread);
-  self->run_loop_active.store(core.run_loop_active.load());
-  self->run_in_progress.store(core.run_in_progress.load());
+Value fl_value_to_value(FlValue* value) {
+  if (value == nullptr) {
+    return Value();
+  }
+  switch (fl_value_get_type(value)) {
+    case FL_VALUE_TYPE_BOOL:
+      return Value(static_cast<bool>(fl_value_get_bool(value)));
+    case FL_VALUE_TYPE_INT:
+      return Value(static_cast<int64_t>(fl_value_get_int(value)));
+    case FL_VALUE_TYPE_FLOAT:
+      return Value(fl_value_get_float(value));
+    case FL_VALUE_TYPE_STRING:
+      return Value(fl_value_get_string(value));
+    case FL_VALUE_TYPE_UINT8_LIST: {
+      const uint8_t* data = fl_value_get_uint8_list(value);
+      return Value(Value::Bytes(data, data + fl_value_get_length(value)));
+    }
+    case FL_VALUE_TYPE_LIST: {
+      Value list = Value::NewList();
+      size_t count = fl_value_get_length(value);
+      for (size_t i = 0; i < count; ++i) {
+        list.Append(fl_value_to_value(fl_value_get_list_value(value, i)));
+      }
+      return list;
+    }
+    case FL_VALUE_TYPE_MAP: {
+      Value map = Value::NewMap();
+      size_t count = fl_value_get_length(value);
+      for (size_t i = 0; i < count; ++i) {
+        FlValue* k = fl_value_get_map_key(value, i);
+        if (k == nullptr || fl_value_get_type(k) != FL_VALUE_TYPE_STRING) {
+          continue;
+        }
+        map.Set(fl_value_get_string(k),
+                fl_value_to_value(fl_value_get_map_value(value, i)));
+      }
+      return map;
+    }
+    default:
+      return Value();
+  }
 }
 
-void stop_run_loop(FlutterAria2Plugin* self) {
-  auto core = take_core_state(self);
-  flutter_aria2::core::StopRunLoop(&core);
-  put_core_state(self, std::move(core));
+int64_t elapsed_us(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - since)
+      .count();
 }
 
-struct EventPayload {
+// An event travelling from the emitting thread to the main thread. The
+// payload is converted before it is queued, so only the channel send is left
+// for the main thread.
+struct NativeEventPayload {
   FlutterAria2Plugin* plugin;
-  int event;
-  std::string gid;
+  std::string method;
+  FlValue* args;
+  int64_t convert_us;
 };
 
-gboolean send_download_event_on_main(gpointer user_data) {
-  std::unique_ptr<EventPayload> payload(static_cast<EventPayload*>(user_data));
-  if (payload->plugin == nullptr || payload->plugin->channel == nullptr) {
+gboolean send_native_event_on_main(gpointer user_data) {
+  std::unique_ptr<NativeEventPayload> event(
+      static_cast<NativeEventPayload*>(user_data));
+  g_autoptr(FlValue) args = event->args;
+  FlutterAria2Plugin* plugin = event->plugin;
+  if (plugin == nullptr || plugin->channel == nullptr ||
+      plugin->core == nullptr) {
     return G_SOURCE_REMOVE;
   }
-  g_autoptr(FlValue) args = fl_value_new_map();
-  fl_value_set_string(args, "event", fl_value_new_int(payload->event));
-  fl_value_set_string(args, "gid", fl_value_new_string(payload->gid.c_str()));
-  fl_method_channel_invoke_method(payload->plugin->channel, "onDownloadEvent",
+  const auto start = std::chrono::steady_clock::now();
+  fl_method_channel_invoke_method(plugin->channel, event->method.c_str(),
                                   args, nullptr, nullptr, nullptr);
+  // Keyed by event name next to the methods: the main-thread share is the
+  // send, the other share the conversion on the emitting thread.
+  plugin->core->timings.Record(event->method, elapsed_us(start),
+                               event->convert_us);
   return G_SOURCE_REMOVE;
 }
 
-int download_event_callback(aria2_session_t* /*session*/,
-                            aria2_download_event_t event, aria2_gid_t gid,
-                            void* user_data) {
-  auto* plugin = static_cast<FlutterAria2Plugin*>(user_data);
-  auto* payload = new EventPayload{
-      plugin,
-      static_cast<int>(event),
-      flutter_aria2::common::GidToHex(gid),
+// Called on the aria2 run-loop thread or the method worker.
+void native_event_sink(const char* method, Value&& payload, void* user_data) {
+  const auto start = std::chrono::steady_clock::now();
+  FlValue* args = value_to_fl_value(payload);
+  auto* event = new NativeEventPayload{
+      static_cast<FlutterAria2Plugin*>(user_data),
+      method,
+      args,
+      elapsed_us(start),
   };
-  g_main_context_invoke(nullptr, send_download_event_on_main, payload);
-  return 0;
+  g_main_context_invoke(nullptr, send_native_event_on_main, event);
 }
 
 }  // namespace
 
-// Called when a method call is received from Flutter.
-static void flutter_aria2_plugin_handle_method_call(
+// Runs a method call on the worker thread and returns its response.
+static FlMethodResponse* flutter_aria2_plugin_run_method_call(
     FlutterAria2Plugin* self,
     FlMethodCall* method_call) {
-  g_autoptr(FlMethodResponse) response = nullptr;
+  FlMethodResponse* response = nullptr;
 
   const gchar* method = fl_method_call_get_name(method_call);
   FlValue* args = fl_method_call_get_args(method_call);
@@ -236,29 +347,22 @@ static void flutter_aria2_plugin_handle_method_call(
   if (strcmp(method, "getPlatformVersion") == 0) {
     response = get_platform_version();
   } else if (strcmp(method, "libraryInit") == 0) {
-    auto core = take_core_state(self);
-    int ret = flutter_aria2::core::LibraryInit(&core);
-    put_core_state(self, std::move(core));
+    int ret = flutter_aria2::core::LibraryInit(self->core);
     response = success_response(fl_value_new_int(ret));
   } else if (strcmp(method, "libraryDeinit") == 0) {
-    auto core = take_core_state(self);
-    int ret = flutter_aria2::core::LibraryDeinit(&core);
-    put_core_state(self, std::move(core));
+    int ret = flutter_aria2::core::LibraryDeinit(self->core);
     response = success_response(fl_value_new_int(ret));
   } else if (strcmp(method, "sessionNew") == 0) {
-    if (const char* err = require_initialized(self)) {
+    if (const char* err = flutter_aria2::core::RequireInitialized(self->core)) {
       response = error_response(err, "Call libraryInit() before sessionNew()");
-    } else if (const char* err = require_no_session(self)) {
+    } else if (const char* err = flutter_aria2::core::RequireNoSession(self->core)) {
       response = error_response(err,
                                 "Session already exists. Call sessionFinal() first.");
     } else {
       KeyValHelper options = options_from_map(args, "options");
       bool keep_running = map_get_bool(args, "keepRunning", true);
-      auto core = take_core_state(self);
       const char* error = flutter_aria2::core::SessionNew(
-          &core, options.data(), options.count(), keep_running,
-          &download_event_callback, self);
-      put_core_state(self, std::move(core));
+          self->core, options.data(), options.count(), keep_running);
       if (error != nullptr) {
         response =
             error_response("SESSION_FAILED", "aria2_session_new returned null");
@@ -267,169 +371,46 @@ static void flutter_aria2_plugin_handle_method_call(
       }
     }
   } else if (strcmp(method, "sessionFinal") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
-      auto core = take_core_state(self);
       int ret = 0;
-      flutter_aria2::core::SessionFinal(&core, &ret);
-      put_core_state(self, std::move(core));
+      flutter_aria2::core::SessionFinal(self->core, &ret);
       response = success_response(fl_value_new_int(ret));
     }
   } else if (strcmp(method, "run") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
-      auto core = take_core_state(self);
-      int ret = flutter_aria2::core::RunOnce(&core);
-      put_core_state(self, std::move(core));
+      int ret = flutter_aria2::core::RunOnce(self->core);
       response = success_response(fl_value_new_int(ret));
     }
   } else if (strcmp(method, "startRunLoop") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
-    } else if (self->run_loop_active.load()) {
-      response = null_success_response();
     } else {
-      auto core = take_core_state(self);
-      flutter_aria2::core::StartRunLoop(&core);
-      put_core_state(self, std::move(core));
+      flutter_aria2::core::StartRunLoop(self->core);
       response = null_success_response();
     }
   } else if (strcmp(method, "stopRunLoop") == 0) {
-    stop_run_loop(self);
+    flutter_aria2::core::StopRunLoop(self->core);
     response = null_success_response();
   } else if (strcmp(method, "shutdown") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
       int force = map_get_bool(args, "force", false) ? 1 : 0;
-      auto core = take_core_state(self);
       int ret = 0;
-      flutter_aria2::core::Shutdown(&core, force != 0, &ret);
-      put_core_state(self, std::move(core));
+      flutter_aria2::core::Shutdown(self->core, force != 0, &ret);
       response = success_response(fl_value_new_int(ret));
     }
-  } else if (strcmp(method, "addUri") == 0) {
-    if (const char* err = require_session(self)) {
-      response = error_response(err, "No active session");
-    } else {
-      FlValue* uris = map_get(args, "uris");
-      if (uris == nullptr || fl_value_get_type(uris) != FL_VALUE_TYPE_LIST) {
-        response = error_response("BAD_ARGS", "Missing 'uris'");
-      } else {
-        std::vector<std::string> uri_strings;
-        std::vector<const char*> uri_ptrs;
-        size_t uri_count = fl_value_get_length(uris);
-        uri_strings.reserve(uri_count);
-        uri_ptrs.reserve(uri_count);
-        for (size_t i = 0; i < uri_count; ++i) {
-          FlValue* value = fl_value_get_list_value(uris, i);
-          if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_STRING) {
-            uri_strings.emplace_back(fl_value_get_string(value));
-          }
-        }
-        for (const std::string& uri : uri_strings) {
-          uri_ptrs.push_back(uri.c_str());
-        }
-
-        KeyValHelper options = options_from_map(args, "options");
-        int position = map_get_int(args, "position", -1);
-        aria2_gid_t gid;
-        int ret = aria2_add_uri(self->session, &gid, uri_ptrs.data(),
-                                uri_ptrs.size(), options.data(), options.count(),
-                                position);
-        if (ret == 0) {
-          response = success_response(fl_value_new_string(
-              flutter_aria2::common::GidToHex(gid).c_str()));
-        } else {
-          g_autofree gchar* message =
-              g_strdup_printf("aria2_add_uri failed with code %d", ret);
-          response = error_response("ARIA2_ERROR", message);
-        }
-      }
-    }
-  } else if (strcmp(method, "addTorrent") == 0) {
-    if (const char* err = require_session(self)) {
-      response = error_response(err, "No active session");
-    } else {
-      std::string torrent_file = map_get_string(args, "torrentFile");
-      FlValue* ws = map_get(args, "webseedUris");
-      std::vector<std::string> ws_strings;
-      std::vector<const char*> ws_ptrs;
-      if (ws != nullptr && fl_value_get_type(ws) == FL_VALUE_TYPE_LIST) {
-        size_t ws_count = fl_value_get_length(ws);
-        ws_strings.reserve(ws_count);
-        ws_ptrs.reserve(ws_count);
-        for (size_t i = 0; i < ws_count; ++i) {
-          FlValue* value = fl_value_get_list_value(ws, i);
-          if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_STRING) {
-            ws_strings.emplace_back(fl_value_get_string(value));
-          }
-        }
-        for (const std::string& item : ws_strings) {
-          ws_ptrs.push_back(item.c_str());
-        }
-      }
-
-      KeyValHelper options = options_from_map(args, "options");
-      int position = map_get_int(args, "position", -1);
-      aria2_gid_t gid;
-      int ret = ws_ptrs.empty()
-                    ? aria2_add_torrent_simple(self->session, &gid,
-                                               torrent_file.c_str(), options.data(),
-                                               options.count(), position)
-                    : aria2_add_torrent(self->session, &gid, torrent_file.c_str(),
-                                        ws_ptrs.data(), ws_ptrs.size(),
-                                        options.data(), options.count(), position);
-      if (ret == 0) {
-        response = success_response(fl_value_new_string(
-            flutter_aria2::common::GidToHex(gid).c_str()));
-      } else {
-        g_autofree gchar* message =
-            g_strdup_printf("aria2_add_torrent failed with code %d", ret);
-        response = error_response("ARIA2_ERROR", message);
-      }
-    }
-  } else if (strcmp(method, "addMetalink") == 0) {
-    if (const char* err = require_session(self)) {
-      response = error_response(err, "No active session");
-    } else {
-      std::string metalink_file = map_get_string(args, "metalinkFile");
-      KeyValHelper options = options_from_map(args, "options");
-      int position = map_get_int(args, "position", -1);
-      aria2_gid_t* gids = nullptr;
-      size_t gids_count = 0;
-      int ret =
-          aria2_add_metalink(self->session, &gids, &gids_count, metalink_file.c_str(),
-                             options.data(), options.count(), position);
-      if (ret == 0) {
-        FlValue* gid_list = fl_value_new_list();
-        for (size_t i = 0; i < gids_count; ++i) {
-          fl_value_append(
-              gid_list, fl_value_new_string(
-                            flutter_aria2::common::GidToHex(gids[i]).c_str()));
-        }
-        if (gids != nullptr) {
-          aria2_free(gids);
-        }
-        response = success_response(gid_list);
-      } else {
-        if (gids != nullptr) {
-          aria2_free(gids);
-        }
-        g_autofree gchar* message =
-            g_strdup_printf("aria2_add_metalink failed with code %d", ret);
-        response = error_response("ARIA2_ERROR", message);
-      }
-    }
   } else if (strcmp(method, "getActiveDownload") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
       aria2_gid_t* gids = nullptr;
       size_t gids_count = 0;
-      int ret = aria2_get_active_download(self->session, &gids, &gids_count);
+      int ret = aria2_get_active_download(self->core->session, &gids, &gids_count);
       if (ret == 0) {
         FlValue* gid_list = fl_value_new_list();
         for (size_t i = 0; i < gids_count; ++i) {
@@ -451,63 +432,52 @@ static void flutter_aria2_plugin_handle_method_call(
       }
     }
   } else if (strcmp(method, "removeDownload") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
       std::string gid_hex = map_get_string(args, "gid");
       bool force = map_get_bool(args, "force", false);
       aria2_gid_t gid = aria2_hex_to_gid(gid_hex.c_str());
-      int ret = aria2_remove_download(self->session, gid, force ? 1 : 0);
+      int ret = aria2_remove_download(self->core->session, gid, force ? 1 : 0);
       response = success_response(fl_value_new_int(ret));
     }
   } else if (strcmp(method, "pauseDownload") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
       std::string gid_hex = map_get_string(args, "gid");
       bool force = map_get_bool(args, "force", false);
       aria2_gid_t gid = aria2_hex_to_gid(gid_hex.c_str());
-      int ret = aria2_pause_download(self->session, gid, force ? 1 : 0);
+      int ret = aria2_pause_download(self->core->session, gid, force ? 1 : 0);
       response = success_response(fl_value_new_int(ret));
     }
   } else if (strcmp(method, "unpauseDownload") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
       std::string gid_hex = map_get_string(args, "gid");
       aria2_gid_t gid = aria2_hex_to_gid(gid_hex.c_str());
-      int ret = aria2_unpause_download(self->session, gid);
+      int ret = aria2_unpause_download(self->core->session, gid);
       response = success_response(fl_value_new_int(ret));
     }
   } else if (strcmp(method, "changePosition") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
       std::string gid_hex = map_get_string(args, "gid");
       int pos = map_get_int(args, "pos", 0);
       int how = map_get_int(args, "how", 0);
       aria2_gid_t gid = aria2_hex_to_gid(gid_hex.c_str());
-      int ret = aria2_change_position(self->session, gid, pos,
+      int ret = aria2_change_position(self->core->session, gid, pos,
                                       static_cast<aria2_offset_mode_t>(how));
       response = success_response(fl_value_new_int(ret));
     }
-  } else if (strcmp(method, "changeOption") == 0) {
-    if (const char* err = require_session(self)) {
-      response = error_response(err, "No active session");
-    } else {
-      std::string gid_hex = map_get_string(args, "gid");
-      KeyValHelper options = options_from_map(args, "options");
-      aria2_gid_t gid = aria2_hex_to_gid(gid_hex.c_str());
-      int ret = aria2_change_option(self->session, gid, options.data(),
-                                    options.count());
-      response = success_response(fl_value_new_int(ret));
-    }
   } else if (strcmp(method, "getGlobalOption") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
       std::string name = map_get_string(args, "name");
-      char* value = aria2_get_global_option(self->session, name.c_str());
+      char* value = aria2_get_global_option(self->core->session, name.c_str());
       if (value != nullptr) {
         response = success_response(fl_value_new_string(value));
         aria2_free(value);
@@ -516,12 +486,12 @@ static void flutter_aria2_plugin_handle_method_call(
       }
     }
   } else if (strcmp(method, "getGlobalOptions") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
       aria2_key_val_t* options = nullptr;
       size_t options_count = 0;
-      int ret = aria2_get_global_options(self->session, &options, &options_count);
+      int ret = aria2_get_global_options(self->core->session, &options, &options_count);
       if (ret == 0) {
         FlValue* map = fl_value_new_map();
         for (size_t i = 0; i < options_count; ++i) {
@@ -543,19 +513,19 @@ static void flutter_aria2_plugin_handle_method_call(
       }
     }
   } else if (strcmp(method, "changeGlobalOption") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
       KeyValHelper options = options_from_map(args, "options");
-      int ret = aria2_change_global_option(self->session, options.data(),
+      int ret = aria2_change_global_option(self->core->session, options.data(),
                                            options.count());
       response = success_response(fl_value_new_int(ret));
     }
   } else if (strcmp(method, "getGlobalStat") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
-      aria2_global_stat_t stat = aria2_get_global_stat(self->session);
+      aria2_global_stat_t stat = aria2_get_global_stat(self->core->session);
       FlValue* map = fl_value_new_map();
       fl_value_set_string(map, "downloadSpeed",
                           fl_value_new_int(stat.download_speed));
@@ -566,12 +536,12 @@ static void flutter_aria2_plugin_handle_method_call(
       response = success_response(map);
     }
   } else if (strcmp(method, "getDownloadInfo") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
       std::string gid_hex = map_get_string(args, "gid");
       aria2_gid_t gid = aria2_hex_to_gid(gid_hex.c_str());
-      aria2_download_handle_t* handle = aria2_get_download_handle(self->session, gid);
+      aria2_download_handle_t* handle = aria2_get_download_handle(self->core->session, gid);
       if (handle == nullptr) {
         g_autofree gchar* message = g_strdup_printf(
             "aria2_get_download_handle returned null for gid %s", gid_hex.c_str());
@@ -597,6 +567,14 @@ static void flutter_aria2_plugin_handle_method_call(
         fl_value_set_string(
             map, "uploadSpeed",
             fl_value_new_int(aria2_download_handle_get_upload_speed(handle)));
+        const flutter_aria2::core::SpeedEstimate estimate =
+            self->core->speeds.Estimate(
+                gid, aria2_download_handle_get_total_length(handle),
+                aria2_download_handle_get_completed_length(handle),
+                aria2_download_handle_get_download_speed(handle));
+        fl_value_set_string(map, "avgSpeed",
+                            fl_value_new_int(estimate.avg_speed));
+        fl_value_set_string(map, "eta", fl_value_new_int(estimate.eta_seconds));
 
         aria2_binary_t info_hash = aria2_download_handle_get_info_hash(handle);
         if (info_hash.data != nullptr && info_hash.length > 0) {
@@ -670,12 +648,12 @@ static void flutter_aria2_plugin_handle_method_call(
       }
     }
   } else if (strcmp(method, "getDownloadFiles") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
       std::string gid_hex = map_get_string(args, "gid");
       aria2_gid_t gid = aria2_hex_to_gid(gid_hex.c_str());
-      aria2_download_handle_t* handle = aria2_get_download_handle(self->session, gid);
+      aria2_download_handle_t* handle = aria2_get_download_handle(self->core->session, gid);
       if (handle == nullptr) {
         g_autofree gchar* message = g_strdup_printf(
             "aria2_get_download_handle returned null for gid %s", gid_hex.c_str());
@@ -696,13 +674,13 @@ static void flutter_aria2_plugin_handle_method_call(
       }
     }
   } else if (strcmp(method, "getDownloadOption") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
       std::string gid_hex = map_get_string(args, "gid");
       std::string name = map_get_string(args, "name");
       aria2_gid_t gid = aria2_hex_to_gid(gid_hex.c_str());
-      aria2_download_handle_t* handle = aria2_get_download_handle(self->session, gid);
+      aria2_download_handle_t* handle = aria2_get_download_handle(self->core->session, gid);
       if (handle == nullptr) {
         g_autofree gchar* message = g_strdup_printf(
             "aria2_get_download_handle returned null for gid %s", gid_hex.c_str());
@@ -719,12 +697,12 @@ static void flutter_aria2_plugin_handle_method_call(
       }
     }
   } else if (strcmp(method, "getDownloadOptions") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
       std::string gid_hex = map_get_string(args, "gid");
       aria2_gid_t gid = aria2_hex_to_gid(gid_hex.c_str());
-      aria2_download_handle_t* handle = aria2_get_download_handle(self->session, gid);
+      aria2_download_handle_t* handle = aria2_get_download_handle(self->core->session, gid);
       if (handle == nullptr) {
         g_autofree gchar* message = g_strdup_printf(
             "aria2_get_download_handle returned null for gid %s", gid_hex.c_str());
@@ -749,12 +727,12 @@ static void flutter_aria2_plugin_handle_method_call(
       }
     }
   } else if (strcmp(method, "getDownloadBtMetaInfo") == 0) {
-    if (const char* err = require_session(self)) {
+    if (const char* err = flutter_aria2::core::RequireSession(self->core)) {
       response = error_response(err, "No active session");
     } else {
       std::string gid_hex = map_get_string(args, "gid");
       aria2_gid_t gid = aria2_hex_to_gid(gid_hex.c_str());
-      aria2_download_handle_t* handle = aria2_get_download_handle(self->session, gid);
+      aria2_download_handle_t* handle = aria2_get_download_handle(self->core->session, gid);
       if (handle == nullptr) {
         g_autofree gchar* message = g_strdup_printf(
             "aria2_get_download_handle returned null for gid %s", gid_hex.c_str());
@@ -792,10 +770,69 @@ static void flutter_aria2_plugin_handle_method_call(
       }
     }
   } else {
-    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+    // Everything else is implemented once in common/ on top of Value.
+    Value result;
+    std::string message;
+    const char* error = flutter_aria2::core::InvokeMethod(
+        self->core, method, fl_value_to_value(args), &result, &message);
+    if (error == nullptr) {
+      response = success_response(value_to_fl_value(result));
+    } else if (strcmp(error, flutter_aria2::core::kNotImplemented) == 0) {
+      response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+    } else {
+      response = error_response(error, message.c_str());
+    }
   }
+  return response;
+}
+
+namespace {
 
-  fl_method_call_respond(method_call, response, nullptr);
+// A call travelling main thread -> worker -> main thread. Holds references
+// to the plugin and the call until the response is sent.
+struct PendingCall {
+  FlutterAria2Plugin* plugin;
+  FlMethodCall* method_call;
+  std::string method;
+  FlMethodResponse* response = nullptr;
+  int64_t main_us = 0;
+  int64_t worker_us = 0;
+};
+
+gboolean respond_on_main(gpointer user_data) {
+  std::unique_ptr<PendingCall> call(static_cast<PendingCall*>(user_data));
+  const auto start = std::chrono::steady_clock::now();
+  fl_method_call_respond(call->method_call, call->response, nullptr);
+  call->plugin->core->timings.Record(call->method,
+                                     call->main_us + elapsed_us(start),
+                                     call->worker_us);
+  g_clear_object(&call->response);
+  g_object_unref(call->method_call);
+  g_object_unref(call->plugin);
+  return G_SOURCE_REMOVE;
+}
+
+}  // namespace
+
+// Called when a method call is received from Flutter. Only hands the call
+// to the worker; the response is sent from the main thread once it ran.
+static void flutter_aria2_plugin_handle_method_call(
+    FlutterAria2Plugin* self,
+    FlMethodCall* method_call) {
+  const auto start = std::chrono::steady_clock::now();
+  auto* call = new PendingCall{
+      FLUTTER_ARIA2_PLUGIN(g_object_ref(self)),
+      FL_METHOD_CALL(g_object_ref(method_call)),
+      fl_method_call_get_name(method_call),
+  };
+  call->main_us = elapsed_us(start);
+  self->worker->Post([call]() {
+    const auto begin = std::chrono::steady_clock::now();
+    call->response =
+        flutter_aria2_plugin_run_method_call(call->plugin, call->method_call);
+    call->worker_us = elapsed_us(begin);
+    g_main_context_invoke(nullptr, respond_on_main, call);
+  });
 }
 
 FlMethodResponse* get_platform_version() {
@@ -808,9 +845,16 @@ FlMethodResponse* get_platform_version() {
 
 static void flutter_aria2_plugin_dispose(GObject* object) {
   auto* self = FLUTTER_ARIA2_PLUGIN(object);
-  auto core = take_core_state(self);
-  flutter_aria2::core::CleanupState(&core);
-  put_core_state(self, std::move(core));
+  // Pending calls hold a reference, so the worker is idle by now.
+  if (self->worker != nullptr) {
+    delete self->worker;
+    self->worker = nullptr;
+  }
+  if (self->core != nullptr) {
+    flutter_aria2::core::CleanupState(self->core);
+    delete self->core;
+    self->core = nullptr;
+  }
   if (self->channel != nullptr) {
     g_object_unref(self->channel);
     self->channel = nullptr;
@@ -823,10 +867,10 @@ static void flutter_aria2_plugin_class_init(FlutterAria2PluginClass* klass) {
 }
 
 static void flutter_aria2_plugin_init(FlutterAria2Plugin* self) {
-  self->session = nullptr;
-  self->library_initialized = FALSE;
-  self->run_loop_active.store(false);
-  self->run_in_progress.store(false);
+  self->core = new flutter_aria2::core::RuntimeState();
+  self->core->event_sink = &native_event_sink;
+  self->core->event_sink_user_data = self;
+  self->worker = new MethodWorker();
   self->channel = nullptr;
 }
 
@@ -2,8 +2,36 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <random>
+#include <thread>
+
 #include "include/flutter_aria2/flutter_aria2_plugin.h"
 #include "flutter_aria2_plugin_private.h"
+#include "../common/aria2_bitfield.h"
+#include "../common/aria2_checksum.h"
+#include "../common/aria2_concurrency.h"
+#include "../common/aria2_helpers.h"
+#include "../common/aria2_hoststats.h"
+#include "../common/aria2_journal.h"
+#include "../common/aria2_loopback.h"
+#include "../common/aria2_mapped_file.h"
+#include "../common/aria2_net.h"
+#include "../common/aria2_probe.h"
+#include "../common/aria2_registry.h"
+#include "../common/aria2_resume.h"
+#include "../common/aria2_retry.h"
+#include "../common/aria2_sha.h"
+#include "../common/aria2_timing.h"
+#include "../common/aria2_torrent.h"
+#include "../common/aria2_virtual_queue.h"
 
 // This demonstrates a simple unit test of the C portion of this plugin's
 // implementation.
@@ -27,5 +55,871 @@ TEST(FlutterAria2Plugin, GetPlatformVersion) {
   EXPECT_THAT(fl_value_get_string(result), testing::StartsWith("Linux "));
 }
 
+TEST(ConcurrencyController, ClimbsWhileThroughputGrowsAndBacksOffOnLoss) {
+  core::ConcurrencyController controller;
+  core::ConcurrencyConfig config;
+  config.max = {4, 4, 4};
+  controller.Configure(config, {1, 1, 1});
+
+  core::ConcurrencySample sample;
+  sample.num_active = 1;
+  sample.throughput = 1000;
+  core::ConcurrencyDecision decision = controller.Step(sample);
+  EXPECT_TRUE(decision.changed);
+  EXPECT_EQ(decision.knob, core::ConcurrencyKnob::kSplit);
+  EXPECT_EQ(decision.to, 2);
+
+  sample.throughput = 1500;
+  decision = controller.Step(sample);
+  EXPECT_STREQ(decision.reason, "gain");
+  EXPECT_EQ(controller.knobs().split, 3);
+
+  sample.throughput = 600;
+  decision = controller.Step(sample);
+  EXPECT_STREQ(decision.reason, "loss");
+  EXPECT_EQ(decision.from, 3);
+  EXPECT_EQ(decision.to, 1);
+
+  // Nothing is waiting, so the concurrent-downloads knob is skipped.
+  sample.throughput = 620;
+  decision = controller.Step(sample);
+  EXPECT_EQ(decision.knob, core::ConcurrencyKnob::kMaxConnectionPerServer);
+  EXPECT_EQ(decision.to, 2);
+}
+
+TEST(LoopbackHttpServer, ServesRangesAtTheRateLimit) {
+  common::LoopbackHttpServer server("range_", 100000, 1);
+  server.set_rate_limit(64 * 1024);
+  ASSERT_TRUE(server.Start());
+  const common::SocketHandle sock =
+      common::TcpConnect("127.0.0.1", server.port(), 5000);
+  ASSERT_NE(sock, common::kInvalidSocket);
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(common::SendAll(sock, "GET /" + server.FileName(0) +
+                                        " HTTP/1.1\r\n"
+                                        "Range: bytes=1000-33767\r\n\r\n"));
+  const std::string response = common::RecvUpTo(sock, 1 << 20);
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  common::CloseSocket(sock);
+  server.Stop();
+
+  EXPECT_EQ(response.compare(0, 24, "HTTP/1.1 206 Partial Con"), 0);
+  EXPECT_NE(response.find("Content-Range: bytes 1000-33767/100000\r\n"),
+            std::string::npos);
+  const size_t body = response.find("\r\n\r\n") + 4;
+  ASSERT_EQ(response.size() - body, 32768u);
+  for (size_t i = 0; i < 32768; ++i) {
+    ASSERT_EQ(response[body + i],
+              common::LoopbackHttpServer::ContentAt(1000 + i))
+        << i;
+  }
+  // Half a second of data at 64 KiB/s; the first chunk goes out at once.
+  EXPECT_GE(elapsed, std::chrono::milliseconds(400));
+}
+
+TEST(ConcurrencyController, AddsDownloadsWhileAThrottledServerRewardsThem) {
+  std::string dir = testing::TempDir() + "/concurrency_XXXXXX";
+  ASSERT_NE(::mkdtemp(&dir[0]), nullptr);
+  // Every connection is capped, so each extra download adds throughput
+  // until the bound. The files outlast the test at that rate.
+  constexpr int kFiles = 6;
+  common::LoopbackHttpServer server("throttled_", 8 * 1024 * 1024, kFiles);
+  server.set_rate_limit(256 * 1024);
+  ASSERT_TRUE(server.Start());
+
+  ASSERT_EQ(aria2_library_init(), 0);
+  common::KeyVals options;
+  options.Add("dir", dir);
+  options.Add("split", "1");
+  options.Add("max-connection-per-server", "1");
+  options.Add("max-concurrent-downloads", "1");
+  options.Add("file-allocation", "none");
+  aria2_session_config_t session_config;
+  aria2_session_config_init(&session_config);
+  session_config.keep_running = 1;
+  aria2_session_t* session =
+      aria2_session_new(options.data(), options.count(), &session_config);
+  ASSERT_NE(session, nullptr);
+  for (int i = 0; i < kFiles; ++i) {
+    const std::string uri = server.Url(i);
+    const char* uri_ptr = uri.c_str();
+    aria2_gid_t gid = 0;
+    ASSERT_EQ(aria2_add_uri(session, &gid, &uri_ptr, 1, nullptr, 0, -1), 0);
+  }
+
+  // Only max-concurrent-downloads has room to move.
+  core::ConcurrencyConfig config;
+  config.min = {1, 1, 1};
+  config.max = {1, 1, 4};
+  config.sample_interval_ms = 2000;
+  core::ConcurrencyController controller;
+  controller.Enable(session, config);
+  core::MetricsLog metrics;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  while (controller.knobs().max_concurrent_downloads < 4 &&
+         std::chrono::steady_clock::now() < deadline) {
+    aria2_run(session, ARIA2_RUN_ONCE);
+    controller.OnTick(session, &metrics);
+  }
+  EXPECT_EQ(controller.knobs().max_concurrent_downloads, 4);
+  EXPECT_EQ(common::GetGlobalOptionInt(session, "max-concurrent-downloads", 0),
+            4);
+  int gains = 0;
+  for (const common::Value& event : metrics.Snapshot(false).AsList()) {
+    const common::Value& data = event.Get("data");
+    EXPECT_EQ(event.Get("component").AsString(), "concurrency");
+    EXPECT_EQ(data.Get("knob").AsString(), "maxConcurrentDownloads");
+    if (data.Get("reason").AsString() == "gain") {
+      ++gains;
+    }
+  }
+  EXPECT_GE(gains, 1);
+
+  aria2_shutdown(session, 1);
+  while (aria2_run(session, ARIA2_RUN_ONCE) == 1) {
+  }
+  aria2_session_final(session);
+  aria2_library_deinit();
+  server.Stop();
+  for (int i = 0; i < kFiles; ++i) {
+    const std::string path = dir + "/" + server.FileName(i);
+    std::remove(path.c_str());
+    std::remove((path + ".aria2").c_str());
+  }
+}
+
+TEST(RetryEngine, BacksOffExponentiallyAndBreaksPerHost) {
+  core::RetryPolicy policy;
+  policy.base_delay_ms = 1000;
+  policy.max_delay_ms = 5000;
+  policy.jitter = 0.5;
+  EXPECT_EQ(core::BackoffDelayMs(policy, 1, 0.5), 1000);
+  EXPECT_EQ(core::BackoffDelayMs(policy, 3, 0.5), 4000);
+  EXPECT_EQ(core::BackoffDelayMs(policy, 10, 0.5), 5000);
+  EXPECT_EQ(core::BackoffDelayMs(policy, 1, 0.0), 500);
+
+  EXPECT_TRUE(core::IsTransientErrorCode(6));
+  EXPECT_FALSE(core::IsTransientErrorCode(3));
+
+  core::CircuitBreaker breaker;
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(breaker.OnFailure(start, 2, 1000));
+  EXPECT_TRUE(breaker.OnFailure(start, 2, 1000));
+  EXPECT_FALSE(breaker.Admit(start, 1000));
+
+  // One trial after the cooldown; its failure reopens the breaker.
+  const auto later = start + std::chrono::milliseconds(1000);
+  EXPECT_TRUE(breaker.Admit(later, 1000));
+  EXPECT_EQ(breaker.state(), core::CircuitBreaker::State::kHalfOpen);
+  EXPECT_TRUE(breaker.OnFailure(later, 2, 1000));
+  EXPECT_FALSE(breaker.Admit(later, 1000));
+  breaker.OnSuccess();
+  EXPECT_TRUE(breaker.Admit(later, 1000));
+}
+
+TEST(HostStatsTable, RanksMirrorsByMeasuredQuality) {
+  core::HostStatsTable table;
+  const std::vector<std::string> uris = {
+      "http://slow.example/f", "https://new.example/f",
+      "http://FAST.example:8080/f"};
+  // Nothing measured yet: the caller's order stands.
+  EXPECT_EQ(table.RankUris(uris), uris);
+
+  table.RecordSample("fast.example", 1 << 20, 4e6);
+  table.RecordSample("slow.example", 1 << 10, 1e5);
+  // The unmeasured host is ranked at the mean, between the two.
+  EXPECT_EQ(table.RankUris(uris),
+            (std::vector<std::string>{"http://FAST.example:8080/f",
+                                      "https://new.example/f",
+                                      "http://slow.example/f"}));
+
+  // High latency discounts an otherwise fast host.
+  table.RecordLatency("fast.example", 60000);
+  EXPECT_EQ(table.RankUris(uris).back(), "http://FAST.example:8080/f");
+}
+
+TEST(VirtualQueue, PersistsEntriesAcrossReopen) {
+  const std::string dir = testing::TempDir();
+  std::remove((dir + "/virtual_queue.idx").c_str());
+  std::remove((dir + "/virtual_queue.heap").c_str());
+  std::string error;
+  {
+    core::VirtualQueue queue;
+    ASSERT_TRUE(queue.Open(dir, 2, &error)) << error;
+    std::vector<std::vector<std::string>> entries;
+    for (int i = 0; i < 1000; ++i) {
+      entries.push_back({"http://a.example/" + std::to_string(i),
+                         "http://b.example/" + std::to_string(i)});
+    }
+    EXPECT_EQ(queue.Append(entries, {{"split", "2"}}, &error), 0);
+    EXPECT_EQ(queue.Append({{"http://c.example/x"}}, {}, &error), 1000);
+  }
+
+  core::VirtualQueue queue;
+  ASSERT_TRUE(queue.Open(dir, 2, &error)) << error;
+  EXPECT_EQ(queue.Describe().Get("total").AsInt(), 1001);
+  EXPECT_EQ(queue.Describe().Get("pending").AsInt(), 1001);
+  common::Value entry;
+  ASSERT_TRUE(queue.Describe(999, &entry));
+  EXPECT_EQ(entry.Get("uris").AsStringList(),
+            (std::vector<std::string>{"http://a.example/999",
+                                      "http://b.example/999"}));
+  EXPECT_FALSE(queue.Describe(1001, &entry));
+  queue.Close();
+}
+
+TEST(ResumeCache, EncodesVersionOneControlFile) {
+  core::ResumeEntry entry;
+  entry.info_hash = "0123456789abcdefghij";
+  entry.piece_length = 256 * 1024;
+  entry.total_length = 0x123456789LL;
+  entry.upload_length = 5;
+  entry.bitfield = std::string("\xff\x80", 2);
+
+  // Version, extension, info hash, piece length, total length, upload
+  // length, bitfield and the (empty) in-flight piece count, big-endian.
+  const std::string expected(
+      "\x00\x01"
+      "\x00\x00\x00\x01"
+      "\x00\x00\x00\x14"
+      "0123456789abcdefghij"
+      "\x00\x04\x00\x00"
+      "\x00\x00\x00\x01\x23\x45\x67\x89"
+      "\x00\x00\x00\x00\x00\x00\x00\x05"
+      "\x00\x00\x00\x02"
+      "\xff\x80"
+      "\x00\x00\x00\x00",
+      60);
+  EXPECT_EQ(core::EncodeControlFile(entry), expected);
+
+  // Without an info hash the extension bit is clear.
+  entry.info_hash.clear();
+  const std::string plain = core::EncodeControlFile(entry);
+  ASSERT_EQ(plain.size(), 40u);
+  EXPECT_EQ(plain.substr(0, 10), std::string("\x00\x01\x00\x00\x00\x00"
+                                             "\x00\x00\x00\x00",
+                                             10));
+}
+
+TEST(ResumeCache, DecodesWhatItEncodes) {
+  core::ResumeEntry entry;
+  entry.key = "uri\nhttp://example.com/a\n/downloads\n";
+  entry.control_path = "/downloads/a.aria2";
+  entry.control_size = 77;
+  entry.control_mtime_ns = 1700000000123456789LL;
+  entry.piece_length = 1024 * 1024;
+  entry.total_length = 5000000;
+  entry.bitfield = std::string("\x0f\x00\xf0", 3);
+  entry.files.push_back({"/downloads/a", 5000000, 1700000000000000001LL});
+
+  const std::string encoded = core::EncodeResumeEntry(entry);
+  core::ResumeEntry decoded;
+  ASSERT_TRUE(core::DecodeResumeEntry(encoded, &decoded));
+  EXPECT_EQ(decoded.key, entry.key);
+  EXPECT_EQ(decoded.control_path, entry.control_path);
+  EXPECT_EQ(decoded.control_size, 77);
+  EXPECT_EQ(decoded.control_mtime_ns, entry.control_mtime_ns);
+  EXPECT_EQ(decoded.piece_length, entry.piece_length);
+  EXPECT_EQ(decoded.total_length, entry.total_length);
+  EXPECT_EQ(decoded.bitfield, entry.bitfield);
+  ASSERT_EQ(decoded.files.size(), 1u);
+  EXPECT_EQ(decoded.files[0].path, "/downloads/a");
+  EXPECT_EQ(decoded.files[0].mtime_ns, 1700000000000000001LL);
+
+  EXPECT_FALSE(core::DecodeResumeEntry(encoded.substr(0, encoded.size() - 1),
+                                       &decoded));
+  EXPECT_FALSE(core::DecodeResumeEntry(encoded + "x", &decoded));
+  EXPECT_FALSE(core::DecodeResumeEntry("A2FRES01" + encoded.substr(8),
+                                       &decoded));
+}
+
+TEST(ResumeCache, ResumesUnchangedFilesAndVerifiesChangedOnes) {
+  const std::string dir = testing::TempDir();
+  const std::string data = dir + "/resume_data.bin";
+  const std::string control = data + ".aria2";
+  std::string error;
+  std::remove(control.c_str());
+  ASSERT_TRUE(common::WriteFileAtomic(data, std::string(4096, 'a'), &error))
+      << error;
+
+  core::ResumeCache cache;
+  ASSERT_TRUE(cache.Open(dir, &error)) << error;
+  const std::string key =
+      core::ResumeCache::UriKey("http://example.com/resume_data.bin", dir, "");
+  std::remove(cache.EntryPath(key).c_str());
+
+  common::KeyVals options;
+  EXPECT_EQ(cache.Prepare(key, "", &options), core::ResumeOutcome::kNone);
+  EXPECT_EQ(options.Find("check-integrity"), nullptr);
+
+  core::ResumeEntry entry;
+  entry.key = key;
+  entry.control_path = control;
+  entry.piece_length = 1024;
+  entry.total_length = 8192;
+  entry.bitfield = std::string("\xf0", 1);
+  core::ResumeFile file;
+  file.path = data;
+  ASSERT_TRUE(common::StatFile(data, &file.size, &file.mtime_ns));
+  entry.files.push_back(file);
+  ASSERT_TRUE(common::WriteFileAtomic(cache.EntryPath(key),
+                                      core::EncodeResumeEntry(entry), &error))
+      << error;
+
+  // Unchanged files: the missing control file is rebuilt from the entry.
+  EXPECT_EQ(cache.Prepare(key, "", &options), core::ResumeOutcome::kHit);
+  ASSERT_NE(options.Find("check-integrity"), nullptr);
+  EXPECT_EQ(*options.Find("check-integrity"), "false");
+  std::string contents;
+  ASSERT_TRUE(common::ReadWholeFile(control, &contents));
+  EXPECT_EQ(contents, core::EncodeControlFile(entry));
+  // The entry survives until the download is tracked.
+  EXPECT_TRUE(common::FileExists(cache.EntryPath(key)));
+
+  // A file that changed since the snapshot forces verification.
+  ASSERT_TRUE(common::WriteFileAtomic(data, std::string(4097, 'a'), &error))
+      << error;
+  EXPECT_EQ(cache.Prepare(key, "", &options), core::ResumeOutcome::kStale);
+  EXPECT_EQ(*options.Find("check-integrity"), "true");
+
+  cache.Track(1, key, "");
+  EXPECT_FALSE(common::FileExists(cache.EntryPath(key)));
+  const core::ResumeCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.stale, 1);
+  cache.Reset();
+  cache.Close();
+}
+
+TEST(PieceBitfields, VectorKernelMatchesPortablePath) {
+  std::mt19937 rng(20240611);
+  std::vector<uint8_t> buffer(1 + 1024);
+  // Sizes around the 16- and 32-byte blocks leave tails of every length;
+  // starting one byte in keeps the loads unaligned.
+  for (size_t size = 0; size <= 1024; size += (size < 130 ? 1 : 37)) {
+    for (int density = 0; density < 4; ++density) {
+      for (size_t i = 0; i < buffer.size(); ++i) {
+        const uint32_t r = rng();
+        // Dense, sparse, random and long runs.
+        buffer[i] = density == 0   ? static_cast<uint8_t>(r | (r >> 8))
+                    : density == 1 ? static_cast<uint8_t>(r & (r >> 8))
+                    : density == 2 ? static_cast<uint8_t>(r)
+                                   : ((r & 7) < 4 ? 0xff : 0x00);
+      }
+      const uint8_t* data = buffer.data() + 1;
+      int64_t completed = 0;
+      int64_t runs = 0;
+      bool prev = false;
+      for (size_t bit = 0; bit < size * 8; ++bit) {
+        const bool set = (data[bit / 8] & (0x80 >> (bit % 8))) != 0;
+        completed += set ? 1 : 0;
+        runs += set && !prev ? 1 : 0;
+        prev = set;
+      }
+      const core::BitfieldSummary fast = core::SummarizeBitfield(data, size);
+      const core::BitfieldSummary portable =
+          core::SummarizeBitfieldPortable(data, size);
+      EXPECT_EQ(portable.completed, completed) << "size " << size;
+      EXPECT_EQ(portable.runs, runs) << "size " << size;
+      EXPECT_EQ(fast.completed, completed)
+          << core::BitfieldKernel() << " size " << size;
+      EXPECT_EQ(fast.runs, runs) << core::BitfieldKernel() << " size " << size;
+    }
+  }
+}
+
+std::string Sha256Hex(const std::string& data) {
+  common::Sha256 hash;
+  hash.Update(data.data(), data.size());
+  return hash.HexDigest();
+}
+
+TEST(Sha256, MatchesFips180VectorsOnEveryKernel) {
+  std::mt19937 rng(180);
+  std::string random(4099, '\0');
+  for (char& c : random) {
+    c = static_cast<char>(rng());
+  }
+  std::string reference;
+  for (bool portable : {false, true}) {
+    common::ForcePortableShaKernels(portable);
+    SCOPED_TRACE(common::Sha256::Kernel());
+    EXPECT_EQ(Sha256Hex(""),
+              "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(Sha256Hex("abc"),
+              "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT_EQ(
+        Sha256Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    EXPECT_EQ(Sha256Hex(std::string(1000000, 'a')),
+              "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+    // Hashing a growing prefix piece by piece, as the checksum workers do,
+    // gives the digest of the whole.
+    const std::string whole = Sha256Hex(random);
+    common::Sha256 hash;
+    size_t offset = 0;
+    for (size_t step = 1; offset < random.size(); step = step * 3 % 257 + 1) {
+      const size_t take = std::min(step, random.size() - offset);
+      hash.Update(random.data() + offset, take);
+      offset += take;
+    }
+    EXPECT_EQ(hash.HexDigest(), whole);
+    if (reference.empty()) {
+      reference = whole;
+    } else {
+      EXPECT_EQ(whole, reference);
+    }
+  }
+  common::ForcePortableShaKernels(false);
+}
+
+struct ChecksumSession {
+  core::ChecksumVerifier* verifier = nullptr;
+  int completions = 0;
+};
+
+int HandleChecksumEvent(aria2_session_t* session, aria2_download_event_t event,
+                        aria2_gid_t gid, void* user_data) {
+  auto* state = static_cast<ChecksumSession*>(user_data);
+  if (event == ARIA2_EVENT_ON_DOWNLOAD_COMPLETE) {
+    ++state->completions;
+  }
+  state->verifier->OnDownloadEvent(session, event, gid);
+  return 0;
+}
+
+TEST(ChecksumVerifier, HashesPrefixesAndReportsMismatches) {
+  std::string dir = testing::TempDir() + "/checksum_XXXXXX";
+  ASSERT_NE(::mkdtemp(&dir[0]), nullptr);
+  // Throttled so that pieces finish well before the downloads do.
+  constexpr int64_t kSize = 4 * 1024 * 1024;
+  common::LoopbackHttpServer server("verified_", kSize, 2);
+  server.set_rate_limit(1024 * 1024);
+  ASSERT_TRUE(server.Start());
+  std::string content(static_cast<size_t>(kSize), '\0');
+  for (size_t i = 0; i < content.size(); ++i) {
+    content[i] = common::LoopbackHttpServer::ContentAt(i);
+  }
+  const std::string digest = Sha256Hex(content);
+
+  core::ChecksumVerifier verifier;
+  ChecksumSession state;
+  state.verifier = &verifier;
+  ASSERT_EQ(aria2_library_init(), 0);
+  common::KeyVals options;
+  options.Add("dir", dir);
+  options.Add("split", "1");
+  options.Add("piece-length", "1M");
+  aria2_session_config_t session_config;
+  aria2_session_config_init(&session_config);
+  session_config.keep_running = 1;
+  session_config.download_event_callback = &HandleChecksumEvent;
+  session_config.user_data = &state;
+  aria2_session_t* session =
+      aria2_session_new(options.data(), options.count(), &session_config);
+  ASSERT_NE(session, nullptr);
+  std::vector<aria2_gid_t> gids;
+  for (int i = 0; i < 2; ++i) {
+    const std::string uri = server.Url(i);
+    const char* uri_ptr = uri.c_str();
+    aria2_gid_t gid = 0;
+    ASSERT_EQ(aria2_add_uri(session, &gid, &uri_ptr, 1, nullptr, 0, -1), 0);
+    gids.push_back(gid);
+  }
+  verifier.Watch(gids[0], {{1, digest}});
+  verifier.Watch(gids[1], {{1, std::string(64, '0')}});
+
+  std::vector<core::ChecksumResult> results;
+  int64_t hashed_before_completion = 0;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  while (results.size() < 2 && std::chrono::steady_clock::now() < deadline) {
+    aria2_run(session, ARIA2_RUN_ONCE);
+    verifier.OnTick(session);
+    if (state.completions == 0) {
+      hashed_before_completion =
+          verifier.Describe().Get("bytesHashed").AsInt();
+    }
+    for (core::ChecksumResult& result : verifier.TakeResults()) {
+      results.push_back(std::move(result));
+    }
+  }
+  EXPECT_GT(hashed_before_completion, 0);
+  ASSERT_EQ(results.size(), 2u);
+  std::sort(results.begin(), results.end(),
+            [&](const core::ChecksumResult& a, const core::ChecksumResult& b) {
+              return a.gid == gids[0] && b.gid != gids[0];
+            });
+  EXPECT_EQ(results[0].gid, gids[0]);
+  EXPECT_FALSE(results[0].mismatch);
+  ASSERT_EQ(results[0].files.size(), 1u);
+  EXPECT_EQ(results[0].files[0].sha256, digest);
+  EXPECT_EQ(results[1].gid, gids[1]);
+  EXPECT_TRUE(results[1].mismatch);
+  ASSERT_EQ(results[1].files.size(), 1u);
+  EXPECT_EQ(results[1].files[0].sha256, digest);
+  EXPECT_EQ(results[1].files[0].expected, std::string(64, '0'));
+  EXPECT_EQ(verifier.Describe().Get("verified").AsInt(), 1);
+  EXPECT_EQ(verifier.Describe().Get("mismatches").AsInt(), 1);
+
+  aria2_shutdown(session, 1);
+  while (aria2_run(session, ARIA2_RUN_ONCE) == 1) {
+  }
+  aria2_session_final(session);
+  aria2_library_deinit();
+  verifier.Reset();
+  server.Stop();
+  for (int i = 0; i < 2; ++i) {
+    std::remove((dir + "/" + server.FileName(i)).c_str());
+  }
+}
+
+std::string Sha1Hex(const std::string& data) {
+  uint8_t digest[common::Sha1::kDigestSize];
+  common::Sha1 hash;
+  hash.Update(data.data(), data.size());
+  hash.Digest(digest);
+  std::string out;
+  for (uint8_t byte : digest) {
+    out += "0123456789abcdef"[byte >> 4];
+    out += "0123456789abcdef"[byte & 0xf];
+  }
+  return out;
+}
+
+// Bytes that do not repeat within a piece, so equal pieces stand out.
+std::string TorrentTestData(size_t size, uint32_t seed) {
+  std::string out(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    out[i] = static_cast<char>(
+        ((static_cast<uint32_t>(i) + seed) * 2654435761u) >> 13);
+  }
+  return out;
+}
+
+common::Value CreateTorrent(core::TorrentConfig config) {
+  std::promise<common::Value> done;
+  core::TorrentCreator creator;
+  EXPECT_TRUE(creator.Start(std::move(config), [&](common::Value result) {
+    done.set_value(std::move(result));
+  }));
+  return done.get_future().get();
+}
+
+TEST(TorrentCreator, HashesSha1KnownAnswersOnEveryKernel) {
+  for (bool portable : {false, true}) {
+    common::ForcePortableShaKernels(portable);
+    SCOPED_TRACE(common::Sha1::Kernel());
+    EXPECT_EQ(Sha1Hex(""), "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+    EXPECT_EQ(Sha1Hex("abc"), "a9993e364706816aba3e25717850c26c9cd0d89d");
+    EXPECT_EQ(
+        Sha1Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+        "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+    EXPECT_EQ(Sha1Hex(std::string(1000000, 'a')),
+              "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+  }
+  common::ForcePortableShaKernels(false);
+}
+
+TEST(TorrentCreator, PicksPieceLengthForAboutTwoThousandPieces) {
+  EXPECT_EQ(core::PickPieceLength(0), 256 * 1024);
+  EXPECT_EQ(core::PickPieceLength(2000LL * 256 * 1024), 256 * 1024);
+  EXPECT_EQ(core::PickPieceLength(2001LL * 256 * 1024), 512 * 1024);
+  EXPECT_EQ(core::PickPieceLength(1LL << 30), 1024 * 1024);
+  EXPECT_EQ(core::PickPieceLength(100LL << 30), 16 * 1024 * 1024);
+}
+
+TEST(TorrentCreator, WritesTheReferenceTorrent) {
+  const std::string dir = testing::TempDir();
+  std::string error;
+  ASSERT_TRUE(common::WriteFileAtomic(dir + "/ref.bin",
+                                      TorrentTestData(40000, 0), &error))
+      << error;
+
+  core::TorrentConfig config;
+  config.paths = {dir + "/ref.bin"};
+  config.output = dir + "/ref.torrent";
+  config.piece_length = 16 * 1024;
+  config.trackers = {"http://t1.example/announce",
+                     "http://t2.example/announce"};
+  config.webseeds = {"http://w.example/ref.bin"};
+  config.comment = "ref";
+  config.private_torrent = true;
+  config.threads = 2;
+  const common::Value result = CreateTorrent(config);
+  ASSERT_TRUE(result.Get("ok").AsBool()) << result.Get("error").AsString();
+  EXPECT_EQ(result.Get("pieces").AsInt(), 3);
+  EXPECT_EQ(result.Get("infoHash").AsString(),
+            "953175fc3e984172c3b6d0eec388629a2cb47d6c");
+
+  // Written by an independent bencoder, with the creation date at 0.
+  std::string pieces;
+  const std::string pieces_hex =
+      "3deec79fe09e5fb7f6123556543851ff8da267d6"
+      "0ea93cff370abb611f7852de333fa6a6aced9400"
+      "80bb8d5f3e0daa496451b4518ad5c7ab77dfa2e7";
+  for (size_t i = 0; i < pieces_hex.size(); i += 2) {
+    pieces.push_back(
+        static_cast<char>(std::stoi(pieces_hex.substr(i, 2), nullptr, 16)));
+  }
+  const std::string expected =
+      "d8:announce26:http://t1.example/announce"
+      "13:announce-listll26:http://t1.example/announceel26:http://"
+      "t2.example/announceee"
+      "7:comment3:ref10:created by13:flutter_aria213:creation datei0e"
+      "4:infod6:lengthi40000e4:name7:ref.bin12:piece lengthi16384e"
+      "6:pieces60:" +
+      pieces +
+      "7:privatei1ee"
+      "8:url-listl24:http://w.example/ref.binee";
+  std::string torrent;
+  ASSERT_TRUE(common::ReadWholeFile(config.output, &torrent));
+  const std::string date_key = "13:creation datei";
+  const size_t date = torrent.find(date_key);
+  ASSERT_NE(date, std::string::npos);
+  const size_t date_end = torrent.find('e', date + date_key.size());
+  torrent.replace(date + date_key.size(), date_end - date - date_key.size(),
+                  "0");
+  EXPECT_EQ(torrent, expected);
+
+  // A directory becomes a multi-file torrent whose pieces span the files.
+  const std::string tree = dir + "/reftree";
+  ::mkdir(tree.c_str(), 0755);
+  ::mkdir((tree + "/sub").c_str(), 0755);
+  ASSERT_TRUE(common::WriteFileAtomic(tree + "/a.txt",
+                                      TorrentTestData(20000, 1), &error));
+  ASSERT_TRUE(common::WriteFileAtomic(tree + "/sub/b.txt",
+                                      TorrentTestData(30000, 2), &error));
+  config = core::TorrentConfig();
+  config.paths = {tree};
+  config.output = dir + "/reftree.torrent";
+  config.piece_length = 16 * 1024;
+  config.threads = 3;
+  const common::Value multi = CreateTorrent(config);
+  ASSERT_TRUE(multi.Get("ok").AsBool()) << multi.Get("error").AsString();
+  EXPECT_EQ(multi.Get("files").AsInt(), 2);
+  EXPECT_EQ(multi.Get("infoHash").AsString(),
+            "144a401b2a8c65eec577a4c78c9cf24c7a4d88c6");
+}
+
+// Overwrites |size| bytes of |path| at the record whose URI is |uri|,
+// |delta| bytes from the start of that URI.
+void CorruptJournalRecord(const std::string& path, const std::string& uri,
+                          long delta, const char* bytes, size_t size) {
+  std::string contents;
+  ASSERT_TRUE(common::ReadWholeFile(path, &contents));
+  const size_t at = contents.find(uri);
+  ASSERT_NE(at, std::string::npos);
+  FILE* file = std::fopen(path.c_str(), "r+b");
+  ASSERT_NE(file, nullptr);
+  std::fseek(file, static_cast<long>(at) + delta, SEEK_SET);
+  std::fwrite(bytes, 1, size, file);
+  std::fclose(file);
+}
+
+std::string DownloadOption(aria2_session_t* session, aria2_gid_t gid,
+                           const char* name) {
+  aria2_download_handle_t* handle = aria2_get_download_handle(session, gid);
+  if (handle == nullptr) {
+    return "";
+  }
+  char* value = aria2_download_handle_get_option(handle, name);
+  std::string out = value == nullptr ? "" : value;
+  aria2_free(value);
+  aria2_delete_download_handle(handle);
+  return out;
+}
+
+TEST(SessionJournal, RestoresUpToACorruptTail) {
+  std::string dir = testing::TempDir() + "/journal_XXXXXX";
+  ASSERT_NE(::mkdtemp(&dir[0]), nullptr);
+  ASSERT_EQ(aria2_library_init(), 0);
+  aria2_session_config_t session_config;
+  aria2_session_config_init(&session_config);
+  session_config.keep_running = 1;
+  const aria2_key_val_t no_options[] = {{nullptr, nullptr}};
+  std::string error;
+  std::vector<aria2_gid_t> restored;
+
+  core::SessionJournal journal;
+  ASSERT_TRUE(journal.Open(nullptr, dir, false, &restored, &error)) << error;
+  EXPECT_EQ(journal.Describe().Get("generation").AsInt(), 2);
+  journal.OnAdded(1, {"http://a.example/1"}, {{"split", "2"}});
+  journal.OnAdded(2, {"http://b.example/2"}, {});
+  journal.OnAdded(3, {"http://c.example/3"}, {});
+  journal.OnOptionsChanged(1, {{"split", "4"}});
+  journal.OnDownloadEvent(nullptr, ARIA2_EVENT_ON_DOWNLOAD_PAUSE, 2);
+  journal.OnDownloadEvent(nullptr, ARIA2_EVENT_ON_DOWNLOAD_COMPLETE, 3);
+
+  // Finished downloads fill the log until the tick rotates it and the
+  // compactor writes a snapshot of the live ones for the new generation.
+  const std::string filler(2048, 'x');
+  for (aria2_gid_t gid = 1000;
+       journal.Describe().Get("generation").AsInt() == 2 && gid < 10000;
+       ++gid) {
+    journal.OnAdded(gid, {"http://churn.example/" + filler}, {});
+    journal.OnDownloadEvent(nullptr, ARIA2_EVENT_ON_DOWNLOAD_COMPLETE, gid);
+    journal.OnTick();
+  }
+  for (int i = 0; i < 5000 && journal.Describe().Get("compacting").AsBool();
+       ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(journal.Describe().Get("generation").AsInt(), 3);
+  EXPECT_EQ(journal.Describe().Get("snapshotGeneration").AsInt(), 3);
+  EXPECT_FALSE(common::FileExists(dir + "/journal-2.log"));
+
+  journal.OnAdded(4, {"http://d.example/4"}, {});
+  journal.OnDownloadEvent(nullptr, ARIA2_EVENT_ON_DOWNLOAD_PAUSE, 1);
+  journal.OnAdded(5, {"http://e.example/5"}, {});
+  journal.OnDownloadEvent(nullptr, ARIA2_EVENT_ON_DOWNLOAD_COMPLETE, 4);
+  journal.Close();
+  // A flipped byte fails the checksum of 5's record; replay stops there, so
+  // neither 5 nor the later finish of 4 is applied.
+  CorruptJournalRecord(dir + "/journal-3.log", "http://e.example/5", 0, "X",
+                       1);
+
+  aria2_session_t* session =
+      aria2_session_new(no_options, 0, &session_config);
+  ASSERT_NE(session, nullptr);
+  restored.clear();
+  ASSERT_TRUE(journal.Open(session, dir, true, &restored, &error)) << error;
+  EXPECT_EQ(restored, (std::vector<aria2_gid_t>{1, 2, 4}));
+  EXPECT_EQ(common::GetDownloadStatus(session, 1), common::kStatusPaused);
+  EXPECT_EQ(common::GetDownloadStatus(session, 2), common::kStatusPaused);
+  EXPECT_EQ(common::GetDownloadStatus(session, 4), common::kStatusWaiting);
+  EXPECT_EQ(DownloadOption(session, 1, "split"), "4");
+  EXPECT_EQ(journal.Describe().Get("snapshotGeneration").AsInt(), 4);
+  EXPECT_FALSE(common::FileExists(dir + "/journal-3.log"));
+
+  // A record torn mid-write claims more bytes than the log holds.
+  journal.OnAdded(6, {"http://f.example/6"}, {});
+  journal.Close();
+  const char torn[4] = {'\x00', '\xff', '\xff', '\x7f'};
+  CorruptJournalRecord(dir + "/journal-4.log", "http://f.example/6", -25, torn,
+                       sizeof(torn));
+  aria2_session_final(session);
+
+  session = aria2_session_new(no_options, 0, &session_config);
+  ASSERT_NE(session, nullptr);
+  restored.clear();
+  ASSERT_TRUE(journal.Open(session, dir, true, &restored, &error)) << error;
+  EXPECT_EQ(restored, (std::vector<aria2_gid_t>{1, 2, 4}));
+  EXPECT_EQ(journal.GetStats().restore_failed, 0);
+  journal.Close();
+  aria2_session_final(session);
+  aria2_library_deinit();
+}
+
+TEST(SizeProber, SendsTheDownloadsHeadersAndSkipsProxiedHosts) {
+  int port = 0;
+  const common::SocketHandle listener = common::TcpListenLoopback(&port);
+  ASSERT_NE(listener, common::kInvalidSocket);
+  std::string request;
+  std::atomic<int> served{0};
+  std::thread server([&]() {
+    for (int i = 0; i < 2; ++i) {
+      const common::SocketHandle sock =
+          common::TcpAccept(listener, 2000, 2000);
+      if (sock == common::kInvalidSocket) {
+        continue;
+      }
+      char buffer[4096];
+      const int n = common::RecvSome(sock, buffer, sizeof(buffer));
+      if (i == 0 && n > 0) {
+        request.assign(buffer, static_cast<size_t>(n));
+      }
+      common::SendAll(sock,
+                      "HTTP/1.1 200 OK\r\nContent-Length: 1234\r\n"
+                      "Connection: close\r\n\r\n");
+      common::CloseSocket(sock);
+      ++served;
+    }
+  });
+
+  const std::string uri =
+      "http://127.0.0.1:" + std::to_string(port) + "/file.bin";
+  core::ProbeSettings settings;
+  settings.user_agent = "probe-test/1";
+  settings.headers = {"X-Token: abc"};
+  settings.user = "u";
+  settings.password = "p";
+  EXPECT_EQ(core::SizeProber::ProbeUri(uri, settings), 1234);
+
+  // aria2 would go through the proxy, which a probe cannot.
+  settings.proxy = "http://proxy.invalid:3128";
+  EXPECT_EQ(core::SizeProber::ProbeUri(uri, settings), -1);
+  settings.no_proxy = "example.com, 127.0.0.1";
+  EXPECT_EQ(core::SizeProber::ProbeUri(uri, settings), 1234);
+
+  // A cancelled probe does not even look the host up.
+  std::atomic<bool> cancel{true};
+  EXPECT_EQ(core::SizeProber::ProbeUri("http://unresolvable.invalid/",
+                                       core::ProbeSettings(), &cancel),
+            -1);
+  server.join();
+  common::CloseSocket(listener);
+
+  EXPECT_EQ(served.load(), 2);
+  EXPECT_NE(request.find("HEAD /file.bin HTTP/1.1\r\n"), std::string::npos);
+  EXPECT_NE(request.find("User-Agent: probe-test/1\r\n"), std::string::npos);
+  EXPECT_NE(request.find("X-Token: abc\r\n"), std::string::npos);
+  EXPECT_NE(request.find("Authorization: Basic dTpw\r\n"), std::string::npos);
+}
+
+TEST(DownloadRegistry, PagesBucketsInArrivalOrder) {
+  core::DownloadRegistry registry;
+  for (aria2_gid_t gid = 1; gid <= 10; ++gid) {
+    registry.OnAdded(gid);
+  }
+  registry.OnDownloadEvent(ARIA2_EVENT_ON_DOWNLOAD_START, 3);
+  registry.OnDownloadEvent(ARIA2_EVENT_ON_DOWNLOAD_COMPLETE, 3);
+  registry.OnDownloadEvent(ARIA2_EVENT_ON_DOWNLOAD_ERROR, 1);
+  registry.OnDownloadEvent(ARIA2_EVENT_ON_DOWNLOAD_START, 5);
+
+  using Bucket = core::DownloadRegistry::Bucket;
+  EXPECT_EQ(registry.Page(Bucket::kStopped, 0, 10),
+            (std::vector<aria2_gid_t>{3, 1}));
+  EXPECT_EQ(registry.Page(Bucket::kActive, 0, 10),
+            (std::vector<aria2_gid_t>{5}));
+  EXPECT_EQ(registry.Page(Bucket::kWaiting, 0, 3),
+            (std::vector<aria2_gid_t>{2, 4, 6}));
+  EXPECT_EQ(registry.Page(Bucket::kWaiting, 3, 3),
+            (std::vector<aria2_gid_t>{7, 8, 9}));
+  EXPECT_EQ(registry.Page(Bucket::kWaiting, 6, 3),
+            (std::vector<aria2_gid_t>{10}));
+
+  EXPECT_TRUE(registry.Erase(3));
+  EXPECT_FALSE(registry.Erase(3));
+  const core::DownloadRegistry::Summary summary = registry.GetSummary();
+  EXPECT_EQ(summary.active, 1);
+  EXPECT_EQ(summary.waiting, 7);
+  EXPECT_EQ(summary.complete, 0);
+  EXPECT_EQ(summary.error, 1);
+}
+
+TEST(MethodTimings, CountsSlowMainThreadCalls) {
+  core::MethodTimings timings;
+  timings.Record("addTorrent", 200, 30000);
+  timings.Record("addTorrent", 1500, 10000);
+  timings.Record("getGlobalStat", 50, 20);
+
+  const common::Value out = timings.Describe();
+  const common::Value& torrent = out.Get("addTorrent");
+  EXPECT_EQ(torrent.Get("calls").AsInt(), 2);
+  EXPECT_EQ(torrent.Get("mainUs").AsInt(), 1700);
+  EXPECT_EQ(torrent.Get("mainMaxUs").AsInt(), 1500);
+  EXPECT_EQ(torrent.Get("slowOnMain").AsInt(), 1);
+  EXPECT_EQ(torrent.Get("workerUs").AsInt(), 40000);
+  EXPECT_EQ(torrent.Get("workerMaxUs").AsInt(), 30000);
+  EXPECT_EQ(out.Get("getGlobalStat").Get("slowOnMain").AsInt(), 0);
+
+  timings.Clear();
+  EXPECT_TRUE(timings.Describe().AsMap().empty());
+}
+
 }  // namespace test
 }  // namespace flutter_aria2
@@ -4,11 +4,11 @@ NS_ASSUME_NONNULL_BEGIN
 
 FOUNDATION_EXPORT NSErrorDomain const FlutterAria2NativeErrorDomain;
 
-typedef void (^FlutterAria2DownloadEventHandler)(NSInteger event, NSString* gid);
+typedef void (^FlutterAria2NativeEventHandler)(NSString* method, id _Nullable payload);
 
 @interface FlutterAria2Native : NSObject
 
-@property(nonatomic, copy, nullable) FlutterAria2DownloadEventHandler onDownloadEvent;
+@property(nonatomic, copy, nullable) FlutterAria2NativeEventHandler onNativeEvent;
 
 - (void)invokeMethod:(NSString*)method
            arguments:(NSDictionary<NSString*, id>* _Nullable)arguments
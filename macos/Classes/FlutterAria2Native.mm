@@ -3,9 +3,12 @@
 #include <aria2_c_api.h>
 #include "../../common/aria2_core.h"
 #include "../../common/aria2_helpers.h"
+#include "../../common/aria2_methods.h"
+#include "../../common/aria2_value.h"
 
 #include <atomic>
 #include <cstdio>
+#include <cstring>
 #include <sstream>
 #include <string>
 #include <thread>
@@ -16,30 +19,6 @@ NSErrorDomain const FlutterAria2NativeErrorDomain = @"FlutterAria2NativeErrorDom
 namespace {
 
 using Dict = NSDictionary<NSString*, id>*;
-using Array = NSArray*;
-
-flutter_aria2::core::RuntimeState TakeCoreState(
-    aria2_session_t*& session, BOOL& libraryInitialized, std::thread& runThread,
-    std::atomic<bool>& runLoopActive, std::atomic<bool>& runInProgress) {
-  flutter_aria2::core::RuntimeState core;
-  core.session = session;
-  core.library_initialized = libraryInitialized;
-  core.run_thread = std::move(runThread);
-  core.run_loop_active.store(runLoopActive.load());
-  core.run_in_progress.store(runInProgress.load());
-  return core;
-}
-
-void PutCoreState(aria2_session_t*& session, BOOL& libraryInitialized,
-                  std::thread& runThread, std::atomic<bool>& runLoopActive,
-                  std::atomic<bool>& runInProgress,
-                  flutter_aria2::core::RuntimeState&& core) {
-  session = core.session;
-  libraryInitialized = core.library_initialized ? YES : NO;
-  runThread = std::move(core.run_thread);
-  runLoopActive.store(core.run_loop_active.load());
-  runInProgress.store(core.run_in_progress.load());
-}
 
 NSError* MakeError(NSString* code, NSString* message) {
   return [NSError errorWithDomain:FlutterAria2NativeErrorDomain
@@ -93,14 +72,6 @@ Dict MapGetDict(Dict map, NSString* key) {
   return nil;
 }
 
-Array MapGetArray(Dict map, NSString* key) {
-  id value = MapGet(map, key);
-  if ([value isKindOfClass:[NSArray class]]) {
-    return (Array)value;
-  }
-  return nil;
-}
-
 struct KeyValHelper {
   std::vector<std::string> keys;
   std::vector<std::string> values;
@@ -159,15 +130,114 @@ NSDictionary* FileDataToNSDictionary(const aria2_file_data_t& file) {
   };
 }
 
+id ValueToObjC(const flutter_aria2::common::Value& value) {
+  using Type = flutter_aria2::common::Value::Type;
+  switch (value.type()) {
+    case Type::kNull:
+      return [NSNull null];
+    case Type::kBool:
+      return @(value.AsBool());
+    case Type::kInt:
+      return @(value.AsInt());
+    case Type::kDouble:
+      return @(value.AsDouble());
+    case Type::kString:
+      return [NSString stringWithUTF8String:value.AsString().c_str()];
+    case Type::kBytes:
+      return [NSData dataWithBytes:value.AsBytes().data()
+                            length:value.AsBytes().size()];
+    case Type::kList: {
+      NSMutableArray* list = [NSMutableArray arrayWithCapacity:value.AsList().size()];
+      for (const auto& item : value.AsList()) {
+        [list addObject:ValueToObjC(item)];
+      }
+      return list;
+    }
+    case Type::kMap: {
+      NSMutableDictionary* map = [NSMutableDictionary dictionary];
+      for (const auto& entry : value.AsMap()) {
+        map[[NSString stringWithUTF8String:entry.first.c_str()]] = ValueToObjC(entry.second);
+      }
+      return map;
+    }
+  }
+  return [NSNull null];
+}
+
+flutter_aria2::common::Value ObjCToValue(id obj) {
+  using flutter_aria2::common::Value;
+  if (obj == nil || obj == [NSNull null]) {
+    return Value();
+  }
+  if ([obj isKindOfClass:[NSNumber class]]) {
+    NSNumber* number = (NSNumber*)obj;
+    if (CFGetTypeID((__bridge CFTypeRef)number) == CFBooleanGetTypeID()) {
+      return Value(static_cast<bool>(number.boolValue));
+    }
+    const char* type = number.objCType;
+    if (std::strcmp(type, @encode(double)) == 0 ||
+        std::strcmp(type, @encode(float)) == 0) {
+      return Value(number.doubleValue);
+    }
+    return Value(static_cast<int64_t>(number.longLongValue));
+  }
+  if ([obj isKindOfClass:[NSString class]]) {
+    return Value(std::string([(NSString*)obj UTF8String]));
+  }
+  // FlutterStandardTypedData exposes its payload through -data.
+  NSData* data = [obj isKindOfClass:[NSData class]] ? (NSData*)obj : nil;
+  if (data == nil && [obj respondsToSelector:@selector(data)]) {
+    id inner = [obj performSelector:@selector(data)];
+    data = [inner isKindOfClass:[NSData class]] ? (NSData*)inner : nil;
+  }
+  if (data != nil) {
+    const auto* bytes = static_cast<const uint8_t*>(data.bytes);
+    return Value(Value::Bytes(bytes, bytes + data.length));
+  }
+  if ([obj isKindOfClass:[NSArray class]]) {
+    Value out = Value::NewList();
+    for (id item in (NSArray*)obj) {
+      out.Append(ObjCToValue(item));
+    }
+    return out;
+  }
+  if ([obj isKindOfClass:[NSDictionary class]]) {
+    Value out = Value::NewMap();
+    NSDictionary* dict = (NSDictionary*)obj;
+    for (id key in dict) {
+      if ([key isKindOfClass:[NSString class]]) {
+        out.Set([(NSString*)key UTF8String], ObjCToValue(dict[key]));
+      }
+    }
+    return out;
+  }
+  return Value();
+}
+
+void EmitNativeEvent(const char* method,
+                     flutter_aria2::common::Value&& payload,
+                     void* user_data) {
+  __weak FlutterAria2Native* weakNative = (__bridge __weak FlutterAria2Native*)user_data;
+  if (weakNative == nil) {
+    return;
+  }
+
+  NSString* name = [NSString stringWithUTF8String:method];
+  id arguments = ValueToObjC(payload);
+  dispatch_async(dispatch_get_main_queue(), ^{
+    FlutterAria2Native* native = weakNative;
+    if (native == nil || native.onNativeEvent == nil) {
+      return;
+    }
+    native.onNativeEvent(name, arguments == [NSNull null] ? nil : arguments);
+  });
+}
+
 }  // namespace
 
 @interface FlutterAria2Native () {
  @private
-  aria2_session_t* _session;
-  BOOL _libraryInitialized;
-  std::thread _runThread;
-  std::atomic<bool> _runLoopActive;
-  std::atomic<bool> _runInProgress;
+  flutter_aria2::core::RuntimeState _core;
 }
 @end
 
@@ -176,57 +246,14 @@ NSDictionary* FileDataToNSDictionary(const aria2_file_data_t& file) {
 - (instancetype)init {
   self = [super init];
   if (self) {
-    _session = nullptr;
-    _libraryInitialized = NO;
-    _runLoopActive.store(false);
-    _runInProgress.store(false);
+    _core.event_sink = &EmitNativeEvent;
+    _core.event_sink_user_data = (__bridge void*)self;
   }
   return self;
 }
 
 - (void)dealloc {
-  auto core = TakeCoreState(_session, _libraryInitialized, _runThread,
-                            _runLoopActive, _runInProgress);
-  flutter_aria2::core::CleanupState(&core);
-  PutCoreState(_session, _libraryInitialized, _runThread, _runLoopActive,
-               _runInProgress, std::move(core));
-}
-
-- (void)waitForPendingRun {
-  auto core = TakeCoreState(_session, _libraryInitialized, _runThread,
-                            _runLoopActive, _runInProgress);
-  flutter_aria2::core::WaitForPendingRun(&core);
-  PutCoreState(_session, _libraryInitialized, _runThread, _runLoopActive,
-               _runInProgress, std::move(core));
-}
-
-- (void)stopRunLoopInternal {
-  auto core = TakeCoreState(_session, _libraryInitialized, _runThread,
-                            _runLoopActive, _runInProgress);
-  flutter_aria2::core::StopRunLoop(&core);
-  PutCoreState(_session, _libraryInitialized, _runThread, _runLoopActive,
-               _runInProgress, std::move(core));
-}
-
-static int DownloadEventCallback(aria2_session_t* /*session*/,
-                                 aria2_download_event_t event,
-                                 aria2_gid_t gid,
-                                 void* user_data) {
-  __weak FlutterAria2Native* weakNative = (__bridge __weak FlutterAria2Native*)user_data;
-  if (weakNative == nil) {
-    return 0;
-  }
-
-  NSString* gidHex = [NSString
-      stringWithUTF8String:flutter_aria2::common::GidToHex(gid).c_str()];
-  dispatch_async(dispatch_get_main_queue(), ^{
-    FlutterAria2Native* native = weakNative;
-    if (native == nil || native.onDownloadEvent == nil) {
-      return;
-    }
-    native.onDownloadEvent(static_cast<NSInteger>(event), gidHex);
-  });
-  return 0;
+  flutter_aria2::core::CleanupState(&_core);
 }
 
 - (void)invokeMethod:(NSString*)method
@@ -239,41 +266,28 @@ static int DownloadEventCallback(aria2_session_t* /*session*/,
     return;
   }
   if ([method isEqualToString:@"libraryInit"]) {
-    auto core = TakeCoreState(_session, _libraryInitialized, _runThread,
-                              _runLoopActive, _runInProgress);
-    int ret = flutter_aria2::core::LibraryInit(&core);
-    PutCoreState(_session, _libraryInitialized, _runThread, _runLoopActive,
-                 _runInProgress, std::move(core));
+    int ret = flutter_aria2::core::LibraryInit(&_core);
     completion(@(ret), nil);
     return;
   }
   if ([method isEqualToString:@"libraryDeinit"]) {
-    auto core = TakeCoreState(_session, _libraryInitialized, _runThread,
-                              _runLoopActive, _runInProgress);
-    int ret = flutter_aria2::core::LibraryDeinit(&core);
-    PutCoreState(_session, _libraryInitialized, _runThread, _runLoopActive,
-                 _runInProgress, std::move(core));
+    int ret = flutter_aria2::core::LibraryDeinit(&_core);
     completion(@(ret), nil);
     return;
   }
   if ([method isEqualToString:@"sessionNew"]) {
-    if (!_libraryInitialized) {
+    if (!_core.library_initialized) {
       completion(nil, MakeError(@"NOT_INITIALIZED", @"Call libraryInit() before sessionNew()"));
       return;
     }
-    if (_session != nullptr) {
+    if (_core.session != nullptr) {
       completion(nil, MakeError(@"SESSION_EXISTS", @"Session already exists. Call sessionFinal() first."));
       return;
     }
     KeyValHelper options = OptionsFromArgs(args, @"options");
     bool keepRunning = MapGetBool(args, @"keepRunning", true);
-    auto core = TakeCoreState(_session, _libraryInitialized, _runThread,
-                              _runLoopActive, _runInProgress);
     const char* error = flutter_aria2::core::SessionNew(
-        &core, options.data(), options.count(), keepRunning,
-        &DownloadEventCallback, (__bridge void*)self);
-    PutCoreState(_session, _libraryInitialized, _runThread, _runLoopActive,
-                 _runInProgress, std::move(core));
+        &_core, options.data(), options.count(), keepRunning);
     if (error != nullptr) {
       completion(nil, MakeError(@"SESSION_FAILED", @"aria2_session_new returned null"));
       return;
@@ -282,39 +296,36 @@ static int DownloadEventCallback(aria2_session_t* /*session*/,
     return;
   }
   if ([method isEqualToString:@"sessionFinal"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
-    auto core = TakeCoreState(_session, _libraryInitialized, _runThread,
-                              _runLoopActive, _runInProgress);
     int ret = 0;
-    flutter_aria2::core::SessionFinal(&core, &ret);
-    PutCoreState(_session, _libraryInitialized, _runThread, _runLoopActive,
-                 _runInProgress, std::move(core));
+    flutter_aria2::core::SessionFinal(&_core, &ret);
     completion(@(ret), nil);
     return;
   }
   if ([method isEqualToString:@"run"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
-    if (_runInProgress.load()) {
+    if (_core.run_in_progress.load()) {
       completion(@1, nil);
       return;
     }
-    _runInProgress.store(true);
-    aria2_session_t* session = _session;
+    _core.run_in_progress.store(true);
+    aria2_session_t* session = _core.session;
     __block FlutterAria2Native* native = self;
     dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
       int ret = -1;
       try {
         ret = aria2_run(session, ARIA2_RUN_ONCE);
+        flutter_aria2::core::Tick(&native->_core);
       } catch (...) {
         ret = -1;
       }
-      native->_runInProgress.store(false);
+      native->_core.run_in_progress.store(false);
       dispatch_async(dispatch_get_main_queue(), ^{
         completion(@(ret), nil);
       });
@@ -322,152 +333,42 @@ static int DownloadEventCallback(aria2_session_t* /*session*/,
     return;
   }
   if ([method isEqualToString:@"startRunLoop"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
-    if (_runLoopActive.load()) {
+    if (_core.run_loop_active.load()) {
       completion(nil, nil);
       return;
     }
-    auto core = TakeCoreState(_session, _libraryInitialized, _runThread,
-                              _runLoopActive, _runInProgress);
-    flutter_aria2::core::StartRunLoop(&core);
-    PutCoreState(_session, _libraryInitialized, _runThread, _runLoopActive,
-                 _runInProgress, std::move(core));
+    flutter_aria2::core::StartRunLoop(&_core);
     completion(nil, nil);
     return;
   }
   if ([method isEqualToString:@"stopRunLoop"]) {
-    [self stopRunLoopInternal];
+    flutter_aria2::core::StopRunLoop(&_core);
     completion(nil, nil);
     return;
   }
   if ([method isEqualToString:@"shutdown"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
     int force = MapGetBool(args, @"force", false) ? 1 : 0;
-    auto core = TakeCoreState(_session, _libraryInitialized, _runThread,
-                              _runLoopActive, _runInProgress);
     int ret = 0;
-    flutter_aria2::core::Shutdown(&core, force != 0, &ret);
-    PutCoreState(_session, _libraryInitialized, _runThread, _runLoopActive,
-                 _runInProgress, std::move(core));
+    flutter_aria2::core::Shutdown(&_core, force != 0, &ret);
     completion(@(ret), nil);
     return;
   }
-  if ([method isEqualToString:@"addUri"]) {
-    if (_session == nullptr) {
-      completion(nil, MakeError(@"NO_SESSION", @"No active session"));
-      return;
-    }
-    Array uris = MapGetArray(args, @"uris");
-    if (uris == nil) {
-      completion(nil, MakeError(@"BAD_ARGS", @"Missing 'uris'"));
-      return;
-    }
-    std::vector<std::string> uriStrings;
-    std::vector<const char*> uriPtrs;
-    uriStrings.reserve(uris.count);
-    for (id item in uris) {
-      if ([item isKindOfClass:[NSString class]]) {
-        uriStrings.emplace_back([(NSString*)item UTF8String]);
-      }
-    }
-    uriPtrs.reserve(uriStrings.size());
-    for (const auto& item : uriStrings) {
-      uriPtrs.push_back(item.c_str());
-    }
-    KeyValHelper options = OptionsFromArgs(args, @"options");
-    int position = MapGetInt(args, @"position", -1);
-    aria2_gid_t gid;
-    int ret = aria2_add_uri(_session, &gid, uriPtrs.data(), uriPtrs.size(),
-                            options.data(), options.count(), position);
-    if (ret == 0) {
-      completion([NSString stringWithUTF8String:flutter_aria2::common::GidToHex(gid)
-                                                .c_str()],
-                 nil);
-    } else {
-      completion(nil, MakeError(@"ARIA2_ERROR", [NSString stringWithFormat:@"aria2_add_uri failed with code %d", ret]));
-    }
-    return;
-  }
-  if ([method isEqualToString:@"addTorrent"]) {
-    if (_session == nullptr) {
-      completion(nil, MakeError(@"NO_SESSION", @"No active session"));
-      return;
-    }
-    NSString* torrentFile = MapGetString(args, @"torrentFile");
-    Array webseedUris = MapGetArray(args, @"webseedUris");
-    std::vector<std::string> wsStrings;
-    std::vector<const char*> wsPtrs;
-    if (webseedUris != nil) {
-      wsStrings.reserve(webseedUris.count);
-      for (id item in webseedUris) {
-        if ([item isKindOfClass:[NSString class]]) {
-          wsStrings.emplace_back([(NSString*)item UTF8String]);
-        }
-      }
-      wsPtrs.reserve(wsStrings.size());
-      for (const auto& item : wsStrings) {
-        wsPtrs.push_back(item.c_str());
-      }
-    }
-    KeyValHelper options = OptionsFromArgs(args, @"options");
-    int position = MapGetInt(args, @"position", -1);
-    aria2_gid_t gid;
-    int ret = wsPtrs.empty()
-                  ? aria2_add_torrent_simple(_session, &gid, torrentFile.UTF8String,
-                                             options.data(), options.count(), position)
-                  : aria2_add_torrent(_session, &gid, torrentFile.UTF8String,
-                                      wsPtrs.data(), wsPtrs.size(),
-                                      options.data(), options.count(), position);
-    if (ret == 0) {
-      completion([NSString stringWithUTF8String:flutter_aria2::common::GidToHex(gid)
-                                                .c_str()],
-                 nil);
-    } else {
-      completion(nil, MakeError(@"ARIA2_ERROR", [NSString stringWithFormat:@"aria2_add_torrent failed with code %d", ret]));
-    }
-    return;
-  }
-  if ([method isEqualToString:@"addMetalink"]) {
-    if (_session == nullptr) {
-      completion(nil, MakeError(@"NO_SESSION", @"No active session"));
-      return;
-    }
-    NSString* metalinkFile = MapGetString(args, @"metalinkFile");
-    KeyValHelper options = OptionsFromArgs(args, @"options");
-    int position = MapGetInt(args, @"position", -1);
-    aria2_gid_t* gids = nullptr;
-    size_t gidsCount = 0;
-    int ret = aria2_add_metalink(_session, &gids, &gidsCount, metalinkFile.UTF8String,
-                                 options.data(), options.count(), position);
-    if (ret == 0) {
-      NSMutableArray* gidList = [NSMutableArray array];
-      for (size_t i = 0; i < gidsCount; ++i) {
-        [gidList addObject:[NSString
-                               stringWithUTF8String:flutter_aria2::common::GidToHex(gids[i])
-                                                        .c_str()]];
-      }
-      if (gids != nullptr) aria2_free(gids);
-      completion(gidList, nil);
-    } else {
-      if (gids != nullptr) aria2_free(gids);
-      completion(nil, MakeError(@"ARIA2_ERROR", [NSString stringWithFormat:@"aria2_add_metalink failed with code %d", ret]));
-    }
-    return;
-  }
   if ([method isEqualToString:@"getActiveDownload"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
     aria2_gid_t* gids = nullptr;
     size_t gidsCount = 0;
-    int ret = aria2_get_active_download(_session, &gids, &gidsCount);
+    int ret = aria2_get_active_download(_core.session, &gids, &gidsCount);
     if (ret == 0) {
       NSMutableArray* gidList = [NSMutableArray array];
       for (size_t i = 0; i < gidsCount; ++i) {
@@ -484,66 +385,54 @@ static int DownloadEventCallback(aria2_session_t* /*session*/,
     return;
   }
   if ([method isEqualToString:@"removeDownload"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
     NSString* hex = MapGetString(args, @"gid");
     bool force = MapGetBool(args, @"force", false);
-    completion(@(aria2_remove_download(_session, aria2_hex_to_gid(hex.UTF8String), force ? 1 : 0)), nil);
+    completion(@(aria2_remove_download(_core.session, aria2_hex_to_gid(hex.UTF8String), force ? 1 : 0)), nil);
     return;
   }
   if ([method isEqualToString:@"pauseDownload"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
     NSString* hex = MapGetString(args, @"gid");
     bool force = MapGetBool(args, @"force", false);
-    completion(@(aria2_pause_download(_session, aria2_hex_to_gid(hex.UTF8String), force ? 1 : 0)), nil);
+    completion(@(aria2_pause_download(_core.session, aria2_hex_to_gid(hex.UTF8String), force ? 1 : 0)), nil);
     return;
   }
   if ([method isEqualToString:@"unpauseDownload"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
     NSString* hex = MapGetString(args, @"gid");
-    completion(@(aria2_unpause_download(_session, aria2_hex_to_gid(hex.UTF8String))), nil);
+    completion(@(aria2_unpause_download(_core.session, aria2_hex_to_gid(hex.UTF8String))), nil);
     return;
   }
   if ([method isEqualToString:@"changePosition"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
     NSString* hex = MapGetString(args, @"gid");
     int pos = MapGetInt(args, @"pos", 0);
     int how = MapGetInt(args, @"how", 0);
-    int ret = aria2_change_position(_session, aria2_hex_to_gid(hex.UTF8String), pos,
+    int ret = aria2_change_position(_core.session, aria2_hex_to_gid(hex.UTF8String), pos,
                                     static_cast<aria2_offset_mode_t>(how));
     completion(@(ret), nil);
     return;
   }
-  if ([method isEqualToString:@"changeOption"]) {
-    if (_session == nullptr) {
-      completion(nil, MakeError(@"NO_SESSION", @"No active session"));
-      return;
-    }
-    NSString* hex = MapGetString(args, @"gid");
-    KeyValHelper options = OptionsFromArgs(args, @"options");
-    int ret = aria2_change_option(_session, aria2_hex_to_gid(hex.UTF8String),
-                                  options.data(), options.count());
-    completion(@(ret), nil);
-    return;
-  }
   if ([method isEqualToString:@"getGlobalOption"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
     NSString* name = MapGetString(args, @"name");
-    char* value = aria2_get_global_option(_session, name.UTF8String);
+    char* value = aria2_get_global_option(_core.session, name.UTF8String);
     if (value != nullptr) {
       completion([NSString stringWithUTF8String:value], nil);
       aria2_free(value);
@@ -553,13 +442,13 @@ static int DownloadEventCallback(aria2_session_t* /*session*/,
     return;
   }
   if ([method isEqualToString:@"getGlobalOptions"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
     aria2_key_val_t* options = nullptr;
     size_t optionsCount = 0;
-    int ret = aria2_get_global_options(_session, &options, &optionsCount);
+    int ret = aria2_get_global_options(_core.session, &options, &optionsCount);
     if (ret == 0) {
       NSMutableDictionary* map = [NSMutableDictionary dictionary];
       for (size_t i = 0; i < optionsCount; ++i) {
@@ -576,20 +465,20 @@ static int DownloadEventCallback(aria2_session_t* /*session*/,
     return;
   }
   if ([method isEqualToString:@"changeGlobalOption"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
     KeyValHelper options = OptionsFromArgs(args, @"options");
-    completion(@(aria2_change_global_option(_session, options.data(), options.count())), nil);
+    completion(@(aria2_change_global_option(_core.session, options.data(), options.count())), nil);
     return;
   }
   if ([method isEqualToString:@"getGlobalStat"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
-    aria2_global_stat_t stat = aria2_get_global_stat(_session);
+    aria2_global_stat_t stat = aria2_get_global_stat(_core.session);
     completion(@{
       @"downloadSpeed" : @(stat.download_speed),
       @"uploadSpeed" : @(stat.upload_speed),
@@ -600,13 +489,13 @@ static int DownloadEventCallback(aria2_session_t* /*session*/,
     return;
   }
   if ([method isEqualToString:@"getDownloadInfo"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
     NSString* hex = MapGetString(args, @"gid");
     aria2_download_handle_t* dh =
-        aria2_get_download_handle(_session, aria2_hex_to_gid(hex.UTF8String));
+        aria2_get_download_handle(_core.session, aria2_hex_to_gid(hex.UTF8String));
     if (dh == nullptr) {
       completion(nil, MakeError(@"HANDLE_FAILED",
                                 [NSString stringWithFormat:@"aria2_get_download_handle returned null for gid %@", hex]));
@@ -620,6 +509,12 @@ static int DownloadEventCallback(aria2_session_t* /*session*/,
     map[@"uploadLength"] = @(aria2_download_handle_get_upload_length(dh));
     map[@"downloadSpeed"] = @(aria2_download_handle_get_download_speed(dh));
     map[@"uploadSpeed"] = @(aria2_download_handle_get_upload_speed(dh));
+    const flutter_aria2::core::SpeedEstimate estimate = _core.speeds.Estimate(
+        aria2_hex_to_gid(hex.UTF8String), aria2_download_handle_get_total_length(dh),
+        aria2_download_handle_get_completed_length(dh),
+        aria2_download_handle_get_download_speed(dh));
+    map[@"avgSpeed"] = @(estimate.avg_speed);
+    map[@"eta"] = @(estimate.eta_seconds);
 
     aria2_binary_t infoHash = aria2_download_handle_get_info_hash(dh);
     if (infoHash.data != nullptr && infoHash.length > 0) {
@@ -672,13 +567,13 @@ static int DownloadEventCallback(aria2_session_t* /*session*/,
     return;
   }
   if ([method isEqualToString:@"getDownloadFiles"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
     NSString* hex = MapGetString(args, @"gid");
     aria2_download_handle_t* dh =
-        aria2_get_download_handle(_session, aria2_hex_to_gid(hex.UTF8String));
+        aria2_get_download_handle(_core.session, aria2_hex_to_gid(hex.UTF8String));
     if (dh == nullptr) {
       completion(nil, MakeError(@"HANDLE_FAILED",
                                 [NSString stringWithFormat:@"aria2_get_download_handle returned null for gid %@", hex]));
@@ -699,14 +594,14 @@ static int DownloadEventCallback(aria2_session_t* /*session*/,
     return;
   }
   if ([method isEqualToString:@"getDownloadOption"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
     NSString* hex = MapGetString(args, @"gid");
     NSString* name = MapGetString(args, @"name");
     aria2_download_handle_t* dh =
-        aria2_get_download_handle(_session, aria2_hex_to_gid(hex.UTF8String));
+        aria2_get_download_handle(_core.session, aria2_hex_to_gid(hex.UTF8String));
     if (dh == nullptr) {
       completion(nil, MakeError(@"HANDLE_FAILED",
                                 [NSString stringWithFormat:@"aria2_get_download_handle returned null for gid %@", hex]));
@@ -723,13 +618,13 @@ static int DownloadEventCallback(aria2_session_t* /*session*/,
     return;
   }
   if ([method isEqualToString:@"getDownloadOptions"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
     NSString* hex = MapGetString(args, @"gid");
     aria2_download_handle_t* dh =
-        aria2_get_download_handle(_session, aria2_hex_to_gid(hex.UTF8String));
+        aria2_get_download_handle(_core.session, aria2_hex_to_gid(hex.UTF8String));
     if (dh == nullptr) {
       completion(nil, MakeError(@"HANDLE_FAILED",
                                 [NSString stringWithFormat:@"aria2_get_download_handle returned null for gid %@", hex]));
@@ -752,13 +647,13 @@ static int DownloadEventCallback(aria2_session_t* /*session*/,
     return;
   }
   if ([method isEqualToString:@"getDownloadBtMetaInfo"]) {
-    if (_session == nullptr) {
+    if (_core.session == nullptr) {
       completion(nil, MakeError(@"NO_SESSION", @"No active session"));
       return;
     }
     NSString* hex = MapGetString(args, @"gid");
     aria2_download_handle_t* dh =
-        aria2_get_download_handle(_session, aria2_hex_to_gid(hex.UTF8String));
+        aria2_get_download_handle(_core.session, aria2_hex_to_gid(hex.UTF8String));
     if (dh == nullptr) {
       completion(nil, MakeError(@"HANDLE_FAILED",
                                 [NSString stringWithFormat:@"aria2_get_download_handle returned null for gid %@", hex]));
@@ -787,7 +682,19 @@ static int DownloadEventCallback(aria2_session_t* /*session*/,
     return;
   }
 
-  completion(nil, MakeError(@"NOT_IMPLEMENTED", @"Method is not implemented on native side"));
+  flutter_aria2::common::Value value;
+  std::string message;
+  const char* error = flutter_aria2::core::InvokeMethod(
+      &_core, method.UTF8String, ObjCToValue(args), &value, &message);
+  if (error == nullptr) {
+    id result = ValueToObjC(value);
+    completion(result == [NSNull null] ? nil : result, nil);
+  } else if (std::strcmp(error, flutter_aria2::core::kNotImplemented) == 0) {
+    completion(nil, MakeError(@"NOT_IMPLEMENTED", @"Method is not implemented on native side"));
+  } else {
+    completion(nil, MakeError([NSString stringWithUTF8String:error],
+                              [NSString stringWithUTF8String:message.c_str()]));
+  }
 }
 
 @end
@@ -10,11 +10,8 @@ public class FlutterAria2Plugin: NSObject, FlutterPlugin {
     self.native = FlutterAria2Native()
     super.init()
 
-    native.onDownloadEvent = { [weak channel] event, gid in
-      channel?.invokeMethod("onDownloadEvent", arguments: [
-        "event": event,
-        "gid": gid,
-      ])
+    native.onNativeEvent = { [weak channel] method, payload in
+      channel?.invokeMethod(method, arguments: payload)
     }
   }
 
@@ -1,5 +1,8 @@
+import 'dart:typed_data';
+
 import 'package:flutter/services.dart';
 import 'package:flutter_test/flutter_test.dart';
+import 'package:flutter_aria2/flutter_aria2.dart';
 import 'package:flutter_aria2/flutter_aria2_method_channel.dart';
 
 void main() {
@@ -7,11 +10,24 @@ void main() {
 
   MethodChannelFlutterAria2 platform = MethodChannelFlutterAria2();
   const MethodChannel channel = MethodChannel('flutter_aria2');
+  final List<MethodCall> log = <MethodCall>[];
+
+  // 模拟原生层向 Dart 发起的调用
+  Future<void> sendNative(String method, Map<String, dynamic> arguments) {
+    return TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger.handlePlatformMessage(
+      channel.name,
+      channel.codec.encodeMethodCall(MethodCall(method, arguments)),
+      (ByteData? _) {},
+    );
+  }
 
   setUp(() {
+    platform = MethodChannelFlutterAria2();
+    log.clear();
     TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger.setMockMethodCallHandler(
       channel,
       (MethodCall methodCall) async {
+        log.add(methodCall);
         return '42';
       },
     );
@@ -24,4 +40,210 @@ void main() {
   test('getPlatformVersion', () async {
     expect(await platform.getPlatformVersion(), '42');
   });
+
+  test('setEventFilter maps events to C API mask bits', () async {
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger.setMockMethodCallHandler(
+      channel,
+      (MethodCall methodCall) async {
+        log.add(methodCall);
+        return true;
+      },
+    );
+
+    await platform.setEventFilter(
+      {Aria2DownloadEvent.onDownloadStart, Aria2DownloadEvent.onDownloadComplete},
+      gids: {'g1'},
+      name: 'ui',
+    );
+
+    expect(log, hasLength(1));
+    expect(log.single.method, 'setEventFilter');
+    final args = log.single.arguments as Map;
+    expect(args['name'], 'ui');
+    // onDownloadStart = 1, onDownloadComplete = 4
+    expect(args['eventMask'], (1 << 1) | (1 << 4));
+    expect(args['gids'], ['g1']);
+  });
+
+  test('onDownloadEvents delivers batched events with their subscriptions', () async {
+    final events = <Aria2DownloadEventData>[];
+    final sub = platform.onDownloadEvent.listen(events.add);
+
+    await sendNative('onDownloadEvents', {
+      'events': [
+        {'event': 1, 'gid': 'g1', 'subscriptions': ['ui']},
+        {
+          'event': 4,
+          'gid': 'g1',
+          'subscriptions': ['ui', 'log'],
+          'checksums': [],
+        },
+      ],
+    });
+    await pumpEventQueue();
+    await sub.cancel();
+
+    expect(events, hasLength(2));
+    expect(events[0].event, Aria2DownloadEvent.onDownloadStart);
+    expect(events[0].subscriptions, ['ui']);
+    expect(events[1].event, Aria2DownloadEvent.onDownloadComplete);
+    expect(events[1].subscriptions, ['ui', 'log']);
+  });
+
+  group('awaitAll', () {
+    setUp(() {
+      TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger.setMockMethodCallHandler(
+        channel,
+        (MethodCall methodCall) async {
+          log.add(methodCall);
+          return true;
+        },
+      );
+    });
+
+    // 等待 awaitDownloads 调用送达后返回其 waiter id
+    Future<int> registeredId() async {
+      await pumpEventQueue();
+      final call = log.lastWhere((c) => c.method == 'awaitDownloads');
+      return (call.arguments as Map)['id'] as int;
+    }
+
+    test('completes from onDownloadSettled results', () async {
+      final future = platform.awaitAll(['g1', 'g2'],
+          timeout: const Duration(seconds: 5));
+      final id = await registeredId();
+      final args = log.last.arguments as Map;
+      expect(args['gids'], ['g1', 'g2']);
+      expect(args['timeoutMs'], 5000);
+
+      await sendNative('onDownloadSettled', {
+        'id': id,
+        'results': [
+          {'gid': 'g1', 'event': 4, 'info': {'gid': 'g1', 'status': 3}},
+          {'gid': 'g2', 'event': 5, 'info': {'gid': 'g2', 'errorCode': 2}},
+        ],
+      });
+
+      final results = await future;
+      expect(results, hasLength(2));
+      expect(results[0].gid, 'g1');
+      expect(results[0].isComplete, isTrue);
+      expect(results[1].event, Aria2DownloadEvent.onDownloadError);
+      expect(results[1].info.errorCode, 2);
+    });
+
+    test('ignores settlements for other waiters', () async {
+      final future = platform.awaitAll(['g1']);
+      final id = await registeredId();
+      var done = false;
+      future.then((_) => done = true);
+
+      await sendNative('onDownloadSettled', {'id': id + 1, 'results': []});
+      await pumpEventQueue();
+      expect(done, isFalse);
+
+      await sendNative('onDownloadSettled', {'id': id, 'results': []});
+      expect(await future, isEmpty);
+    });
+
+    test('maps timedOut to TIMEOUT', () async {
+      final future = platform.awaitAll(['g1']);
+      final id = await registeredId();
+      final expectation = expectLater(
+        future,
+        throwsA(isA<Aria2Exception>().having((e) => e.code, 'code', 'TIMEOUT')),
+      );
+
+      await sendNative('onDownloadSettled', {'id': id, 'timedOut': true});
+      await expectation;
+    });
+
+    test('maps error to WAIT_FAILED', () async {
+      final future = platform.awaitAll(['g1']);
+      final id = await registeredId();
+      final expectation = expectLater(
+        future,
+        throwsA(isA<Aria2Exception>()
+            .having((e) => e.code, 'code', 'WAIT_FAILED')
+            .having((e) => e.message, 'message', 'session closed')),
+      );
+
+      await sendNative('onDownloadSettled', {'id': id, 'error': 'session closed'});
+      await expectation;
+    });
+  });
+
+  group('fetchToMemory', () {
+    // 让 fetchToMemory 返回 gid；early 不为 null 时先于返回送达完成事件
+    void mockFetch(Map<String, dynamic>? early) {
+      TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger.setMockMethodCallHandler(
+        channel,
+        (MethodCall methodCall) async {
+          log.add(methodCall);
+          if (early != null) {
+            await sendNative('onFetchComplete', {'gid': 'f1', ...early});
+          }
+          return 'f1';
+        },
+      );
+    }
+
+    test('completes from onFetchComplete after the call returns', () async {
+      mockFetch(null);
+      final future = platform.fetchToMemory(['http://example.com/a'],
+          maxBytes: 1024);
+      await pumpEventQueue();
+      expect(log.single.method, 'fetchToMemory');
+      expect((log.single.arguments as Map)['maxBytes'], 1024);
+
+      await sendNative('onFetchComplete', {
+        'gid': 'f1',
+        'ok': true,
+        'data': Uint8List.fromList([1, 2, 3]),
+      });
+      expect(await future, [1, 2, 3]);
+    });
+
+    test('uses a result that arrived before the call returned', () async {
+      mockFetch({'ok': true, 'data': Uint8List.fromList([4, 5])});
+      expect(await platform.fetchToMemory(['http://example.com/a']), [4, 5]);
+    });
+
+    test('maps an early tooLarge result to TOO_LARGE', () async {
+      mockFetch({'ok': false, 'tooLarge': true, 'error': 'exceeds maxBytes'});
+      await expectLater(
+        platform.fetchToMemory(['http://example.com/a']),
+        throwsA(isA<Aria2Exception>().having((e) => e.code, 'code', 'TOO_LARGE')),
+      );
+    });
+
+    test('maps other failures to FETCH_FAILED', () async {
+      mockFetch({'ok': false, 'error': 'connection refused'});
+      await expectLater(
+        platform.fetchToMemory(['http://example.com/a']),
+        throwsA(isA<Aria2Exception>()
+            .having((e) => e.code, 'code', 'FETCH_FAILED')
+            .having((e) => e.message, 'message', 'connection refused')),
+      );
+    });
+
+    test('does not reuse an early result for a later fetch', () async {
+      mockFetch({'ok': true, 'data': Uint8List.fromList([7])});
+      expect(await platform.fetchToMemory(['http://example.com/a']), [7]);
+
+      mockFetch(null);
+      var done = false;
+      final future = platform.fetchToMemory(['http://example.com/a']);
+      future.then((_) => done = true);
+      await pumpEventQueue();
+      expect(done, isFalse);
+
+      await sendNative('onFetchComplete', {
+        'gid': 'f1',
+        'ok': true,
+        'data': Uint8List.fromList([8]),
+      });
+      expect(await future, [8]);
+    });
+  });
 }
@@ -1,3 +1,5 @@
+import 'dart:typed_data';
+
 import 'package:flutter_test/flutter_test.dart';
 import 'package:flutter_aria2/flutter_aria2.dart';
 import 'package:flutter_aria2/flutter_aria2_platform_interface.dart';
@@ -13,6 +15,23 @@ class MockFlutterAria2Platform
   @override
   Stream<Aria2DownloadEventData> get onDownloadEvent => Stream.empty();
 
+  @override
+  Stream<Aria2RetryEvent> get onRetryEvent => Stream.empty();
+
+  @override
+  Stream<Aria2VirtualMaterialized> get onVirtualMaterialized =>
+      Stream.empty();
+
+  @override
+  Stream<Aria2ImportProgress> get onImportProgress => Stream.empty();
+
+  @override
+  Stream<Aria2GroupEvent> get onGroupEvent => Stream.empty();
+
+  @override
+  Stream<List<Aria2ProgressTriggerHit>> get onProgressTrigger =>
+      Stream.empty();
+
   @override
   Future<int> libraryInit() => Future.value(0);
 
@@ -43,15 +62,34 @@ class MockFlutterAria2Platform
     List<String> uris, {
     Map<String, String>? options,
     int position = -1,
+    Aria2Priority? priority,
+    int? sizeHint,
+    DateTime? deadline,
+    bool rankMirrors = false,
+    String? expectedSha256,
+    bool computeSha256 = false,
   }) =>
       Future.value('');
 
+  @override
+  Future<Aria2ImportProgress> importInputFile(
+    String path, {
+    Map<String, String>? options,
+    bool toVirtualQueue = false,
+  }) =>
+      Future.value(Aria2ImportProgress.fromMap({'path': path, 'done': true}));
+
+  @override
+  Future<void> cancelImport() => Future.value();
+
   @override
   Future<String> addTorrent(
     String torrentFile, {
     List<String>? webseedUris,
     Map<String, String>? options,
     int position = -1,
+    Map<int, String>? expectedSha256,
+    bool computeSha256 = false,
   }) =>
       Future.value('');
 
@@ -63,9 +101,50 @@ class MockFlutterAria2Platform
   }) =>
       Future.value([]);
 
+  @override
+  Future<String> addTorrentBytes(
+    Uint8List torrent, {
+    List<String>? webseedUris,
+    Map<String, String>? options,
+    int position = -1,
+    Map<int, String>? expectedSha256,
+    bool computeSha256 = false,
+  }) =>
+      Future.value('');
+
+  @override
+  Future<List<String>> addMetalinkBytes(
+    Uint8List metalink, {
+    Map<String, String>? options,
+    int position = -1,
+  }) =>
+      Future.value([]);
+
+  @override
+  Future<Uint8List> fetchToMemory(
+    List<String> uris, {
+    Map<String, String>? options,
+    int maxBytes = 16 * 1024 * 1024,
+    Aria2Priority? priority,
+    bool rankMirrors = false,
+  }) =>
+      Future.value(Uint8List(0));
+
   @override
   Future<List<String>> getActiveDownload() => Future.value([]);
 
+  @override
+  Future<List<String>> getWaitingDownloads({int offset = 0, int limit = 100}) =>
+      Future.value([]);
+
+  @override
+  Future<List<String>> getStoppedDownloads({int offset = 0, int limit = 100}) =>
+      Future.value([]);
+
+  @override
+  Future<Aria2DownloadSummary> getDownloadSummary() =>
+      Future.value(Aria2DownloadSummary.fromMap({}));
+
   @override
   Future<int> removeDownload(String gid, {bool force = false}) =>
       Future.value(0);
@@ -81,6 +160,113 @@ class MockFlutterAria2Platform
   Future<int> changePosition(String gid, int pos, Aria2OffsetMode how) =>
       Future.value(0);
 
+  @override
+  Future<int> setDownloadPriority(String gid, Aria2Priority priority) =>
+      Future.value(0);
+
+  @override
+  Future<Aria2Priority> getDownloadPriority(String gid) =>
+      Future.value(Aria2Priority.normal);
+
+  @override
+  Future<int> reorderByPriority() => Future.value(0);
+
+  @override
+  Future<int> setQueuePolicy(Aria2QueuePolicy policy) => Future.value(0);
+
+  @override
+  Future<Aria2QueuePolicy> getQueuePolicy() =>
+      Future.value(Aria2QueuePolicy.fifo);
+
+  @override
+  Future<int> setDownloadDeadline(String gid, DateTime? deadline) =>
+      Future.value(0);
+
+  @override
+  Future<Map<String, dynamic>> setRetryPolicy(Aria2RetryPolicy policy) =>
+      Future.value({'enabled': policy.enabled});
+
+  @override
+  Future<Map<String, dynamic>> getRetryStats() => Future.value({});
+
+  @override
+  Future<Map<String, dynamic>> setRetentionPolicy(
+          Aria2RetentionPolicy policy) =>
+      Future.value({'maxCount': policy.maxCount ?? -1});
+
+  @override
+  Future<Map<String, dynamic>> getRetentionStats() => Future.value({});
+
+  @override
+  Future<List<Aria2HostStats>> getHostStats({bool clear = false}) =>
+      Future.value([]);
+
+  @override
+  Future<Map<String, dynamic>> openVirtualQueue(String dir,
+          {int lookahead = 2}) =>
+      Future.value({'open': true});
+
+  @override
+  Future<void> closeVirtualQueue() => Future.value();
+
+  @override
+  Future<int> addVirtualUris(
+    List<List<String>> entries, {
+    Map<String, String>? options,
+  }) =>
+      Future.value(0);
+
+  @override
+  Future<Aria2VirtualEntry> getVirtualEntry(int id) =>
+      Future.value(Aria2VirtualEntry.fromMap({'id': id}));
+
+  @override
+  Future<Map<String, dynamic>> getVirtualQueueStats() => Future.value({});
+
+  @override
+  Future<Map<String, dynamic>> openHistory(String dir) =>
+      Future.value({'open': true});
+
+  @override
+  Future<void> closeHistory() => Future.value();
+
+  @override
+  Future<List<Aria2HistoryRecord>> queryHistory({
+    Aria2HistoryFilter filter = const Aria2HistoryFilter(),
+    int offset = 0,
+    int limit = 100,
+  }) =>
+      Future.value([]);
+
+  @override
+  Future<Map<String, dynamic>> getHistoryStats() => Future.value({});
+
+  @override
+  Future<Map<String, dynamic>> openJournal(String dir, {bool restore = true}) =>
+      Future.value({'open': true, 'restoredGids': []});
+
+  @override
+  Future<void> closeJournal() => Future.value();
+
+  @override
+  Future<Map<String, dynamic>> checkpointJournal() => Future.value({});
+
+  @override
+  Future<Map<String, dynamic>> getJournalStats() => Future.value({});
+
+  @override
+  Future<Map<String, dynamic>> openResumeCache(String dir) =>
+      Future.value({'open': true});
+
+  @override
+  Future<void> closeResumeCache() => Future.value();
+
+  @override
+  Future<int> saveResumeState() => Future.value(0);
+
+  @override
+  Future<Map<String, dynamic>> getResumeCacheStats() => Future.value({});
+
   @override
   Future<int> changeOption(String gid, Map<String, String> options) =>
       Future.value(0);
@@ -106,6 +292,57 @@ class MockFlutterAria2Platform
         ),
       );
 
+  @override
+  Future<Aria2NativeMetrics> getNativeMetrics({bool clear = false}) =>
+      Future.value(Aria2NativeMetrics.fromMap({}));
+
+  @override
+  Future<Map<String, dynamic>> enableAdaptiveConcurrency(
+          Aria2ConcurrencyConfig config) =>
+      Future.value({'enabled': true});
+
+  @override
+  Future<void> disableAdaptiveConcurrency() => Future.value();
+
+  @override
+  Future<Aria2AutotuneResult> autotune({
+    required String dir,
+    required List<String> diskCache,
+    required List<String> fileAllocation,
+    required List<String> pieceLength,
+    required int workloadBytes,
+    required int fileCount,
+    required Duration runTimeout,
+  }) =>
+      Future.value(Aria2AutotuneResult.fromMap({}));
+
+  @override
+  Future<void> cancelAutotune() => Future.value();
+
+  @override
+  Future<Aria2CreatedTorrent> createTorrent({
+    required List<String> paths,
+    required String output,
+    int? pieceLength,
+    List<String> trackers = const [],
+    List<String> webseeds = const [],
+    String? comment,
+    bool isPrivate = false,
+    int threads = 0,
+  }) =>
+      Future.value(Aria2CreatedTorrent.fromMap({'path': output}));
+
+  @override
+  Future<void> cancelCreateTorrent() => Future.value();
+
+  @override
+  Future<Aria2CreateTorrentProgress> getCreateTorrentProgress() =>
+      Future.value(Aria2CreateTorrentProgress.fromMap({}));
+
+  @override
+  Stream<Uint8List> openProgressiveStream(String gid, {int fileIndex = 1}) =>
+      const Stream.empty();
+
   @override
   Future<int> shutdown({bool force = false}) => Future.value(0);
 
@@ -134,6 +371,78 @@ class MockFlutterAria2Platform
         mode: Aria2BtFileMode.none,
         name: '',
       ));
+
+  @override
+  Future<Aria2PieceBitfield> getPieceBitfield(String gid, {int? sinceSeq}) =>
+      Future.value(Aria2PieceBitfield.fromMap({}));
+
+  @override
+  Future<Aria2GroupProgress> getGroupProgress(String gid) =>
+      Future.value(Aria2GroupProgress.fromMap({'rootGid': gid}));
+
+  @override
+  Future<int> pauseGroup(String gid, {bool force = false}) => Future.value(0);
+
+  @override
+  Future<int> unpauseGroup(String gid) => Future.value(0);
+
+  @override
+  Future<int> removeGroup(String gid, {bool force = false}) => Future.value(0);
+
+  @override
+  Future<Map<String, dynamic>> setSpeedHistoryPolicy(
+          Aria2SpeedHistoryPolicy policy) =>
+      Future.value(policy.toMap());
+
+  @override
+  Future<Aria2SpeedHistory> getSpeedHistory(String gid) =>
+      Future.value(Aria2SpeedHistory.fromMap({'intervalMs': 1000}));
+
+  @override
+  Future<int> registerProgressTrigger(
+    String? gid, {
+    double? percentStep,
+    double? speedDeltaPct,
+    List<Duration>? etaBoundaries,
+    Duration minInterval = Duration.zero,
+  }) =>
+      Future.value(1);
+
+  @override
+  Future<bool> unregisterProgressTrigger(int id) => Future.value(true);
+
+  @override
+  Future<Aria2DownloadResult> awaitDownload(String gid, {Duration? timeout}) =>
+      Future.value(Aria2DownloadResult.fromMap({
+        'gid': gid,
+        'event': 4,
+        'info': {'gid': gid, 'status': 3},
+      }));
+
+  @override
+  Future<List<Aria2DownloadResult>> awaitAll(
+    List<String> gids, {
+    Duration? timeout,
+  }) =>
+      Future.wait(gids.map((gid) => awaitDownload(gid)));
+
+  @override
+  Future<void> setEventFilter(
+    Set<Aria2DownloadEvent> events, {
+    Set<String>? gids,
+    String name = 'default',
+  }) =>
+      Future.value();
+
+  @override
+  Future<bool> clearEventFilter({String name = 'default'}) =>
+      Future.value(true);
+
+  @override
+  Future<Map<String, Aria2MethodTiming>> getMethodTimings({
+    bool clear = false,
+  }) =>
+      Future.value(const {});
 }
 
 void main() {
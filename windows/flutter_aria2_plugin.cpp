@@ -1,5 +1,6 @@
 #include "flutter_aria2_plugin.h"
 #include "../common/aria2_helpers.h"
+#include "../common/aria2_methods.h"
 
 #include <windows.h>
 #include <VersionHelpers.h>
@@ -119,11 +120,66 @@ EV FileDataToEncodable(const aria2_file_data_t& f) {
   return EV(m);
 }
 
-}  // anonymous namespace
+// ────── common::Value <-> EncodableValue ──────
+
+EV ToEncodable(const common::Value& v) {
+  using Type = common::Value::Type;
+  switch (v.type()) {
+    case Type::kNull:   return EV();
+    case Type::kBool:   return EV(v.AsBool());
+    case Type::kInt:    return EV(v.AsInt());
+    case Type::kDouble: return EV(v.AsDouble());
+    case Type::kString: return EV(v.AsString());
+    case Type::kBytes:  return EV(v.AsBytes());
+    case Type::kList: {
+      EList list;
+      list.reserve(v.AsList().size());
+      for (const auto& item : v.AsList()) {
+        list.push_back(ToEncodable(item));
+      }
+      return EV(list);
+    }
+    case Type::kMap: {
+      EMap map;
+      for (const auto& entry : v.AsMap()) {
+        map[EV(entry.first)] = ToEncodable(entry.second);
+      }
+      return EV(map);
+    }
+  }
+  return EV();
+}
 
-// ──────────────────────── Static members ────────────────────────
+common::Value FromEncodable(const EV* v) {
+  if (v == nullptr) return common::Value();
+  if (auto* b = std::get_if<bool>(v)) return common::Value(*b);
+  if (auto* i = std::get_if<int32_t>(v)) return common::Value(*i);
+  if (auto* i = std::get_if<int64_t>(v)) return common::Value(*i);
+  if (auto* d = std::get_if<double>(v)) return common::Value(*d);
+  if (auto* s = std::get_if<std::string>(v)) return common::Value(*s);
+  if (auto* bytes = std::get_if<std::vector<uint8_t>>(v)) {
+    return common::Value(*bytes);
+  }
+  if (auto* list = std::get_if<EList>(v)) {
+    common::Value out = common::Value::NewList();
+    for (const auto& item : *list) {
+      out.Append(FromEncodable(&item));
+    }
+    return out;
+  }
+  if (auto* map = std::get_if<EMap>(v)) {
+    common::Value out = common::Value::NewMap();
+    for (const auto& pair : *map) {
+      if (auto* key = std::get_if<std::string>(&pair.first)) {
+        out.Set(*key, FromEncodable(&pair.second));
+      }
+    }
+    return out;
+  }
+  return common::Value();
+}
 
-FlutterAria2Plugin* FlutterAria2Plugin::instance_ = nullptr;
+}  // anonymous namespace
 
 // ──────────────────────── Registration ────────────────────────
 
@@ -141,19 +197,18 @@ void FlutterAria2Plugin::RegisterWithRegistrar(
         plugin_pointer->HandleMethodCall(call, std::move(result));
       });
 
-  instance_ = plugin.get();
   registrar->AddPlugin(std::move(plugin));
 }
 
 // ──────────────────────── Ctor / Dtor ────────────────────────
 
-FlutterAria2Plugin::FlutterAria2Plugin() {}
+FlutterAria2Plugin::FlutterAria2Plugin() {
+  core_.event_sink = &FlutterAria2Plugin::EmitNativeEvent;
+  core_.event_sink_user_data = this;
+}
 
 FlutterAria2Plugin::~FlutterAria2Plugin() {
   flutter_aria2::core::CleanupState(&core_);
-  if (instance_ == this) {
-    instance_ = nullptr;
-  }
 }
 
 void FlutterAria2Plugin::StopRunLoop() {
@@ -166,20 +221,15 @@ void FlutterAria2Plugin::WaitForPendingRun() {
 
 // ──────────────────────── Event callback ────────────────────────
 
-int FlutterAria2Plugin::DownloadEventCallback(
-    aria2_session_t* /*session*/,
-    aria2_download_event_t event,
-    aria2_gid_t gid,
-    void* /*user_data*/) {
-  if (instance_ && instance_->channel_) {
-    EMap data;
-    data[EV("event")] = EV(static_cast<int32_t>(event));
-    data[EV("gid")] = EV(flutter_aria2::common::GidToHex(gid));
-    instance_->channel_->InvokeMethod(
-        "onDownloadEvent",
-        std::make_unique<EV>(data));
-  }
-  return 0;  // 0 = continue
+void FlutterAria2Plugin::EmitNativeEvent(const char* method,
+                                         common::Value&& payload,
+                                         void* user_data) {
+  auto* plugin = static_cast<FlutterAria2Plugin*>(user_data);
+  if (plugin && plugin->channel_) {
+    plugin->channel_->InvokeMethod(
+        method,
+        std::make_unique<EV>(ToEncodable(payload)));
+  }
 }
 
 // ──────────────────────── Method dispatch ────────────────────────
@@ -241,8 +291,7 @@ void FlutterAria2Plugin::HandleMethodCall(
     bool keep_running = MapGetBool(a, "keepRunning", true);
 
     const char* error = flutter_aria2::core::SessionNew(
-        &core_, options.data(), options.count(), keep_running,
-        &FlutterAria2Plugin::DownloadEventCallback, this);
+        &core_, options.data(), options.count(), keep_running);
     if (error != nullptr) {
       result->Error("SESSION_FAILED", "aria2_session_new returned null");
       return;
@@ -288,6 +337,7 @@ void FlutterAria2Plugin::HandleMethodCall(
       int ret = 0;
       try {
         ret = aria2_run(session, ARIA2_RUN_ONCE);
+        flutter_aria2::core::Tick(&core_);
       } catch (...) {
         ret = -1;
       }
@@ -341,143 +391,6 @@ void FlutterAria2Plugin::HandleMethodCall(
     return;
   }
 
-  // ════════════════════════════════════════════════════════════════
-  //  Add URI
-  // ════════════════════════════════════════════════════════════════
-
-  if (method == "addUri") {
-    if (const char* err = flutter_aria2::core::RequireSession(&core_)) {
-      result->Error(err, "No active session");
-      return;
-    }
-    const auto& a = std::get<EMap>(*args);
-
-    // Parse URI list
-    auto* uris_ev = MapGet(a, "uris");
-    if (!uris_ev) {
-      result->Error("BAD_ARGS", "Missing 'uris'");
-      return;
-    }
-    const auto& uris_list = std::get<EList>(*uris_ev);
-    std::vector<std::string> uri_strs;
-    std::vector<const char*> uri_ptrs;
-    uri_strs.reserve(uris_list.size());
-    for (const auto& u : uris_list) {
-      uri_strs.push_back(std::get<std::string>(u));
-    }
-    uri_ptrs.reserve(uri_strs.size());
-    for (const auto& s : uri_strs) {
-      uri_ptrs.push_back(s.c_str());
-    }
-
-    auto options  = OptionsFromMap(a, "options");
-    int  position = MapGetInt(a, "position", -1);
-
-    aria2_gid_t gid;
-    int ret = aria2_add_uri(session_, &gid,
-                            uri_ptrs.data(), uri_ptrs.size(),
-                            options.data(), options.count(),
-                            position);
-    if (ret == 0) {
-      result->Success(EV(flutter_aria2::common::GidToHex(gid)));
-    } else {
-      result->Error("ARIA2_ERROR",
-                    "aria2_add_uri failed with code " + std::to_string(ret));
-    }
-    return;
-  }
-
-  // ════════════════════════════════════════════════════════════════
-  //  Add Torrent
-  // ════════════════════════════════════════════════════════════════
-
-  if (method == "addTorrent") {
-    if (const char* err = flutter_aria2::core::RequireSession(&core_)) {
-      result->Error(err, "No active session");
-      return;
-    }
-    const auto& a = std::get<EMap>(*args);
-    std::string torrent_file = MapGetString(a, "torrentFile");
-
-    // Webseed URIs (optional)
-    std::vector<std::string> ws_strs;
-    std::vector<const char*> ws_ptrs;
-    if (auto* ws_ev = MapGet(a, "webseedUris")) {
-      const auto& ws_list = std::get<EList>(*ws_ev);
-      ws_strs.reserve(ws_list.size());
-      for (const auto& u : ws_list) {
-        ws_strs.push_back(std::get<std::string>(u));
-      }
-      ws_ptrs.reserve(ws_strs.size());
-      for (const auto& s : ws_strs) {
-        ws_ptrs.push_back(s.c_str());
-      }
-    }
-
-    auto options  = OptionsFromMap(a, "options");
-    int  position = MapGetInt(a, "position", -1);
-
-    aria2_gid_t gid;
-    int ret;
-    if (ws_ptrs.empty()) {
-      ret = aria2_add_torrent_simple(session_, &gid,
-                                     torrent_file.c_str(),
-                                     options.data(), options.count(),
-                                     position);
-    } else {
-      ret = aria2_add_torrent(session_, &gid,
-                              torrent_file.c_str(),
-                              ws_ptrs.data(), ws_ptrs.size(),
-                              options.data(), options.count(),
-                              position);
-    }
-
-    if (ret == 0) {
-      result->Success(EV(flutter_aria2::common::GidToHex(gid)));
-    } else {
-      result->Error("ARIA2_ERROR",
-                    "aria2_add_torrent failed with code " +
-                        std::to_string(ret));
-    }
-    return;
-  }
-
-  // ════════════════════════════════════════════════════════════════
-  //  Add Metalink
-  // ════════════════════════════════════════════════════════════════
-
-  if (method == "addMetalink") {
-    if (const char* err = flutter_aria2::core::RequireSession(&core_)) {
-      result->Error(err, "No active session");
-      return;
-    }
-    const auto& a = std::get<EMap>(*args);
-    std::string metalink_file = MapGetString(a, "metalinkFile");
-    auto options  = OptionsFromMap(a, "options");
-    int  position = MapGetInt(a, "position", -1);
-
-    aria2_gid_t* gids = nullptr;
-    size_t gids_count = 0;
-    int ret = aria2_add_metalink(session_, &gids, &gids_count,
-                                 metalink_file.c_str(),
-                                 options.data(), options.count(),
-                                 position);
-    if (ret == 0) {
-      EList gid_list;
-      for (size_t i = 0; i < gids_count; ++i) {
-        gid_list.push_back(EV(flutter_aria2::common::GidToHex(gids[i])));
-      }
-      if (gids) aria2_free(gids);
-      result->Success(EV(gid_list));
-    } else {
-      if (gids) aria2_free(gids);
-      result->Error("ARIA2_ERROR",
-                    "aria2_add_metalink failed with code " +
-                        std::to_string(ret));
-    }
-    return;
-  }
-
   // ════════════════════════════════════════════════════════════════
   //  Get active downloads
   // ════════════════════════════════════════════════════════════════
@@ -571,25 +484,6 @@ void FlutterAria2Plugin::HandleMethodCall(
     return;
   }
 
-  // ════════════════════════════════════════════════════════════════
-  //  Per-download options
-  // ════════════════════════════════════════════════════════════════
-
-  if (method == "changeOption") {
-    if (const char* err = flutter_aria2::core::RequireSession(&core_)) {
-      result->Error(err, "No active session");
-      return;
-    }
-    const auto& a = std::get<EMap>(*args);
-    std::string hex = MapGetString(a, "gid");
-    auto options = OptionsFromMap(a, "options");
-    aria2_gid_t gid = aria2_hex_to_gid(hex.c_str());
-    int ret = aria2_change_option(session_, gid,
-                                  options.data(), options.count());
-    result->Success(EV(ret));
-    return;
-  }
-
   // ════════════════════════════════════════════════════════════════
   //  Global options
   // ════════════════════════════════════════════════════════════════
@@ -700,6 +594,13 @@ void FlutterAria2Plugin::HandleMethodCall(
     m[EV("downloadSpeed")]   = EV(aria2_download_handle_get_download_speed(dh));
     m[EV("uploadSpeed")]     = EV(aria2_download_handle_get_upload_speed(dh));
 
+    const flutter_aria2::core::SpeedEstimate estimate = core_.speeds.Estimate(
+        gid, aria2_download_handle_get_total_length(dh),
+        aria2_download_handle_get_completed_length(dh),
+        aria2_download_handle_get_download_speed(dh));
+    m[EV("avgSpeed")] = EV(estimate.avg_speed);
+    m[EV("eta")]      = EV(estimate.eta_seconds);
+
     // Info hash → hex string
     aria2_binary_t ih = aria2_download_handle_get_info_hash(dh);
     if (ih.data && ih.length > 0) {
@@ -905,10 +806,20 @@ void FlutterAria2Plugin::HandleMethodCall(
   }
 
   // ════════════════════════════════════════════════════════════════
-  //  Not implemented
+  //  Shared methods (common/), otherwise not implemented
   // ════════════════════════════════════════════════════════════════
 
-  result->NotImplemented();
+  common::Value value;
+  std::string message;
+  const char* error = flutter_aria2::core::InvokeMethod(
+      &core_, method, FromEncodable(args), &value, &message);
+  if (error == nullptr) {
+    result->Success(ToEncodable(value));
+  } else if (std::strcmp(error, flutter_aria2::core::kNotImplemented) == 0) {
+    result->NotImplemented();
+  } else {
+    result->Error(error, message);
+  }
 }
 
 }  // namespace flutter_aria2
@@ -10,6 +10,7 @@
 
 #include <aria2_c_api.h>
 #include "../common/aria2_core.h"
+#include "../common/aria2_value.h"
 
 namespace flutter_aria2 {
 
@@ -47,14 +48,10 @@ class FlutterAria2Plugin : public flutter::Plugin {
   // Method channel for sending events back to Dart.
   std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>> channel_;
 
-  // Singleton instance pointer (used by the event callback).
-  static FlutterAria2Plugin* instance_;
-
-  // aria2 download event callback (C-compatible static function).
-  static int DownloadEventCallback(aria2_session_t* session,
-                                   aria2_download_event_t event,
-                                   aria2_gid_t gid,
-                                   void* user_data);
+  // Native event sink installed on core_ (C-compatible static function).
+  static void EmitNativeEvent(const char* method,
+                              common::Value&& payload,
+                              void* user_data);
 };
 
 }  // namespace flutter_aria2